@@ -0,0 +1,422 @@
+/* CirKit: A circuit toolkit
+ * Copyright (C) 2017-2019  EPFL
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <alice/alice.hpp>
+#include <alice/detail/utils.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <fmt/format.h>
+#include <kitty/constructors.hpp>
+#include <kitty/dynamic_truth_table.hpp>
+#include <kitty/hash.hpp>
+#include <mockturtle/algorithms/simulation.hpp>
+#include <mockturtle/utils/stopwatch.hpp>
+#include <mockturtle/views/depth_view.hpp>
+#include <mockturtle/views/mapping_view.hpp>
+
+#include "../utils/cancellation.hpp"
+#include "../utils/cirkit_command.hpp"
+#include "../utils/thread_pool.hpp"
+
+namespace alice
+{
+
+/* Beam search over optimization scripts.  A script is a sequence of moves,
+   which are command lines such as `resub --max_pis 8`.  In each round, every
+   move is applied to every script in the beam; the resulting candidates are
+   evaluated concurrently, each on a copy of the network in an environment of
+   its own, and the `beam` best candidates (by cost, then runtime) form the
+   next beam. */
+class autotune_command : public cirkit::cirkit_command<autotune_command, aig_t, mig_t, xag_t, xmg_t, klut_t>
+{
+public:
+  autotune_command( environment::ptr& env ) : cirkit::cirkit_command<autotune_command, aig_t, mig_t, xag_t, xmg_t, klut_t>( env, "Searches optimization scripts", "tune script for {0}" )
+  {
+    add_option( "--moves", moves_line, "semicolon-separated commands or aliases to combine (default depends on network type)" );
+    add_option( "--length", length, "maximum number of moves in a script", true );
+    add_option( "--beam", beam_width, "number of scripts kept in each round", true );
+    add_option( "--cost", cost, "cost function", true )->set_type_name( "cost in {size, depth, luts}" );
+    add_option( "--lutsize", lut_size, "LUT size for cost function luts", true );
+    add_option( "--threads", num_threads, "number of candidates that are evaluated concurrently", true );
+    add_option( "--alias", alias_name, "name of the alias for the best script", true );
+    add_option( "--report", report_filename, "write JSON report of cost vs. time of all candidates" );
+    add_flag( "--apply", "replace network by the best one" );
+    add_flag( "-v,--verbose", "print best script of each round" );
+  }
+
+  rules validity_rules() const override
+  {
+    auto r = cirkit::cirkit_command<autotune_command, aig_t, mig_t, xag_t, xmg_t, klut_t>::validity_rules();
+    r.push_back( {[this]() { return cost == "size" || cost == "depth" || cost == "luts"; }, "unknown cost function"} );
+    r.push_back( {[this]() { return length > 0u && beam_width > 0u; }, "length and beam width must be positive"} );
+    r.push_back( {[this]() { return env->spawn() != nullptr; }, "shell cannot create environments for candidates"} );
+    return r;
+  }
+
+  template<class Store>
+  inline void execute_store()
+  {
+    using network_type = typename Store::element_type;
+
+    moves.clear();
+    for ( auto const& line : moves_line.empty() ? default_moves<Store>() : alice::detail::split_with_quotes<';'>( moves_line ) )
+    {
+      const auto move = alice::detail::trim_copy( line );
+      if ( !move.empty() )
+      {
+        /* spawned environments do not know the aliases of the shell */
+        moves.push_back( cirkit::expand_alias( *env, move ) );
+      }
+    }
+    candidates.clear();
+
+    if ( !pool || pool->num_threads() != num_threads )
+    {
+      pool = std::make_shared<cirkit::thread_pool>( num_threads );
+    }
+
+    /* one environment per thread, their output is discarded */
+    std::vector<environment::ptr> envs( num_threads );
+    std::vector<std::ostringstream> outs( num_threads );
+    for ( auto i = 0u; i < num_threads; ++i )
+    {
+      envs[i] = env->spawn();
+      envs[i]->reroute( outs[i], outs[i] );
+      envs[i]->template store<Store>().extend();
+      envs[i]->set_default_option( store_info<Store>::option );
+    }
+
+    time_total = {};
+    mockturtle::stopwatch t( time_total );
+
+    std::vector<state<network_type>> beam( 1u );
+    beam[0].network = copy_network( *store<Store>().current() );
+    evaluate( *envs[0], beam[0] );
+    initial_cost = beam[0].cost;
+    auto best = beam[0];
+
+    for ( auto round = 0u; round < length && !cirkit::is_cancelled(); ++round )
+    {
+      std::vector<state<network_type>> children( beam.size() * moves.size() );
+      pool->parallel_for( 0u, static_cast<uint32_t>( children.size() ), [&]( uint32_t i, uint32_t tid ) {
+        if ( cirkit::is_cancelled() )
+        {
+          return;
+        }
+
+        outs[tid].str( {} );
+        auto const& parent = beam[i / moves.size()];
+        auto& child = children[i];
+        child.moves = parent.moves;
+        child.moves.push_back( static_cast<uint32_t>( i % moves.size() ) );
+        child.network = copy_network( *parent.network );
+        child.time = parent.time;
+        child.valid = run( *envs[tid], child, moves[child.moves.back()] ) && evaluate( *envs[tid], child );
+      } );
+
+      children.erase( std::remove_if( children.begin(), children.end(), []( auto const& c ) { return !c.valid; } ), children.end() );
+      if ( children.empty() )
+      {
+        break;
+      }
+
+      for ( auto const& c : children )
+      {
+        candidates.push_back( {script( c ), c.cost, c.time} );
+      }
+
+      /* best first; of candidates with equal cost and signature only the
+         fastest one is kept, to keep the beam diverse */
+      std::stable_sort( children.begin(), children.end(), []( auto const& a, auto const& b ) {
+        return a.cost < b.cost || ( a.cost == b.cost && a.time < b.time );
+      } );
+      beam.clear();
+      for ( auto& c : children )
+      {
+        if ( beam.size() == beam_width )
+        {
+          break;
+        }
+        if ( std::any_of( beam.begin(), beam.end(), [&]( auto const& b ) { return b.cost == c.cost && b.signature == c.signature; } ) )
+        {
+          continue;
+        }
+        beam.push_back( std::move( c ) );
+      }
+
+      if ( beam.front().cost < best.cost )
+      {
+        best = beam.front();
+      }
+      if ( is_set( "verbose" ) )
+      {
+        env->out() << fmt::format( "[i] round {:>2}: cost = {:>8} {:>7.2f} secs   {}\n", round + 1u, beam.front().cost, beam.front().time, script( beam.front() ) );
+      }
+    }
+
+    best_script = script( best );
+    best_cost = best.cost;
+    best_time = best.time;
+
+    if ( !best.moves.empty() )
+    {
+      env->execute( fmt::format( "alias {} \"{}\"", alias_name, best_script ) );
+      env->out() << fmt::format( "[i] best script: cost = {} -> {} in {:.2f} secs, saved as alias {}\n", initial_cost, best_cost, best_time, alias_name );
+      env->out() << fmt::format( "[i] {}\n", best_script );
+      if ( is_set( "apply" ) )
+      {
+        store<Store>().current() = best.network;
+      }
+    }
+    else
+    {
+      env->out() << "[i] no script improves the network\n";
+    }
+
+    if ( !report_filename.empty() )
+    {
+      std::ofstream os( report_filename );
+      os << std::setw( 2 ) << report() << "\n";
+    }
+  }
+
+  nlohmann::json log() const override
+  {
+    return {
+      {"time_total", mockturtle::to_seconds( time_total )},
+      {"cost", cost},
+      {"initial_cost", initial_cost},
+      {"best_cost", best_cost},
+      {"best_time", best_time},
+      {"best_script", best_script},
+      {"candidates", candidates.size()},
+      {"threads", num_threads}
+    };
+  }
+
+private:
+  template<class Ntk>
+  struct state
+  {
+    std::vector<uint32_t> moves;
+    std::shared_ptr<Ntk> network;
+    double cost{0.0};
+    double time{0.0};
+    uint64_t signature{0u};
+    bool valid{false};
+  };
+
+  /* random simulation with the same patterns for all candidates */
+  struct signature_simulator
+  {
+    kitty::dynamic_truth_table compute_constant( bool value ) const
+    {
+      kitty::dynamic_truth_table tt( num_signature_vars );
+      return value ? ~tt : tt;
+    }
+
+    kitty::dynamic_truth_table compute_pi( uint32_t index ) const
+    {
+      kitty::dynamic_truth_table tt( num_signature_vars );
+      kitty::create_random( tt, index );
+      return tt;
+    }
+
+    kitty::dynamic_truth_table compute_not( kitty::dynamic_truth_table const& value ) const
+    {
+      return ~value;
+    }
+  };
+
+  struct candidate
+  {
+    std::string script;
+    double cost;
+    double time;
+  };
+
+  /* deep copy with fresh network and mapping storages (network copies
+     share them otherwise), names are kept */
+  template<class NamedNtk, bool StoreFunction>
+  static std::shared_ptr<mockturtle::mapping_view<NamedNtk, StoreFunction>> copy_network( mockturtle::mapping_view<NamedNtk, StoreFunction> const& ntk )
+  {
+    NamedNtk named_ntk = ntk;
+    named_ntk._storage = std::make_shared<typename NamedNtk::storage::element_type>( *named_ntk._storage );
+    return std::make_shared<mockturtle::mapping_view<NamedNtk, StoreFunction>>( named_ntk );
+  }
+
+  template<class Store>
+  static std::vector<std::string> default_moves()
+  {
+    if constexpr ( std::is_same_v<Store, klut_t> )
+    {
+      /* remapping merges LUTs; for other network types, LUT mapping would
+         replace the network by a LUT network and is no move */
+      return {"resub --max_pis 8", "resub --max_pis 10", "resub --max_pis 12 --lut_size 4",
+              "lut_mapping -k 4; collapse_mapping", "lut_mapping -k 5; collapse_mapping", "lut_mapping -k 6; collapse_mapping"};
+    }
+    else
+    {
+      std::vector<std::string> moves{"cut_rewrite --strategy=0 -k 4 --lutcount 25 --multiple",
+                                     "cut_rewrite --strategy=0 -k 4 --lutcount 25 --multiple -z",
+                                     "resub --max_pis 6", "resub --max_pis 8 --depth 2", "resub --max_pis 10", "resub --max_pis 12 --depth 2"};
+      if constexpr ( std::is_same_v<Store, mig_t> || std::is_same_v<Store, xmg_t> )
+      {
+        moves.insert( moves.end(), {"refactor --strategy=1", "refactor --strategy=1 -z"} );
+      }
+      if constexpr ( std::is_same_v<Store, mig_t> )
+      {
+        moves.push_back( "mighty --area_aware" );
+      }
+      return moves;
+    }
+  }
+
+  /* applies a move to the network of a state in a worker environment */
+  template<class Ntk>
+  bool run( environment& wenv, state<Ntk>& s, std::string const& move ) const
+  {
+    using store_t = std::shared_ptr<Ntk>;
+
+    wenv.store<store_t>().current() = s.network;
+    mockturtle::stopwatch<>::duration time{0};
+    bool success{false};
+    {
+      mockturtle::stopwatch t( time );
+      success = wenv.execute( move );
+    }
+    s.network = wenv.store<store_t>().current();
+    s.time += mockturtle::to_seconds( time );
+    return success && !cirkit::is_cancelled();
+  }
+
+  template<class Ntk>
+  bool evaluate( environment& wenv, state<Ntk>& s ) const
+  {
+    using store_t = std::shared_ptr<Ntk>;
+
+    mockturtle::depth_view<Ntk> depth_ntk{*s.network};
+    if ( cost == "depth" )
+    {
+      s.cost = depth_ntk.depth();
+    }
+    else if ( cost == "luts" )
+    {
+      /* the mapping is removed after counting, later moves would
+         invalidate it */
+      wenv.store<store_t>().current() = s.network;
+      if ( !wenv.execute( fmt::format( "lut_mapping -k {} --nofun", lut_size ) ) )
+      {
+        return false;
+      }
+      auto const& mapped = wenv.store<store_t>().current();
+      s.cost = mapped->num_cells();
+      mapped->clear_mapping();
+    }
+    else
+    {
+      s.cost = s.network->num_gates();
+    }
+    s.signature = signature( *s.network, depth_ntk.depth() );
+    return true;
+  }
+
+  /* structural hash of a network; all candidates compute the same output
+     functions, therefore the signature combines the simulation values of
+     all gates, independent of their order, with size and depth */
+  template<class Ntk>
+  static uint64_t signature( Ntk const& ntk, uint32_t depth )
+  {
+    const auto values = mockturtle::simulate_nodes<kitty::dynamic_truth_table>( ntk, signature_simulator{} );
+    uint64_t result{0u};
+    ntk.foreach_gate( [&]( auto const& n ) {
+      result += kitty::hash<kitty::dynamic_truth_table>()( values[n] ) * 0x9e3779b97f4a7c15;
+    } );
+    return result ^ ( static_cast<uint64_t>( ntk.num_gates() ) << 32 ) ^ depth;
+  }
+
+  template<class State>
+  std::string script( State const& s ) const
+  {
+    std::string result;
+    for ( auto m : s.moves )
+    {
+      result += ( result.empty() ? "" : "; " ) + moves[m];
+    }
+    if ( cost == "luts" && !s.moves.empty() )
+    {
+      result += fmt::format( "; lut_mapping -k {}", lut_size );
+    }
+    return result;
+  }
+
+  nlohmann::json report() const
+  {
+    nlohmann::json js_candidates = nlohmann::json::array();
+    for ( auto const& c : candidates )
+    {
+      js_candidates.push_back( {{"script", c.script}, {"cost", c.cost}, {"time", c.time}} );
+    }
+    return {
+      {"cost", cost},
+      {"initial_cost", initial_cost},
+      {"best", {{"script", best_script}, {"cost", best_cost}, {"time", best_time}}},
+      {"candidates", js_candidates}
+    };
+  }
+
+private:
+  std::string moves_line;
+  uint32_t length{6u};
+  uint32_t beam_width{4u};
+  std::string cost{"size"};
+  uint32_t lut_size{6u};
+  uint32_t num_threads{1u};
+  std::string alias_name{"autotuned"};
+  std::string report_filename;
+  std::shared_ptr<cirkit::thread_pool> pool;
+
+  std::vector<std::string> moves;
+  std::vector<candidate> candidates;
+  double initial_cost{0.0};
+  double best_cost{0.0};
+  double best_time{0.0};
+  std::string best_script;
+  mockturtle::stopwatch<>::duration time_total{0};
+
+  static constexpr uint32_t num_signature_vars = 8u;
+};
+
+ALICE_ADD_COMMAND( autotune, "Synthesis" )
+
+} // namespace alice
@@ -0,0 +1,93 @@
+/* CirKit: A circuit toolkit
+ * Copyright (C) 2017-2019  EPFL
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <alice/alice.hpp>
+
+#include <mockturtle/networks/aig.hpp>
+#include <mockturtle/networks/xag.hpp>
+#include <mockturtle/networks/xmg.hpp>
+
+#include "../utils/balancing.hpp"
+#include "../utils/cirkit_command.hpp"
+
+namespace alice
+{
+
+class balance_command : public cirkit::cirkit_command<balance_command, aig_t, xag_t, xmg_t>
+{
+public:
+  balance_command( environment::ptr& env ) : cirkit::cirkit_command<balance_command, aig_t, xag_t, xmg_t>( env, "Balances AND and XOR supergates", "balances {0}" )
+  {
+    add_flag( "--area_aware", ps.area_aware, "do not increase area" );
+    add_option( "--max_leaves", ps.max_leaves, "maximum number of supergate leaves through nodes with multiple fanouts", true );
+    add_flag( "--sop", ps.sop_balancing, "rebuild small cuts from their SOPs" );
+    add_option( "--cut_size", ps.cut_size, "maximum cut size for SOP balancing", true );
+    add_flag( "-v,--verbose", ps.verbose, "show statistics" );
+  }
+
+  rules validity_rules() const override
+  {
+    auto r = cirkit::cirkit_command<balance_command, aig_t, xag_t, xmg_t>::validity_rules();
+    r.push_back( {[this]() { return ps.cut_size >= 2u && ps.cut_size <= 10u; }, "cut size must be between 2 and 10"} );
+    r.push_back( {[this]() { return ps.max_leaves >= 2u; }, "maximum number of leaves must be at least 2"} );
+    return r;
+  }
+
+  template<class Store>
+  inline void execute_store()
+  {
+    if constexpr ( std::is_same_v<Store, aig_t> )
+    {
+      cirkit::balancing( *static_cast<mockturtle::aig_network*>( store<Store>().current().get() ), ps, &st );
+    }
+    else if constexpr ( std::is_same_v<Store, xag_t> )
+    {
+      cirkit::balancing( *static_cast<mockturtle::xag_network*>( store<Store>().current().get() ), ps, &st );
+    }
+    else if constexpr ( std::is_same_v<Store, xmg_t> )
+    {
+      cirkit::balancing( *static_cast<mockturtle::xmg_network*>( store<Store>().current().get() ), ps, &st );
+    }
+  }
+
+  nlohmann::json log() const override
+  {
+    return {
+      {"time_total", mockturtle::to_seconds( st.time_total )},
+      {"supergates", st.num_supergates},
+      {"sop_cuts", st.num_sop_cuts},
+      {"depth_before", st.depth_before},
+      {"depth_after", st.depth_after}
+    };
+  }
+
+private:
+  cirkit::balancing_params ps;
+  cirkit::balancing_stats st;
+};
+
+ALICE_ADD_COMMAND( balance, "Synthesis" )
+
+} // namespace alice
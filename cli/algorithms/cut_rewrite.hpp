@@ -25,7 +25,13 @@
 
 #include <alice/alice.hpp>
 
-#include <mockturtle/algorithms/cleanup.hpp>
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <fmt/format.h>
 #include <mockturtle/algorithms/cut_rewriting.hpp>
 #include <mockturtle/algorithms/gates_to_nodes.hpp>
 #include <mockturtle/algorithms/node_resynthesis.hpp>
@@ -37,6 +43,12 @@
 #include <mockturtle/algorithms/node_resynthesis/xmg_npn.hpp>
 
 #include "../utils/cirkit_command.hpp"
+#include "../utils/compaction.hpp"
+#include "../utils/cut_arena.hpp"
+#include "../utils/network_cost.hpp"
+#include "../utils/npn_database.hpp"
+#include "../utils/parallel_cut_rewriting.hpp"
+#include "../utils/thread_pool.hpp"
 
 namespace alice
 {
@@ -50,7 +62,9 @@ public:
 
     add_option( "-k,--lutsize", ps.cut_enumeration_ps.cut_size, "cut size", true );
     add_option( "--lutcount", ps.cut_enumeration_ps.cut_limit, "cut limit", true );
-    add_option( "--strategy", strategy, "resynthesis strategy", true )->set_type_name( "strategy in {db=0, exact=1, akers=2}" );
+    add_option( "--strategy", strategy, "resynthesis strategy", true )->set_type_name( "strategy in {db=0, exact=1, akers=2, db6=3}" );
+    add_option( "--db", db_filename, "NPN database for 5- and 6-input cuts (strategy 3)" );
+    add_option( "--cost", cost, "cost function", true )->set_type_name( "cost in {size, depth, size_depth, mc}" );
     add_flag( "-z,--zero_gain", ps.allow_zero_gain, "enable zero-gain rewriting" );
     add_flag( "--multiple", "try multiple candidates if possible" );
     add_flag( "--greedy", "use Greedy candidate selection" );
@@ -59,20 +73,57 @@ public:
     add_option( "--exact_lutsize", exact_lutsize, "LUT size for exact resynthesis", true );
     add_option( "--conflict_limit", conflict_limit, "conflict limit for exact resynthesis", true );
     add_option( "-i,--iterations", num_iterations, "number of iterations to repeat {0=infty}", true );
+    add_option( "--threads", num_threads, "number of threads for cut enumeration and evaluation", true );
+    add_option( "--frontier_depth", frontier_depth, "fanout depth revisited after changes with -i 0 and --threads (0 for cut size)", true );
+    add_option( "--cut_memory", cut_memory, "memory limit for cut sets in MB (0 for no limit)", true );
     add_flag( "-p,--progress", ps.progress, "show progress" );
     add_flag( "-v,--verbose", ps.verbose, "show statistics" );
   }
 
+  rules validity_rules() const override
+  {
+    auto r = cirkit::cirkit_command<cut_rewrite_command, aig_t, mig_t, xmg_t, xag_t, klut_t>::validity_rules();
+    r.push_back( {[this]() { return cirkit::cost_function_from_string( cost ).has_value(); }, "unknown cost function"} );
+    r.push_back( {[this]() { return strategy != 3u || is_set( "db" ) || npn_db; }, "no NPN database loaded"} );
+    return r;
+  }
+
   template<class Store>
   inline void execute_store()
   {
     bool done = true;
+    st = {};
+    pst = {};
+    executed = false;
+    failed = false;
+    if ( is_set( "clear_cache" ) )
+    {
+      thread_caches.clear();
+    }
     ps.candidate_selection_strategy = is_set( "greedy" ) ? mockturtle::cut_rewriting_params::greedy : mockturtle::cut_rewriting_params::minimize_weight;
     ps.use_dont_cares = is_set( "dont_cares" );
 
+    /* the database stays mapped until another file is given */
+    if ( is_set( "db" ) && ( !npn_db || npn_db->path() != db_filename ) )
+    {
+      npn_db = cirkit::npn_database::open( db_filename );
+      if ( !npn_db )
+      {
+        env->err() << fmt::format( "[e] cannot read NPN database {}\n", db_filename );
+        return;
+      }
+    }
+
+    cost_kind = *cirkit::cost_function_from_string( cost );
+    if ( cost_kind == cirkit::cost_function::mc && !std::is_same_v<Store, aig_t> && !std::is_same_v<Store, xag_t> )
+    {
+      env->err() << "[e] cost function mc is only supported for AIGs and XAGs\n";
+      return;
+    }
+
     /* cost function */
-    auto const cost_fn = []( const auto& ntk ){
-      return ntk->num_gates();
+    auto const cost_fn = [this]( const auto& ntk ){
+      return network_cost( *ntk );
     };
 
     /* cost comparison function: repeated until evaluates to true  */
@@ -82,6 +133,7 @@ public:
 
     auto curr_cost = cost_fn( store<Store>().current().get() );
     iterations_counter = 0u;
+    fixpoint = false;
     do
     {
       ++iterations_counter;
@@ -94,30 +146,23 @@ public:
         if constexpr ( std::is_same_v<Store, aig_t> )
         {
           auto* aig_p = static_cast<mockturtle::aig_network*>( store<Store>().current().get() );
-          mockturtle::xag_npn_resynthesis<mockturtle::aig_network> resyn;
-          mockturtle::cut_rewriting( *aig_p, resyn, ps, &st );
-          *aig_p = cleanup_dangling( *aig_p );
+          rewrite( *aig_p, []() { return mockturtle::xag_npn_resynthesis<mockturtle::aig_network>(); } );
         }
         else if constexpr (std::is_same_v<Store, xag_t> )
         {
           auto* xag_p = static_cast<mockturtle::xag_network*>( store<Store>().current().get() );
-          mockturtle::xag_npn_resynthesis<mockturtle::xag_network> resyn;
-          mockturtle::cut_rewriting( *xag_p, resyn, ps, &st );
-          *xag_p = cleanup_dangling( *xag_p );
+          rewrite( *xag_p, []() { return mockturtle::xag_npn_resynthesis<mockturtle::xag_network>(); } );
         }
         else if constexpr ( std::is_same_v<Store, mig_t> )
         {
           auto* mig_p = static_cast<mockturtle::mig_network*>( store<Store>().current().get() );
-          mockturtle::mig_npn_resynthesis resyn( is_set( "multiple" ) );
-          mockturtle::cut_rewriting( *mig_p, resyn, ps, &st );
-          *mig_p = cleanup_dangling( *mig_p );
+          const auto multiple = is_set( "multiple" );
+          rewrite( *mig_p, [multiple]() { return mockturtle::mig_npn_resynthesis( multiple ); } );
         }
         else if constexpr ( std::is_same_v<Store, xmg_t> )
         {
           auto* xmg_p = static_cast<mockturtle::xmg_network*>( store<Store>().current().get() );
-          mockturtle::xmg_npn_resynthesis resyn;
-          mockturtle::cut_rewriting( *xmg_p, resyn, ps, &st );
-          *xmg_p = cleanup_dangling( *xmg_p );
+          rewrite( *xmg_p, []() { return mockturtle::xmg_npn_resynthesis(); } );
         }
         else
         {
@@ -137,9 +182,7 @@ public:
           mockturtle::exact_resynthesis_params esps;
           esps.cache = exact_cache;
           esps.conflict_limit = conflict_limit;
-          mockturtle::exact_resynthesis resyn( exact_lutsize, esps );
-          mockturtle::cut_rewriting( *klut_p, resyn, ps, &st );
-          *klut_p = cleanup_dangling( *klut_p );
+          rewrite( *klut_p, [&]() { return mockturtle::exact_resynthesis( exact_lutsize, thread_params( esps ) ); } );
         }
         else if constexpr ( std::is_same_v<Store, aig_t> )
         {
@@ -151,9 +194,7 @@ public:
           mockturtle::exact_resynthesis_params esps;
           esps.cache = exact_aig_cache;
           esps.conflict_limit = conflict_limit;
-          mockturtle::exact_aig_resynthesis<mockturtle::aig_network> resyn( false, esps );
-          mockturtle::cut_rewriting( *aig_p, resyn, ps, &st );
-          *aig_p = cleanup_dangling( *aig_p );
+          rewrite( *aig_p, [&]() { return mockturtle::exact_aig_resynthesis<mockturtle::aig_network>( false, thread_params( esps ) ); } );
         }
         else if constexpr ( std::is_same_v<Store, xag_t> )
         {
@@ -165,9 +206,7 @@ public:
           mockturtle::exact_resynthesis_params esps;
           esps.cache = exact_xag_cache;
           esps.conflict_limit = conflict_limit;
-          mockturtle::exact_aig_resynthesis<mockturtle::xag_network> resyn( true, esps );
-          mockturtle::cut_rewriting( *xag_p, resyn, ps, &st );
-          *xag_p = cleanup_dangling( *xag_p );
+          rewrite( *xag_p, [&]() { return mockturtle::exact_aig_resynthesis<mockturtle::xag_network>( true, thread_params( esps ) ); } );
         }
         else
         {
@@ -180,9 +219,7 @@ public:
         if constexpr ( std::is_same_v<Store, mig_t> )
         {
           auto* mig_p = static_cast<mockturtle::mig_network*>( store<Store>().current().get() );
-          mockturtle::akers_resynthesis<mockturtle::mig_network> resyn;
-          mockturtle::cut_rewriting( *mig_p, resyn, ps, &st );
-          *mig_p = cleanup_dangling( *mig_p );
+          rewrite( *mig_p, []() { return mockturtle::akers_resynthesis<mockturtle::mig_network>(); } );
         }
         else
         {
@@ -190,11 +227,43 @@ public:
         }
       }
       break;
+      case 3:
+      {
+        /* cuts with up to 4 inputs are resynthesized as in strategy 0 */
+        if constexpr ( std::is_same_v<Store, aig_t> )
+        {
+          auto* aig_p = static_cast<mockturtle::aig_network*>( store<Store>().current().get() );
+          rewrite( *aig_p, [this]() { return npn_db_resynthesis<mockturtle::aig_network>( mockturtle::xag_npn_resynthesis<mockturtle::aig_network>() ); } );
+        }
+        else if constexpr ( std::is_same_v<Store, xag_t> )
+        {
+          auto* xag_p = static_cast<mockturtle::xag_network*>( store<Store>().current().get() );
+          rewrite( *xag_p, [this]() { return npn_db_resynthesis<mockturtle::xag_network>( mockturtle::xag_npn_resynthesis<mockturtle::xag_network>() ); } );
+        }
+        else if constexpr ( std::is_same_v<Store, mig_t> )
+        {
+          auto* mig_p = static_cast<mockturtle::mig_network*>( store<Store>().current().get() );
+          const auto multiple = is_set( "multiple" );
+          rewrite( *mig_p, [this, multiple]() { return npn_db_resynthesis<mockturtle::mig_network>( mockturtle::mig_npn_resynthesis( multiple ) ); } );
+        }
+        else if constexpr ( std::is_same_v<Store, xmg_t> )
+        {
+          auto* xmg_p = static_cast<mockturtle::xmg_network*>( store<Store>().current().get() );
+          rewrite( *xmg_p, [this]() { return npn_db_resynthesis<mockturtle::xmg_network>( mockturtle::xmg_npn_resynthesis() ); } );
+        }
+        else
+        {
+          env->err() << "[w] this strategy works only for AIGs, XAGs, MIGs, and XMGs\n";
+        }
+      }
+      break;
       }
 
       auto const new_cost = cost_fn( store<Store>().current().get() );
-      done = ( num_iterations == 0 && !compare_fn( new_cost, curr_cost ) ) ||
-             ( num_iterations > 0 && iterations_counter >= num_iterations );
+      done = fixpoint || failed ||
+             ( num_iterations == 0 && !compare_fn( new_cost, curr_cost ) ) ||
+             ( num_iterations > 0 && iterations_counter >= num_iterations ) ||
+             cirkit::is_cancelled();
 
       curr_cost = new_cost;
     } while ( !done );
@@ -202,18 +271,238 @@ public:
 
   nlohmann::json log() const override
   {
+    if ( !executed )
+    {
+      return nullptr;
+    }
+
+    if ( parallel )
+    {
+      return {
+        {"time_total", mockturtle::to_seconds( pst.time_total )},
+        {"num_iterations", num_iterations},
+        {"cost", cost},
+        {"threads", num_threads},
+        {"passes", pst.num_passes},
+        {"evaluated", pst.num_evaluated},
+        {"rewrites", pst.num_rewrites},
+        {"cut_memory", pst.cut_memory},
+        {"capped", pst.num_capped}
+      };
+    }
+
     return {
       {"time_total", mockturtle::to_seconds( st.time_total )},
-      {"num_iterations", num_iterations}
+      {"num_iterations", num_iterations},
+      {"cost", cost}
     };
   }
 
+  std::vector<std::pair<std::string, double>> phases() const override
+  {
+    if ( !executed )
+    {
+      return {};
+    }
+
+    if ( parallel )
+    {
+      return {
+        {"cuts", mockturtle::to_seconds( pst.time_cuts )},
+        {"evaluation", mockturtle::to_seconds( pst.time_evaluation )},
+        {"commit", mockturtle::to_seconds( pst.time_commit )}
+      };
+    }
+
+    return {
+      {"cuts", mockturtle::to_seconds( st.time_cuts )},
+      {"rewriting", mockturtle::to_seconds( st.time_rewriting )},
+      {"mis", mockturtle::to_seconds( st.time_mis )}
+    };
+  }
+
+private:
+  /* primary and secondary cost of a network under the cost function */
+  template<class Ntk>
+  std::pair<uint32_t, uint32_t> network_cost( Ntk const& ntk ) const
+  {
+    switch ( cost_kind )
+    {
+    default:
+      return {ntk.num_gates(), 0u};
+    case cirkit::cost_function::depth:
+      return {cirkit::network_depth( ntk ), ntk.num_gates()};
+    case cirkit::cost_function::size_depth:
+      return {ntk.num_gates(), cirkit::network_depth( ntk )};
+    case cirkit::cost_function::mc:
+    {
+      uint32_t num_ands{0u};
+      if constexpr ( mockturtle::has_is_and_v<Ntk> )
+      {
+        ntk.foreach_gate( [&]( auto const& n ) {
+          num_ands += ntk.is_and( n ) ? 1u : 0u;
+        } );
+      }
+      return {num_ands, ntk.num_gates()};
+    }
+    }
+  }
+
+  template<class Ntk, class MakeResynFn>
+  void rewrite( Ntk& ntk, MakeResynFn&& make_resyn )
+  {
+    if constexpr ( std::is_same_v<Ntk, mockturtle::aig_network> || std::is_same_v<Ntk, mockturtle::xag_network> )
+    {
+      if ( cost_kind == cirkit::cost_function::mc )
+      {
+        rewrite( ntk, make_resyn, cirkit::mc_cost<Ntk>() );
+        return;
+      }
+    }
+    rewrite( ntk, make_resyn, cirkit::unit_cost<Ntk>() );
+  }
+
+  /* runs the parallel engine if more than one thread is requested, for
+     depth-aware cost functions, or if the cut memory is limited, and
+     mockturtle's cut rewriting otherwise; make_resyn creates a resynthesis
+     object (once per thread in the parallel engine) */
+  template<class Ntk, class MakeResynFn, class NodeCostFn>
+  void rewrite( Ntk& ntk, MakeResynFn&& make_resyn, NodeCostFn const& node_cost_fn )
+  {
+    const auto small_cuts = ps.cut_enumeration_ps.cut_size <= cirkit::small_cut::max_size;
+    const auto level_constrained = cost_kind == cirkit::cost_function::depth || cost_kind == cirkit::cost_function::size_depth;
+    if ( level_constrained && !small_cuts )
+    {
+      env->err() << "[w] depth-aware cost functions support cut sizes up to 6, using size\n";
+    }
+    parallel = small_cuts && ( num_threads > 1u || level_constrained || cut_memory != 0u );
+
+    if ( parallel )
+    {
+      if ( cut_memory != 0u && cirkit::parallel_cut_enumeration_min_memory( ntk ) > ( uint64_t( cut_memory ) << 20u ) )
+      {
+        env->err() << fmt::format( "[e] cut sets of constants and PIs exceed the memory limit ({} MB)\n", cirkit::parallel_cut_enumeration_min_memory( ntk ) >> 20u );
+        failed = true;
+        return;
+      }
+      if ( !pool || pool->num_threads() != num_threads )
+      {
+        pool = std::make_shared<cirkit::thread_pool>( num_threads );
+      }
+
+      cirkit::parallel_cut_rewriting_params pps;
+      pps.cut_size = ps.cut_enumeration_ps.cut_size;
+      pps.cut_limit = ps.cut_enumeration_ps.cut_limit;
+      pps.allow_zero_gain = ps.allow_zero_gain;
+      pps.cost = cost_kind;
+      pps.frontier_depth = frontier_depth;
+      pps.cut_memory = uint64_t( cut_memory ) << 20u;
+      pps.verbose = ps.verbose;
+
+      cirkit::parallel_cut_rewriting_stats rst;
+      if ( num_iterations == 0u )
+      {
+        /* later passes only revisit the fanout of changed nodes */
+        cirkit::parallel_cut_rewriting_fixpoint( ntk, make_resyn, *pool, pps, &rst, node_cost_fn );
+        fixpoint = true;
+      }
+      else
+      {
+        cirkit::parallel_cut_rewriting( ntk, make_resyn, *pool, pps, &rst, node_cost_fn );
+      }
+      pst.add( rst );
+      merge_thread_caches();
+    }
+    else
+    {
+      if ( num_threads > 1u )
+      {
+        env->err() << "[w] parallel cut rewriting supports cut sizes up to 6, using sequential cut rewriting\n";
+      }
+      if ( cut_memory != 0u && cirkit::estimated_cut_memory( ntk ) > ( uint64_t( cut_memory ) << 20u ) )
+      {
+        env->err() << fmt::format( "[e] cut sets of sequential cut rewriting exceed the memory limit ({} MB)\n", cirkit::estimated_cut_memory( ntk ) >> 20u );
+        failed = true;
+        return;
+      }
+      auto resyn = make_resyn();
+      mockturtle::cut_rewriting_stats rst;
+      mockturtle::cut_rewriting( ntk, cirkit::cancellable_resynthesis( resyn ), ps, &rst, node_cost_fn );
+      merge_thread_caches();
+      st.time_total += rst.time_total;
+      st.time_cuts += rst.time_cuts;
+      st.time_rewriting += rst.time_rewriting;
+      st.time_mis += rst.time_mis;
+    }
+
+    cirkit::compact_dangling( ntk );
+    executed = true;
+  }
+
+  template<class Ntk, class FallbackFn>
+  cirkit::npn_database_resynthesis<Ntk, FallbackFn> npn_db_resynthesis( FallbackFn&& fallback ) const
+  {
+    return cirkit::npn_database_resynthesis<Ntk, FallbackFn>( npn_db, std::move( fallback ) );
+  }
+
+  /* exact resynthesis caches are not thread-safe, with more than one thread
+     each resynthesis object gets a cache of its own, which is kept for the
+     next calls instead of copying the command's cache each time; new entries
+     are merged into the command's cache once after rewriting */
+  mockturtle::exact_resynthesis_params thread_params( mockturtle::exact_resynthesis_params const& esps )
+  {
+    auto copy = esps;
+    if ( num_threads > 1u )
+    {
+      auto& caches = thread_caches[esps.cache];
+      if ( caches.used == caches.caches.size() )
+      {
+        caches.caches.push_back( std::make_shared<mockturtle::exact_resynthesis_params::cache_map_t>() );
+      }
+      copy.cache = caches.caches[caches.used++];
+    }
+    return copy;
+  }
+
+  void merge_thread_caches()
+  {
+    for ( auto& [cache, caches] : thread_caches )
+    {
+      for ( auto i = 0u; i < caches.used; ++i )
+      {
+        cache->insert( caches.caches[i]->begin(), caches.caches[i]->end() );
+      }
+      caches.used = 0u;
+    }
+  }
+
 private:
   mockturtle::cut_rewriting_params ps;
   mockturtle::cut_rewriting_stats st;
+  cirkit::parallel_cut_rewriting_stats pst;
+  std::shared_ptr<cirkit::thread_pool> pool;
+  uint32_t num_threads{1u};
+  uint32_t cut_memory{0u};
+  uint32_t frontier_depth{0u};
+  std::string cost{"size"};
+  std::string db_filename;
+  std::shared_ptr<cirkit::npn_database const> npn_db;
+  cirkit::cost_function cost_kind{cirkit::cost_function::size};
+  bool parallel{false};
+  bool fixpoint{false};
+
+  /* statistics are accumulated over all iterations of the last execution */
+  bool executed{false};
+  bool failed{false};
   mockturtle::exact_resynthesis_params::cache_t exact_cache{std::make_shared<mockturtle::exact_resynthesis_params::cache_map_t>()}; 
   mockturtle::exact_resynthesis_params::cache_t exact_aig_cache{std::make_shared<mockturtle::exact_resynthesis_params::cache_map_t>()}; 
   mockturtle::exact_resynthesis_params::cache_t exact_xag_cache{std::make_shared<mockturtle::exact_resynthesis_params::cache_map_t>()}; 
+  struct thread_cache_list
+  {
+    std::vector<mockturtle::exact_resynthesis_params::cache_t> caches;
+    uint32_t used{0u};
+  };
+  std::map<mockturtle::exact_resynthesis_params::cache_t, thread_cache_list> thread_caches;
   uint32_t strategy{0u};
   uint32_t exact_lutsize{3u};
   uint32_t iterations_counter{0u};
@@ -48,11 +48,11 @@ public:
     result_ = mockturtle::equivalence_checking( *( store<Store>().current() ), ps, &st );
     if ( result_ )
     {
-      std::cout << "[i] miter is" << ( *result_ ? "" : " not" ) << " equivalent\n";
+      env->out() << "[i] miter is" << ( *result_ ? "" : " not" ) << " equivalent\n";
     }
     else
     {
-      std::cout << "[i] resource limit reached, result undefined\n";
+      env->out() << "[i] resource limit reached, result undefined\n";
     }
   }
 
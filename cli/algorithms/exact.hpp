@@ -26,6 +26,7 @@
 #include <alice/alice.hpp>
 
 #include <algorithm>
+#include <limits>
 #include <vector>
 
 #include <mockturtle/algorithms/node_resynthesis/exact.hpp>
@@ -66,17 +67,14 @@ public:
         exact_aig_cache = std::make_shared<mockturtle::exact_resynthesis_params::cache_map_t>();
       }
 
-      mockturtle::exact_resynthesis_params esps;
-      esps.cache = exact_aig_cache;
-      esps.conflict_limit = conflict_limit;
-      constexpr bool with_xor = std::is_same_v<Store, xag_t>;
-      mockturtle::exact_aig_resynthesis<base_type> resyn( with_xor, esps );
-
       base_type ntk;
-      std::vector<typename base_type::signal> pis( tt.num_vars() );
-      std::generate( pis.begin(), pis.end(), [&]() { return ntk.create_pi(); } );
-
-      resyn( ntk, tt, pis.begin(), pis.end(), [&]( auto const& f ) { ntk.create_po( f ); } );
+      synthesize( ntk, tt, [&]( int budget ) {
+        mockturtle::exact_resynthesis_params esps;
+        esps.cache = exact_aig_cache;
+        esps.conflict_limit = budget;
+        constexpr bool with_xor = std::is_same_v<Store, xag_t>;
+        return mockturtle::exact_aig_resynthesis<base_type>( with_xor, esps );
+      } );
 
       if ( ntk.num_pos() == 1u )
       {
@@ -92,16 +90,13 @@ public:
         exact_cache = std::make_shared<mockturtle::exact_resynthesis_params::cache_map_t>();
       }
 
-      mockturtle::exact_resynthesis_params esps;
-      esps.cache = exact_cache;
-      esps.conflict_limit = conflict_limit;
-      mockturtle::exact_resynthesis resyn( lutsize, esps );
-
       mockturtle::klut_network ntk;
-      std::vector<mockturtle::klut_network::signal> pis( tt.num_vars() );
-      std::generate( pis.begin(), pis.end(), [&]() { return ntk.create_pi(); } );
-
-      resyn( ntk, tt, pis.begin(), pis.end(), [&]( auto const& f ) { ntk.create_po( f ); } );
+      synthesize( ntk, tt, [&]( int budget ) {
+        mockturtle::exact_resynthesis_params esps;
+        esps.cache = exact_cache;
+        esps.conflict_limit = budget;
+        return mockturtle::exact_resynthesis<mockturtle::klut_network>( lutsize, esps );
+      } );
 
       if ( ntk.num_pos() == 1u )
       {
@@ -113,6 +108,31 @@ public:
   }
 
 private:
+  /* percy's SAT calls cannot be interrupted, without a conflict limit the
+     synthesis is therefore restarted with doubling conflict budgets and the
+     cancellation token is polled between the restarts; as the budgets grow
+     geometrically, earlier restarts add at most the conflicts of the last one */
+  template<class Ntk, class MakeResyn>
+  void synthesize( Ntk& ntk, kitty::dynamic_truth_table const& tt, MakeResyn&& make_resyn )
+  {
+    std::vector<typename Ntk::signal> pis( tt.num_vars() );
+    std::generate( pis.begin(), pis.end(), [&]() { return ntk.create_pi(); } );
+
+    for ( auto budget = conflict_limit > 0 ? conflict_limit : initial_budget;; budget = std::min( budget, std::numeric_limits<int>::max() / 2 ) * 2 )
+    {
+      auto resyn = make_resyn( budget );
+      resyn( ntk, tt, pis.begin(), pis.end(), [&]( auto const& f ) { ntk.create_po( f ); } );
+
+      if ( ntk.num_pos() > 0u || conflict_limit > 0 || cirkit::is_cancelled() )
+      {
+        return;
+      }
+    }
+  }
+
+private:
+  static constexpr int initial_budget = 1000;
+
   mockturtle::exact_resynthesis_params::cache_t exact_cache{std::make_shared<mockturtle::exact_resynthesis_params::cache_map_t>()};
   mockturtle::exact_resynthesis_params::cache_t exact_aig_cache{std::make_shared<mockturtle::exact_resynthesis_params::cache_map_t>()};
   unsigned lutsize{3u};
@@ -0,0 +1,399 @@
+/* CirKit: A circuit toolkit
+ * Copyright (C) 2017-2019  EPFL
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <alice/alice.hpp>
+#include <alice/detail/utils.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <numeric>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <fmt/format.h>
+#include <mockturtle/utils/stopwatch.hpp>
+#include <mockturtle/views/mapping_view.hpp>
+
+#include "../utils/cancellation.hpp"
+#include "../utils/cirkit_command.hpp"
+
+namespace alice
+{
+
+/* Runs the steps of a flow (an alias such as compress2rs or a semicolon
+   separated list of commands) within a time budget.  For each step, the
+   command keeps an estimate of its runtime per gate and of its relative
+   gain from earlier runs in this session.  When the remaining steps are not
+   expected to finish in time, the steps with the highest expected gain per
+   second that fit into the remaining budget are kept, and the others are
+   skipped; with --reorder the kept steps run in order of their expected
+   gain per second.  At the deadline the running step is cancelled, and the
+   best network seen after any step is restored, with its names and
+   mapping. */
+class flow_command : public cirkit::cirkit_command<flow_command, aig_t, mig_t, xag_t, xmg_t, klut_t>
+{
+public:
+  flow_command( environment::ptr& env ) : cirkit::cirkit_command<flow_command, aig_t, mig_t, xag_t, xmg_t, klut_t>( env, "Runs a flow within a time budget", "run flow on {0}" )
+  {
+    add_option( "flow,--flow", flow, "alias name or semicolon-separated commands" )->required();
+    add_option( "--budget", budget, "time budget in seconds (default: variable flow_budget, 0 for no budget)" );
+    add_flag( "--reorder", "run steps with higher expected gain per second first when the budget is tight" );
+    add_flag( "--reset", "forget runtime and gain estimates of earlier runs" );
+    add_flag( "-v,--verbose", "print steps" );
+  }
+
+  template<class Store>
+  inline void execute_store()
+  {
+    if ( is_set( "reset" ) )
+    {
+      models.clear();
+    }
+
+    auto total_budget = budget;
+    if ( !is_set( "budget" ) )
+    {
+      const auto value = env->variable( "flow_budget", "0" );
+      try
+      {
+        total_budget = std::stod( value );
+      }
+      catch ( ... )
+      {
+        env->err() << fmt::format( "[w] invalid value {} for flow_budget, running without budget\n", value );
+        total_budget = 0.0;
+      }
+    }
+
+    /* steps are executed on this store */
+    set_default_option<Store>();
+
+    steps.clear();
+    for ( auto const& line : alice::detail::split_with_quotes<';'>( cirkit::expand_alias( *env, alice::detail::trim_copy( flow ) ) ) )
+    {
+      const auto step = alice::detail::trim_copy( line );
+      if ( !step.empty() )
+      {
+        steps.push_back( {step} );
+      }
+    }
+
+    const auto num_gates = [&]() { return static_cast<uint32_t>( store<Store>().current()->num_gates() ); };
+
+    time_total = {};
+    mockturtle::stopwatch t( time_total );
+
+    /* the scope tightens the deadline of all steps */
+    cirkit::cancellation_scope scope( total_budget );
+    const auto start = clock::now();
+    const auto remaining = [&]() {
+      return total_budget > 0.0 ? total_budget - std::chrono::duration<double>( clock::now() - start ).count() : std::numeric_limits<double>::infinity();
+    };
+
+    gates_before = num_gates();
+    best_gates = gates_before;
+    restored = false;
+
+    /* the snapshot is only taken before a step modifies the best network */
+    std::shared_ptr<typename Store::element_type> best;
+    bool current_is_best{true};
+
+    std::vector<uint32_t> pending( steps.size() );
+    std::iota( pending.begin(), pending.end(), 0u );
+    uint32_t num_run{0u};
+
+    while ( !pending.empty() && !cirkit::is_cancelled() )
+    {
+      const auto size = num_gates();
+      const auto selected = select_steps( pending, size, remaining() );
+
+      /* without reordering, the next step in the flow is run if it is
+         selected, and skipped otherwise */
+      auto i = pending.front();
+      if ( is_set( "reorder" ) && !selected.empty() )
+      {
+        i = selected.front();
+      }
+      pending.erase( std::find( pending.begin(), pending.end(), i ) );
+
+      auto& step = steps[i];
+      if ( std::find( selected.begin(), selected.end(), i ) == selected.end() )
+      {
+        step.status = "skipped";
+        if ( is_set( "verbose" ) )
+        {
+          env->out() << fmt::format( "[i] skip {}\n", step.command );
+        }
+        continue;
+      }
+
+      if ( current_is_best )
+      {
+        take_snapshot( *store<Store>().current(), best );
+      }
+
+      mockturtle::stopwatch<>::duration time{0};
+      bool success{false};
+      {
+        mockturtle::stopwatch t_step( time );
+        success = env->execute( step.command );
+      }
+
+      step.run = true;
+      step.position = num_run++;
+      step.time = mockturtle::to_seconds( time );
+      step.gates_before = size;
+      step.gates_after = num_gates();
+      step.status = !success ? "failed" : ( cirkit::is_cancelled() ? "cancelled" : "success" );
+
+      /* cancelled steps did not run completely, their runtime says little */
+      if ( success && !cirkit::is_cancelled() )
+      {
+        models[step.command].update( size, step.gates_after, step.time );
+      }
+
+      if ( is_set( "verbose" ) )
+      {
+        env->out() << fmt::format( "[i] {:<40} gates = {:>7} -> {:<7} {:>6.2f} secs   {}\n", step.command, step.gates_before, step.gates_after, step.time, step.status );
+      }
+
+      current_is_best = step.gates_after <= best_gates;
+      best_gates = std::min( best_gates, step.gates_after );
+    }
+
+    for ( auto i : pending )
+    {
+      steps[i].status = "not run";
+    }
+
+    if ( !current_is_best )
+    {
+      store<Store>().current() = std::move( best );
+      restored = true;
+    }
+
+    env->out() << fmt::format( "[i] flow: gates = {} -> {}, {} of {} steps run{}\n", gates_before, best_gates,
+                               std::count_if( steps.begin(), steps.end(), []( auto const& s ) { return s.run; } ), steps.size(),
+                               restored ? ", best network restored" : "" );
+  }
+
+  nlohmann::json log() const override
+  {
+    nlohmann::json js_steps = nlohmann::json::array();
+    for ( auto const& step : steps )
+    {
+      js_steps.push_back( {
+        {"command", step.command},
+        {"status", step.status},
+        {"position", step.position},
+        {"time", step.time},
+        {"gates_before", step.gates_before},
+        {"gates_after", step.gates_after}
+      } );
+    }
+
+    return {
+      {"time_total", mockturtle::to_seconds( time_total )},
+      {"gates_before", gates_before},
+      {"gates_after", best_gates},
+      {"restored", restored},
+      {"steps", js_steps}
+    };
+  }
+
+  std::vector<std::pair<std::string, double>> phases() const override
+  {
+    std::vector<std::pair<std::string, double>> result;
+    for ( auto const& step : steps )
+    {
+      if ( step.run )
+      {
+        result.emplace_back( step.command, step.time );
+      }
+    }
+    return result;
+  }
+
+private:
+  using clock = std::chrono::steady_clock;
+
+  /* runtime per gate and relative gain of a step over earlier runs; the
+     first runs are averaged with equal weights, afterwards the estimates are
+     exponential moving averages in which the latest run has the weight
+     smoothing, such that they follow the network as it shrinks */
+  struct step_model
+  {
+    static constexpr double smoothing = 0.25;
+
+    void update( uint32_t gates_before, uint32_t gates_after, double time )
+    {
+      const auto size = std::max( gates_before, 1u );
+      const auto observed_time = time / size;
+      const auto observed_gain = ( static_cast<double>( gates_before ) - gates_after ) / size;
+      ++runs;
+      const auto weight = std::max( 1.0 / runs, smoothing );
+      time_per_gate += weight * ( observed_time - time_per_gate );
+      gain += weight * ( observed_gain - gain );
+    }
+
+    uint32_t runs{0u};
+    double time_per_gate{0.0};
+    double gain{0.0};
+  };
+
+  struct step_info
+  {
+    std::string command;
+    std::string status;
+    bool run{false};
+    int32_t position{-1};
+    double time{0.0};
+    uint32_t gates_before{0u};
+    uint32_t gates_after{0u};
+  };
+
+  /* copies network, names, and mapping of a store element into snapshot;
+     network copies share their storage, therefore the snapshot gets its own
+     storage, which is reused by later snapshots, and the mapping is copied
+     cell by cell */
+  template<class NamedNtk, bool StoreFunction>
+  static void take_snapshot( mockturtle::mapping_view<NamedNtk, StoreFunction> const& ntk, std::shared_ptr<mockturtle::mapping_view<NamedNtk, StoreFunction>>& snapshot )
+  {
+    using storage_type = typename NamedNtk::storage::element_type;
+    using node = typename NamedNtk::node;
+
+    auto storage = snapshot ? snapshot->_storage : std::make_shared<storage_type>();
+    *storage = *ntk._storage;
+
+    NamedNtk named_ntk = ntk;
+    named_ntk._storage = storage;
+    snapshot = std::make_shared<mockturtle::mapping_view<NamedNtk, StoreFunction>>( named_ntk );
+
+    if ( !ntk.has_mapping() )
+    {
+      return;
+    }
+    std::vector<node> leaves;
+    ntk.foreach_node( [&]( auto const& n ) {
+      if ( !ntk.is_cell_root( n ) )
+      {
+        return;
+      }
+      leaves.clear();
+      ntk.foreach_cell_fanin( n, [&]( auto const& l ) { leaves.push_back( l ); } );
+      snapshot->add_to_mapping( n, leaves.begin(), leaves.end() );
+      if constexpr ( StoreFunction )
+      {
+        snapshot->set_cell_function( n, ntk.cell_function( n ) );
+      }
+    } );
+  }
+
+  /* selects the pending steps that are run; all steps are selected, in flow
+     order, if they are expected to fit into the remaining time, otherwise
+     the steps with the highest expected gain per second that fit are
+     selected, ordered by gain per second.  Steps without estimates are
+     selected as long as there is time left, they are expected to be as
+     expensive per gate as the average known step. */
+  std::vector<uint32_t> select_steps( std::vector<uint32_t> const& pending, uint32_t size, double time_left ) const
+  {
+    if ( time_left == std::numeric_limits<double>::infinity() )
+    {
+      return pending;
+    }
+
+    double avg_time_per_gate{0.0};
+    uint32_t known{0u};
+    for ( auto const& [_, model] : models )
+    {
+      avg_time_per_gate += model.time_per_gate;
+      ++known;
+    }
+    avg_time_per_gate = known ? avg_time_per_gate / known : 0.0;
+
+    struct estimate
+    {
+      uint32_t index;
+      double time;
+      double rate;
+    };
+    std::vector<estimate> estimates;
+    double total_time{0.0};
+    for ( auto j : pending )
+    {
+      const auto it = models.find( steps[j].command );
+      if ( it == models.end() )
+      {
+        estimates.push_back( {j, avg_time_per_gate * size, std::numeric_limits<double>::infinity()} );
+      }
+      else
+      {
+        const auto time = it->second.time_per_gate * size;
+        const auto gain = std::max( it->second.gain, 0.0 ) * size;
+        estimates.push_back( {j, time, gain / std::max( time, 1e-6 )} );
+      }
+      total_time += estimates.back().time;
+    }
+
+    if ( total_time <= time_left )
+    {
+      return pending;
+    }
+
+    /* keep the steps with the highest gain per second that fit */
+    std::stable_sort( estimates.begin(), estimates.end(), []( auto const& a, auto const& b ) { return a.rate > b.rate; } );
+    std::vector<uint32_t> selected;
+    for ( auto const& e : estimates )
+    {
+      if ( e.time > time_left || e.rate <= 0.0 )
+      {
+        continue;
+      }
+      selected.push_back( e.index );
+      time_left -= e.time;
+    }
+    return selected;
+  }
+
+private:
+  std::string flow;
+  double budget{0.0};
+
+  std::unordered_map<std::string, step_model> models;
+
+  std::vector<step_info> steps;
+  uint32_t gates_before{0u};
+  uint32_t best_gates{0u};
+  bool restored{false};
+  mockturtle::stopwatch<>::duration time_total{0};
+};
+
+ALICE_ADD_COMMAND( flow, "Synthesis" )
+
+} // namespace alice
@@ -25,10 +25,18 @@
 
 #include <alice/alice.hpp>
 
+#include <algorithm>
+#include <limits>
+#include <memory>
+#include <vector>
+
 #include <mockturtle/algorithms/cut_enumeration/spectr_cut.hpp>
 #include <mockturtle/algorithms/lut_mapping.hpp>
 
 #include "../utils/cirkit_command.hpp"
+#include "../utils/cut_arena.hpp"
+#include "../utils/parallel_lut_mapping.hpp"
+#include "../utils/thread_pool.hpp"
 
 namespace alice
 {
@@ -42,26 +50,109 @@ public:
     add_option( "--lutcount", ps.cut_enumeration_ps.cut_limit, "number of cuts per node", true );
     add_option( "--cost", cost, "cost function for priority cut selection", true )->set_type_name( "cost function in {mf=0, spectral=1}");
     add_flag( "--nofun", "do not compute cut functions (only when cost function is 0)" );
+    add_option( "--threads", num_threads, "number of threads for cut enumeration and area-flow selection", true );
+    add_flag( "--delay", pps.delay_oriented, "recover area without increasing the delay-optimal depth" );
+    add_option( "--lut_delay", pps.lut_delay, "delay of a LUT", true );
+    add_option( "--target_depth", pps.target_depth, "target depth in LUT levels (implies --delay)" );
+    add_option( "--relax", pps.relax, "relaxation of the delay-optimal depth in percent (implies --delay)" );
+    add_option( "--cut_memory", cut_memory, "memory limit for cut sets in MB (0 for no limit)", true );
+    add_flag( "-v,--verbose", ps.verbose, "show statistics" );
+  }
+
+  rules validity_rules() const override
+  {
+    auto r = cirkit::cirkit_command<lut_mapping_command, aig_t, mig_t, xag_t, xmg_t, klut_t>::validity_rules();
+    r.push_back( {[this]() { return !is_set( "target_depth" ) || !is_set( "relax" ); }, "target depth and relaxation cannot be combined"} );
+    r.push_back( {[this]() { return pps.lut_delay > 0u; }, "LUT delay must be positive"} );
+    return r;
   }
 
   template<class Store>
   inline void execute_store()
   {
+    auto& ntk = *( store<Store>().current() );
+
+    /* cirkit's engine implements the mf cost function for LUTs with up to 6
+       inputs; it runs on multiple threads, for delay-oriented mapping, and
+       if the cut memory is limited */
+    const auto delay_oriented = pps.delay_oriented || is_set( "target_depth" ) || is_set( "relax" );
+    const auto supported = cost == 0u && ps.cut_enumeration_ps.cut_size <= 6u;
+    if ( delay_oriented && !supported )
+    {
+      env->err() << "[e] delay-oriented mapping requires cost function 0 and LUTs with at most 6 inputs\n";
+      return;
+    }
+
+    if ( !supported && num_threads > 1u )
+    {
+      env->err() << "[w] parallel LUT mapping supports cost function 0 and LUTs with up to 6 inputs, using sequential LUT mapping\n";
+    }
+
+    cirkit_engine = supported && ( num_threads > 1u || delay_oriented || cut_memory != 0u );
+    if ( cirkit_engine )
+    {
+      if ( cut_memory != 0u && cirkit::parallel_lut_mapping_min_memory( ntk ) > ( uint64_t( cut_memory ) << 20u ) )
+      {
+        env->err() << fmt::format( "[e] fallback cut sets exceed the memory limit ({} MB), which must cover two cuts per node\n", cirkit::parallel_lut_mapping_min_memory( ntk ) >> 20u );
+        return;
+      }
+      if ( !pool || pool->num_threads() != num_threads )
+      {
+        pool = std::make_shared<cirkit::thread_pool>( num_threads );
+      }
+
+      auto cps = pps;
+      cps.cut_size = ps.cut_enumeration_ps.cut_size;
+      cps.cut_limit = ps.cut_enumeration_ps.cut_limit;
+      cps.rounds = ps.rounds;
+      cps.rounds_ela = ps.rounds_ela;
+      cps.delay_oriented = delay_oriented;
+      cps.target_depth = is_set( "target_depth" ) ? pps.target_depth : 0u;
+      cps.relax = is_set( "relax" ) ? pps.relax : 0u;
+      cps.cut_memory = uint64_t( cut_memory ) << 20u;
+      cps.verbose = ps.verbose;
+
+      const auto mapped = is_set( "nofun" ) ? cirkit::parallel_lut_mapping( ntk, *pool, cps, &pst ) : cirkit::parallel_lut_mapping<typename Store::element_type, true>( ntk, *pool, cps, &pst );
+      if ( mapped )
+      {
+        if ( delay_oriented && cps.target_depth != 0u && pst.depth > cps.target_depth )
+        {
+          env->err() << fmt::format( "[w] target depth {} cannot be met, mapped depth is {}\n", cps.target_depth, pst.depth );
+        }
+        num_luts = pst.num_luts;
+        depth = pst.depth;
+        return;
+      }
+      if ( delay_oriented )
+      {
+        env->err() << fmt::format( "[e] network has gates with more than {} fanins\n", ps.cut_enumeration_ps.cut_size );
+        return;
+      }
+      env->err() << fmt::format( "[w] network has gates with more than {} fanins, using sequential LUT mapping\n", ps.cut_enumeration_ps.cut_size );
+      cirkit_engine = false;
+    }
+
+    if ( cut_memory != 0u && cirkit::estimated_cut_memory( ntk ) > ( uint64_t( cut_memory ) << 20u ) )
+    {
+      env->err() << fmt::format( "[e] cut sets of sequential LUT mapping exceed the memory limit ({} MB)\n", cirkit::estimated_cut_memory( ntk ) >> 20u );
+      return;
+    }
+
     if ( is_set( "nofun" ) )
     {
-      mockturtle::lut_mapping( *( store<Store>().current() ), ps );
+      mockturtle::lut_mapping( ntk, ps );
     }
     else
     {
       if ( cost == 0u )
       {
-        mockturtle::lut_mapping<typename Store::element_type, true>( *( store<Store>().current() ), ps );
+        mockturtle::lut_mapping<typename Store::element_type, true>( ntk, ps );
       }
       else if ( cost == 1u )
       {
         if constexpr ( mockturtle::has_is_xor_v<typename Store::element_type> )
         {
-          mockturtle::lut_mapping<typename Store::element_type, true, mockturtle::cut_enumeration_spectr_cut>( *( store<Store>().current() ), ps );
+          mockturtle::lut_mapping<typename Store::element_type, true, mockturtle::cut_enumeration_spectr_cut>( ntk, ps );
         }
         else
         {
@@ -69,11 +160,97 @@ public:
         }
       }
     }
+    num_luts = ntk.num_cells();
+    depth = mapped_depth( ntk );
+  }
+
+  nlohmann::json log() const override
+  {
+    if ( cirkit_engine )
+    {
+      return {
+        {"time_total", mockturtle::to_seconds( pst.time_total )},
+        {"threads", num_threads},
+        {"luts", num_luts},
+        {"depth", depth},
+        {"delay", pst.delay},
+        {"required", pst.required},
+        {"cut_memory", pst.cut_memory},
+        {"capped", pst.num_capped}
+      };
+    }
+
+    return {
+      {"threads", 1u},
+      {"luts", num_luts},
+      {"depth", depth}
+    };
+  }
+
+private:
+  /* number of LUTs on the longest path of a mapping */
+  template<class Ntk>
+  static uint32_t mapped_depth( Ntk const& ntk )
+  {
+    constexpr auto unknown = std::numeric_limits<uint32_t>::max();
+    std::vector<uint32_t> levels( ntk.size(), unknown );
+    std::vector<typename Ntk::node> stack;
+
+    uint32_t max_level{0u};
+    ntk.foreach_po( [&]( auto const& f ) {
+      stack.push_back( ntk.get_node( f ) );
+      while ( !stack.empty() )
+      {
+        const auto n = stack.back();
+        const auto index = ntk.node_to_index( n );
+        if ( levels[index] != unknown )
+        {
+          stack.pop_back();
+          continue;
+        }
+        if ( !ntk.is_cell_root( n ) )
+        {
+          levels[index] = 0u;
+          stack.pop_back();
+          continue;
+        }
+
+        uint32_t level{0u};
+        bool ready{true};
+        ntk.foreach_cell_fanin( n, [&]( auto const& m ) {
+          const auto l = levels[ntk.node_to_index( m )];
+          if ( l == unknown )
+          {
+            stack.push_back( m );
+            ready = false;
+          }
+          else
+          {
+            level = std::max( level, l + 1u );
+          }
+        } );
+        if ( ready )
+        {
+          levels[index] = std::max( level, 1u );
+          stack.pop_back();
+        }
+      }
+      max_level = std::max( max_level, levels[ntk.node_to_index( ntk.get_node( f ) )] );
+    } );
+    return max_level;
   }
 
 private:
   mockturtle::lut_mapping_params ps;
+  cirkit::parallel_lut_mapping_params pps;
+  cirkit::parallel_lut_mapping_stats pst;
   unsigned cost{0u};
+  uint32_t num_threads{1u};
+  uint32_t cut_memory{0u};
+  uint32_t num_luts{0u};
+  uint32_t depth{0u};
+  bool cirkit_engine{false};
+  std::shared_ptr<cirkit::thread_pool> pool;
 };
 
 ALICE_ADD_COMMAND( lut_mapping, "Mapping" )
@@ -46,8 +46,8 @@ public:
     const auto size = mockturtle::multiplicative_complexity( *store<Store>().current() );
     const auto depth = mockturtle::multiplicative_complexity_depth( *store<Store>().current() );
 
-    std::cout << fmt::format( "[i] mult. compl. size  = {}\n", size ? std::to_string( *size ) : std::string( "N/A" ) );
-    std::cout << fmt::format( "[i] mult. compl. depth = {}\n", depth ? std::to_string( *depth ) : std::string( "N/A" ) );
+    env->out() << fmt::format( "[i] mult. compl. size  = {}\n", size ? std::to_string( *size ) : std::string( "N/A" ) );
+    env->out() << fmt::format( "[i] mult. compl. depth = {}\n", depth ? std::to_string( *depth ) : std::string( "N/A" ) );
   }
 };
 
@@ -0,0 +1,200 @@
+/* CirKit: A circuit toolkit
+ * Copyright (C) 2017-2019  EPFL
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <alice/alice.hpp>
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <fmt/format.h>
+#include <mockturtle/algorithms/cut_rewriting.hpp>
+#include <mockturtle/algorithms/refactoring.hpp>
+#include <mockturtle/properties/mccost.hpp>
+#include <mockturtle/utils/stopwatch.hpp>
+
+#include "../utils/cirkit_command.hpp"
+#include "../utils/dont_cares.hpp"
+#include "../utils/mc_optimization.hpp"
+#include "../utils/thread_pool.hpp"
+
+namespace alice
+{
+
+class mcopt_command : public cirkit::cirkit_command<mcopt_command, xag_t>
+{
+public:
+  mcopt_command( environment::ptr& env ) : cirkit::cirkit_command<mcopt_command, xag_t>( env, "Optimizes for multiplicative complexity until fixpoint", "applies optimization to {0}" )
+  {
+    add_option( "--load", db, "load database for minmc (text or compiled)" );
+    add_flag( "--keep", "keep compiled database loaded for all sessions of this process" );
+    add_flag( "--verify", "verify database when loading" );
+    add_option( "-k,--lutsize", rps.cut_enumeration_ps.cut_size, "cut size", true );
+    add_option( "--lutcount", rps.cut_enumeration_ps.cut_limit, "cut limit", true );
+    add_flag( "--dc", fps.use_dont_cares, "use don't cares for rewriting and refactoring" );
+    add_option( "--dc_window", dc_ps.window_size, "maximum number of inputs of don't-care windows", true );
+    add_flag( "--dc_sat", dc_ps.sat_validation, "prove don't cares beyond windows with SAT" );
+    add_option( "-i,--iterations", num_iterations, "maximum number of iterations {0=until fixpoint}", true );
+    add_option( "--threads", num_threads, "number of threads", true );
+    add_option( "--window_size", window_size, "maximum number of gates per refactoring window with --threads (0 for 10000 gates)", true );
+    add_flag( "--verbose,-v", "print AND gates after each iteration" );
+
+    rps.min_cand_cut_size = 2u;
+  }
+
+  rules validity_rules() const override
+  {
+    auto r = cirkit::cirkit_command<mcopt_command, xag_t>::validity_rules();
+    r.push_back( {[this]() { return is_set( "load" ) || mc_db; }, "no database loaded"} );
+    return r;
+  }
+
+  template<class Store>
+  inline void execute_store()
+  {
+    executed = false;
+
+    if ( is_set( "load" ) )
+    {
+      mc_db = cirkit::load_mc_rewriting_database( db, is_set( "verify" ), is_set( "keep" ) );
+      if ( !mc_db )
+      {
+        env->err() << fmt::format( "[e] cannot load database: {}\n", mc_db.error );
+        return;
+      }
+    }
+
+    if ( num_threads > 1u && !mc_db.compiled )
+    {
+      env->err() << "[w] parallel MC rewriting requires a compiled database (see minmc --compile), using one thread for rewriting\n";
+    }
+    if ( !pool || pool->num_threads() != num_threads )
+    {
+      pool = std::make_shared<cirkit::thread_pool>( num_threads );
+    }
+
+    auto* xag_p = static_cast<mockturtle::xag_network*>( store<xag_t>().current().get() );
+    const auto num_ands = [&]() { return mockturtle::multiplicative_complexity( *xag_p ).value_or( 0u ); };
+
+    /* the don't-care cache is shared by all iterations */
+    dcs.set_params( dc_ps );
+    auto* dont_cares = fps.use_dont_cares ? &dcs : nullptr;
+
+    time_total = time_rewriting = time_refactoring = {};
+    and_counts = {num_ands()};
+    rolled_back = false;
+
+    mockturtle::stopwatch t( time_total );
+    for ( auto i = 1u; !cirkit::is_cancelled(); ++i )
+    {
+      /* rewriting and refactoring only change the gates, names and mapping
+         of the store element stay untouched */
+      auto snapshot = *xag_p->_storage;
+      {
+        mockturtle::stopwatch t_rewriting( time_rewriting );
+        cirkit::mc_rewriting( *xag_p, mc_db, rps, *pool, rst, dont_cares );
+      }
+      {
+        mockturtle::stopwatch t_refactoring( time_refactoring );
+        mockturtle::refactoring_stats fst;
+        cirkit::mc_refactoring( *xag_p, fps, *pool, window_size, fst, dont_cares );
+      }
+
+      and_counts.push_back( num_ands() );
+      if ( is_set( "verbose" ) )
+      {
+        env->out() << fmt::format( "[i] iteration {:>3}: AND gates = {}\n", i, and_counts.back() );
+      }
+
+      if ( and_counts.back() >= and_counts[and_counts.size() - 2u] )
+      {
+        /* keep the network of the previous iteration */
+        *xag_p->_storage = std::move( snapshot );
+        dcs.clear();
+        rolled_back = true;
+        break;
+      }
+      if ( num_iterations > 0u && i >= num_iterations )
+      {
+        break;
+      }
+    }
+    executed = true;
+  }
+
+  nlohmann::json log() const override
+  {
+    if ( !executed )
+    {
+      return nullptr;
+    }
+
+    return {
+      {"time_total", mockturtle::to_seconds( time_total )},
+      {"iterations", and_counts.empty() ? 0u : static_cast<uint32_t>( and_counts.size() - 1u )},
+      {"and_counts", and_counts},
+      {"rolled_back", rolled_back},
+      {"threads", num_threads}
+    };
+  }
+
+  std::vector<std::pair<std::string, double>> phases() const override
+  {
+    if ( !executed )
+    {
+      return {};
+    }
+
+    return {
+      {"minmc", mockturtle::to_seconds( time_rewriting )},
+      {"refactormc", mockturtle::to_seconds( time_refactoring )}
+    };
+  }
+
+private:
+  std::string db;
+  cirkit::mc_rewriting_database mc_db;
+  mockturtle::cut_rewriting_params rps;
+  mockturtle::refactoring_params fps;
+  cirkit::mc_rewriting_stats rst;
+  uint32_t num_iterations{0u};
+  uint32_t num_threads{1u};
+  uint32_t window_size{0u};
+  std::shared_ptr<cirkit::thread_pool> pool;
+  cirkit::dont_care_params dc_ps;
+  cirkit::windowed_dont_cares<mockturtle::xag_network> dcs;
+
+  mockturtle::stopwatch<>::duration time_total{0};
+  mockturtle::stopwatch<>::duration time_rewriting{0};
+  mockturtle::stopwatch<>::duration time_refactoring{0};
+  std::vector<uint32_t> and_counts;
+  bool rolled_back{false};
+  bool executed{false};
+};
+
+ALICE_ADD_COMMAND( mcopt, "Synthesis" )
+
+} // namespace alice
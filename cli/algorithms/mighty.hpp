@@ -25,11 +25,11 @@
 
 #include <alice/alice.hpp>
 
-#include <mockturtle/algorithms/cleanup.hpp>
 #include <mockturtle/algorithms/mig_algebraic_rewriting.hpp>
 #include <mockturtle/views/depth_view.hpp>
 
 #include "../utils/cirkit_command.hpp"
+#include "../utils/compaction.hpp"
 
 namespace alice
 {
@@ -51,10 +51,12 @@ public:
   inline void execute_store()
   {
     auto* mig_p = static_cast<mockturtle::mig_network*>( store<Store>().current().get() );
-    mockturtle::depth_view depth_mig{*mig_p};
-    ps.allow_area_increase = !is_set( "area_aware" );
-    mockturtle::mig_algebraic_depth_rewriting( depth_mig, ps );
-    *mig_p = mockturtle::cleanup_dangling( *mig_p );
+    {
+      mockturtle::depth_view depth_mig{*mig_p};
+      ps.allow_area_increase = !is_set( "area_aware" );
+      mockturtle::mig_algebraic_depth_rewriting( depth_mig, ps );
+    }
+    cirkit::compact_dangling( *mig_p );
   }
 
   nlohmann::json log() const override
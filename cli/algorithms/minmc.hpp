@@ -25,31 +25,36 @@
 
 #include <alice/alice.hpp>
 
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <exception>
+#include <fstream>
+#include <map>
 #include <memory>
+#include <sstream>
 #include <string>
+#include <vector>
 
-#include <mockturtle/algorithms/cleanup.hpp>
+#include <fmt/format.h>
+#include <kitty/constructors.hpp>
+#include <kitty/dynamic_truth_table.hpp>
 #include <mockturtle/algorithms/cut_rewriting.hpp>
 #include <mockturtle/algorithms/node_resynthesis/xag_minmc.hpp>
+#include <mockturtle/networks/xag.hpp>
 #include <mockturtle/utils/stopwatch.hpp>
 
 #include "../utils/cirkit_command.hpp"
+#include "../utils/cut_arena.hpp"
+#include "../utils/dont_cares.hpp"
+#include "../utils/mc_database.hpp"
+#include "../utils/mc_optimization.hpp"
+#include "../utils/parallel_cuts.hpp"
+#include "../utils/thread_pool.hpp"
 
 namespace alice
 {
 
-namespace detail
-{
-template<class Ntk>
-struct mc_cost
-{
-  uint32_t operator()( Ntk const& ntk, mockturtle::node<Ntk> const& n ) const
-  {
-    return ntk.is_and( n ) ? 1 : 0;
-  }
-};
-} // namespace detail
-
 class minmc_command : public cirkit::cirkit_command<minmc_command, xag_t>
 {
 public:
@@ -58,8 +63,15 @@ public:
     add_option( "-k,--lutsize", ps.cut_enumeration_ps.cut_size, "cut size", true );
     add_option( "--lutcount", ps.cut_enumeration_ps.cut_limit, "cut limit", true );
     add_flag( "--progress,-p", ps.progress, "show progress" );
-    add_option( "--load", db, "load database" );
-    add_flag( "--verify" , "verify database when loading" );
+    add_option( "--load", db, "load database (text or compiled)" );
+    add_option( "--compile", compile_files, "compile text database into binary database" )->expected( 2 );
+    add_flag( "--keep", "keep compiled database loaded for all sessions of this process" );
+    add_flag( "--verify", "verify database when loading" );
+    add_option( "--threads", num_threads, "number of threads for cut classification (requires compiled database)", true );
+    add_flag( "--dc", use_dont_cares, "use don't cares of cut leaves" );
+    add_option( "--dc_window", dc_ps.window_size, "maximum number of inputs of don't-care windows", true );
+    add_flag( "--dc_sat", dc_ps.sat_validation, "prove don't cares beyond windows with SAT" );
+    add_option( "--cut_memory", cut_memory, "memory limit for cut sets in MB (0 for no limit)", true );
     add_flag( "--verbose,-v", ps.verbose, "be verbose" );
 
     ps.min_cand_cut_size = 2u;
@@ -68,46 +80,221 @@ public:
   rules validity_rules() const override
   {
     return {
-      {[this]() { return store<xag_t>().current_index() >= 0 || is_set( "load" ); }, "no current XAG available" },
-      {[this]() { return store<xag_t>().current_index() < 0 || is_set( "load" ) || resyn; }, "no database loaded" }
+      {[this]() { return store<xag_t>().current_index() >= 0 || is_set( "load" ) || is_set( "compile" ); }, "no current XAG available" },
+      {[this]() { return store<xag_t>().current_index() < 0 || is_set( "load" ) || mc_db; }, "no database loaded" }
     };
   }
 
   template<class Store>
   inline void execute_store()
   {
-    if ( is_set( "load" ) )
+    st = {};
+    executed = false;
+
+    if ( is_set( "compile" ) )
     {
-      mockturtle::xag_minmc_resynthesis_params params;
-      if ( is_set( "verify" ) )
-      {
-        params.verify_database = true;
-      }
-      resyn.reset( new mockturtle::xag_minmc_resynthesis( db, params ) );
+      compile( compile_files[0], compile_files[1] );
     }
 
-    if ( store<xag_t>().current_index() >= 0 )
+    if ( is_set( "load" ) && !load() )
     {
-      resyn->ps.print_stats = ps.verbose;
+      return;
+    }
+
+    if ( store<xag_t>().current_index() >= 0 && mc_db )
+    {
+      if ( num_threads > 1u && !mc_db.compiled )
+      {
+        env->err() << "[w] parallel MC rewriting requires a compiled database (see --compile), using one thread\n";
+      }
+      if ( !pool || pool->num_threads() != num_threads )
+      {
+        pool = std::make_shared<cirkit::thread_pool>( num_threads );
+      }
 
       auto* xag_p = static_cast<mockturtle::xag_network*>( store<xag_t>().current().get() );
-      mockturtle::cut_rewriting( *xag_p, *resyn, ps, &st, detail::mc_cost<mockturtle::xag_network>() );
-      *xag_p = mockturtle::cleanup_dangling( *xag_p );
+      dcs.set_params( dc_ps );
+      dcs.reset_stats();
+      if ( cut_memory != 0u && ps.cut_enumeration_ps.cut_size > cirkit::small_cut::max_size && cirkit::estimated_cut_memory( *xag_p ) > ( uint64_t( cut_memory ) << 20u ) )
+      {
+        env->err() << fmt::format( "[e] cut sets of sequential MC rewriting exceed the memory limit ({} MB)\n", cirkit::estimated_cut_memory( *xag_p ) >> 20u );
+        return;
+      }
+      if ( cut_memory != 0u && ps.cut_enumeration_ps.cut_size <= cirkit::small_cut::max_size && cirkit::parallel_cut_enumeration_min_memory( *xag_p ) > ( uint64_t( cut_memory ) << 20u ) )
+      {
+        env->err() << fmt::format( "[e] cut sets of constants and PIs exceed the memory limit ({} MB)\n", cirkit::parallel_cut_enumeration_min_memory( *xag_p ) >> 20u );
+        return;
+      }
+      cirkit::mc_rewriting( *xag_p, mc_db, ps, *pool, st, use_dont_cares ? &dcs : nullptr, uint64_t( cut_memory ) << 20u );
+      executed = true;
+      if ( use_dont_cares && ps.verbose )
+      {
+        dcs.stats().report();
+      }
     }
   }
 
   nlohmann::json log() const override
   {
+    if ( !executed )
+    {
+      return nullptr;
+    }
+
+    if ( st.parallel )
+    {
+      return {
+        {"time_total", mockturtle::to_seconds( st.pst.time_total )},
+        {"threads", num_threads},
+        {"evaluated", st.pst.num_evaluated},
+        {"rewrites", st.pst.num_rewrites},
+        {"cut_memory", st.pst.cut_memory},
+        {"capped", st.pst.num_capped}
+      };
+    }
+
+    return {
+      {"time_total", mockturtle::to_seconds( st.st.time_total )}
+    };
+  }
+
+  std::vector<std::pair<std::string, double>> phases() const override
+  {
+    if ( !executed )
+    {
+      return {};
+    }
+
+    if ( st.parallel )
+    {
+      return {
+        {"cuts", mockturtle::to_seconds( st.pst.time_cuts )},
+        {"evaluation", mockturtle::to_seconds( st.pst.time_evaluation )},
+        {"commit", mockturtle::to_seconds( st.pst.time_commit )}
+      };
+    }
+
     return {
-      {"time_total", mockturtle::to_seconds( st.time_total )}
+      {"cuts", mockturtle::to_seconds( st.st.time_cuts )},
+      {"rewriting", mockturtle::to_seconds( st.st.time_rewriting )},
+      {"mis", mockturtle::to_seconds( st.st.time_mis )}
     };
   }
 
+private:
+  bool load()
+  {
+    mc_db = cirkit::load_mc_rewriting_database( db, is_set( "verify" ), is_set( "keep" ) );
+    if ( !mc_db )
+    {
+      env->err() << fmt::format( "[e] cannot load database: {}\n", mc_db.error );
+      return false;
+    }
+    if ( mc_db.text && is_set( "keep" ) )
+    {
+      env->err() << "[w] only compiled databases can be kept loaded\n";
+    }
+    return true;
+  }
+
+  /* compiles a text database by building the structure of each class
+     representative with mockturtle's resynthesis; the first token of each
+     line is the truth table in hexadecimal, other lines are skipped */
+  void compile( std::string const& text_filename, std::string const& binary_filename )
+  {
+    std::ifstream in( text_filename );
+    if ( !in )
+    {
+      env->err() << fmt::format( "[e] cannot read database {}\n", text_filename );
+      return;
+    }
+
+    mockturtle::xag_minmc_resynthesis_params params;
+    params.verify_database = is_set( "verify" );
+    params.print_stats = false;
+    std::unique_ptr<mockturtle::xag_minmc_resynthesis> text_resyn;
+    try
+    {
+      text_resyn = std::make_unique<mockturtle::xag_minmc_resynthesis>( text_filename, params );
+    }
+    catch ( std::exception const& e )
+    {
+      env->err() << fmt::format( "[e] text database {} is invalid ({})\n", text_filename, e.what() );
+      return;
+    }
+
+    std::map<uint64_t, cirkit::npn_structure> entries;
+    uint32_t num_failed{0u};
+    std::string line;
+    while ( std::getline( in, line ) && !cirkit::is_cancelled() )
+    {
+      std::string token;
+      std::istringstream( line ) >> token;
+      if ( token.size() > 2u && token[0] == '0' && token[1] == 'x' )
+      {
+        token = token.substr( 2u );
+      }
+      if ( token.empty() || token.size() > 16u || ( token.size() & ( token.size() - 1u ) ) != 0u || !std::all_of( token.begin(), token.end(), ::isxdigit ) )
+      {
+        continue;
+      }
+
+      /* one hex digit has 2 variables */
+      auto num_vars = 2u;
+      while ( ( 1u << num_vars ) < 4u * token.size() )
+      {
+        ++num_vars;
+      }
+      kitty::dynamic_truth_table tt( num_vars );
+      kitty::create_from_hex_string( tt, token );
+
+      const auto t = cirkit::spectral_canonize( cirkit::expand_to_6_vars( tt ) );
+      if ( entries.count( t.representative ) )
+      {
+        continue;
+      }
+
+      mockturtle::xag_network xag;
+      std::vector<mockturtle::xag_network::signal> pis( 6u );
+      std::generate( pis.begin(), pis.end(), [&]() { return xag.create_pi(); } );
+
+      kitty::dynamic_truth_table repr( 6u );
+      kitty::create_from_words( repr, &t.representative, &t.representative + 1 );
+
+      bool found{false};
+      ( *text_resyn )( xag, repr, pis.begin(), pis.end(), [&]( auto const& f ) {
+        const auto s = cirkit::extract_npn_structure( xag, f, pis );
+        if ( s && cirkit::simulate_npn_structure( s->fanins.data(), s->num_gates(), s->output ) == t.representative )
+        {
+          entries[t.representative] = *s;
+          found = true;
+        }
+        return false;
+      } );
+      num_failed += found ? 0u : 1u;
+    }
+
+    if ( !cirkit::write_mc_database( binary_filename, entries ) )
+    {
+      env->err() << fmt::format( "[e] cannot write database {}\n", binary_filename );
+      return;
+    }
+    env->out() << fmt::format( "[i] compiled {} classes into {} ({} failed)\n", entries.size(), binary_filename, num_failed );
+  }
+
 private:
   std::string db;
-  std::shared_ptr<mockturtle::xag_minmc_resynthesis> resyn;
+  std::vector<std::string> compile_files;
+  cirkit::mc_rewriting_database mc_db;
   mockturtle::cut_rewriting_params ps;
-  mockturtle::cut_rewriting_stats st;
+  cirkit::mc_rewriting_stats st;
+  bool executed{false};
+  uint32_t num_threads{1u};
+  uint32_t cut_memory{0u};
+  std::shared_ptr<cirkit::thread_pool> pool;
+  bool use_dont_cares{false};
+  cirkit::dont_care_params dc_ps;
+  cirkit::windowed_dont_cares<mockturtle::xag_network> dcs;
 };
 
 ALICE_ADD_COMMAND( minmc, "Synthesis" )
@@ -90,8 +90,8 @@ public:
 
       if ( is_set( "trans" ) )
       {
-        std::cout << fmt::format( "[i] negations = {1:0{0}b}\n", tts.current().num_vars() + 1, std::get<1>( result ) );
-        std::cout << fmt::format( "[i] permutation = {}\n", fmt::join( std::get<2>( result ), ", " ) );
+        env->out() << fmt::format( "[i] negations = {1:0{0}b}\n", tts.current().num_vars() + 1, std::get<1>( result ) );
+        env->out() << fmt::format( "[i] permutation = {}\n", fmt::join( std::get<2>( result ), ", " ) );
       }
     }
 
@@ -0,0 +1,273 @@
+/* CirKit: A circuit toolkit
+ * Copyright (C) 2017-2019  EPFL
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <alice/alice.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <optional>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <fmt/format.h>
+#include <kitty/constructors.hpp>
+#include <kitty/dynamic_truth_table.hpp>
+#include <kitty/isop.hpp>
+#include <kitty/operations.hpp>
+#include <mockturtle/algorithms/cut_enumeration.hpp>
+#include <mockturtle/algorithms/node_resynthesis/exact.hpp>
+#include <mockturtle/networks/xag.hpp>
+#include <mockturtle/utils/stopwatch.hpp>
+
+#include "../utils/cirkit_command.hpp"
+#include "../utils/npn_database.hpp"
+#include "../utils/thread_pool.hpp"
+
+namespace alice
+{
+
+class npndb_command : public cirkit::cirkit_command<npndb_command, aig_t, xag_t>
+{
+public:
+  npndb_command( environment::ptr& env ) : cirkit::cirkit_command<npndb_command, aig_t, xag_t>( env, "Builds NPN database for cut rewriting", "collect cut functions from {0}" )
+  {
+    add_option( "filename,--filename", filename, "database file" );
+    add_option( "-k,--lutsize", cut_size, "cut size", true );
+    add_option( "--min_size", min_size, "smallest cut size to collect", true );
+    add_option( "--lutcount", cut_limit, "cut limit", true );
+    add_option( "--conflict_limit", conflict_limit, "conflict limit for exact synthesis", true );
+    add_option( "--threads", num_threads, "number of threads for synthesis", true );
+    add_flag( "--no_exact", "only use SOP structures" );
+    add_flag( "-a,--append", "add new classes to existing database" );
+    add_flag( "-v,--verbose", "show statistics" );
+  }
+
+  rules validity_rules() const override
+  {
+    auto r = cirkit::cirkit_command<npndb_command, aig_t, xag_t>::validity_rules();
+    r.push_back( {[this]() { return is_set( "filename" ); }, "no database file given"} );
+    r.push_back( {[this]() { return min_size >= 5u && min_size <= cut_size && cut_size <= 6u; }, "cut sizes must be between 5 and 6"} );
+    return r;
+  }
+
+  template<class Store>
+  inline void execute_store()
+  {
+    using base_type = typename Store::element_type::base_type;
+    auto const& ntk = *static_cast<base_type*>( store<Store>().current().get() );
+    constexpr bool with_xor = std::is_same_v<Store, xag_t>;
+    exact = !is_set( "no_exact" );
+
+    time_total = {};
+    if ( !build<base_type>( ntk, with_xor ) )
+    {
+      env->err() << fmt::format( "[e] cannot write database {}\n", filename );
+      return;
+    }
+
+    if ( is_set( "verbose" ) )
+    {
+      env->out() << fmt::format( "[i] classes = {}, synthesized = {}, entries = {} ({:.2f} secs)\n",
+                                 num_classes, num_synthesized, num_entries, mockturtle::to_seconds( time_total ) );
+    }
+  }
+
+  nlohmann::json log() const override
+  {
+    return {
+      {"time_total", mockturtle::to_seconds( time_total )},
+      {"classes", num_classes},
+      {"synthesized", num_synthesized},
+      {"entries_before", num_entries_before},
+      {"entries", num_entries}
+    };
+  }
+
+private:
+  template<class Ntk>
+  bool build( Ntk const& ntk, bool with_xor )
+  {
+    mockturtle::stopwatch t( time_total );
+
+    std::map<uint64_t, cirkit::npn_structure> entries;
+    if ( is_set( "append" ) )
+    {
+      if ( auto db = cirkit::npn_database::open( filename ) )
+      {
+        db->foreach_entry( [&]( auto const& e ) {
+          auto& s = entries[e.function];
+          s.fanins.assign( db->fanins( e ), db->fanins( e ) + 2u * e.num_gates );
+          s.output = e.output;
+        } );
+      }
+      else
+      {
+        env->err() << fmt::format( "[w] cannot read database {}, creating a new one\n", filename );
+      }
+    }
+    num_entries_before = static_cast<uint32_t>( entries.size() );
+
+    /* collect representatives of cut functions */
+    mockturtle::cut_enumeration_params cps;
+    cps.cut_size = cut_size;
+    cps.cut_limit = cut_limit;
+    const auto cuts = mockturtle::cut_enumeration<Ntk, true>( ntk, cps );
+
+    std::unordered_map<uint64_t, uint64_t> representative;
+    std::set<uint64_t> classes;
+    ntk.foreach_gate( [&]( auto const& n ) {
+      for ( auto& cut : cuts.cuts( ntk.node_to_index( n ) ) )
+      {
+        if ( cut->size() < min_size )
+        {
+          continue;
+        }
+        const auto word = cirkit::expand_to_6_vars( cuts.truth_table( *cut ) );
+        auto it = representative.find( word );
+        if ( it == representative.end() )
+        {
+          it = representative.emplace( word, cirkit::npn_canonize( word ).representative ).first;
+        }
+        classes.insert( it->second );
+      }
+    } );
+    num_classes = static_cast<uint32_t>( classes.size() );
+
+    std::vector<uint64_t> todo;
+    for ( auto c : classes )
+    {
+      if ( !entries.count( c ) )
+      {
+        todo.push_back( c );
+      }
+    }
+
+    /* synthesize structures for new classes */
+    if ( !pool || pool->num_threads() != num_threads )
+    {
+      pool = std::make_shared<cirkit::thread_pool>( num_threads );
+    }
+
+    std::vector<std::optional<cirkit::npn_structure>> structures( todo.size() );
+    pool->parallel_for( 0u, static_cast<uint32_t>( todo.size() ), [&]( uint32_t i, uint32_t ) {
+      if ( !cirkit::is_cancelled() )
+      {
+        structures[i] = synthesize( todo[i], with_xor );
+      }
+    } );
+
+    num_synthesized = 0u;
+    for ( auto i = 0u; i < todo.size(); ++i )
+    {
+      if ( structures[i] )
+      {
+        entries[todo[i]] = *structures[i];
+        ++num_synthesized;
+      }
+    }
+
+    num_entries = static_cast<uint32_t>( entries.size() );
+    return cirkit::write_npn_database( filename, entries );
+  }
+
+  /* smallest structure among the SOPs of the function and its complement and
+     the exact synthesis result (if found within the conflict limit) */
+  std::optional<cirkit::npn_structure> synthesize( uint64_t function, bool with_xor ) const
+  {
+    using signal = mockturtle::xag_network::signal;
+
+    mockturtle::xag_network ntk;
+    std::vector<signal> pis( 6u );
+    std::generate( pis.begin(), pis.end(), [&]() { return ntk.create_pi(); } );
+
+    kitty::dynamic_truth_table tt( 6u );
+    kitty::create_from_words( tt, &function, &function + 1 );
+
+    std::optional<cirkit::npn_structure> best;
+    const auto consider = [&]( signal const& f ) {
+      auto s = cirkit::extract_npn_structure( ntk, f, pis );
+      if ( s && cirkit::simulate_npn_structure( s->fanins.data(), s->num_gates(), s->output ) == function && ( !best || s->num_gates() < best->num_gates() ) )
+      {
+        best = s;
+      }
+    };
+
+    const auto sop = [&]( kitty::dynamic_truth_table const& on ) {
+      auto f = ntk.get_constant( false );
+      for ( auto const& cube : kitty::isop( on ) )
+      {
+        auto c = ntk.get_constant( true );
+        for ( auto i = 0u; i < 6u; ++i )
+        {
+          if ( cube.get_mask( i ) )
+          {
+            c = ntk.create_and( c, cube.get_bit( i ) ? pis[i] : ntk.create_not( pis[i] ) );
+          }
+        }
+        f = ntk.create_or( f, c );
+      }
+      return f;
+    };
+    consider( sop( tt ) );
+    consider( ntk.create_not( sop( ~tt ) ) );
+
+    if ( exact )
+    {
+      mockturtle::exact_resynthesis_params esps;
+      esps.conflict_limit = conflict_limit;
+      mockturtle::exact_aig_resynthesis<mockturtle::xag_network> resyn( with_xor, esps );
+      resyn( ntk, tt, pis.begin(), pis.end(), [&]( auto const& f ) {
+        consider( f );
+        return true;
+      } );
+    }
+
+    return best;
+  }
+
+private:
+  std::string filename;
+  uint32_t cut_size{6u};
+  uint32_t min_size{5u};
+  uint32_t cut_limit{8u};
+  int32_t conflict_limit{1000};
+  uint32_t num_threads{1u};
+  bool exact{true};
+  std::shared_ptr<cirkit::thread_pool> pool;
+
+  mockturtle::stopwatch<>::duration time_total{0};
+  uint32_t num_classes{0u};
+  uint32_t num_synthesized{0u};
+  uint32_t num_entries_before{0u};
+  uint32_t num_entries{0u};
+};
+
+ALICE_ADD_COMMAND( npndb, "Synthesis" )
+
+} // namespace alice
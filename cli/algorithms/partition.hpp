@@ -0,0 +1,224 @@
+/* CirKit: A circuit toolkit
+ * Copyright (C) 2017-2019  EPFL
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <alice/alice.hpp>
+#include <alice/detail/utils.hpp>
+
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <fmt/format.h>
+#include <mockturtle/utils/stopwatch.hpp>
+
+#include "../utils/cirkit_command.hpp"
+#include "../utils/compaction.hpp"
+#include "../utils/partitioning.hpp"
+#include "../utils/thread_pool.hpp"
+
+namespace alice
+{
+
+class partition_command : public cirkit::cirkit_command<partition_command, aig_t, xag_t, mig_t, xmg_t>
+{
+public:
+  partition_command( environment::ptr& env ) : cirkit::cirkit_command<partition_command, aig_t, xag_t, mig_t, xmg_t>( env, "Optimizes partitions of a network concurrently", "partition {0}" )
+  {
+    add_option( "--size", ps.size, "maximum number of gates per partition", true );
+    add_option( "--max_inputs", ps.max_inputs, "maximum number of inputs per partition (0 for no limit)", true );
+    add_option( "--max_outputs", ps.max_outputs, "maximum number of outputs per partition (0 for no limit)", true );
+    add_option( "-c,--command", command_line, "command that is applied to each partition" );
+    add_option( "--threads", num_threads, "number of partitions that are optimized concurrently", true );
+    add_flag( "-v,--verbose", "print statistics and output of commands" );
+  }
+
+  rules validity_rules() const override
+  {
+    auto r = cirkit::cirkit_command<partition_command, aig_t, xag_t, mig_t, xmg_t>::validity_rules();
+    r.push_back( {[this]() { return !command_line.empty(); }, "no command specified"} );
+    r.push_back( {[this]() { return env->spawn() != nullptr; }, "shell cannot create environments for partitions"} );
+    return r;
+  }
+
+  template<class Store>
+  inline void execute_store()
+  {
+    using network_type = typename Store::element_type;
+    using base_type = typename network_type::base_type;
+
+    partitions.clear();
+    mockturtle::stopwatch<>::duration total{0};
+
+    auto* ntk_p = static_cast<base_type*>( store<Store>().current().get() );
+    std::vector<std::string> outputs;
+    {
+      mockturtle::stopwatch t( total );
+
+      const auto windows = cirkit::partition_network( *ntk_p, ps );
+
+      std::vector<base_type> parts;
+      for ( auto const& w : windows )
+      {
+        parts.push_back( cirkit::extract_window( *ntk_p, w ) );
+      }
+
+      partitions.resize( windows.size() );
+      outputs.resize( windows.size() );
+
+      if ( !pool || pool->num_threads() != num_threads )
+      {
+        pool = std::make_shared<cirkit::thread_pool>( num_threads );
+      }
+
+      /* spawned environments do not know the aliases of the shell */
+      std::string expanded;
+      for ( auto const& line : alice::detail::split_with_quotes<';'>( command_line ) )
+      {
+        const auto step = alice::detail::trim_copy( line );
+        if ( !step.empty() )
+        {
+          expanded += ( expanded.empty() ? "" : "; " ) + cirkit::expand_alias( *env, step );
+        }
+      }
+
+      /* partitions are optimized in one environment per thread, which is
+         created from the shell factory */
+      std::vector<environment::ptr> envs( num_threads );
+      for ( auto& part_env : envs )
+      {
+        part_env = env->spawn();
+        part_env->store<Store>().extend();
+        part_env->set_default_option( store_info<Store>::option );
+      }
+
+      pool->parallel_for( 0u, static_cast<uint32_t>( windows.size() ), [&]( uint32_t i, uint32_t tid ) {
+        auto& stats = partitions[i];
+        stats.inputs = static_cast<uint32_t>( windows[i].inputs.size() );
+        stats.outputs = static_cast<uint32_t>( windows[i].outputs.size() );
+        stats.gates_before = stats.gates_after = parts[i].num_gates();
+
+        if ( cirkit::is_cancelled() )
+        {
+          stats.status = "skipped";
+          return;
+        }
+
+        mockturtle::stopwatch<>::duration time{0};
+        {
+          mockturtle::stopwatch t_part( time );
+
+          auto& part_env = envs[tid];
+          std::ostringstream out;
+          part_env->reroute( out, out );
+          part_env->store<Store>().current() = std::make_shared<network_type>( parts[i] );
+
+          const auto success = part_env->execute( expanded );
+          auto const& result = *part_env->store<Store>().current();
+          if ( success && result.num_pis() == parts[i].num_pis() && result.num_pos() == parts[i].num_pos() )
+          {
+            parts[i] = static_cast<base_type const&>( result );
+            cirkit::compact_dangling( parts[i] );
+            stats.gates_after = parts[i].num_gates();
+            stats.status = "success";
+          }
+          else
+          {
+            stats.status = "failed";
+          }
+          outputs[i] = out.str();
+        }
+        stats.time = mockturtle::to_seconds( time );
+      } );
+
+      gates_before = ntk_p->num_gates();
+      auto stitched = cirkit::stitch_windows( *ntk_p, windows, parts );
+      cirkit::compact_dangling( stitched );
+      *ntk_p = stitched;
+      gates_after = ntk_p->num_gates();
+    }
+    time_total = mockturtle::to_seconds( total );
+
+    if ( is_set( "verbose" ) )
+    {
+      for ( auto i = 0u; i < partitions.size(); ++i )
+      {
+        auto const& stats = partitions[i];
+        env->out() << fmt::format( "[i] partition {:>5}   i/o = {:>5}/{:<5}   gates = {:>7} -> {:<7}   {:>6.2f} secs   {}\n",
+                                   i, stats.inputs, stats.outputs, stats.gates_before, stats.gates_after, stats.time, stats.status );
+        env->out() << outputs[i];
+      }
+    }
+    env->out() << fmt::format( "[i] {} partitions, gates = {} -> {}\n", partitions.size(), gates_before, gates_after );
+  }
+
+  nlohmann::json log() const override
+  {
+    nlohmann::json parts;
+    for ( auto const& stats : partitions )
+    {
+      parts.push_back( {
+        {"inputs", stats.inputs},
+        {"outputs", stats.outputs},
+        {"gates_before", stats.gates_before},
+        {"gates_after", stats.gates_after},
+        {"time", stats.time},
+        {"status", stats.status}
+      } );
+    }
+
+    return {
+      {"partitions", parts},
+      {"gates_before", gates_before},
+      {"gates_after", gates_after},
+      {"time_total", time_total}
+    };
+  }
+
+private:
+  struct partition_stats
+  {
+    uint32_t inputs{0u};
+    uint32_t outputs{0u};
+    uint32_t gates_before{0u};
+    uint32_t gates_after{0u};
+    double time{0.0};
+    std::string status;
+  };
+
+  cirkit::partitioning_params ps;
+  std::string command_line;
+  uint32_t num_threads{1u};
+  std::shared_ptr<cirkit::thread_pool> pool;
+
+  std::vector<partition_stats> partitions;
+  uint32_t gates_before{0u};
+  uint32_t gates_after{0u};
+  double time_total{0.0};
+};
+
+ALICE_ADD_COMMAND( partition, "Synthesis" )
+
+} // namespace alice
@@ -25,84 +25,237 @@
 
 #include <alice/alice.hpp>
 
-#include <mockturtle/algorithms/cleanup.hpp>
+#include <string>
+
 #include <mockturtle/algorithms/refactoring.hpp>
 #include <mockturtle/algorithms/node_resynthesis/akers.hpp>
+#include <mockturtle/algorithms/node_resynthesis/bidecomposition.hpp>
+#include <mockturtle/algorithms/node_resynthesis/dsd.hpp>
 #include <mockturtle/algorithms/node_resynthesis/mig_npn.hpp>
+#include <mockturtle/algorithms/node_resynthesis/shannon.hpp>
+#include <mockturtle/algorithms/node_resynthesis/xag_npn.hpp>
 #include <mockturtle/algorithms/node_resynthesis/xmg_npn.hpp>
 
 #include "../utils/cirkit_command.hpp"
+#include "../utils/compaction.hpp"
+#include "../utils/dont_cares.hpp"
+#include "../utils/network_cost.hpp"
+#include "../utils/refactoring.hpp"
 
 namespace alice
 {
 
-class refactor_command : public cirkit::cirkit_command<refactor_command, mig_t, xmg_t>
+class refactor_command : public cirkit::cirkit_command<refactor_command, aig_t, mig_t, xag_t, xmg_t>
 {
 public:
-  refactor_command( environment::ptr& env ) : cirkit::cirkit_command<refactor_command, mig_t, xmg_t>( env, "Performs cut rewriting", "apply cut rewriting to {0}" )
+  refactor_command( environment::ptr& env ) : cirkit::cirkit_command<refactor_command, aig_t, mig_t, xag_t, xmg_t>( env, "Performs cut rewriting", "apply cut rewriting to {0}" )
   {
     add_option( "--max_pis", ps.max_pis, "maximum number of PIs in MFFC", true );
-    add_option( "--strategy", strategy, "resynthesis strategy", true )->set_type_name( "strategy in {mignpn=0, akers=1}" );
+    add_option( "--strategy", strategy, "resynthesis strategy", true )->set_type_name( "strategy in {npn=0, akers/bidec=1, dsd=2}" );
+    add_option( "--cost", cost, "cost function", true )->set_type_name( "cost in {size, depth, size_depth, mc}" );
     add_flag( "-z,--zero_gain", ps.allow_zero_gain, "enable zero-gain refactoring" );
+    add_flag( "--dc", ps.use_dont_cares, "use don't cares of MFFC leaves" );
+    add_option( "--dc_window", dc_ps.window_size, "maximum number of inputs of don't-care windows", true );
+    add_flag( "--dc_sat", dc_ps.sat_validation, "prove don't cares beyond windows with SAT" );
     add_flag( "-p,--progress", ps.progress, "show progress" );
     add_flag( "-v,--verbose", ps.verbose, "show statistics" );
   }
 
+  rules validity_rules() const override
+  {
+    auto r = cirkit::cirkit_command<refactor_command, aig_t, mig_t, xag_t, xmg_t>::validity_rules();
+    r.push_back( {[this]() { return cirkit::cost_function_from_string( cost ).has_value(); }, "unknown cost function"} );
+    return r;
+  }
+
   template<class Store>
   inline void execute_store()
   {
+    cost_kind = *cirkit::cost_function_from_string( cost );
+    if ( cost_kind == cirkit::cost_function::mc && !std::is_same_v<Store, aig_t> && !std::is_same_v<Store, xag_t> )
+    {
+      env->err() << "[e] cost function mc is only supported for AIGs and XAGs\n";
+      return;
+    }
+
+    if constexpr ( std::is_same_v<Store, aig_t> )
+    {
+      refactor( *static_cast<mockturtle::aig_network*>( store<Store>().current().get() ) );
+    }
+    else if constexpr ( std::is_same_v<Store, mig_t> )
+    {
+      refactor( *static_cast<mockturtle::mig_network*>( store<Store>().current().get() ) );
+    }
+    else if constexpr ( std::is_same_v<Store, xag_t> )
+    {
+      refactor( *static_cast<mockturtle::xag_network*>( store<Store>().current().get() ) );
+    }
+    else if constexpr ( std::is_same_v<Store, xmg_t> )
+    {
+      refactor( *static_cast<mockturtle::xmg_network*>( store<Store>().current().get() ) );
+    }
+  }
+
+  nlohmann::json log() const override
+  {
+    if ( cirkit_engine )
+    {
+      return {
+        {"time_total", mockturtle::to_seconds( cst.time_total )},
+        {"cost", cost},
+        {"rewrites", cst.num_rewrites},
+        {"cache_hits", cst.num_cache_hits}
+      };
+    }
+
+    return {
+      {"time_total", mockturtle::to_seconds( st.time_total )},
+      {"cost", cost}
+    };
+  }
+
+private:
+  /* MIGs and XMGs resynthesize MFFCs with Akers' method (strategy 1), AIGs
+     and XAGs with bi-decomposition; the NPN databases (strategy 0) only cover
+     4-input functions, larger MFFC functions of AIGs and XAGs are decomposed
+     by DSD and Shannon decomposition first */
+  template<class Ntk>
+  void refactor( Ntk& ntk )
+  {
+    constexpr auto is_xag = std::is_same_v<Ntk, mockturtle::aig_network> || std::is_same_v<Ntk, mockturtle::xag_network>;
+
     switch ( strategy )
     {
     default:
     case 0:
     {
-      if constexpr ( std::is_same_v<Store, mig_t> )
+      if constexpr ( is_xag )
+      {
+        mockturtle::xag_npn_resynthesis<Ntk> npn_resyn;
+        mockturtle::shannon_resynthesis<Ntk, decltype( npn_resyn )> shannon_resyn( 4u, &npn_resyn );
+        mockturtle::dsd_resynthesis<Ntk, decltype( shannon_resyn )> resyn( shannon_resyn );
+        refactor( ntk, resyn );
+      }
+      else if constexpr ( std::is_same_v<Ntk, mockturtle::mig_network> )
       {
-        auto* mig_p = static_cast<mockturtle::mig_network*>( store<Store>().current().get() );
         mockturtle::mig_npn_resynthesis resyn;
-        mockturtle::refactoring( *mig_p, resyn, ps );
-        *mig_p = cleanup_dangling( *mig_p );
+        refactor( ntk, resyn );
       }
-      else if constexpr ( std::is_same_v<Store, xmg_t> )
+      else
       {
-        auto* xmg_p = static_cast<mockturtle::xmg_network*>( store<Store>().current().get() );
         mockturtle::xmg_npn_resynthesis resyn;
-        mockturtle::refactoring( *xmg_p, resyn, ps );
-        *xmg_p = cleanup_dangling( *xmg_p );
+        refactor( ntk, resyn );
       }
     }
     break;
     case 1:
     {
-      if constexpr ( std::is_same_v<Store, mig_t> )
+      if constexpr ( is_xag )
       {
-        auto* mig_p = static_cast<mockturtle::mig_network*>( store<Store>().current().get() );
-        mockturtle::akers_resynthesis<mockturtle::mig_network> resyn;
-        mockturtle::refactoring( *mig_p, resyn, ps );
-        *mig_p = cleanup_dangling( *mig_p );
+        mockturtle::bidecomposition_resynthesis<Ntk> resyn;
+        refactor( ntk, resyn );
       }
-      else if constexpr ( std::is_same_v<Store, xmg_t> )
+      else
       {
-        auto* xmg_p = static_cast<mockturtle::xmg_network*>( store<Store>().current().get() );
-        mockturtle::akers_resynthesis<mockturtle::xmg_network> resyn;
-        mockturtle::refactoring( *xmg_p, resyn, ps );
-        *xmg_p = cleanup_dangling( *xmg_p );
+        mockturtle::akers_resynthesis<Ntk> resyn;
+        refactor( ntk, resyn );
       }
     }
+    break;
+    case 2:
+    {
+      mockturtle::shannon_resynthesis<Ntk> shannon_resyn;
+      mockturtle::dsd_resynthesis<Ntk, decltype( shannon_resyn )> resyn( shannon_resyn );
+      refactor( ntk, resyn );
+    }
+    break;
     }
   }
 
-  nlohmann::json log() const override
+  template<class Ntk, class ResynFn>
+  void refactor( Ntk& ntk, ResynFn& resyn )
   {
-   return {
-      {"time_total", mockturtle::to_seconds( st.time_total )}
-    };
+    if constexpr ( std::is_same_v<Ntk, mockturtle::aig_network> || std::is_same_v<Ntk, mockturtle::xag_network> )
+    {
+      if ( cost_kind == cirkit::cost_function::mc )
+      {
+        refactor( ntk, resyn, cirkit::mc_cost<Ntk>() );
+        return;
+      }
+    }
+    refactor( ntk, resyn, cirkit::unit_cost<Ntk>() );
+  }
+
+  /* depth-aware cost functions, don't cares, and the MC cost need cirkit's
+     refactoring engine, which is also used for all AIGs and XAGs to reuse
+     resynthesis results of MFFCs with the same function; resynthesis
+     functions without don't-care support try several completions of the MFFC
+     function */
+  template<class Ntk, class ResynFn, class NodeCostFn>
+  void refactor( Ntk& ntk, ResynFn& resyn, NodeCostFn const& cost_fn )
+  {
+    const auto level_constrained = cost_kind == cirkit::cost_function::depth || cost_kind == cirkit::cost_function::size_depth;
+    cirkit_engine = level_constrained || ps.use_dont_cares || std::is_same_v<Ntk, mockturtle::aig_network> || std::is_same_v<Ntk, mockturtle::xag_network>;
+    if ( cirkit_engine )
+    {
+      cirkit::refactoring_params cps;
+      cps.max_pis = ps.max_pis;
+      cps.allow_zero_gain = ps.allow_zero_gain;
+      cps.cost = cost_kind;
+      cps.verbose = ps.verbose;
+
+      if ( ps.use_dont_cares )
+      {
+        auto& dcs = dont_cares<Ntk>();
+        dcs.set_params( dc_ps );
+        cirkit::dont_care_resynthesis<ResynFn&> dc_resyn( resyn );
+        cirkit::refactoring( ntk, cirkit::cancellable_resynthesis( dc_resyn ), cps, &cst, cost_fn, &dcs );
+        dcs.remap( ntk, cirkit::compact_dangling( ntk ) );
+        return;
+      }
+      cirkit::refactoring( ntk, cirkit::cancellable_resynthesis( resyn ), cps, &cst, cost_fn );
+    }
+    else
+    {
+      mockturtle::refactoring( ntk, cirkit::cancellable_resynthesis( resyn ), ps, &st );
+    }
+    cirkit::compact_dangling( ntk );
+  }
+
+  template<class Ntk>
+  cirkit::windowed_dont_cares<Ntk>& dont_cares()
+  {
+    if constexpr ( std::is_same_v<Ntk, mockturtle::aig_network> )
+    {
+      return aig_dcs;
+    }
+    else if constexpr ( std::is_same_v<Ntk, mockturtle::mig_network> )
+    {
+      return mig_dcs;
+    }
+    else if constexpr ( std::is_same_v<Ntk, mockturtle::xag_network> )
+    {
+      return xag_dcs;
+    }
+    else
+    {
+      return xmg_dcs;
+    }
   }
 
 private:
   mockturtle::refactoring_params ps;
   mockturtle::refactoring_stats st;
+  cirkit::refactoring_stats cst;
   unsigned strategy{0u};
+  std::string cost{"size"};
+  cirkit::cost_function cost_kind{cirkit::cost_function::size};
+  bool cirkit_engine{false};
+  cirkit::dont_care_params dc_ps;
+  cirkit::windowed_dont_cares<mockturtle::aig_network> aig_dcs;
+  cirkit::windowed_dont_cares<mockturtle::mig_network> mig_dcs;
+  cirkit::windowed_dont_cares<mockturtle::xag_network> xag_dcs;
+  cirkit::windowed_dont_cares<mockturtle::xmg_network> xmg_dcs;
 };
 
 ALICE_ADD_COMMAND( refactor, "Synthesis" )
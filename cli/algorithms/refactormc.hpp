@@ -28,56 +28,60 @@
 #include <memory>
 #include <string>
 
-#include <mockturtle/algorithms/cleanup.hpp>
 #include <mockturtle/algorithms/refactoring.hpp>
-#include <mockturtle/algorithms/node_resynthesis/bidecomposition.hpp>
 #include <mockturtle/utils/stopwatch.hpp>
 
 #include "../utils/cirkit_command.hpp"
+#include "../utils/dont_cares.hpp"
+#include "../utils/mc_optimization.hpp"
+#include "../utils/thread_pool.hpp"
 
 namespace alice
 {
 
-namespace detail
-{
-template<class Ntk>
-struct mc_cost2
-{
-  uint32_t operator()( Ntk const& ntk, mockturtle::node<Ntk> const& n ) const
-  {
-    return ntk.is_and( n ) ? 1 : 0;
-  }
-};
-} // namespace detail
-
 class refactormc_command : public cirkit::cirkit_command<refactormc_command, xag_t>
 {
 public:
   refactormc_command( environment::ptr& env ) : cirkit::cirkit_command<refactormc_command, xag_t>( env, "Optimizes for multiplicative complexity", "applies optimization to {0}" )
   {
     add_flag( "--dc", ps.use_dont_cares, "use don't cares for optimization" );
+    add_option( "--dc_window", dc_ps.window_size, "maximum number of inputs of don't-care windows", true );
+    add_flag( "--dc_sat", dc_ps.sat_validation, "prove don't cares beyond windows with SAT" );
     add_flag( "--progress,-p", ps.progress, "show progress" );
+    add_option( "--threads", num_threads, "number of windows that are refactored concurrently", true );
+    add_option( "--window_size", window_size, "maximum number of gates per window with --threads (0 for 10000 gates)", true );
   }
 
   template<class Store>
   inline void execute_store()
   {
-    mockturtle::bidecomposition_resynthesis<mockturtle::xag_network> bi_resyn;
+    if ( !pool || pool->num_threads() != num_threads )
+    {
+      pool = std::make_shared<cirkit::thread_pool>( num_threads );
+    }
+
+    st = {};
     auto* xag_p = static_cast<mockturtle::xag_network*>( store<xag_t>().current().get() );
-    mockturtle::refactoring( *xag_p, bi_resyn, ps, &st, detail::mc_cost2<mockturtle::xag_network>());
-    *xag_p = mockturtle::cleanup_dangling( *xag_p );
+    dcs.set_params( dc_ps );
+    cirkit::mc_refactoring( *xag_p, ps, *pool, window_size, st, &dcs );
   }
 
   nlohmann::json log() const override
   {
     return {
-      {"time_total", mockturtle::to_seconds( st.time_total )}
+      {"time_total", mockturtle::to_seconds( st.time_total )},
+      {"threads", num_threads}
     };
   }
 
 private:
   mockturtle::refactoring_params ps;
   mockturtle::refactoring_stats st;
+  uint32_t num_threads{1u};
+  uint32_t window_size{0u};
+  std::shared_ptr<cirkit::thread_pool> pool;
+  cirkit::dont_care_params dc_ps;
+  cirkit::windowed_dont_cares<mockturtle::xag_network> dcs;
 };
 
 ALICE_ADD_COMMAND( refactormc, "Synthesis" )
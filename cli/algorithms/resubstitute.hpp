@@ -25,70 +25,201 @@
 
 #include <alice/alice.hpp>
 
-#include <mockturtle/algorithms/cleanup.hpp>
+#include <algorithm>
+#include <memory>
+#include <string>
+
+#include <fmt/format.h>
 #include <mockturtle/algorithms/resubstitution.hpp>
 #include <mockturtle/algorithms/aig_resub.hpp>
 #include <mockturtle/algorithms/mig_resub.hpp>
 
 #include "../utils/cirkit_command.hpp"
+#include "../utils/compaction.hpp"
+#include "../utils/network_cost.hpp"
+#include "../utils/parallel_resubstitution.hpp"
+#include "../utils/thread_pool.hpp"
 
 namespace alice
 {
 
-class resub_command : public cirkit::cirkit_command<resub_command, aig_t, mig_t, xag_t, xmg_t>
+class resub_command : public cirkit::cirkit_command<resub_command, aig_t, mig_t, xag_t, xmg_t, klut_t>
 {
 public:
-  resub_command( environment::ptr& env ) : cirkit::cirkit_command<resub_command, aig_t, mig_t, xag_t, xmg_t>( env, "Performs resubstitution", "apply resubstitution to {0}" )
+  resub_command( environment::ptr& env ) : cirkit::cirkit_command<resub_command, aig_t, mig_t, xag_t, xmg_t, klut_t>( env, "Performs resubstitution", "apply resubstitution to {0}" )
   {
     add_option( "--max_pis", ps.max_pis, "maximum number of PIs in reconvergence-driven window", true );
     add_option( "--max_divisors", ps.max_divisors, "maximum number of divisors to consider", true );
     add_option( "--skip_fanout_limit_for_roots", ps.skip_fanout_limit_for_roots, "maximum fanout of a node to be considered as root", true );
     add_option( "--skip_fanout_limit_for_divisors", ps.skip_fanout_limit_for_divisors, "maximum fanout of a node to be considered as divisor", true );
-    add_option( "--depth", ps.max_inserts, "maximum number of nodes inserted by resubstitution", true );
+    add_option( "--depth", ps.max_inserts, "maximum number of nodes inserted by resubstitution (at most 2 with more than one thread, the cost functions depth and mc, and for LUT networks)", true );
+    add_option( "--cost", cost, "cost function (mc only for AIGs and XAGs, depth not for MIGs)", true )->set_type_name( "cost in {size, depth, size_depth, mc}" );
+    add_option( "--threads", num_threads, "number of threads that evaluate windows concurrently (AIGs, XAGs, XMGs, and LUT networks)", true );
+    add_option( "--lut_size", lut_size, "maximum fanin size of a new LUT in LUT networks (at most 6)", true );
     // add_flag( "-z,--zero_gain", ps.zero_gain, "enable zero-gain resubstitution" );
     add_flag( "-p,--progress", ps.progress, "show progress" );
     add_flag( "-v,--verbose", ps.verbose, "show statistics" );
   }
 
+  rules validity_rules() const override
+  {
+    auto r = cirkit::cirkit_command<resub_command, aig_t, mig_t, xag_t, xmg_t, klut_t>::validity_rules();
+    r.push_back( {[this]() { return cirkit::cost_function_from_string( cost ).has_value(); }, "unknown cost function"} );
+    r.push_back( {[this]() { return lut_size >= 1u && lut_size <= 6u; }, "LUT size must be between 1 and 6"} );
+    return r;
+  }
+
   template<class Store>
   inline void execute_store()
   {
+    st = {};
+    pst = {};
+    executed = false;
+
+    cost_kind = *cirkit::cost_function_from_string( cost );
+    if ( cost_kind == cirkit::cost_function::mc && !std::is_same_v<Store, aig_t> && !std::is_same_v<Store, xag_t> )
+    {
+      env->err() << "[e] cost function mc is only supported for AIGs and XAGs\n";
+      return;
+    }
+    if ( cost_kind == cirkit::cost_function::depth && std::is_same_v<Store, mig_t> )
+    {
+      env->err() << "[e] cost function depth is not supported for MIGs\n";
+      return;
+    }
+
+    /* size_depth rejects substitutions that increase the level of the root,
+       using the levels that mockturtle's resubstitution maintains */
+    ps.preserve_depth = cost_kind == cirkit::cost_function::size_depth;
+
     if constexpr ( std::is_same_v<Store, aig_t> )
     {
       auto* aig_p = static_cast<mockturtle::aig_network*>( store<Store>().current().get() );
-      mockturtle::aig_resubstitution( *aig_p, ps, &st );
-      *aig_p = cleanup_dangling( *aig_p );
+      resubstitute( *aig_p, [&]() { mockturtle::aig_resubstitution( *aig_p, ps, &st ); } );
     }
     else if constexpr ( std::is_same_v<Store, mig_t> )
     {
       auto* mig_p = static_cast<mockturtle::mig_network*>( store<Store>().current().get() );
-      mockturtle::mig_resubstitution( *mig_p, ps, &st );
-      *mig_p = cleanup_dangling( *mig_p );
+      resubstitute( *mig_p, [&]() { mockturtle::mig_resubstitution( *mig_p, ps, &st ); } );
     }
     else if constexpr ( std::is_same_v<Store, xag_t> )
     {
       auto* xag_p = static_cast<mockturtle::xag_network*>( store<Store>().current().get() );
-      mockturtle::resubstitution( *xag_p, ps, &st );
-      *xag_p = cleanup_dangling( *xag_p );
+      resubstitute( *xag_p, [&]() { mockturtle::resubstitution( *xag_p, ps, &st ); } );
     }
     else if constexpr ( std::is_same_v<Store, xmg_t> )
     {
       auto* xmg_p = static_cast<mockturtle::xmg_network*>( store<Store>().current().get() );
-      mockturtle::resubstitution( *xmg_p, ps, &st );
-      *xmg_p = cleanup_dangling( *xmg_p );
+      resubstitute( *xmg_p, [&]() { mockturtle::resubstitution( *xmg_p, ps, &st ); } );
+    }
+    else if constexpr ( std::is_same_v<Store, klut_t> )
+    {
+      auto* klut_p = static_cast<mockturtle::klut_network*>( store<Store>().current().get() );
+      resubstitute( *klut_p, []() {} );
     }
   }
 
   nlohmann::json log() const override
   {
-   return {
-      {"time_total", mockturtle::to_seconds( st.time_total )}
+    if ( !executed )
+    {
+      return nullptr;
+    }
+
+    return {
+      {"time_total", mockturtle::to_seconds( parallel ? pst.time_total : st.time_total )},
+      {"cost", cost},
+      {"threads", parallel ? num_threads : 1u}
+    };
+  }
+
+  std::vector<std::pair<std::string, double>> phases() const override
+  {
+    if ( !executed )
+    {
+      return {};
+    }
+
+    if ( parallel )
+    {
+      return {
+        {"evaluation", mockturtle::to_seconds( pst.time_evaluation )},
+        {"commit", mockturtle::to_seconds( pst.time_commit )}
+      };
+    }
+    return {
+      {"cuts", mockturtle::to_seconds( st.time_cuts )},
+      {"mffc", mockturtle::to_seconds( st.time_mffc )},
+      {"divisors", mockturtle::to_seconds( st.time_divs )},
+      {"simulation", mockturtle::to_seconds( st.time_simulation )},
+      {"substitute", mockturtle::to_seconds( st.time_substitute )}
     };
   }
 
+private:
+  /* with more than one thread, windows and divisors are evaluated
+     concurrently on the unchanged network and substitutions are committed
+     sequentially; the depth and mc cost functions use this engine also with
+     one thread; the parallel engine inserts at most two AND, OR, or XOR
+     gates and is the only engine for LUT networks, in which it inserts at
+     most one LUT; it has no MAJ divisors, which mockturtle's
+     mig_resubstitution uses, therefore MIGs always use the latter, while
+     XMGs, which use mockturtle's generic AND/OR/XOR resubstitution, are
+     supported */
+  template<class Ntk, class Fn>
+  void resubstitute( Ntk& ntk, Fn&& sequential )
+  {
+    constexpr auto is_mig = std::is_same_v<Ntk, mockturtle::mig_network>;
+    if ( is_mig && num_threads > 1u )
+    {
+      env->err() << "[w] parallel resubstitution has no MAJ divisors, using sequential resubstitution\n";
+    }
+
+    /* mockturtle's resubstitution has neither the depth nor the mc cost */
+    const auto cirkit_cost = cost_kind == cirkit::cost_function::depth || cost_kind == cirkit::cost_function::mc;
+    parallel = ( ( num_threads > 1u || cirkit_cost ) && !is_mig ) || std::is_same_v<Ntk, mockturtle::klut_network>;
+    if ( parallel )
+    {
+      if ( ps.max_inserts > 2u )
+      {
+        env->err() << fmt::format( "[w] parallel resubstitution inserts at most 2 nodes, using depth 2 instead of {}\n", ps.max_inserts );
+      }
+
+      if ( !pool || pool->num_threads() != num_threads )
+      {
+        pool = std::make_shared<cirkit::thread_pool>( num_threads );
+      }
+
+      cirkit::parallel_resubstitution_params pps;
+      pps.max_pis = ps.max_pis;
+      pps.max_divisors = ps.max_divisors;
+      pps.max_inserts = std::min<uint32_t>( ps.max_inserts, 2u );
+      pps.skip_fanout_limit_for_roots = ps.skip_fanout_limit_for_roots;
+      pps.skip_fanout_limit_for_divisors = ps.skip_fanout_limit_for_divisors;
+      pps.lut_size = lut_size;
+      pps.cost = cost_kind;
+      pps.verbose = ps.verbose;
+      cirkit::parallel_resubstitution( ntk, *pool, pps, &pst );
+    }
+    else
+    {
+      sequential();
+    }
+    cirkit::compact_dangling( ntk );
+    executed = true;
+  }
+
 private:
   mockturtle::resubstitution_params ps;
   mockturtle::resubstitution_stats st;
+  cirkit::parallel_resubstitution_stats pst;
+  std::string cost{"size"};
+  cirkit::cost_function cost_kind{cirkit::cost_function::size};
+  uint32_t num_threads{1u};
+  uint32_t lut_size{6u};
+  bool parallel{false};
+  bool executed{false};
+  std::shared_ptr<cirkit::thread_pool> pool;
 };
 
 ALICE_ADD_COMMAND( resub, "Synthesis" )
@@ -25,9 +25,14 @@
 
 #include <alice/alice.hpp>
 
+#include <memory>
+
 #include <mockturtle/algorithms/satlut_mapping.hpp>
 
 #include "../utils/cirkit_command.hpp"
+#include "../utils/cut_arena.hpp"
+#include "../utils/parallel_satlut_mapping.hpp"
+#include "../utils/thread_pool.hpp"
 
 namespace alice
 {
@@ -41,18 +46,63 @@ public:
     add_option( "--lutcount", ps.cut_enumeration_ps.cut_limit, "number of cuts per node", true );
     add_option( "--conflict_limit", ps.conflict_limit, "conflict limit (0 to disable)", true );
     add_option( "--window_size", window_size, "window size (0 for no windowing)", true );
+    add_option( "--cut_memory", cut_memory, "memory limit for cut sets in MB (0 for no limit)", true );
+    add_option( "--threads", num_threads, "number of threads for solving windows", true );
     add_flag( "--nofun", "do not compute cut functions" );
+    add_flag( "-v,--verbose", "show statistics" );
   }
 
   template<class Store>
   inline void execute_store()
   {
+    st = {};
+    pst = {};
+    executed = false;
+
+    /* mockturtle's cut sets have a fixed size per node, the limit can only
+       be enforced by rejecting the network; parallel windows enumerate cuts
+       in extracted windows only */
+    cut_bytes = cirkit::estimated_cut_memory( *( store<Store>().current() ) );
+    if ( cut_memory != 0u && cut_bytes > ( uint64_t( cut_memory ) << 20u ) && !( window_size > 0 && num_threads > 1u ) )
+    {
+      env->err() << fmt::format( "[e] cut sets exceed the memory limit ({} MB)\n", cut_bytes >> 20u );
+      return;
+    }
+
+    parallel = false;
     if ( window_size > 0 )
     {
       if ( !store<Store>().current()->has_mapping() )
       {
         env->err() << "[e] windowed mapping requires network to be pre-mapped (e.g., with lut_mapping)\n";
+        return;
       }
+
+      /* disjoint windows are solved concurrently, each with its own solver */
+      if ( num_threads > 1u )
+      {
+        if ( !pool || pool->num_threads() != num_threads )
+        {
+          pool = std::make_shared<cirkit::thread_pool>( num_threads );
+        }
+
+        cirkit::parallel_satlut_mapping_params pps;
+        pps.window_size = window_size;
+        pps.satlut_ps = ps;
+        pps.verbose = is_set( "verbose" );
+        if ( is_set( "nofun" ) )
+        {
+          cirkit::parallel_satlut_mapping( *( store<Store>().current() ), *pool, pps, &pst );
+        }
+        else
+        {
+          cirkit::parallel_satlut_mapping<typename Store::element_type, true>( *( store<Store>().current() ), *pool, pps, &pst );
+        }
+        parallel = true;
+        executed = true;
+        return;
+      }
+
       if ( is_set( "nofun" ) )
       {
         mockturtle::satlut_mapping( *( store<Store>().current() ), window_size, ps, &st );
@@ -61,7 +111,6 @@ public:
       {
         mockturtle::satlut_mapping<typename Store::element_type, true>( *( store<Store>().current() ), window_size, ps, &st );
       }
-      
     }
     else
     {
@@ -74,19 +123,79 @@ public:
         mockturtle::satlut_mapping<typename Store::element_type, true>( *( store<Store>().current() ), ps, &st );
       }
     }
+    executed = true;
   }
 
   nlohmann::json log() const override
   {
+    if ( !executed )
+    {
+      return nullptr;
+    }
+
+    if ( parallel )
+    {
+      auto windows = nlohmann::json::array();
+      for ( auto const& w : pst.windows )
+      {
+        windows.push_back( {
+          {"cells_before", w.cells_before},
+          {"cells_after", w.cells_after},
+          {"gain", w.committed ? w.cells_before - w.cells_after : 0u},
+          {"time_sat", mockturtle::to_seconds( w.time_sat )},
+          {"cut_memory", w.cut_memory},
+          {"solved", w.solved},
+          {"committed", w.committed}
+        } );
+      }
+
+      return {
+        {"time_total", mockturtle::to_seconds( pst.time_total )},
+        {"threads", num_threads},
+        {"cells_before", pst.cells_before},
+        {"cells_after", pst.cells_after},
+        {"cut_memory", pst.cut_memory},
+        {"windows", windows}
+      };
+    }
+
+    return {
+      {"time_total", mockturtle::to_seconds( st.time_total )},
+      {"cut_memory", cut_bytes}
+    };
+  }
+
+  std::vector<std::pair<std::string, double>> phases() const override
+  {
+    if ( !executed )
+    {
+      return {};
+    }
+
+    if ( parallel )
+    {
+      return {
+        {"windows", mockturtle::to_seconds( pst.time_windows )},
+        {"commit", mockturtle::to_seconds( pst.time_commit )}
+      };
+    }
+
     return {
-      {"time_total", mockturtle::to_seconds( st.time_total )}
+      {"sat", mockturtle::to_seconds( st.time_sat )}
     };
   }
 
 private:
   mockturtle::satlut_mapping_params ps;
   mockturtle::satlut_mapping_stats st;
+  cirkit::parallel_satlut_mapping_stats pst;
+  std::shared_ptr<cirkit::thread_pool> pool;
   unsigned window_size{32u};
+  uint32_t num_threads{1u};
+  bool parallel{false};
+  bool executed{false};
+  uint32_t cut_memory{0u};
+  uint64_t cut_bytes{0u};
 };
 
 ALICE_ADD_COMMAND( satlut_mapping, "Mapping" )
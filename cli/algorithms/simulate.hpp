@@ -63,13 +63,13 @@ public:
         {
           if ( is_set( "binary" ) )
           {
-            kitty::print_binary( result );
+            kitty::print_binary( result, env->out() );
           }
           else
           {
-            kitty::print_hex( result );
+            kitty::print_hex( result, env->out() );
           }
-          std::cout << "\n";
+          env->out() << "\n";
         }
         if ( is_set( "store" ) )
         {
@@ -99,6 +99,12 @@ public:
     return {{"tables", j}};
   }
 
+  /*! \brief Simulation results of the last run with `--log` */
+  std::vector<kitty::dynamic_truth_table> const& results() const
+  {
+    return tables;
+  }
+
 private:
   std::vector<kitty::dynamic_truth_table> tables;
 };
@@ -0,0 +1,165 @@
+/* CirKit: A circuit toolkit
+ * Copyright (C) 2017-2019  EPFL
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+  C functions to exchange networks with the current store elements as flat
+  arrays (see `utils/flat_network.hpp` for the encoding).  This file is
+  included by `cirkit.cpp` after `ALICE_MAIN` when building the C bindings,
+  and relies on the `cli_t` type defined by that macro.  The corresponding
+  declarations are in `cirkit.h`.
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <memory>
+
+#include "stores/aig.hpp"
+#include "stores/klut.hpp"
+#include "stores/mig.hpp"
+#include "stores/xag.hpp"
+#include "stores/xmg.hpp"
+#include "utils/flat_network.hpp"
+
+namespace cirkit::detail
+{
+
+/* calls fn with a default-constructed pointer of the store element type */
+template<class Fn>
+int dispatch_gate_store( const char* store, Fn&& fn )
+{
+  if ( std::strcmp( store, "aig" ) == 0 )
+  {
+    return fn( alice::aig_t() );
+  }
+  else if ( std::strcmp( store, "xag" ) == 0 )
+  {
+    return fn( alice::xag_t() );
+  }
+  else if ( std::strcmp( store, "mig" ) == 0 )
+  {
+    return fn( alice::mig_t() );
+  }
+  else if ( std::strcmp( store, "xmg" ) == 0 )
+  {
+    return fn( alice::xmg_t() );
+  }
+  return -1;
+}
+
+} // namespace cirkit::detail
+
+extern "C"
+{
+  /* returns the fanin size per gate (2 or 3), or -1 if the store is unknown or empty */
+  DLLEXPORT int cirkit_network_size( void* p, const char* store, uint32_t* num_pis, uint32_t* num_gates, uint32_t* num_pos )
+  {
+    auto cli = reinterpret_cast<cli_t*>( p );
+    return cirkit::detail::dispatch_gate_store( store, [&]( auto tag ) {
+      using element_t = decltype( tag );
+      auto& s = cli->env->template store<element_t>();
+      if ( s.empty() )
+      {
+        return -1;
+      }
+      cirkit::flat_network_size( *s.current(), *num_pis, *num_gates, *num_pos );
+      return static_cast<int>( cirkit::flat_fanin_size<typename element_t::element_type>() );
+    } );
+  }
+
+  /* writes the current network into arrays sized by cirkit_network_size; gate_types may be NULL */
+  DLLEXPORT int cirkit_export_network( void* p, const char* store, uint32_t* fanins, uint8_t* gate_types, uint32_t* pos )
+  {
+    auto cli = reinterpret_cast<cli_t*>( p );
+    return cirkit::detail::dispatch_gate_store( store, [&]( auto tag ) {
+      auto& s = cli->env->template store<decltype( tag )>();
+      if ( s.empty() )
+      {
+        return -1;
+      }
+      cirkit::write_flat_network( *s.current(), fanins, gate_types, pos );
+      return 0;
+    } );
+  }
+
+  /* adds a network from flat arrays to the store; gate_types may be NULL */
+  DLLEXPORT int cirkit_import_network( void* p, const char* store, uint32_t num_pis, uint32_t num_gates, const uint32_t* fanins, const uint8_t* gate_types, uint32_t num_pos, const uint32_t* pos )
+  {
+    auto cli = reinterpret_cast<cli_t*>( p );
+    return cirkit::detail::dispatch_gate_store( store, [&]( auto tag ) {
+      using element_t = decltype( tag );
+      using nt = typename element_t::element_type;
+      using base_nt = typename nt::base_type;
+
+      const auto ntk = cirkit::read_flat_network<base_nt>( num_pis, num_gates, fanins, gate_types, num_pos, pos );
+      if ( !ntk )
+      {
+        return -1;
+      }
+      cli->env->template store<element_t>().extend() = std::make_shared<nt>( *ntk );
+      return 0;
+    } );
+  }
+
+  /* returns 0, or -1 if the LUT store is empty */
+  DLLEXPORT int cirkit_lut_network_size( void* p, uint32_t* num_pis, uint32_t* num_luts, uint32_t* num_fanins, uint32_t* num_words, uint32_t* num_pos )
+  {
+    auto cli = reinterpret_cast<cli_t*>( p );
+    auto& s = cli->env->template store<alice::klut_t>();
+    if ( s.empty() )
+    {
+      return -1;
+    }
+    cirkit::flat_lut_network_size( *s.current(), *num_pis, *num_luts, *num_fanins, *num_words, *num_pos );
+    return 0;
+  }
+
+  /* writes the current LUT network into arrays sized by cirkit_lut_network_size (num_luts + 1 offsets) */
+  DLLEXPORT int cirkit_export_lut_network( void* p, uint32_t* fanin_offsets, uint32_t* fanins, uint64_t* functions, uint32_t* pos )
+  {
+    auto cli = reinterpret_cast<cli_t*>( p );
+    auto& s = cli->env->template store<alice::klut_t>();
+    if ( s.empty() )
+    {
+      return -1;
+    }
+    cirkit::write_flat_lut_network( *s.current(), fanin_offsets, fanins, functions, pos );
+    return 0;
+  }
+
+  /* adds a LUT network from flat arrays to the store; returns -1 for malformed arrays */
+  DLLEXPORT int cirkit_import_lut_network( void* p, uint32_t num_pis, uint32_t num_luts, const uint32_t* fanin_offsets, uint32_t num_fanins, const uint32_t* fanins, uint32_t num_words, const uint64_t* functions, uint32_t num_pos, const uint32_t* pos )
+  {
+    auto cli = reinterpret_cast<cli_t*>( p );
+    const auto ntk = cirkit::read_flat_lut_network( num_pis, num_luts, fanin_offsets, num_fanins, fanins, num_words, functions, num_pos, pos );
+    if ( !ntk )
+    {
+      return -1;
+    }
+    cli->env->template store<alice::klut_t>().extend() = std::make_shared<alice::klut_nt>( *ntk );
+    return 0;
+  }
+}
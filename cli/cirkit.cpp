@@ -37,19 +37,25 @@
 #include "stores/xag.hpp"
 #include "stores/xmg.hpp"
 
+#include "algorithms/autotune.hpp"
+#include "algorithms/balance.hpp"
 #include "algorithms/collapse_mapping.hpp"
 #include "algorithms/cut_rewrite.hpp"
 #include "algorithms/equivalence_checking.hpp"
 #include "algorithms/exact.hpp"
+#include "algorithms/flow.hpp"
 #include "algorithms/genmod.hpp"
 #include "algorithms/lut_mapping.hpp"
 #include "algorithms/lut_resynthesis.hpp"
 #include "algorithms/mccost.hpp"
+#include "algorithms/mcopt.hpp"
 #include "algorithms/migcost.hpp"
 #include "algorithms/mighty.hpp"
 #include "algorithms/minmc.hpp"
 #include "algorithms/miter.hpp"
 #include "algorithms/npn.hpp"
+#include "algorithms/npndb.hpp"
+#include "algorithms/partition.hpp"
 #include "algorithms/print_gates.hpp"
 #include "algorithms/refactor.hpp"
 #include "algorithms/refactormc.hpp"
@@ -59,4 +65,12 @@
 #include "algorithms/spectral.hpp"
 #include "algorithms/tt.hpp"
 
+#if defined ALICE_PYTHON
+#include "python.hpp"
+#endif
+
 ALICE_MAIN( cirkit )
+
+#if defined ALICE_CINTERFACE
+#include "cinterface.hpp"
+#endif
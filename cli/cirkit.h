@@ -0,0 +1,74 @@
+/* CirKit: A circuit toolkit
+ * Copyright (C) 2017-2019  EPFL
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+  C bindings of the cirkit_c shared library (built with -DBUILD_CBINDINGS=ON)
+
+  Networks are exchanged as flat arrays.  Node index 0 is constant 0, indexes
+  1 to num_pis are the primary inputs, and gates follow in topological order.
+  A literal is twice the node index plus one if complemented.  Gates that do
+  not lead to an output are not exported.  Array sizes are queried first, and
+  the caller then passes buffers of that size.
+*/
+
+#ifndef CIRKIT_H
+#define CIRKIT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void* cirkit_create();
+void cirkit_delete( void* p );
+
+/* executes a command; returns -1 on failure, otherwise the size of the JSON
+   log (0 if there is none), which is copied into log if non-NULL */
+int cirkit_command( void* p, const char* cmd, char* log, size_t size );
+
+/* returns the size (including the terminating zero) of the JSON log of the
+   last command, and copies it into log if size is large enough */
+size_t cirkit_log( void* p, char* log, size_t size );
+
+/* store is one of "aig", "xag", "mig", "xmg"; gates have 2 (aig, xag) or 3
+   (mig, xmg) fanin literals; gate_types (may be NULL) is 1 for XOR (xag) or
+   XOR3 (xmg) gates and 0 otherwise */
+int cirkit_network_size( void* p, const char* store, uint32_t* num_pis, uint32_t* num_gates, uint32_t* num_pos );
+int cirkit_export_network( void* p, const char* store, uint32_t* fanins, uint8_t* gate_types, uint32_t* pos );
+int cirkit_import_network( void* p, const char* store, uint32_t num_pis, uint32_t num_gates, const uint32_t* fanins, const uint8_t* gate_types, uint32_t num_pos, const uint32_t* pos );
+
+/* LUT i has fanins fanins[fanin_offsets[i]] to fanins[fanin_offsets[i + 1] - 1]
+   and its truth table in max(1, 2^(k - 6)) consecutive words of functions */
+int cirkit_lut_network_size( void* p, uint32_t* num_pis, uint32_t* num_luts, uint32_t* num_fanins, uint32_t* num_words, uint32_t* num_pos );
+int cirkit_export_lut_network( void* p, uint32_t* fanin_offsets, uint32_t* fanins, uint64_t* functions, uint32_t* pos );
+int cirkit_import_lut_network( void* p, uint32_t num_pis, uint32_t num_luts, const uint32_t* fanin_offsets, uint32_t num_fanins, const uint32_t* fanins, uint32_t num_words, const uint64_t* functions, uint32_t num_pos, const uint32_t* pos );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,206 @@
+/* CirKit: A circuit toolkit
+ * Copyright (C) 2017-2019  EPFL
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+  Python functions that return NumPy arrays, which are filled directly from
+  the binary representation of store elements.  This file is included by
+  `cirkit.cpp` when building the Python module.
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <string>
+
+#include <alice/alice.hpp>
+#include <kitty/dynamic_truth_table.hpp>
+#include <pybind11/numpy.h>
+
+#include "algorithms/simulate.hpp"
+#include "stores/aig.hpp"
+#include "stores/klut.hpp"
+#include "stores/mig.hpp"
+#include "stores/tt.hpp"
+#include "stores/xag.hpp"
+#include "stores/xmg.hpp"
+#include "utils/flat_network.hpp"
+
+namespace alice
+{
+
+namespace detail
+{
+
+/* copies truth tables with the same number of variables into the rows of a 2D array */
+template<class Iterator>
+py::array_t<uint64_t> truth_tables_to_array( Iterator begin, Iterator end )
+{
+  const auto num_tables = static_cast<std::size_t>( std::distance( begin, end ) );
+  const auto num_blocks = num_tables == 0u ? 0u : begin->num_blocks();
+  if ( std::any_of( begin, end, [&]( auto const& tt ) { return tt.num_blocks() != num_blocks; } ) )
+  {
+    throw py::value_error( "truth tables must have the same number of variables" );
+  }
+
+  py::array_t<uint64_t> array( {num_tables, num_blocks} );
+  auto* data = array.mutable_data();
+  without_gil( [&]() {
+    for ( auto it = begin; it != end; ++it )
+    {
+      data = std::copy( it->cbegin(), it->cend(), data );
+    }
+  } );
+  return array;
+}
+
+template<class Ntk>
+py::dict network_to_arrays( Ntk const& ntk )
+{
+  uint32_t num_pis, num_gates, num_pos;
+  without_gil( [&]() { cirkit::flat_network_size( ntk, num_pis, num_gates, num_pos ); } );
+
+  py::array_t<uint32_t> fanins( {static_cast<std::size_t>( num_gates ), static_cast<std::size_t>( cirkit::flat_fanin_size<Ntk>() )} );
+  py::array_t<uint8_t> gate_types( num_gates );
+  py::array_t<uint32_t> pos( num_pos );
+  auto* fanins_data = fanins.mutable_data();
+  auto* gate_types_data = gate_types.mutable_data();
+  auto* pos_data = pos.mutable_data();
+  without_gil( [&]() { cirkit::write_flat_network( ntk, fanins_data, gate_types_data, pos_data ); } );
+
+  py::dict d;
+  d["num_pis"] = num_pis;
+  d["fanins"] = fanins;
+  d["gate_types"] = gate_types;
+  d["pos"] = pos;
+  return d;
+}
+
+template<class Ntk>
+py::dict lut_network_to_arrays( Ntk const& ntk )
+{
+  uint32_t num_pis, num_luts, num_fanins, num_words, num_pos;
+  without_gil( [&]() { cirkit::flat_lut_network_size( ntk, num_pis, num_luts, num_fanins, num_words, num_pos ); } );
+
+  py::array_t<uint32_t> fanin_offsets( num_luts + 1u );
+  py::array_t<uint32_t> fanins( num_fanins );
+  py::array_t<uint64_t> functions( num_words );
+  py::array_t<uint32_t> pos( num_pos );
+  auto* fanin_offsets_data = fanin_offsets.mutable_data();
+  auto* fanins_data = fanins.mutable_data();
+  auto* functions_data = functions.mutable_data();
+  auto* pos_data = pos.mutable_data();
+  without_gil( [&]() { cirkit::write_flat_lut_network( ntk, fanin_offsets_data, fanins_data, functions_data, pos_data ); } );
+
+  py::dict d;
+  d["num_pis"] = num_pis;
+  d["fanin_offsets"] = fanin_offsets;
+  d["fanins"] = fanins;
+  d["functions"] = functions;
+  d["pos"] = pos;
+  return d;
+}
+
+template<class T>
+py::object network_store_to_arrays( const environment::ptr& env )
+{
+  if ( env->store<T>().empty() )
+  {
+    throw py::value_error( fmt::format( "no current {} in store", store_info<T>::name ) );
+  }
+  return network_to_arrays( *env->store<T>().current() );
+}
+
+} // namespace detail
+
+ALICE_ADD_PYTHON_FUNCTION( tt_array, env, kwargs, "Returns the current truth table (or all truth tables with all=True) as array of 64-bit words" )
+{
+  auto const& tts = env->store<kitty::dynamic_truth_table>();
+  if ( kwargs.contains( "all" ) && kwargs["all"].cast<bool>() )
+  {
+    return detail::truth_tables_to_array( tts.data().begin(), tts.data().end() );
+  }
+
+  if ( tts.empty() )
+  {
+    throw py::value_error( "no current truth table in store" );
+  }
+  auto const& tt = tts.current();
+  py::array_t<uint64_t> array( tt.num_blocks() );
+  auto* data = array.mutable_data();
+  detail::without_gil( [&]() { std::copy( tt.cbegin(), tt.cend(), data ); } );
+  return array;
+}
+
+ALICE_ADD_PYTHON_FUNCTION( simulate_array, env, kwargs, "Simulates the current network and returns one row of 64-bit words per output" )
+{
+  auto cmd = std::dynamic_pointer_cast<simulate_command>( env->commands().at( "simulate" ) );
+
+  auto pargs = detail::make_args( "simulate", kwargs );
+  pargs.push_back( "--silent" );
+  pargs.push_back( "--log" );
+  if ( !detail::without_gil( [&]() { return cmd->run( pargs ); } ) )
+  {
+    throw py::value_error( "simulate failed, see error output for details" );
+  }
+
+  return detail::truth_tables_to_array( cmd->results().begin(), cmd->results().end() );
+}
+
+ALICE_ADD_PYTHON_FUNCTION( network_arrays, env, kwargs, "Returns the current network (store=aig|xag|mig|xmg|lut) as dictionary of arrays" )
+{
+  const auto store = kwargs.contains( "store" ) ? kwargs["store"].cast<std::string>() : std::string( "aig" );
+
+  if ( store == "aig" )
+  {
+    return detail::network_store_to_arrays<aig_t>( env );
+  }
+  else if ( store == "xag" )
+  {
+    return detail::network_store_to_arrays<xag_t>( env );
+  }
+  else if ( store == "mig" )
+  {
+    return detail::network_store_to_arrays<mig_t>( env );
+  }
+  else if ( store == "xmg" )
+  {
+    return detail::network_store_to_arrays<xmg_t>( env );
+  }
+  else if ( store == "lut" )
+  {
+    if ( env->store<klut_t>().empty() )
+    {
+      throw py::value_error( "no current LUT network in store" );
+    }
+    return detail::lut_network_to_arrays( *env->store<klut_t>().current() );
+  }
+
+  throw py::value_error( fmt::format( "unknown store {}", store ) );
+}
+
+} // namespace alice
@@ -84,7 +84,7 @@ ALICE_READ_FILE( aig_t, aiger, filename, cmd )
   lorina::diagnostic_engine diag;
   if ( lorina::read_aiger( filename, mockturtle::aiger_reader( aig ), &diag ) != lorina::return_code::success )
   {
-    std::cout << "[w] parse error\n";
+    cmd.env->out() << "[w] parse error\n";
   }
   return std::make_shared<aig_nt>( aig );
 }
@@ -101,7 +101,7 @@ ALICE_READ_FILE( aig_t, verilog, filename, cmd )
   lorina::diagnostic_engine diag;
   if ( lorina::read_verilog( filename, mockturtle::verilog_reader( aig ), &diag ) != lorina::return_code::success )
   {
-    std::cout << "[w] parse error\n";
+    cmd.env->out() << "[w] parse error\n";
   }
   return std::make_shared<aig_nt>( aig );
 }
@@ -83,7 +83,7 @@ ALICE_READ_FILE( klut_t, aiger, filename, cmd )
   lorina::diagnostic_engine diag;
   if ( lorina::read_aiger( filename, mockturtle::aiger_reader( named_klut ), &diag ) != lorina::return_code::success )
   {
-    std::cout << "[w] parse error\n";
+    cmd.env->out() << "[w] parse error\n";
   }
   return std::make_shared<klut_nt>( named_klut );
 }
@@ -96,7 +96,7 @@ ALICE_READ_FILE( klut_t, bench, filename, cmd )
   lorina::diagnostic_engine diag;
   if ( lorina::read_bench( filename, mockturtle::bench_reader( named_klut ), &diag ) != lorina::return_code::success )
   {
-    std::cout << "[w] parse error\n";
+    cmd.env->out() << "[w] parse error\n";
   }
   return std::make_shared<klut_nt>( named_klut );
 }
@@ -120,7 +120,7 @@ ALICE_READ_FILE( klut_t, blif, filename, cmd )
   lorina::diagnostic_engine diag;
   if ( lorina::read_blif( filename, mockturtle::blif_reader( named_klut ), &diag ) != lorina::return_code::success )
   {
-    std::cout << "[w] parse error\n";
+    cmd.env->out() << "[w] parse error\n";
   }
   return std::make_shared<klut_nt>( named_klut );
 }
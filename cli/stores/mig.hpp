@@ -81,7 +81,7 @@ ALICE_READ_FILE( mig_t, aiger, filename, cmd )
   lorina::diagnostic_engine diag;
   if ( lorina::read_aiger( filename, mockturtle::aiger_reader( mig ), &diag ) != lorina::return_code::success )
   {
-    std::cout << "[w] parse error\n";
+    cmd.env->out() << "[w] parse error\n";
   }
   return std::make_shared<mig_nt>( mig );
 }
@@ -104,7 +104,7 @@ ALICE_READ_FILE( mig_t, verilog, filename, cmd )
   lorina::diagnostic_engine diag;
   if ( lorina::read_verilog( filename, mockturtle::verilog_reader( mig ), &diag ) != lorina::return_code::success )
   {
-    std::cout << "[w] parse error\n";
+    cmd.env->out() << "[w] parse error\n";
   }
   return std::make_shared<mig_nt>( mig );
 }
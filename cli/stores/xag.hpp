@@ -98,7 +98,7 @@ ALICE_READ_FILE( xag_t, verilog, filename, cmd )
   lorina::diagnostic_engine diag;
   if ( lorina::read_verilog( filename, mockturtle::verilog_reader( xag ), &diag ) != lorina::return_code::success )
   {
-    std::cout << "[w] parse error\n";
+    cmd.env->out() << "[w] parse error\n";
   }
   return std::make_shared<xag_nt>( xag );
 }
@@ -82,7 +82,7 @@ ALICE_READ_FILE( xmg_t, aiger, filename, cmd )
   lorina::diagnostic_engine diag;
   if ( lorina::read_aiger( filename, mockturtle::aiger_reader( xmg ), &diag ) != lorina::return_code::success )
   {
-    std::cout << "[w] parse error\n";
+    cmd.env->out() << "[w] parse error\n";
   }
   return std::make_shared<xmg_nt>( xmg );
 }
@@ -105,7 +105,7 @@ ALICE_READ_FILE( xmg_t, verilog, filename, cmd )
   lorina::diagnostic_engine diag;
   if ( lorina::read_verilog( filename, mockturtle::verilog_reader( xmg ), &diag ) != lorina::return_code::success )
   {
-    std::cout << "[w] parse error\n";
+    cmd.env->out() << "[w] parse error\n";
   }
   return std::make_shared<xmg_nt>( xmg );
 }
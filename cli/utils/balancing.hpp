@@ -0,0 +1,645 @@
+/* CirKit: A circuit toolkit
+ * Copyright (C) 2017-2019  EPFL
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <optional>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+#include <fmt/format.h>
+#include <kitty/constructors.hpp>
+#include <kitty/cube.hpp>
+#include <kitty/dynamic_truth_table.hpp>
+#include <kitty/isop.hpp>
+#include <kitty/operators.hpp>
+#include <mockturtle/networks/aig.hpp>
+#include <mockturtle/networks/xag.hpp>
+#include <mockturtle/networks/xmg.hpp>
+#include <mockturtle/utils/stopwatch.hpp>
+#include <mockturtle/views/topo_view.hpp>
+
+#include "compaction.hpp"
+#include "network_cost.hpp"
+#include "output_stream.hpp"
+
+namespace cirkit
+{
+
+struct balancing_params
+{
+  /*! \brief Only collect supergates through nodes with a single fanout */
+  bool area_aware{false};
+
+  /*! \brief Maximum number of leaves when collecting supergates through nodes with multiple fanouts */
+  uint32_t max_leaves{16u};
+
+  /*! \brief Rebuild small cuts from their SOPs if this lowers the arrival time */
+  bool sop_balancing{false};
+
+  /*! \brief Maximum number of leaves of a cut for SOP balancing */
+  uint32_t cut_size{6u};
+
+  /*! \brief Show statistics */
+  bool verbose{false};
+};
+
+struct balancing_stats
+{
+  mockturtle::stopwatch<>::duration time_total{0};
+
+  uint32_t num_supergates{0u};
+  uint32_t num_sop_cuts{0u};
+  uint32_t depth_before{0u};
+  uint32_t depth_after{0u};
+
+  void report( std::ostream& os = output_stream() ) const
+  {
+    os << fmt::format( "[i] supergates = {:>8d}\n", num_supergates );
+    os << fmt::format( "[i] SOP cuts   = {:>8d}\n", num_sop_cuts );
+    os << fmt::format( "[i] depth      = {:>8d} -> {}\n", depth_before, depth_after );
+    os << fmt::format( "[i] total time = {:>5.2f} secs\n", mockturtle::to_seconds( time_total ) );
+  }
+};
+
+namespace detail
+{
+
+enum class supergate_kind : uint8_t
+{
+  none,
+  conjunction,
+  exclusive
+};
+
+template<class Ntk>
+class balancing_impl
+{
+public:
+  using node = typename Ntk::node;
+  using signal = typename Ntk::signal;
+
+  balancing_impl( Ntk const& ntk, balancing_params const& ps, balancing_stats& st )
+      : ntk( ntk ),
+        ps( ps ),
+        st( st )
+  {
+  }
+
+  Ntk run()
+  {
+    const auto size = ntk.size();
+    kinds.resize( size, supergate_kind::none );
+    inverted.resize( size, 0u );
+    needed.resize( size, 0u );
+    first_leaf.resize( size, 0u );
+    num_leaves.resize( size, 0u );
+    fanouts.resize( size, 0u );
+    copies.resize( size );
+    ntk.foreach_node( [&]( auto const& n ) {
+      fanouts[ntk.node_to_index( n )] = ntk.fanout_size( n );
+    } );
+
+    std::vector<node> order;
+    {
+      mockturtle::topo_view topo{ntk};
+      topo.foreach_node( [&]( auto const& n ) {
+        order.push_back( n );
+      } );
+    }
+
+    /* supergates of all nodes that are used by outputs or as supergate
+       leaves, collected from the outputs towards the inputs */
+    ntk.foreach_po( [&]( auto const& f ) {
+      needed[ntk.node_to_index( ntk.get_node( f ) )] = 1u;
+    } );
+    for ( auto it = order.rbegin(); it != order.rend(); ++it )
+    {
+      const auto index = ntk.node_to_index( *it );
+      if ( needed[index] && !ntk.is_constant( *it ) && !ntk.is_pi( *it ) )
+      {
+        collect_supergate( *it );
+      }
+    }
+
+    /* rebuild needed nodes in topological order, balanced by arrival time */
+    ntk.foreach_pi( [&]( auto const& n ) {
+      copies[ntk.node_to_index( n )] = res.create_pi();
+    } );
+    arrival.resize( res.size(), 0u );
+
+    for ( auto const& n : order )
+    {
+      const auto index = ntk.node_to_index( n );
+      if ( ntk.is_constant( n ) )
+      {
+        copies[index] = res.get_constant( ntk.constant_value( n ) );
+      }
+      else if ( needed[index] && !ntk.is_pi( n ) )
+      {
+        copies[index] = rebuild( n );
+      }
+    }
+
+    ntk.foreach_po( [&]( auto const& f ) {
+      res.create_po( copy( f ) );
+    } );
+
+    compact_dangling( res );
+    return res;
+  }
+
+private:
+  /* the function of a gate as conjunction or exclusive-or of its (possibly
+     complemented) fanins; `inv` is the complement of the output */
+  template<class Fn>
+  supergate_kind decompose( node const& n, bool& inv, Fn&& fn ) const
+  {
+    inv = false;
+    if constexpr ( std::is_same_v<Ntk, mockturtle::xmg_network> )
+    {
+      /* AND, OR, and XOR gates are majority and XOR3 gates with a constant
+         first fanin */
+      std::vector<signal> fanins;
+      ntk.foreach_fanin( n, [&]( auto const& f ) {
+        fanins.push_back( f );
+      } );
+      if ( !ntk.is_constant( ntk.get_node( fanins[0] ) ) )
+      {
+        return supergate_kind::none;
+      }
+      const auto value = ntk.is_complemented( fanins[0] );
+      if ( ntk.is_xor3( n ) )
+      {
+        inv = value;
+        fn( fanins[1] );
+        fn( fanins[2] );
+        return supergate_kind::exclusive;
+      }
+      inv = value;
+      fn( value ? !fanins[1] : fanins[1] );
+      fn( value ? !fanins[2] : fanins[2] );
+      return supergate_kind::conjunction;
+    }
+    else
+    {
+      ntk.foreach_fanin( n, [&]( auto const& f ) {
+        fn( f );
+      } );
+      if constexpr ( std::is_same_v<Ntk, mockturtle::xag_network> )
+      {
+        if ( ntk.is_xor( n ) )
+        {
+          return supergate_kind::exclusive;
+        }
+      }
+      return supergate_kind::conjunction;
+    }
+  }
+
+  /* leaves of the supergate rooted in n; conjunctions are collected through
+     uncomplemented conjunctions, exclusive-ors through exclusive-ors, whose
+     output complements are moved to the root */
+  void collect_supergate( node const& n )
+  {
+    const auto index = ntk.node_to_index( n );
+    bool inv{false};
+    std::vector<signal> stack;
+    const auto kind = decompose( n, inv, [&]( auto const& f ) { stack.push_back( f ); } );
+
+    kinds[index] = kind;
+    first_leaf[index] = static_cast<uint32_t>( leaves.size() );
+
+    while ( !stack.empty() && kind != supergate_kind::none )
+    {
+      const auto f = stack.back();
+      stack.pop_back();
+
+      const auto m = ntk.get_node( f );
+      const auto num = static_cast<uint32_t>( leaves.size() ) - first_leaf[index] + static_cast<uint32_t>( stack.size() ) + 1u;
+      if ( !ntk.is_constant( m ) && !ntk.is_pi( m ) && ( fanouts[ntk.node_to_index( m )] == 1u || ( !ps.area_aware && num < ps.max_leaves ) ) )
+      {
+        bool m_inv{false};
+        std::vector<signal> m_fanins;
+        const auto m_kind = decompose( m, m_inv, [&]( auto const& g ) { m_fanins.push_back( g ); } );
+        if ( m_kind == kind && ( kind == supergate_kind::exclusive || m_inv == ntk.is_complemented( f ) ) )
+        {
+          if ( kind == supergate_kind::exclusive )
+          {
+            inv ^= m_inv ^ ntk.is_complemented( f );
+          }
+          std::copy( m_fanins.begin(), m_fanins.end(), std::back_inserter( stack ) );
+          continue;
+        }
+      }
+      leaves.push_back( f );
+      needed[ntk.node_to_index( m )] = 1u;
+    }
+
+    if ( kind == supergate_kind::none )
+    {
+      ntk.foreach_fanin( n, [&]( auto const& f ) {
+        leaves.push_back( f );
+        needed[ntk.node_to_index( ntk.get_node( f ) )] = 1u;
+      } );
+    }
+    else
+    {
+      ++st.num_supergates;
+    }
+
+    inverted[index] = inv;
+    num_leaves[index] = static_cast<uint32_t>( leaves.size() ) - first_leaf[index];
+  }
+
+  signal rebuild( node const& n )
+  {
+    const auto index = ntk.node_to_index( n );
+    const auto begin = leaves.begin() + first_leaf[index];
+    const auto end = begin + num_leaves[index];
+
+    if ( kinds[index] == supergate_kind::none )
+    {
+      std::vector<signal> children;
+      std::transform( begin, end, std::back_inserter( children ), [&]( auto const& f ) { return copy( f ); } );
+      return create( [&]() { return res.clone_node( ntk, n, children ); }, children );
+    }
+
+    std::vector<signal> operands;
+    std::transform( begin, end, std::back_inserter( operands ), [&]( auto const& f ) { return copy( f ); } );
+    auto f = kinds[index] == supergate_kind::conjunction ? balanced_and( operands ) : balanced_xor( operands );
+    f = inverted[index] ? res.create_not( f ) : f;
+
+    if ( ps.sop_balancing )
+    {
+      if ( const auto g = sop_balance( n ); g && arrival_of( *g ) < arrival_of( f ) )
+      {
+        ++st.num_sop_cuts;
+        return *g;
+      }
+    }
+    return f;
+  }
+
+  signal copy( signal const& f ) const
+  {
+    const auto s = copies[ntk.node_to_index( ntk.get_node( f ) )];
+    return ntk.is_complemented( f ) ? !s : s;
+  }
+
+  uint32_t arrival_of( signal const& f ) const
+  {
+    return arrival[res.node_to_index( res.get_node( f ) )];
+  }
+
+  /* creates a gate and derives its arrival time from its children; nodes
+     returned by structural hashing already have one */
+  template<class CreateFn>
+  signal create( CreateFn&& create_fn, std::vector<signal> const& children )
+  {
+    const auto size = res.size();
+    const auto f = create_fn();
+    const auto index = res.node_to_index( res.get_node( f ) );
+    if ( index >= size )
+    {
+      arrival.resize( res.size(), 0u );
+      uint32_t level{0u};
+      for ( auto const& c : children )
+      {
+        level = std::max( level, arrival_of( c ) );
+      }
+      arrival[index] = level + 1u;
+    }
+    return f;
+  }
+
+  /* combines the two operands with the earliest arrival times until one
+     operand is left */
+  template<class CreateFn>
+  signal balanced( std::vector<signal> operands, CreateFn&& create_fn )
+  {
+    const auto key = [&]( auto const& f ) {
+      return std::make_tuple( arrival_of( f ), res.node_to_index( res.get_node( f ) ), res.is_complemented( f ) );
+    };
+    const auto later = [&]( auto const& a, auto const& b ) { return key( a ) > key( b ); };
+
+    std::make_heap( operands.begin(), operands.end(), later );
+    while ( operands.size() > 1u )
+    {
+      std::pop_heap( operands.begin(), operands.end(), later );
+      const auto a = operands.back();
+      operands.pop_back();
+      std::pop_heap( operands.begin(), operands.end(), later );
+      const auto b = operands.back();
+      operands.pop_back();
+
+      operands.push_back( create( [&]() { return create_fn( a, b ); }, {a, b} ) );
+      std::push_heap( operands.begin(), operands.end(), later );
+    }
+    return operands.front();
+  }
+
+  signal balanced_and( std::vector<signal> operands )
+  {
+    /* constants and duplicate operands */
+    std::sort( operands.begin(), operands.end(), [&]( auto const& a, auto const& b ) {
+      return std::make_pair( res.node_to_index( res.get_node( a ) ), res.is_complemented( a ) ) < std::make_pair( res.node_to_index( res.get_node( b ) ), res.is_complemented( b ) );
+    } );
+    std::vector<signal> normalized;
+    for ( auto const& f : operands )
+    {
+      if ( res.is_constant( res.get_node( f ) ) )
+      {
+        if ( res.is_complemented( f ) == res.constant_value( res.get_node( f ) ) )
+        {
+          return res.get_constant( false );
+        }
+        continue;
+      }
+      if ( !normalized.empty() && res.get_node( normalized.back() ) == res.get_node( f ) )
+      {
+        if ( res.is_complemented( normalized.back() ) != res.is_complemented( f ) )
+        {
+          return res.get_constant( false );
+        }
+        continue;
+      }
+      normalized.push_back( f );
+    }
+    if ( normalized.empty() )
+    {
+      return res.get_constant( true );
+    }
+    return balanced( normalized, [&]( auto const& a, auto const& b ) { return res.create_and( a, b ); } );
+  }
+
+  signal balanced_xor( std::vector<signal> operands )
+  {
+    /* complements are moved to the output, and pairs of equal operands
+       cancel out */
+    bool inv{false};
+    for ( auto& f : operands )
+    {
+      if ( res.is_complemented( f ) )
+      {
+        inv = !inv;
+        f = !f;
+      }
+    }
+    std::sort( operands.begin(), operands.end(), [&]( auto const& a, auto const& b ) {
+      return res.node_to_index( res.get_node( a ) ) < res.node_to_index( res.get_node( b ) );
+    } );
+    std::vector<signal> normalized;
+    for ( auto const& f : operands )
+    {
+      if ( res.is_constant( res.get_node( f ) ) )
+      {
+        inv ^= res.constant_value( res.get_node( f ) );
+        continue;
+      }
+      if ( !normalized.empty() && normalized.back() == f )
+      {
+        normalized.pop_back();
+        continue;
+      }
+      normalized.push_back( f );
+    }
+    if ( normalized.empty() )
+    {
+      return res.get_constant( inv );
+    }
+    const auto f = balanced( normalized, [&]( auto const& a, auto const& b ) { return res.create_xor( a, b ); } );
+    return inv ? !f : f;
+  }
+
+  /* expands the supergate leaves of n with the latest arrival times, as long
+     as the cut has at most `cut_size` leaves, and rebuilds the cut function
+     from its SOP (or the SOP of its complement) with balanced cubes */
+  std::optional<signal> sop_balance( node const& n )
+  {
+    std::vector<node> cut, cone{n};
+    const auto index = ntk.node_to_index( n );
+    for ( auto i = 0u; i < num_leaves[index]; ++i )
+    {
+      const auto m = ntk.get_node( leaves[first_leaf[index] + i] );
+      if ( std::find( cut.begin(), cut.end(), m ) == cut.end() )
+      {
+        cut.push_back( m );
+      }
+    }
+    if ( cut.size() > ps.cut_size )
+    {
+      return std::nullopt;
+    }
+
+    while ( true )
+    {
+      std::optional<uint32_t> best;
+      for ( auto i = 0u; i < cut.size(); ++i )
+      {
+        const auto m = cut[i];
+        const auto m_index = ntk.node_to_index( m );
+        if ( ntk.is_constant( m ) || ntk.is_pi( m ) || kinds[m_index] == supergate_kind::none || ( ps.area_aware && fanouts[m_index] != 1u ) )
+        {
+          continue;
+        }
+        if ( !best || arrival_of( copies[m_index] ) > arrival_of( copies[ntk.node_to_index( cut[*best] )] ) )
+        {
+          best = i;
+        }
+      }
+      if ( !best )
+      {
+        break;
+      }
+
+      auto expanded = cut;
+      const auto m = expanded[*best];
+      expanded.erase( expanded.begin() + *best );
+      const auto m_index = ntk.node_to_index( m );
+      for ( auto i = 0u; i < num_leaves[m_index]; ++i )
+      {
+        const auto l = ntk.get_node( leaves[first_leaf[m_index] + i] );
+        if ( std::find( expanded.begin(), expanded.end(), l ) == expanded.end() )
+        {
+          expanded.push_back( l );
+        }
+      }
+      if ( expanded.size() > ps.cut_size )
+      {
+        break;
+      }
+      cut = expanded;
+      cone.push_back( m );
+    }
+    if ( cone.size() == 1u )
+    {
+      return std::nullopt;
+    }
+
+    const auto tt = cut_function( n, cut );
+
+    /* number of gates of the cone, which are removed by the SOP in area-aware
+       mode since they have a single fanout */
+    uint32_t cone_gates{0u};
+    for ( auto const& m : cone )
+    {
+      cone_gates += num_leaves[ntk.node_to_index( m )] - 1u;
+    }
+
+    std::optional<signal> best;
+    for ( auto inv : {false, true} )
+    {
+      const auto cubes = kitty::isop( inv ? ~tt : tt );
+      uint32_t gates = cubes.empty() ? 0u : static_cast<uint32_t>( cubes.size() ) - 1u;
+      for ( auto const& c : cubes )
+      {
+        gates += std::max<uint32_t>( c.num_literals(), 1u ) - 1u;
+      }
+      if ( ps.area_aware && gates > cone_gates )
+      {
+        continue;
+      }
+
+      std::vector<signal> terms;
+      for ( auto const& c : cubes )
+      {
+        std::vector<signal> literals;
+        for ( auto i = 0u; i < cut.size(); ++i )
+        {
+          if ( c.get_mask( i ) )
+          {
+            const auto l = copies[ntk.node_to_index( cut[i] )];
+            literals.push_back( c.get_bit( i ) ? l : !l );
+          }
+        }
+        terms.push_back( !balanced_and( literals ) );
+      }
+      auto f = terms.empty() ? res.get_constant( true ) : balanced_and( terms );
+      f = inv ? f : !f;
+      if ( !best || arrival_of( f ) < arrival_of( *best ) )
+      {
+        best = f;
+      }
+    }
+    return best;
+  }
+
+  kitty::dynamic_truth_table cut_function( node const& n, std::vector<node> const& cut ) const
+  {
+    const auto it = std::find( cut.begin(), cut.end(), n );
+    if ( it != cut.end() )
+    {
+      kitty::dynamic_truth_table tt( static_cast<uint32_t>( cut.size() ) );
+      kitty::create_nth_var( tt, static_cast<uint32_t>( std::distance( cut.begin(), it ) ) );
+      return tt;
+    }
+
+    const auto index = ntk.node_to_index( n );
+    const auto is_and = kinds[index] == supergate_kind::conjunction;
+    kitty::dynamic_truth_table tt( static_cast<uint32_t>( cut.size() ) );
+    if ( is_and )
+    {
+      tt = ~tt;
+    }
+    for ( auto i = 0u; i < num_leaves[index]; ++i )
+    {
+      const auto f = leaves[first_leaf[index] + i];
+      const auto ftt = cut_function( ntk.get_node( f ), cut );
+      const auto value = ntk.is_complemented( f ) ? ~ftt : ftt;
+      tt = is_and ? tt & value : tt ^ value;
+    }
+    return inverted[index] ? ~tt : tt;
+  }
+
+private:
+  Ntk const& ntk;
+  balancing_params const& ps;
+  balancing_stats& st;
+
+  Ntk res;
+
+  std::vector<supergate_kind> kinds;
+  std::vector<uint8_t> inverted;
+  std::vector<uint8_t> needed;
+  std::vector<uint32_t> first_leaf;
+  std::vector<uint32_t> num_leaves;
+  std::vector<signal> leaves;
+  std::vector<uint32_t> fanouts;
+
+  std::vector<signal> copies;
+  std::vector<uint32_t> arrival;
+};
+
+} // namespace detail
+
+/*! \brief Balances AND and XOR supergates by arrival time
+
+  Supergates are maximal trees of AND gates (including OR gates as AND gates
+  with complemented inputs and output) or of XOR gates, collected through
+  nodes with a single fanout, and, unless `ps.area_aware` is set, through
+  nodes with multiple fanouts as long as the supergate has less than
+  `ps.max_leaves` leaves, which duplicates logic.  The network is rebuilt in
+  topological order, and each supergate is recreated by combining the two
+  leaves with the earliest arrival times until one signal is left.
+
+  With `ps.sop_balancing`, the supergate leaves with the latest arrival times
+  are expanded into cuts of up to `ps.cut_size` leaves, whose functions are
+  rebuilt from their irredundant SOPs, if that results in an earlier arrival
+  time (and, if `ps.area_aware` is set, does not increase the number of
+  gates).  Majority and XOR3 gates of XMGs with three non-constant fanins are
+  copied.
+
+  The run time is linear in the size of the network for a fixed maximum
+  number of leaves and cut size.  The network is replaced by the balanced
+  one, such that PIs and POs keep their order.
+*/
+template<class Ntk>
+void balancing( Ntk& ntk, balancing_params const& ps = {}, balancing_stats* pst = nullptr )
+{
+  balancing_stats st;
+  {
+    mockturtle::stopwatch t( st.time_total );
+    st.depth_before = network_depth( ntk );
+    detail::balancing_impl<Ntk> impl( ntk, ps, st );
+    ntk = impl.run();
+    st.depth_after = network_depth( ntk );
+  }
+
+  if ( ps.verbose )
+  {
+    st.report();
+  }
+
+  if ( pst )
+  {
+    *pst = st;
+  }
+}
+
+} // namespace cirkit
@@ -0,0 +1,310 @@
+/* CirKit: A circuit toolkit
+ * Copyright (C) 2017-2019  EPFL
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <utility>
+
+#ifndef _WIN32
+#include <signal.h>
+#endif
+
+#include <kitty/dynamic_truth_table.hpp>
+
+namespace cirkit
+{
+
+/*! \brief Cooperative cancellation token
+
+  Long running loops poll `is_cancelled()` and stop at the next point at
+  which the network is in a consistent state.  The token is cancelled either
+  when its deadline has been reached or when SIGINT has been received while a
+  command was running.
+
+  Each running command owns a token, which is the current token of the
+  thread that executes the command.  Worker threads that are started on
+  behalf of the command must adopt the token (see `cancellation_token::adopt`).
+*/
+class cancellation_token
+{
+public:
+  using clock = std::chrono::steady_clock;
+
+  /*! \brief Token of the command that runs in this thread (or `nullptr`) */
+  static cancellation_token*& current()
+  {
+    thread_local cancellation_token* token = nullptr;
+    return token;
+  }
+
+  /*! \brief Makes `token` the current token of this thread until destruction */
+  class adopt
+  {
+  public:
+    explicit adopt( cancellation_token* token ) : prev( current() )
+    {
+      current() = token;
+    }
+
+    ~adopt()
+    {
+      current() = prev;
+    }
+
+  private:
+    cancellation_token* prev;
+  };
+
+  inline bool is_cancelled()
+  {
+    if ( _cancelled.load( std::memory_order_relaxed ) )
+    {
+      return true;
+    }
+
+    if ( interrupted().load( std::memory_order_relaxed ) )
+    {
+      _reason = interrupted_reason;
+      _cancelled = true;
+      return true;
+    }
+
+    if ( _deadline != no_deadline && clock::now().time_since_epoch().count() > _deadline )
+    {
+      _reason = timed_out_reason;
+      _cancelled = true;
+      return true;
+    }
+
+    return false;
+  }
+
+  /*! \brief Reason for cancellation ("timed out" or "interrupted") */
+  inline std::string reason() const
+  {
+    switch ( _reason.load() )
+    {
+    case timed_out_reason:
+      return "timed out";
+    case interrupted_reason:
+      return "interrupted";
+    default:
+      return {};
+    }
+  }
+
+private:
+  friend class cancellation_scope;
+
+  static_assert( std::atomic<bool>::is_always_lock_free, "the SIGINT flag must be lock-free to be set in a signal handler" );
+
+  static std::atomic<bool>& interrupted()
+  {
+    static std::atomic<bool> flag{false};
+    return flag;
+  }
+
+  /* only sets the flag, which is async-signal-safe; the handler is reset to
+     the default action on delivery, such that a second Ctrl-C terminates the
+     program as before */
+  static void on_sigint( int )
+  {
+    interrupted().store( true, std::memory_order_relaxed );
+  }
+
+private:
+  static constexpr int64_t no_deadline = INT64_MAX;
+  static constexpr uint8_t timed_out_reason = 1u;
+  static constexpr uint8_t interrupted_reason = 2u;
+
+  std::atomic<bool> _cancelled{false};
+  std::atomic<uint8_t> _reason{0u};
+  int64_t _deadline{no_deadline};
+};
+
+/*! \brief Checks whether the current command should stop */
+inline bool is_cancelled()
+{
+  auto* token = cancellation_token::current();
+  return token && token->is_cancelled();
+}
+
+/*! \brief Scope in which a command can be cancelled
+
+  The scope creates a new token and makes it the current token of the thread.
+  Nested scopes (e.g., commands called from flows) can only tighten the
+  deadline of the enclosing scope.  The SIGINT handler is installed as long as
+  at least one scope is active in the process.
+
+  \param timeout Timeout in seconds (0 for no timeout)
+*/
+class cancellation_scope
+{
+public:
+  explicit cancellation_scope( double timeout = 0.0 )
+      : parent( cancellation_token::current() )
+  {
+    if ( parent )
+    {
+      token._deadline = parent->_deadline;
+    }
+
+    if ( timeout > 0.0 )
+    {
+      const auto deadline = ( cancellation_token::clock::now() + std::chrono::duration_cast<cancellation_token::clock::duration>( std::chrono::duration<double>( timeout ) ) ).time_since_epoch().count();
+      token._deadline = std::min<int64_t>( token._deadline, deadline );
+    }
+
+    cancellation_token::current() = &token;
+
+    std::lock_guard<std::mutex> lock( handler_mutex() );
+    if ( active_scopes()++ == 0u )
+    {
+      cancellation_token::interrupted() = false;
+      install_handler();
+    }
+  }
+
+  ~cancellation_scope()
+  {
+    cancellation_token::current() = parent;
+
+    std::lock_guard<std::mutex> lock( handler_mutex() );
+    if ( --active_scopes() == 0u )
+    {
+      restore_handler();
+    }
+  }
+
+  /*! \brief Returns the reason of cancellation or an empty string */
+  std::string status() const
+  {
+    return token._cancelled ? token.reason() : std::string();
+  }
+
+private:
+  static std::mutex& handler_mutex()
+  {
+    static std::mutex m;
+    return m;
+  }
+
+  static uint32_t& active_scopes()
+  {
+    static uint32_t count{0u};
+    return count;
+  }
+
+#ifndef _WIN32
+  static struct sigaction& prev_action()
+  {
+    static struct sigaction action;
+    return action;
+  }
+
+  static void install_handler()
+  {
+    struct sigaction action;
+    action.sa_handler = &cancellation_token::on_sigint;
+    sigemptyset( &action.sa_mask );
+    action.sa_flags = SA_RESETHAND | SA_RESTART;
+    sigaction( SIGINT, &action, &prev_action() );
+  }
+
+  static void restore_handler()
+  {
+    sigaction( SIGINT, &prev_action(), nullptr );
+  }
+#else
+  /* the handler is reset to the default action on delivery on Windows */
+  using handler_t = void ( * )( int );
+  static handler_t& prev_handler()
+  {
+    static handler_t handler{nullptr};
+    return handler;
+  }
+
+  static void install_handler()
+  {
+    prev_handler() = std::signal( SIGINT, &cancellation_token::on_sigint );
+  }
+
+  static void restore_handler()
+  {
+    std::signal( SIGINT, prev_handler() && prev_handler() != SIG_ERR ? prev_handler() : SIG_DFL );
+  }
+#endif
+
+private:
+  cancellation_token token;
+  cancellation_token* parent;
+};
+
+/*! \brief Resynthesis wrapper that stops producing candidates when cancelled
+
+  Algorithms like cut rewriting and refactoring only change the network for
+  candidates returned by the resynthesis function.  When the token is
+  cancelled, the wrapper returns no more candidates, such that the algorithm
+  quickly finishes its pass and leaves a consistent network.
+*/
+template<class ResynFn>
+class cancellable_resynthesis
+{
+public:
+  explicit cancellable_resynthesis( ResynFn& fn ) : fn( fn ) {}
+
+  template<typename Ntk, typename LeavesIterator, typename Fn>
+  void operator()( Ntk& ntk, kitty::dynamic_truth_table const& function, LeavesIterator begin, LeavesIterator end, Fn&& callback ) const
+  {
+    if ( is_cancelled() )
+    {
+      return;
+    }
+    fn( ntk, function, begin, end, std::forward<Fn>( callback ) );
+  }
+
+  template<typename Ntk, typename LeavesIterator, typename Fn>
+  auto operator()( Ntk& ntk, kitty::dynamic_truth_table const& function, kitty::dynamic_truth_table const& dont_cares, LeavesIterator begin, LeavesIterator end, Fn&& callback ) const
+      -> decltype( std::declval<ResynFn&>()( ntk, function, dont_cares, begin, end, std::forward<Fn>( callback ) ), void() )
+  {
+    if ( is_cancelled() )
+    {
+      return;
+    }
+    fn( ntk, function, dont_cares, begin, end, std::forward<Fn>( callback ) );
+  }
+
+private:
+  ResynFn& fn;
+};
+
+} // namespace cirkit
@@ -25,10 +25,18 @@
 
 #pragma once
 
+#include <regex>
+#include <string>
+#include <vector>
+
 #include <alice/command.hpp>
+#include <alice/detail/utils.hpp>
 
 #include <fmt/format.h>
 
+#include "cancellation.hpp"
+#include "output_stream.hpp"
+
 namespace cirkit
 {
 
@@ -48,6 +56,8 @@ public:
     {
       ( add_flag_helper<Stores>( option_text ), ... );
     }
+
+    add_option( "--timeout", timeout, "stop after given number of seconds (0 for no timeout)" );
   }
 
   rules validity_rules() const override
@@ -66,13 +76,35 @@ public:
 
   void execute() override
   {
+    cancellation_scope scope( timeout );
+    output_stream_scope output_scope( env->out() );
+
     if ( !( execute_helper<Stores>() || ... ) )
     {
       env->out() << "[w] no store specified\n";
     }
+
+    _status = scope.status();
+    if ( !_status.empty() )
+    {
+      env->err() << fmt::format( "[w] command {}, store element is left in its last consistent state\n", _status );
+    }
+  }
+
+  std::string status() const override
+  {
+    return _status;
   }
 
 protected:
+  bool run( const std::vector<std::string>& args ) override
+  {
+    /* timeout is not sticky between calls */
+    timeout = 0.0;
+    _status.clear();
+    return command::run( args );
+  }
+
   void add_new_option()
   {
     add_flag( "-n,--new", "create new store element" );
@@ -137,6 +169,31 @@ private:
 private:
   std::string default_option;
   bool option_set{false};
+  double timeout{0.0};
+  std::string _status;
 };
 
+/*! \brief Expands aliases of a command line like the shell does
+
+  Commands that execute command lines in spawned environments expand them
+  first, since aliases are defined in the environment of the shell.
+*/
+inline std::string expand_alias( environment const& env, std::string const& line )
+{
+  std::smatch m;
+  for ( auto const& p : env.aliases() )
+  {
+    if ( std::regex_match( line, m, std::regex( p.first ) ) )
+    {
+      std::vector<std::string> matches( m.size() - 1u );
+      for ( auto i = 0u; i < matches.size(); ++i )
+      {
+        matches[i] = std::string( m[i + 1] );
+      }
+      return expand_alias( env, alice::detail::trim_copy( alice::detail::format_with_vector( p.second, matches ) ) );
+    }
+  }
+  return line;
+}
+
 } // namespace cirkit
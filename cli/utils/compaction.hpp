@@ -0,0 +1,291 @@
+/* CirKit: A circuit toolkit
+ * Copyright (C) 2017-2019  EPFL
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <mockturtle/networks/aig.hpp>
+#include <mockturtle/networks/mig.hpp>
+#include <mockturtle/networks/xag.hpp>
+#include <mockturtle/networks/xmg.hpp>
+
+namespace cirkit
+{
+
+namespace detail
+{
+
+/* all gate functions of these networks are symmetric, and the networks only
+   use the relative order of fanin indexes to normalize nodes or to encode the
+   gate type (XOR in XAGs and XOR3 in XMGs) */
+template<class Ntk>
+inline constexpr bool has_symmetric_gates_v = std::is_same_v<Ntk, mockturtle::aig_network> ||
+                                              std::is_same_v<Ntk, mockturtle::xag_network> ||
+                                              std::is_same_v<Ntk, mockturtle::mig_network> ||
+                                              std::is_same_v<Ntk, mockturtle::xmg_network>;
+
+/* reorders renumbered fanins such that their indexes have the same relative
+   order as before renumbering */
+template<class Children>
+void restore_fanin_order( Children& children, std::array<uint64_t, 3> const& old_indexes )
+{
+  const auto size = children.size();
+
+  std::array<uint32_t, 3> by_old{0u, 1u, 2u}, by_new{0u, 1u, 2u};
+  std::stable_sort( by_old.begin(), by_old.begin() + size, [&]( auto a, auto b ) { return old_indexes[a] < old_indexes[b]; } );
+  std::stable_sort( by_new.begin(), by_new.begin() + size, [&]( auto a, auto b ) { return children[a].index < children[b].index; } );
+
+  auto copy = children;
+  for ( auto r = 0u; r < size; ++r )
+  {
+    children[by_old[r]] = copy[by_new[r]];
+  }
+}
+
+} // namespace detail
+
+/*! \brief Removes dangling nodes in place
+
+  Removes all nodes that are not in the transitive fanin of a combinational
+  output, keeping constants and combinational inputs, and renumbers the
+  remaining nodes in topological order.  Other than mockturtle's
+  `cleanup_dangling`, no second network is built: nodes are permuted within
+  the node array of the network's storage, and fanin indexes, inputs,
+  outputs, fanout counters and the structural hash table are updated.  Nodes
+  are not rehashed, i.e., structurally equivalent nodes are not merged.
+
+  If the live nodes are already in topological order, their relative order
+  does not change; in particular, inputs keep their indexes if they precede
+  all gates.
+
+  Node values and visited flags are undefined afterwards, and views or event
+  handlers that store node indexes become invalid.  Returns the new index for
+  each old node index, or the maximum integer for removed nodes.
+*/
+template<class Ntk>
+std::vector<uint32_t> compact_dangling( Ntk& ntk )
+{
+  constexpr auto removed = std::numeric_limits<uint32_t>::max();
+
+  auto& storage = *ntk._storage;
+  auto& nodes = storage.nodes;
+  const auto size = static_cast<uint32_t>( nodes.size() );
+
+  /* 0: dangling, 1: live, 2: fanins pending, 3: placed */
+  std::vector<uint8_t> state( size, 0u );
+  std::vector<uint8_t> is_ci( size, 0u );
+  std::vector<uint32_t> stack;
+
+  for ( auto const& index : storage.inputs )
+  {
+    is_ci[index] = 1u;
+  }
+
+  const auto is_gate = [&]( uint32_t index ) {
+    return !is_ci[index] && !ntk.is_constant( ntk.index_to_node( index ) );
+  };
+
+  /* mark live nodes */
+  for ( auto i = 0u; i < size; ++i )
+  {
+    if ( !is_gate( i ) )
+    {
+      state[i] = 1u;
+    }
+  }
+  for ( auto const& f : storage.outputs )
+  {
+    stack.push_back( static_cast<uint32_t>( f.index ) );
+  }
+  while ( !stack.empty() )
+  {
+    const auto index = stack.back();
+    stack.pop_back();
+    if ( state[index] != 0u )
+    {
+      continue;
+    }
+    state[index] = 1u;
+    for ( auto const& c : nodes[index].children )
+    {
+      if ( state[c.index] == 0u )
+      {
+        stack.push_back( static_cast<uint32_t>( c.index ) );
+      }
+    }
+  }
+
+  /* topological order of live nodes, which keeps the index order whenever
+     it is topological */
+  std::vector<uint32_t> order;
+  for ( auto i = 0u; i < size; ++i )
+  {
+    if ( state[i] != 1u )
+    {
+      continue;
+    }
+
+    stack.push_back( i );
+    while ( !stack.empty() )
+    {
+      const auto index = stack.back();
+      if ( state[index] == 3u )
+      {
+        stack.pop_back();
+      }
+      else if ( state[index] == 1u && is_gate( index ) )
+      {
+        state[index] = 2u;
+        for ( auto const& c : nodes[index].children )
+        {
+          if ( state[c.index] == 1u )
+          {
+            stack.push_back( static_cast<uint32_t>( c.index ) );
+          }
+        }
+      }
+      else
+      {
+        state[index] = 3u;
+        order.push_back( index );
+        stack.pop_back();
+      }
+    }
+  }
+
+  const auto num_live = static_cast<uint32_t>( order.size() );
+  std::vector<uint32_t> old_to_new( size, removed );
+  for ( auto i = 0u; i < num_live; ++i )
+  {
+    old_to_new[order[i]] = i;
+  }
+
+  /* permute nodes in place, such that node i is the former node order[i];
+     removed nodes are moved behind the live ones */
+  for ( auto i = 0u; i < size; ++i )
+  {
+    if ( old_to_new[i] == removed )
+    {
+      order.push_back( i );
+    }
+  }
+  {
+    std::vector<bool> done( size, false );
+    for ( auto start = 0u; start < num_live; ++start )
+    {
+      if ( done[start] || order[start] == start )
+      {
+        continue;
+      }
+
+      auto tmp = std::move( nodes[start] );
+      auto pos = start;
+      while ( order[pos] != start )
+      {
+        nodes[pos] = std::move( nodes[order[pos]] );
+        done[pos] = true;
+        pos = order[pos];
+      }
+      nodes[pos] = std::move( tmp );
+      done[pos] = true;
+    }
+  }
+  nodes.erase( nodes.begin() + num_live, nodes.end() );
+  std::vector<uint32_t>().swap( order );
+
+  /* renumber inputs, outputs and fanins */
+  for ( auto& index : storage.inputs )
+  {
+    index = old_to_new[index];
+  }
+  for ( auto& f : storage.outputs )
+  {
+    f.index = old_to_new[f.index];
+  }
+
+  std::vector<uint8_t>( num_live, 0u ).swap( is_ci );
+  for ( auto const& index : storage.inputs )
+  {
+    is_ci[index] = 1u;
+  }
+
+  for ( auto i = 0u; i < num_live; ++i )
+  {
+    auto& node = nodes[i];
+    node.data[0].h1 = 0u;
+    if ( !is_gate( i ) )
+    {
+      continue;
+    }
+
+    if constexpr ( detail::has_symmetric_gates_v<Ntk> )
+    {
+      std::array<uint64_t, 3> old_indexes{};
+      for ( auto j = 0u; j < node.children.size(); ++j )
+      {
+        old_indexes[j] = node.children[j].index;
+        node.children[j].index = old_to_new[node.children[j].index];
+      }
+      detail::restore_fanin_order( node.children, old_indexes );
+    }
+    else
+    {
+      for ( auto& c : node.children )
+      {
+        c.index = old_to_new[c.index];
+      }
+    }
+  }
+
+  /* fanout counters and structural hashing */
+  storage.hash.clear();
+  for ( auto i = 0u; i < num_live; ++i )
+  {
+    if ( !is_gate( i ) )
+    {
+      continue;
+    }
+    for ( auto const& c : nodes[i].children )
+    {
+      nodes[c.index].data[0].h1++;
+    }
+    storage.hash[nodes[i]] = i;
+  }
+  for ( auto const& f : storage.outputs )
+  {
+    nodes[f.index].data[0].h1++;
+  }
+
+  return old_to_new;
+}
+
+} // namespace cirkit
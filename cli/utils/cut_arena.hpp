@@ -0,0 +1,309 @@
+/* CirKit: A circuit toolkit
+ * Copyright (C) 2017-2019  EPFL
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <cassert>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <vector>
+
+#include <mockturtle/algorithms/cut_enumeration.hpp>
+
+namespace cirkit
+{
+
+/*! \brief Read-only view of the cuts of a node in a `cut_arena` */
+template<class Cut>
+class cut_span
+{
+public:
+  cut_span() = default;
+  cut_span( Cut const* begin, uint32_t size ) : _begin( begin ), _size( size ) {}
+
+  Cut const* begin() const { return _begin; }
+  Cut const* end() const { return _begin + _size; }
+  uint32_t size() const { return _size; }
+  bool empty() const { return _size == 0u; }
+  Cut const& operator[]( uint32_t i ) const { return _begin[i]; }
+
+private:
+  Cut const* _begin{nullptr};
+  uint32_t _size{0u};
+};
+
+/*! \brief Cut sets of all nodes in chunks of fixed size
+
+  Each node owns at most one cut set, a contiguous slice of a chunk with a
+  fixed capacity.  Chunks are never moved, such that the cut sets of
+  different nodes can be written concurrently once they are allocated; only
+  `allocate` and `release` must be called from a single thread.  Released
+  cut sets, e.g., of nodes that became dead or are recomputed, are kept in a
+  free list per capacity and recycled by the next allocation of the same
+  capacity before a new chunk is reserved.
+
+  If `max_bytes` is not 0, no chunk is reserved beyond this limit and
+  `allocate` fails.  Callers decide how to handle nodes without cut sets,
+  e.g., by treating them as having only their trivial cut, which they can
+  store with `allocate_fallback`.  For that, `reserve_fallback` reserves a
+  fallback region of `fallback_capacity` cuts per cut set up front, which
+  counts towards the limit, such that fallback cut sets never grow the arena
+  beyond it.  Callers must reject limits below `fallback_bytes`, the size of
+  the fallback region, before they use the arena.
+*/
+template<class Cut>
+class cut_arena
+{
+public:
+  /*! \brief Number of cuts in a chunk, which bounds the capacity of a cut set */
+  static constexpr uint32_t chunk_size = 4096u;
+  static constexpr uint64_t chunk_bytes = uint64_t( chunk_size ) * sizeof( Cut );
+
+  explicit cut_arena( uint64_t max_bytes = 0u, uint32_t fallback_capacity = 1u )
+      : max_bytes( max_bytes ),
+        fallback_capacity( fallback_capacity )
+  {
+    assert( fallback_capacity > 0u && chunk_size % fallback_capacity == 0u );
+  }
+
+  /*! \brief Memory of a fallback region for `num_sets` cut sets in bytes */
+  static uint64_t fallback_bytes( uint32_t num_sets, uint32_t fallback_capacity )
+  {
+    const auto sets_per_chunk = chunk_size / fallback_capacity;
+    return ( ( uint64_t( num_sets ) + sets_per_chunk - 1u ) / sets_per_chunk ) * chunk_bytes;
+  }
+
+  /*! \brief Adds entries for new nodes, existing cut sets are kept */
+  void resize( uint32_t num_nodes )
+  {
+    if ( num_nodes > sets.size() )
+    {
+      sets.resize( num_nodes );
+    }
+  }
+
+  /*! \brief Reserves the fallback region for `num_sets` cut sets at a time
+
+    Without limit, fallback cut sets are allocated as any other cut set and
+    nothing is reserved.
+  */
+  void reserve_fallback( uint32_t num_sets )
+  {
+    if ( max_bytes == 0u )
+    {
+      return;
+    }
+    const auto sets_per_chunk = chunk_size / fallback_capacity;
+    while ( num_fallback < num_sets )
+    {
+      const auto chunk = static_cast<uint32_t>( chunks.size() );
+      chunks.emplace_back( new Cut[chunk_size] );
+      is_fallback.push_back( true );
+      for ( auto i = sets_per_chunk; i-- > 0u; )
+      {
+        free_fallback.push_back( chunk * chunk_size + i * fallback_capacity );
+      }
+      num_fallback += sets_per_chunk;
+    }
+  }
+
+  /*! \brief Allocates an empty cut set for `index`, replacing its current one
+
+    Returns false if the memory limit is reached, in which case the node has
+    no cut set afterwards.
+  */
+  bool allocate( uint32_t index, uint32_t capacity )
+  {
+    assert( capacity > 0u && capacity <= chunk_size );
+    release( index );
+
+    auto& set = sets[index];
+    if ( capacity < free_sets.size() && !free_sets[capacity].empty() )
+    {
+      set.offset = free_sets[capacity].back();
+      free_sets[capacity].pop_back();
+      ++_num_recycled;
+    }
+    else
+    {
+      if ( current == none || next + capacity > chunk_size )
+      {
+        if ( max_bytes != 0u && reserved_bytes() + chunk_bytes > max_bytes )
+        {
+          ++_num_failed;
+          return false;
+        }
+        current = static_cast<uint32_t>( chunks.size() );
+        chunks.emplace_back( new Cut[chunk_size] );
+        is_fallback.push_back( false );
+        next = 0u;
+      }
+      set.offset = current * chunk_size + next;
+      next += capacity;
+    }
+
+    set.capacity = static_cast<uint16_t>( capacity );
+    set.size = 0u;
+    return true;
+  }
+
+  /*! \brief Allocates an empty cut set of `fallback_capacity` cuts for `index`
+             in the fallback region, which never fails as long as at most
+             the reserved number of fallback cut sets is in use */
+  void allocate_fallback( uint32_t index )
+  {
+    if ( max_bytes == 0u )
+    {
+      allocate( index, fallback_capacity );
+      return;
+    }
+
+    release( index );
+    assert( !free_fallback.empty() );
+    auto& set = sets[index];
+    set.offset = free_fallback.back();
+    free_fallback.pop_back();
+    set.capacity = static_cast<uint16_t>( fallback_capacity );
+    set.size = 0u;
+  }
+
+  /*! \brief Returns the cut set of `index` to the free list */
+  void release( uint32_t index )
+  {
+    auto& set = sets[index];
+    if ( set.capacity == 0u )
+    {
+      return;
+    }
+    if ( is_fallback[set.offset / chunk_size] )
+    {
+      free_fallback.push_back( set.offset );
+      set = {};
+      return;
+    }
+    if ( free_sets.size() <= set.capacity )
+    {
+      free_sets.resize( set.capacity + 1u );
+    }
+    free_sets[set.capacity].push_back( set.offset );
+    set = {};
+  }
+
+  bool has_cuts( uint32_t index ) const
+  {
+    return sets[index].capacity != 0u;
+  }
+
+  uint32_t capacity( uint32_t index ) const
+  {
+    return sets[index].capacity;
+  }
+
+  /*! \brief Appends a cut, the cut set must not be full */
+  void push_back( uint32_t index, Cut const& cut )
+  {
+    auto& set = sets[index];
+    slot( set.offset )[set.size++] = cut;
+  }
+
+  cut_span<Cut> cuts( uint32_t index ) const
+  {
+    const auto& set = sets[index];
+    return set.capacity == 0u ? cut_span<Cut>() : cut_span<Cut>( slot( set.offset ), set.size );
+  }
+
+  uint64_t total_cuts() const
+  {
+    uint64_t total{0u};
+    for ( auto const& set : sets )
+    {
+      total += set.size;
+    }
+    return total;
+  }
+
+  /*! \brief Memory reserved for chunks in bytes, including the fallback
+             region; chunks are kept until destruction */
+  uint64_t reserved_bytes() const
+  {
+    return chunks.size() * chunk_bytes;
+  }
+
+  /*! \brief Number of allocations that reused a released cut set */
+  uint64_t num_recycled() const
+  {
+    return _num_recycled;
+  }
+
+  /*! \brief Number of allocations that failed due to the memory limit */
+  uint64_t num_failed() const
+  {
+    return _num_failed;
+  }
+
+private:
+  Cut* slot( uint32_t offset ) const
+  {
+    return chunks[offset / chunk_size].get() + offset % chunk_size;
+  }
+
+  struct set_entry
+  {
+    uint32_t offset{0u};
+    uint16_t capacity{0u};
+    uint16_t size{0u};
+  };
+
+  static constexpr uint32_t none = std::numeric_limits<uint32_t>::max();
+
+  uint64_t max_bytes;
+  uint32_t fallback_capacity;
+  std::vector<std::unique_ptr<Cut[]>> chunks;
+  std::vector<bool> is_fallback;
+  std::vector<uint32_t> free_fallback;
+  uint32_t num_fallback{0u};
+  uint32_t current{none};
+  uint32_t next{0u};
+  std::vector<set_entry> sets;
+  std::vector<std::vector<uint32_t>> free_sets;
+
+  uint64_t _num_recycled{0u};
+  uint64_t _num_failed{0u};
+};
+
+/*! \brief Estimated memory of mockturtle's cut enumeration in bytes
+
+  mockturtle reserves a cut set of fixed size for each node, independent of
+  the cut limit, such that its memory can only be bounded by rejecting large
+  networks.
+*/
+template<class Ntk>
+uint64_t estimated_cut_memory( Ntk const& ntk )
+{
+  return uint64_t( ntk.size() ) * sizeof( typename mockturtle::network_cuts<Ntk, true>::cut_set_t );
+}
+
+} // namespace cirkit
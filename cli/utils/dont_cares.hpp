@@ -0,0 +1,773 @@
+/* CirKit: A circuit toolkit
+ * Copyright (C) 2017-2019  EPFL
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <fmt/format.h>
+#include <kitty/constructors.hpp>
+#include <kitty/dynamic_truth_table.hpp>
+#include <kitty/operations.hpp>
+#include <kitty/operators.hpp>
+#include <mockturtle/algorithms/equivalence_checking.hpp>
+
+#include "cancellation.hpp"
+#include "output_stream.hpp"
+
+namespace cirkit
+{
+
+struct dont_care_params
+{
+  /*! \brief Maximum number of inputs of a simulation window */
+  uint32_t window_size{12u};
+
+  /*! \brief Prove don't cares beyond the window with SAT */
+  bool sat_validation{false};
+
+  /*! \brief Conflict limit of each SAT call (0 for no limit) */
+  uint32_t conflict_limit{1000u};
+};
+
+struct dont_care_stats
+{
+  uint32_t num_queries{0u};
+  uint32_t num_cache_hits{0u};
+  uint32_t num_dont_cares{0u};
+  uint32_t num_sat_calls{0u};
+  uint32_t num_sat_dont_cares{0u};
+
+  void report( std::ostream& os = output_stream() ) const
+  {
+    os << fmt::format( "[i] DC queries = {:>8d} ({} cached)\n", num_queries, num_cache_hits );
+    os << fmt::format( "[i] DC found   = {:>8d} queries\n", num_dont_cares );
+    os << fmt::format( "[i] SAT calls  = {:>8d} ({} don't cares)\n", num_sat_calls, num_sat_dont_cares );
+  }
+};
+
+/*! \brief Cached satisfiability don't cares of cut leaves
+
+  The don't cares of a set of leaves are the value combinations that the
+  leaves cannot take.  They are computed in a window of the transitive fanin
+  of the leaves with at most `window_size` inputs, which is grown from the
+  leaves by expanding the node that adds the fewest inputs.  The window is
+  simulated exhaustively and bit-parallel, and each combination that does
+  not occur is a don't care.  Since the window inputs are unconstrained, the
+  result is a subset of the global don't cares.
+
+  With SAT validation, random simulation of the whole network is used to
+  find combinations beyond the window that might not occur, and each of them
+  is proven impossible by equivalence checking of the conjunction of leaf
+  literals in the transitive fanin of the leaves.
+
+  Results are cached per root node.  An entry is reused if its leaves match,
+  and if the nodes of its window still exist and have the same fanins, which
+  is checked by a fingerprint.  All transformations in cirkit preserve the
+  function of each node that remains in the network, also when they use these
+  don't cares, hence a valid entry stays correct across passes.  After
+  `compact_dangling`, entries are kept by `remap`.
+*/
+template<class Ntk>
+class windowed_dont_cares
+{
+public:
+  using node = typename Ntk::node;
+  using signal = typename Ntk::signal;
+
+  explicit windowed_dont_cares( dont_care_params const& ps = {} ) : ps( ps ) {}
+
+  windowed_dont_cares( windowed_dont_cares const& ) = delete;
+  windowed_dont_cares& operator=( windowed_dont_cares const& ) = delete;
+
+  dont_care_params const& params() const
+  {
+    return ps;
+  }
+
+  /*! \brief Changes parameters, entries computed with other parameters are dropped */
+  void set_params( dont_care_params const& new_ps )
+  {
+    if ( new_ps.window_size != ps.window_size || new_ps.sat_validation != ps.sat_validation || new_ps.conflict_limit != ps.conflict_limit )
+    {
+      clear();
+    }
+    ps = new_ps;
+  }
+
+  /*! \brief Prepares the cache for a pass over `ntk`
+
+    Drops entries that do not match the network anymore and computes random
+    simulation signatures for SAT validation.  `compute` may be called
+    concurrently for different root nodes after `prepare`.
+  */
+  void prepare( Ntk const& ntk )
+  {
+    for ( auto& entries : cache )
+    {
+      entries.erase( std::remove_if( entries.begin(), entries.end(), [&]( auto const& e ) { return fingerprint( ntk, e ) != e.fingerprint; } ), entries.end() );
+    }
+    cache.resize( std::max<std::size_t>( cache.size(), ntk.size() ) );
+
+    signatures.clear();
+    if ( ps.sat_validation )
+    {
+      compute_signatures( ntk );
+    }
+  }
+
+  /*! \brief Don't cares of the leaves (node indexes) as a truth table over the leaves */
+  template<class LeavesIterator>
+  kitty::dynamic_truth_table compute( Ntk const& ntk, node const& root, LeavesIterator begin, LeavesIterator end )
+  {
+    ++num_queries;
+
+    entry e;
+    e.leaves.assign( begin, end );
+
+    const auto index = ntk.node_to_index( root );
+    auto* entries = index < cache.size() ? &cache[index] : nullptr;
+    if ( entries )
+    {
+      for ( auto const& c : *entries )
+      {
+        if ( c.leaves == e.leaves )
+        {
+          if ( fingerprint( ntk, c ) == c.fingerprint )
+          {
+            ++num_cache_hits;
+            return c.dont_cares;
+          }
+        }
+      }
+    }
+
+    compute_window( ntk, e );
+    e.dont_cares = simulate_window( ntk, e );
+    if ( !signatures.empty() )
+    {
+      validate_with_sat( ntk, e );
+    }
+    if ( !kitty::is_const0( e.dont_cares ) )
+    {
+      ++num_dont_cares;
+    }
+
+    if ( entries )
+    {
+      e.fingerprint = *fingerprint( ntk, e );
+      entries->erase( std::remove_if( entries->begin(), entries->end(), [&]( auto const& c ) { return c.leaves == e.leaves; } ), entries->end() );
+      if ( entries->size() == max_entries_per_node )
+      {
+        entries->erase( entries->begin() );
+      }
+      entries->push_back( e );
+    }
+    return e.dont_cares;
+  }
+
+  /*! \brief Renumbers entries after `compact_dangling`
+
+    `old_to_new` is the map returned by `compact_dangling`.  Entries that
+    refer to removed nodes are dropped.
+  */
+  void remap( Ntk const& ntk, std::vector<uint32_t> const& old_to_new )
+  {
+    constexpr auto removed = std::numeric_limits<uint32_t>::max();
+
+    std::vector<std::vector<entry>> new_cache( ntk.size() );
+    for ( auto i = 0u; i < cache.size() && i < old_to_new.size(); ++i )
+    {
+      if ( old_to_new[i] == removed )
+      {
+        continue;
+      }
+
+      for ( auto& e : cache[i] )
+      {
+        bool valid{true};
+        const auto map = [&]( std::vector<uint32_t>& indexes ) {
+          for ( auto& index : indexes )
+          {
+            if ( index >= old_to_new.size() || old_to_new[index] == removed )
+            {
+              valid = false;
+              return;
+            }
+            index = old_to_new[index];
+          }
+        };
+        map( e.leaves );
+        map( e.inputs );
+        map( e.gates );
+        if ( !valid )
+        {
+          continue;
+        }
+
+        /* the window has the same structure with new indexes */
+        if ( const auto fp = fingerprint( ntk, e ); fp )
+        {
+          e.fingerprint = *fp;
+          new_cache[old_to_new[i]].push_back( std::move( e ) );
+        }
+      }
+    }
+    cache = std::move( new_cache );
+    signatures.clear();
+  }
+
+  /*! \brief Adds entries of another cache for a different network
+
+    `other` holds entries for `other_ntk`, of which those of the nodes with
+    indexes in `roots` are added.  `other_to_this( index )` maps a node index
+    of `other_ntk` to the index of a node of `ntk` with the same function, or
+    to `std::numeric_limits<uint32_t>::max()`.  An entry is added if all of
+    its nodes are mapped and its window has the same structure in `ntk`.
+  */
+  template<class Fn>
+  void import( Ntk const& ntk, windowed_dont_cares const& other, Ntk const& other_ntk, std::vector<uint32_t> const& roots, Fn&& other_to_this )
+  {
+    constexpr auto removed = std::numeric_limits<uint32_t>::max();
+
+    cache.resize( std::max<std::size_t>( cache.size(), ntk.size() ) );
+    for ( auto r : roots )
+    {
+      const auto new_r = other_to_this( r );
+      if ( r >= other.cache.size() || new_r == removed || new_r >= cache.size() )
+      {
+        continue;
+      }
+
+      auto& entries = cache[new_r];
+      for ( auto const& c : other.cache[r] )
+      {
+        if ( entries.size() == max_entries_per_node || other.fingerprint( other_ntk, c ) != c.fingerprint )
+        {
+          continue;
+        }
+        const auto fp = other.fingerprint( other_ntk, c, other_to_this );
+        if ( !fp || std::any_of( entries.begin(), entries.end(), [&]( auto const& e ) { return e.leaves.size() == c.leaves.size() && std::equal( c.leaves.begin(), c.leaves.end(), e.leaves.begin(), [&]( auto i, auto j ) { return other_to_this( i ) == j; } ); } ) )
+        {
+          continue;
+        }
+
+        auto e = c;
+        for ( auto* indexes : {&e.leaves, &e.inputs, &e.gates} )
+        {
+          std::transform( indexes->begin(), indexes->end(), indexes->begin(), other_to_this );
+        }
+        if ( fingerprint( ntk, e ) == fp )
+        {
+          e.fingerprint = *fp;
+          entries.push_back( std::move( e ) );
+        }
+      }
+    }
+  }
+
+  void clear()
+  {
+    cache.clear();
+    signatures.clear();
+  }
+
+  dont_care_stats stats() const
+  {
+    return {num_queries, num_cache_hits, num_dont_cares, num_sat_calls, num_sat_dont_cares};
+  }
+
+  void reset_stats()
+  {
+    num_queries = num_cache_hits = num_dont_cares = num_sat_calls = num_sat_dont_cares = 0u;
+  }
+
+private:
+  struct entry
+  {
+    std::vector<uint32_t> leaves;
+    std::vector<uint32_t> inputs;
+    std::vector<uint32_t> gates; /* in topological order */
+    uint64_t fingerprint{0u};
+    kitty::dynamic_truth_table dont_cares;
+  };
+
+  static constexpr uint32_t max_entries_per_node = 8u;
+  static constexpr uint32_t max_window_gates = 256u;
+  static constexpr uint32_t num_signature_vars = 8u;
+
+  /* hash of the window structure, or nothing if a node does not exist anymore */
+  std::optional<uint64_t> fingerprint( Ntk const& ntk, entry const& e ) const
+  {
+    return fingerprint( ntk, e, []( uint32_t index ) { return index; } );
+  }
+
+  /* hash of the window structure with node indexes mapped by `map_index` */
+  template<class Fn>
+  std::optional<uint64_t> fingerprint( Ntk const& ntk, entry const& e, Fn&& map_index ) const
+  {
+    uint64_t hash = 0xcbf29ce484222325;
+    bool valid{true};
+    const auto mix = [&]( uint32_t index, uint64_t flag ) {
+      const auto mapped = map_index( index );
+      valid = valid && mapped != std::numeric_limits<uint32_t>::max();
+      hash = ( hash ^ ( 2u * static_cast<uint64_t>( mapped ) + flag ) ) * 0x100000001b3;
+    };
+    const auto exists = [&]( uint32_t index ) {
+      return index < ntk.size() && !ntk.is_dead( ntk.index_to_node( index ) );
+    };
+
+    for ( auto const* indexes : {&e.leaves, &e.inputs, &e.gates} )
+    {
+      for ( auto index : *indexes )
+      {
+        if ( !exists( index ) )
+        {
+          return std::nullopt;
+        }
+        mix( index, 0u );
+        if ( indexes == &e.gates )
+        {
+          ntk.foreach_fanin( ntk.index_to_node( index ), [&]( auto const& f ) {
+            mix( ntk.node_to_index( ntk.get_node( f ) ), ntk.is_complemented( f ) ? 1u : 0u );
+          } );
+        }
+      }
+    }
+    if ( !valid )
+    {
+      return std::nullopt;
+    }
+    return hash;
+  }
+
+  /* grows the window inputs from the leaves */
+  void compute_window( Ntk const& ntk, entry& e ) const
+  {
+    e.inputs.clear();
+    for ( auto index : e.leaves )
+    {
+      if ( !ntk.is_constant( ntk.index_to_node( index ) ) && std::find( e.inputs.begin(), e.inputs.end(), index ) == e.inputs.end() )
+      {
+        e.inputs.push_back( index );
+      }
+    }
+
+    std::vector<uint32_t> expanded, fanins;
+    const auto new_fanins = [&]( uint32_t index ) {
+      fanins.clear();
+      ntk.foreach_fanin( ntk.index_to_node( index ), [&]( auto const& f ) {
+        const auto c = ntk.get_node( f );
+        const auto ci = ntk.node_to_index( c );
+        if ( !ntk.is_constant( c ) && std::find( e.inputs.begin(), e.inputs.end(), ci ) == e.inputs.end() && std::find( fanins.begin(), fanins.end(), ci ) == fanins.end() )
+        {
+          fanins.push_back( ci );
+        }
+      } );
+      return static_cast<uint32_t>( fanins.size() );
+    };
+
+    while ( expanded.size() < max_window_gates )
+    {
+      auto best = e.inputs.size();
+      auto best_size = ps.window_size + 1u;
+      for ( auto i = 0u; i < e.inputs.size(); ++i )
+      {
+        const auto n = ntk.index_to_node( e.inputs[i] );
+        if ( ntk.is_pi( n ) )
+        {
+          continue;
+        }
+        const auto size = static_cast<uint32_t>( e.inputs.size() ) - 1u + new_fanins( e.inputs[i] );
+        if ( size < best_size )
+        {
+          best = i;
+          best_size = size;
+        }
+      }
+      if ( best == e.inputs.size() )
+      {
+        break;
+      }
+
+      const auto index = e.inputs[best];
+      new_fanins( index );
+      e.inputs.erase( e.inputs.begin() + best );
+      e.inputs.insert( e.inputs.end(), fanins.begin(), fanins.end() );
+      expanded.push_back( index );
+    }
+
+    /* topological order of the expanded nodes */
+    e.gates.clear();
+    std::vector<uint8_t> placed( expanded.size(), 0u );
+    std::vector<std::pair<uint32_t, bool>> stack;
+    const auto position = [&]( uint32_t index ) {
+      return static_cast<uint32_t>( std::find( expanded.begin(), expanded.end(), index ) - expanded.begin() );
+    };
+    for ( auto i = 0u; i < expanded.size(); ++i )
+    {
+      stack.emplace_back( i, false );
+      while ( !stack.empty() )
+      {
+        const auto [pos, done] = stack.back();
+        stack.pop_back();
+        if ( done )
+        {
+          e.gates.push_back( expanded[pos] );
+          continue;
+        }
+        if ( placed[pos] )
+        {
+          continue;
+        }
+        placed[pos] = 1u;
+        stack.emplace_back( pos, true );
+        ntk.foreach_fanin( ntk.index_to_node( expanded[pos] ), [&]( auto const& f ) {
+          const auto p = position( ntk.node_to_index( ntk.get_node( f ) ) );
+          if ( p < expanded.size() && !placed[p] )
+          {
+            stack.emplace_back( p, false );
+          }
+        } );
+      }
+    }
+  }
+
+  /* exhaustive simulation of the window; a leaf combination is a don't care
+     if it occurs for no input assignment */
+  kitty::dynamic_truth_table simulate_window( Ntk const& ntk, entry const& e ) const
+  {
+    const auto num_leaves = static_cast<uint32_t>( e.leaves.size() );
+    kitty::dynamic_truth_table dont_cares( num_leaves );
+    if ( e.gates.empty() )
+    {
+      return dont_cares;
+    }
+
+    const auto num_vars = static_cast<uint32_t>( e.inputs.size() );
+    std::unordered_map<uint32_t, kitty::dynamic_truth_table> values;
+    for ( auto i = 0u; i < num_vars; ++i )
+    {
+      kitty::dynamic_truth_table tt( num_vars );
+      kitty::create_nth_var( tt, i );
+      values.emplace( e.inputs[i], tt );
+    }
+    const auto value = [&]( node const& n ) {
+      const auto it = values.find( ntk.node_to_index( n ) );
+      return it == values.end() ? kitty::dynamic_truth_table( num_vars ) : it->second; /* constant */
+    };
+
+    std::vector<kitty::dynamic_truth_table> fanin_values;
+    for ( auto index : e.gates )
+    {
+      const auto n = ntk.index_to_node( index );
+      fanin_values.clear();
+      ntk.foreach_fanin( n, [&]( auto const& f ) {
+        fanin_values.push_back( value( ntk.get_node( f ) ) );
+      } );
+      values[index] = ntk.compute( n, fanin_values.begin(), fanin_values.end() );
+    }
+
+    std::vector<kitty::dynamic_truth_table> leaf_values;
+    for ( auto index : e.leaves )
+    {
+      leaf_values.push_back( value( ntk.index_to_node( index ) ) );
+    }
+
+    /* each combination is a path in a binary tree over the leaves, in which
+       a subtree is skipped as soon as the conjunction becomes empty */
+    kitty::dynamic_truth_table care( num_leaves );
+    mark_care( leaf_values, 0u, 0u, ~kitty::dynamic_truth_table( num_vars ), care );
+    return ~care;
+  }
+
+  void mark_care( std::vector<kitty::dynamic_truth_table> const& leaf_values, uint32_t i, uint64_t combination, kitty::dynamic_truth_table const& conj, kitty::dynamic_truth_table& care ) const
+  {
+    if ( kitty::is_const0( conj ) )
+    {
+      return;
+    }
+    if ( i == leaf_values.size() )
+    {
+      kitty::set_bit( care, combination );
+      return;
+    }
+    mark_care( leaf_values, i + 1u, combination, conj & ~leaf_values[i], care );
+    mark_care( leaf_values, i + 1u, combination | ( UINT64_C( 1 ) << i ), conj & leaf_values[i], care );
+  }
+
+  /* random simulation signatures of all nodes in topological order */
+  void compute_signatures( Ntk const& ntk )
+  {
+    signatures.assign( ntk.size(), kitty::dynamic_truth_table( num_signature_vars ) );
+    std::vector<uint8_t> state( ntk.size(), 0u );
+    std::vector<std::pair<uint32_t, bool>> stack;
+    std::vector<kitty::dynamic_truth_table> fanin_values;
+
+    ntk.foreach_pi( [&]( auto const& n ) {
+      const auto index = ntk.node_to_index( n );
+      kitty::create_random( signatures[index], index );
+      state[index] = 1u;
+    } );
+
+    ntk.foreach_node( [&]( auto const& root ) {
+      if ( ntk.is_dead( root ) )
+      {
+        return;
+      }
+      stack.emplace_back( ntk.node_to_index( root ), false );
+      while ( !stack.empty() )
+      {
+        const auto [index, done] = stack.back();
+        stack.pop_back();
+        const auto n = ntk.index_to_node( index );
+        if ( done )
+        {
+          fanin_values.clear();
+          ntk.foreach_fanin( n, [&]( auto const& f ) {
+            fanin_values.push_back( signatures[ntk.node_to_index( ntk.get_node( f ) )] );
+          } );
+          signatures[index] = ntk.compute( n, fanin_values.begin(), fanin_values.end() );
+          continue;
+        }
+        if ( state[index] != 0u || ntk.is_constant( n ) )
+        {
+          continue;
+        }
+        state[index] = 1u;
+        stack.emplace_back( index, true );
+        ntk.foreach_fanin( n, [&]( auto const& f ) {
+          stack.emplace_back( ntk.node_to_index( ntk.get_node( f ) ), false );
+        } );
+      }
+    } );
+  }
+
+  /* proves that combinations which are not don't cares of the window, and
+     which do not occur in random simulation, cannot occur */
+  void validate_with_sat( Ntk const& ntk, entry& e )
+  {
+    if ( std::any_of( e.leaves.begin(), e.leaves.end(), [&]( auto index ) { return index >= signatures.size(); } ) )
+    {
+      return;
+    }
+
+    std::vector<uint8_t> occurs( e.dont_cares.num_bits(), 0u );
+    for ( auto b = 0u; b < signatures.front().num_bits(); ++b )
+    {
+      uint64_t combination{0u};
+      for ( auto i = 0u; i < e.leaves.size(); ++i )
+      {
+        if ( kitty::get_bit( signatures[e.leaves[i]], b ) )
+        {
+          combination |= UINT64_C( 1 ) << i;
+        }
+      }
+      occurs[combination] = 1u;
+    }
+
+    for ( auto c = 0u; c < occurs.size(); ++c )
+    {
+      if ( occurs[c] || kitty::get_bit( e.dont_cares, c ) || is_cancelled() )
+      {
+        continue;
+      }
+      ++num_sat_calls;
+      if ( is_impossible( ntk, e.leaves, c ) )
+      {
+        ++num_sat_dont_cares;
+        kitty::set_bit( e.dont_cares, c );
+      }
+    }
+  }
+
+  /* checks with SAT that the leaves cannot take the values in combination */
+  bool is_impossible( Ntk const& ntk, std::vector<uint32_t> const& leaves, uint64_t combination ) const
+  {
+    Ntk cone;
+    std::unordered_map<uint32_t, signal> copied;
+    std::vector<std::pair<uint32_t, bool>> stack;
+    std::vector<signal> children;
+
+    const auto copy = [&]( uint32_t root ) {
+      stack.emplace_back( root, false );
+      while ( !stack.empty() )
+      {
+        const auto [index, done] = stack.back();
+        stack.pop_back();
+        const auto n = ntk.index_to_node( index );
+        if ( done )
+        {
+          children.clear();
+          ntk.foreach_fanin( n, [&]( auto const& f ) {
+            const auto s = copied.at( ntk.node_to_index( ntk.get_node( f ) ) );
+            children.push_back( ntk.is_complemented( f ) ? cone.create_not( s ) : s );
+          } );
+          copied[index] = cone.clone_node( ntk, n, children );
+          continue;
+        }
+        if ( copied.count( index ) )
+        {
+          continue;
+        }
+        if ( ntk.is_constant( n ) )
+        {
+          copied[index] = cone.get_constant( false );
+          continue;
+        }
+        if ( ntk.is_pi( n ) )
+        {
+          copied[index] = cone.create_pi();
+          continue;
+        }
+        stack.emplace_back( index, true );
+        ntk.foreach_fanin( n, [&]( auto const& f ) {
+          stack.emplace_back( ntk.node_to_index( ntk.get_node( f ) ), false );
+        } );
+      }
+      return copied.at( root );
+    };
+
+    auto conj = cone.get_constant( true );
+    for ( auto i = 0u; i < leaves.size(); ++i )
+    {
+      const auto s = copy( leaves[i] );
+      conj = cone.create_and( conj, ( ( combination >> i ) & 1u ) ? s : cone.create_not( s ) );
+    }
+    cone.create_po( conj );
+
+    mockturtle::equivalence_checking_params ecps;
+    ecps.conflict_limit = ps.conflict_limit;
+    const auto result = mockturtle::equivalence_checking( cone, ecps );
+    return result && *result;
+  }
+
+private:
+  dont_care_params ps;
+  std::vector<std::vector<entry>> cache;
+  std::vector<kitty::dynamic_truth_table> signatures;
+
+  std::atomic<uint32_t> num_queries{0u};
+  std::atomic<uint32_t> num_cache_hits{0u};
+  std::atomic<uint32_t> num_dont_cares{0u};
+  std::atomic<uint32_t> num_sat_calls{0u};
+  std::atomic<uint32_t> num_sat_dont_cares{0u};
+};
+
+/*! \brief Completions of an incompletely specified function
+
+  Returns distinct completions of `function` with respect to `dont_cares`:
+  the completion in which variables are removed from the support whenever
+  both cofactors agree on their common care set, the function itself, and
+  the completions that assign all don't cares to 0 and 1, respectively.
+*/
+inline std::vector<kitty::dynamic_truth_table> dont_care_completions( kitty::dynamic_truth_table const& function, kitty::dynamic_truth_table const& dont_cares )
+{
+  auto reduced = function;
+  auto care = ~dont_cares;
+  for ( auto i = 0u; i < function.num_vars(); ++i )
+  {
+    const auto f0 = kitty::cofactor0( reduced, i ), f1 = kitty::cofactor1( reduced, i );
+    const auto c0 = kitty::cofactor0( care, i ), c1 = kitty::cofactor1( care, i );
+    if ( kitty::is_const0( ( f0 ^ f1 ) & c0 & c1 ) )
+    {
+      /* take the value of the cofactor that cares */
+      reduced = ( f1 & c1 & ~c0 ) | ( f0 & ~( c1 & ~c0 ) );
+      care = c0 | c1;
+    }
+  }
+
+  std::vector<kitty::dynamic_truth_table> completions;
+  for ( auto const& f : {reduced, function, function & ~dont_cares, function | dont_cares} )
+  {
+    if ( std::find( completions.begin(), completions.end(), f ) == completions.end() )
+    {
+      completions.push_back( f );
+    }
+  }
+  return completions;
+}
+
+/*! \brief Adds don't-care support to a resynthesis function
+
+  The don't-care overload calls the resynthesis function for each completion
+  (see `dont_care_completions`) and passes all candidates to the callback,
+  until the callback returns false.  `ResynFn` may be a reference type.
+*/
+template<class ResynFn>
+class dont_care_resynthesis
+{
+public:
+  explicit dont_care_resynthesis( ResynFn fn ) : fn( std::forward<ResynFn>( fn ) ) {}
+
+  template<typename Ntk, typename LeavesIterator, typename Fn>
+  void operator()( Ntk& ntk, kitty::dynamic_truth_table const& function, LeavesIterator begin, LeavesIterator end, Fn&& callback )
+  {
+    fn( ntk, function, begin, end, std::forward<Fn>( callback ) );
+  }
+
+  template<typename Ntk, typename LeavesIterator, typename Fn>
+  void operator()( Ntk& ntk, kitty::dynamic_truth_table const& function, kitty::dynamic_truth_table const& dont_cares, LeavesIterator begin, LeavesIterator end, Fn&& callback )
+  {
+    bool proceed{true};
+    for ( auto const& f : dont_care_completions( function, dont_cares ) )
+    {
+      fn( ntk, f, begin, end, [&]( auto const& s ) {
+        return proceed = callback( s );
+      } );
+      if ( !proceed )
+      {
+        return;
+      }
+    }
+  }
+
+private:
+  ResynFn fn;
+};
+
+/*! \brief Whether a resynthesis function has a don't-care overload */
+template<class ResynFn, class Ntk, class = void>
+struct has_dont_care_resynthesis : std::false_type
+{
+};
+
+template<class ResynFn, class Ntk>
+struct has_dont_care_resynthesis<ResynFn, Ntk, std::void_t<decltype( std::declval<ResynFn&>()( std::declval<Ntk&>(), std::declval<kitty::dynamic_truth_table const&>(), std::declval<kitty::dynamic_truth_table const&>(), std::declval<typename std::vector<typename Ntk::signal>::iterator>(), std::declval<typename std::vector<typename Ntk::signal>::iterator>(), std::declval<bool ( * )( typename Ntk::signal const& )>() ) )>> : std::true_type
+{
+};
+
+template<class ResynFn, class Ntk>
+inline constexpr bool has_dont_care_resynthesis_v = has_dont_care_resynthesis<ResynFn, Ntk>::value;
+
+} // namespace cirkit
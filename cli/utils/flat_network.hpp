@@ -0,0 +1,376 @@
+/* CirKit: A circuit toolkit
+ * Copyright (C) 2017-2019  EPFL
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+#include <kitty/constructors.hpp>
+#include <kitty/dynamic_truth_table.hpp>
+#include <kitty/operations.hpp>
+
+#include <mockturtle/networks/klut.hpp>
+#include <mockturtle/traits.hpp>
+#include <mockturtle/utils/node_map.hpp>
+#include <mockturtle/views/topo_view.hpp>
+
+namespace cirkit
+{
+
+/* Flat array representation of networks
+
+   Nodes are numbered as in AIGER: index 0 is constant 0, indexes 1 to
+   num_pis are the primary inputs, and the gates follow in topological order.
+   A literal is twice the index plus one for complementation.  Gates that do
+   not lead to an output are not written.
+
+   Gate networks (AIG, XAG, MIG, XMG) store `fanin_size` literals per gate
+   (2 for AIGs and XAGs, 3 for MIGs and XMGs) and an optional gate type per
+   gate (1 for XOR in XAGs and for XOR3 in XMGs, 0 otherwise).
+
+   LUT networks store `num_luts + 1` fanin offsets into the fanin literal
+   array, and the truth tables of the LUTs as consecutive 64-bit words, where
+   a LUT with k inputs occupies max(1, 2^(k-6)) words. */
+
+template<class Ntk>
+constexpr uint32_t flat_fanin_size()
+{
+  return Ntk::max_fanin_size;
+}
+
+/* largest LUT that is read from flat arrays */
+constexpr uint32_t max_flat_lut_size = 16u;
+
+inline uint32_t flat_num_words( uint32_t num_vars )
+{
+  return num_vars <= 6u ? 1u : ( 1u << ( num_vars - 6u ) );
+}
+
+/* gates in topological order, node indexes need not be topological after
+   nodes have been substituted */
+template<class Ntk>
+std::vector<mockturtle::node<Ntk>> flat_gates( Ntk const& ntk )
+{
+  std::vector<mockturtle::node<Ntk>> gates;
+  mockturtle::topo_view<Ntk>{ntk}.foreach_gate( [&]( auto const& n ) {
+    gates.push_back( n );
+  } );
+  return gates;
+}
+
+template<class Ntk>
+mockturtle::node_map<uint32_t, Ntk> flat_literals( Ntk const& ntk, std::vector<mockturtle::node<Ntk>> const& gates )
+{
+  mockturtle::node_map<uint32_t, Ntk> literals( ntk );
+  literals[ntk.get_node( ntk.get_constant( false ) )] = 0u;
+  if ( ntk.get_node( ntk.get_constant( true ) ) != ntk.get_node( ntk.get_constant( false ) ) )
+  {
+    /* LUT networks have an explicit node for constant 1 */
+    literals[ntk.get_node( ntk.get_constant( true ) )] = 1u;
+  }
+
+  uint32_t index{1u};
+  ntk.foreach_pi( [&]( auto const& n ) {
+    literals[n] = 2u * index++;
+  } );
+  for ( auto const& n : gates )
+  {
+    literals[n] = 2u * index++;
+  }
+  return literals;
+}
+
+template<class Ntk>
+inline uint32_t flat_literal( Ntk const& ntk, mockturtle::node_map<uint32_t, Ntk> const& literals, mockturtle::signal<Ntk> const& f )
+{
+  return literals[ntk.get_node( f )] ^ ( ntk.is_complemented( f ) ? 1u : 0u );
+}
+
+/*! \brief Sizes of the flat representation of a gate network */
+template<class Ntk>
+void flat_network_size( Ntk const& ntk, uint32_t& num_pis, uint32_t& num_gates, uint32_t& num_pos )
+{
+  num_pis = ntk.num_pis();
+  num_gates = static_cast<uint32_t>( flat_gates( ntk ).size() );
+  num_pos = ntk.num_pos();
+}
+
+/*! \brief Writes a gate network into caller-provided arrays
+
+  `fanins` must hold `flat_fanin_size<Ntk>() * num_gates` entries, `pos`
+  `num_pos` entries, and `gate_types` (if not `nullptr`) `num_gates` entries.
+*/
+template<class Ntk>
+void write_flat_network( Ntk const& ntk, uint32_t* fanins, uint8_t* gate_types, uint32_t* pos )
+{
+  const auto gates = flat_gates( ntk );
+  const auto literals = flat_literals( ntk, gates );
+
+  for ( auto const& n : gates )
+  {
+    ntk.foreach_fanin( n, [&]( auto const& f ) {
+      *fanins++ = flat_literal( ntk, literals, f );
+    } );
+
+    if ( gate_types )
+    {
+      if constexpr ( mockturtle::has_is_xor_v<Ntk> )
+      {
+        *gate_types++ = ntk.is_xor( n ) ? 1u : 0u;
+      }
+      else if constexpr ( mockturtle::has_is_xor3_v<Ntk> )
+      {
+        *gate_types++ = ntk.is_xor3( n ) ? 1u : 0u;
+      }
+      else
+      {
+        *gate_types++ = 0u;
+      }
+    }
+  }
+
+  ntk.foreach_po( [&]( auto const& f ) {
+    *pos++ = flat_literal( ntk, literals, f );
+  } );
+}
+
+/*! \brief Creates a gate network from flat arrays
+
+  Returns no network, if some literal does not refer to a preceding node.
+*/
+template<class Ntk>
+std::optional<Ntk> read_flat_network( uint32_t num_pis, uint32_t num_gates, uint32_t const* fanins, uint8_t const* gate_types, uint32_t num_pos, uint32_t const* pos )
+{
+  constexpr auto fanin_size = flat_fanin_size<Ntk>();
+
+  Ntk ntk;
+  std::vector<mockturtle::signal<Ntk>> signals;
+  signals.reserve( 1u + num_pis + num_gates );
+  signals.push_back( ntk.get_constant( false ) );
+  for ( auto i = 0u; i < num_pis; ++i )
+  {
+    signals.push_back( ntk.create_pi() );
+  }
+
+  const auto get = [&]( uint32_t literal, mockturtle::signal<Ntk>& f ) {
+    if ( ( literal >> 1 ) >= signals.size() )
+    {
+      return false;
+    }
+    f = ( literal & 1 ) ? ntk.create_not( signals[literal >> 1] ) : signals[literal >> 1];
+    return true;
+  };
+
+  for ( auto i = 0u; i < num_gates; ++i )
+  {
+    std::array<mockturtle::signal<Ntk>, fanin_size> children;
+    for ( auto j = 0u; j < fanin_size; ++j )
+    {
+      if ( !get( *fanins++, children[j] ) )
+      {
+        return std::nullopt;
+      }
+    }
+    const auto is_xor = gate_types && gate_types[i] == 1u;
+
+    if constexpr ( fanin_size == 2u )
+    {
+      if constexpr ( mockturtle::has_create_xor_v<Ntk> )
+      {
+        if ( is_xor )
+        {
+          signals.push_back( ntk.create_xor( children[0], children[1] ) );
+          continue;
+        }
+      }
+      signals.push_back( ntk.create_and( children[0], children[1] ) );
+    }
+    else
+    {
+      if constexpr ( mockturtle::has_create_xor3_v<Ntk> )
+      {
+        if ( is_xor )
+        {
+          signals.push_back( ntk.create_xor3( children[0], children[1], children[2] ) );
+          continue;
+        }
+      }
+      signals.push_back( ntk.create_maj( children[0], children[1], children[2] ) );
+    }
+  }
+
+  for ( auto i = 0u; i < num_pos; ++i )
+  {
+    mockturtle::signal<Ntk> f;
+    if ( !get( pos[i], f ) )
+    {
+      return std::nullopt;
+    }
+    ntk.create_po( f );
+  }
+
+  return ntk;
+}
+
+/*! \brief Sizes of the flat representation of a LUT network */
+template<class Ntk>
+void flat_lut_network_size( Ntk const& ntk, uint32_t& num_pis, uint32_t& num_luts, uint32_t& num_fanins, uint32_t& num_words, uint32_t& num_pos )
+{
+  const auto gates = flat_gates( ntk );
+
+  num_pis = ntk.num_pis();
+  num_luts = static_cast<uint32_t>( gates.size() );
+  num_pos = ntk.num_pos();
+  num_fanins = 0u;
+  num_words = 0u;
+  for ( auto const& n : gates )
+  {
+    num_fanins += ntk.fanin_size( n );
+    num_words += flat_num_words( ntk.fanin_size( n ) );
+  }
+}
+
+/*! \brief Writes a LUT network into caller-provided arrays (sizes from `flat_lut_network_size`) */
+template<class Ntk>
+void write_flat_lut_network( Ntk const& ntk, uint32_t* fanin_offsets, uint32_t* fanins, uint64_t* functions, uint32_t* pos )
+{
+  const auto gates = flat_gates( ntk );
+  const auto literals = flat_literals( ntk, gates );
+
+  uint32_t offset{0u};
+  for ( auto const& n : gates )
+  {
+    *fanin_offsets++ = offset;
+    ntk.foreach_fanin( n, [&]( auto const& f ) {
+      *fanins++ = flat_literal( ntk, literals, f );
+      ++offset;
+    } );
+
+    const auto tt = ntk.node_function( n );
+    if ( tt.num_vars() < 6u )
+    {
+      /* replicate small truth tables, such that they fill the word */
+      *functions++ = kitty::extend_to( tt, 6u )._bits[0];
+    }
+    else
+    {
+      functions = std::copy( tt.cbegin(), tt.cend(), functions );
+    }
+  }
+  *fanin_offsets = offset;
+
+  ntk.foreach_po( [&]( auto const& f ) {
+    *pos++ = flat_literal( ntk, literals, f );
+  } );
+}
+
+/*! \brief Creates a LUT network from flat arrays
+
+  `fanins` has `num_fanins` entries and `functions` has `num_words` entries.
+  Complemented fanins and outputs are realized by inverters.  Returns no
+  network, if some literal does not refer to a preceding node, or if the
+  fanin offsets or truth tables do not fit into the arrays.
+*/
+inline std::optional<mockturtle::klut_network> read_flat_lut_network( uint32_t num_pis, uint32_t num_luts, uint32_t const* fanin_offsets, uint32_t num_fanins, uint32_t const* fanins, uint32_t num_words, uint64_t const* functions, uint32_t num_pos, uint32_t const* pos )
+{
+  using signal = mockturtle::klut_network::signal;
+
+  mockturtle::klut_network ntk;
+  std::vector<signal> signals;
+  signals.reserve( 1u + num_pis + num_luts );
+  signals.push_back( ntk.get_constant( false ) );
+  for ( auto i = 0u; i < num_pis; ++i )
+  {
+    signals.push_back( ntk.create_pi() );
+  }
+
+  const auto get = [&]( uint32_t literal, signal& f ) {
+    if ( ( literal >> 1 ) >= signals.size() )
+    {
+      return false;
+    }
+    f = signals[literal >> 1];
+    if ( literal & 1 )
+    {
+      f = ( literal >> 1 ) == 0u ? ntk.get_constant( true ) : ntk.create_not( f );
+    }
+    return true;
+  };
+
+  uint64_t const* functions_end = functions + num_words;
+  for ( auto i = 0u; i < num_luts; ++i )
+  {
+    if ( fanin_offsets[i] > fanin_offsets[i + 1] || fanin_offsets[i + 1] > num_fanins )
+    {
+      return std::nullopt;
+    }
+    const auto num_vars = fanin_offsets[i + 1] - fanin_offsets[i];
+    if ( num_vars > max_flat_lut_size || flat_num_words( num_vars ) > static_cast<uint64_t>( functions_end - functions ) )
+    {
+      return std::nullopt;
+    }
+
+    std::vector<signal> children( num_vars );
+    for ( auto j = 0u; j < num_vars; ++j )
+    {
+      if ( !get( fanins[fanin_offsets[i] + j], children[j] ) )
+      {
+        return std::nullopt;
+      }
+    }
+
+    kitty::dynamic_truth_table tt( num_vars );
+    if ( num_vars < 6u )
+    {
+      kitty::create_from_words( tt, functions, functions + 1 );
+      tt.mask_bits();
+    }
+    else
+    {
+      kitty::create_from_words( tt, functions, functions + tt.num_blocks() );
+    }
+    functions += flat_num_words( num_vars );
+
+    signals.push_back( ntk.create_node( children, tt ) );
+  }
+
+  for ( auto i = 0u; i < num_pos; ++i )
+  {
+    signal f;
+    if ( !get( pos[i], f ) )
+    {
+      return std::nullopt;
+    }
+    ntk.create_po( f );
+  }
+
+  return ntk;
+}
+
+} // namespace cirkit
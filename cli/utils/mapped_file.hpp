@@ -0,0 +1,213 @@
+/* CirKit: A circuit toolkit
+ * Copyright (C) 2017-2019  EPFL
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <string>
+
+#if defined _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace cirkit
+{
+
+/*! \brief Read-only memory mapping of a file
+
+  The file content is mapped into the address space when opening the file,
+  pages are loaded on first access.  The mapping is released on destruction.
+*/
+class mapped_file
+{
+public:
+  mapped_file() = default;
+
+  ~mapped_file()
+  {
+    close();
+  }
+
+  mapped_file( mapped_file const& ) = delete;
+  mapped_file& operator=( mapped_file const& ) = delete;
+
+  /*! \brief Maps `filename`, returns false if the file cannot be mapped */
+  bool open( std::string const& filename )
+  {
+    close();
+
+#if defined _WIN32
+    file = CreateFileA( filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr );
+    if ( file == INVALID_HANDLE_VALUE )
+    {
+      return false;
+    }
+
+    LARGE_INTEGER file_size;
+    if ( !GetFileSizeEx( file, &file_size ) || file_size.QuadPart == 0 )
+    {
+      close();
+      return false;
+    }
+
+    mapping = CreateFileMappingA( file, nullptr, PAGE_READONLY, 0, 0, nullptr );
+    if ( mapping == nullptr )
+    {
+      close();
+      return false;
+    }
+
+    const auto* addr = MapViewOfFile( mapping, FILE_MAP_READ, 0, 0, 0 );
+    if ( addr == nullptr )
+    {
+      close();
+      return false;
+    }
+    _data = static_cast<uint8_t const*>( addr );
+    _size = static_cast<std::size_t>( file_size.QuadPart );
+#else
+    const auto fd = ::open( filename.c_str(), O_RDONLY );
+    if ( fd < 0 )
+    {
+      return false;
+    }
+
+    struct stat st;
+    if ( fstat( fd, &st ) != 0 || st.st_size == 0 )
+    {
+      ::close( fd );
+      return false;
+    }
+
+    auto* addr = mmap( nullptr, static_cast<std::size_t>( st.st_size ), PROT_READ, MAP_SHARED, fd, 0 );
+    ::close( fd );
+    if ( addr == MAP_FAILED )
+    {
+      return false;
+    }
+    _data = static_cast<uint8_t const*>( addr );
+    _size = static_cast<std::size_t>( st.st_size );
+#endif
+
+    return true;
+  }
+
+  void close()
+  {
+#if defined _WIN32
+    if ( _data )
+    {
+      UnmapViewOfFile( _data );
+    }
+    if ( mapping != nullptr )
+    {
+      CloseHandle( mapping );
+      mapping = nullptr;
+    }
+    if ( file != INVALID_HANDLE_VALUE )
+    {
+      CloseHandle( file );
+      file = INVALID_HANDLE_VALUE;
+    }
+#else
+    if ( _data )
+    {
+      munmap( const_cast<uint8_t*>( _data ), _size );
+    }
+#endif
+    _data = nullptr;
+    _size = 0u;
+  }
+
+  uint8_t const* data() const
+  {
+    return _data;
+  }
+
+  std::size_t size() const
+  {
+    return _size;
+  }
+
+private:
+  uint8_t const* _data{nullptr};
+  std::size_t _size{0u};
+
+#if defined _WIN32
+  HANDLE file{INVALID_HANDLE_VALUE};
+  HANDLE mapping{nullptr};
+#endif
+};
+
+/*! \brief Writes a file that might be mapped by this or another process
+
+  `write_fn` writes the content into an output stream for a temporary file,
+  which replaces `filename` when complete.  Existing mappings of the previous
+  file remain valid.
+*/
+template<class WriteFn>
+bool replace_file( std::string const& filename, WriteFn&& write_fn )
+{
+  const auto tmp_filename = filename + ".tmp";
+  {
+    std::ofstream os( tmp_filename, std::ofstream::binary );
+    if ( !os )
+    {
+      return false;
+    }
+    write_fn( os );
+    if ( !os )
+    {
+      os.close();
+      std::remove( tmp_filename.c_str() );
+      return false;
+    }
+  }
+
+  if ( std::rename( tmp_filename.c_str(), filename.c_str() ) != 0 )
+  {
+    /* rename does not replace existing files on all platforms */
+    std::remove( filename.c_str() );
+    if ( std::rename( tmp_filename.c_str(), filename.c_str() ) != 0 )
+    {
+      std::remove( tmp_filename.c_str() );
+      return false;
+    }
+  }
+  return true;
+}
+
+} // namespace cirkit
@@ -0,0 +1,418 @@
+/* CirKit: A circuit toolkit
+ * Copyright (C) 2017-2019  EPFL
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <kitty/dynamic_truth_table.hpp>
+#include <kitty/spectral.hpp>
+#include <kitty/static_truth_table.hpp>
+#include <mockturtle/networks/xag.hpp>
+
+#include "mapped_file.hpp"
+#include "npn_database.hpp"
+
+namespace cirkit
+{
+
+/*! \brief Spectral classification of a 6-input function
+
+  `ops` is the sequence of spectral operations that transforms the function
+  into its representative, as computed by kitty.
+*/
+struct spectral_transformation
+{
+  uint64_t representative{0u};
+  std::vector<kitty::detail::spectral_operation> ops;
+};
+
+inline spectral_transformation spectral_canonize( uint64_t function )
+{
+  kitty::static_truth_table<6u> tt;
+  *tt.begin() = function;
+
+  spectral_transformation t;
+  const auto repr = kitty::exact_spectral_canonization( tt, [&]( auto const& ops ) { t.ops = ops; } );
+  t.representative = *repr.cbegin();
+  return t;
+}
+
+/*! \brief Slot of the hash index of a compiled MC database */
+struct mc_database_slot
+{
+  uint64_t function;
+  uint32_t offset;
+  uint16_t num_gates;
+  uint16_t output;
+};
+
+namespace detail
+{
+
+struct mc_database_header
+{
+  char magic[8];
+  uint32_t version;
+  uint32_t num_entries;
+  uint32_t num_slots;
+  uint32_t num_literals;
+};
+
+static_assert( sizeof( mc_database_header ) == 24u, "unexpected header size" );
+static_assert( sizeof( mc_database_slot ) == 16u, "unexpected slot size" );
+
+constexpr char mc_database_magic[8] = {'C', 'K', 'M', 'C', 'D', 'B', '\0', '\0'};
+constexpr uint32_t mc_database_version = 1u;
+constexpr uint16_t mc_database_empty_slot = 0xffff;
+
+inline uint32_t mc_database_hash( uint64_t function, uint32_t num_slots )
+{
+  /* num_slots is a power of two */
+  return static_cast<uint32_t>( ( function * 0x9e3779b97f4a7c15 ) >> 32 ) & ( num_slots - 1u );
+}
+
+} // namespace detail
+
+/*! \brief Compiled database of XAGs with minimum multiplicative complexity
+
+  Entries are keyed by the spectral class representative of 6-input
+  functions and store an XAG structure in the format of `npn_structure`.  The
+  file consists of a header, an open-addressing hash index (linear probing,
+  the number of slots is a power of two), and a pool of fanin literals.
+  Opening a database only maps the file; it is read-only and can be shared
+  between threads.
+*/
+class mc_database
+{
+public:
+  /*! \brief Checks whether `filename` starts like a compiled database */
+  static bool is_compiled( std::string const& filename )
+  {
+    std::ifstream in( filename, std::ifstream::binary );
+    char magic[8];
+    return in.read( magic, sizeof( magic ) ) && std::memcmp( magic, detail::mc_database_magic, sizeof( magic ) ) == 0;
+  }
+
+  /*! \brief Opens a compiled database, returns `nullptr` if the file is not valid */
+  static std::shared_ptr<mc_database const> open( std::string const& filename )
+  {
+    std::shared_ptr<mc_database> db( new mc_database );
+    if ( !db->file.open( filename ) || db->file.size() < sizeof( detail::mc_database_header ) )
+    {
+      return nullptr;
+    }
+
+    const auto* header = reinterpret_cast<detail::mc_database_header const*>( db->file.data() );
+    if ( std::memcmp( header->magic, detail::mc_database_magic, sizeof( header->magic ) ) != 0 || header->version != detail::mc_database_version ||
+         header->num_slots == 0u || ( header->num_slots & ( header->num_slots - 1u ) ) != 0u || header->num_entries >= header->num_slots )
+    {
+      return nullptr;
+    }
+
+    const auto size = sizeof( detail::mc_database_header ) + uint64_t( header->num_slots ) * sizeof( mc_database_slot ) + uint64_t( header->num_literals ) * sizeof( uint16_t );
+    if ( db->file.size() < size )
+    {
+      return nullptr;
+    }
+
+    db->header = header;
+    db->slots = reinterpret_cast<mc_database_slot const*>( db->file.data() + sizeof( detail::mc_database_header ) );
+    db->literals = reinterpret_cast<uint16_t const*>( db->slots + header->num_slots );
+    return db;
+  }
+
+  uint32_t size() const
+  {
+    return header->num_entries;
+  }
+
+  /*! \brief Slot of representative `function` (or `nullptr`) */
+  mc_database_slot const* find( uint64_t function ) const
+  {
+    for ( auto i = detail::mc_database_hash( function, header->num_slots );; i = ( i + 1u ) & ( header->num_slots - 1u ) )
+    {
+      auto const& slot = slots[i];
+      if ( slot.num_gates == detail::mc_database_empty_slot )
+      {
+        return nullptr;
+      }
+      if ( slot.function == function )
+      {
+        return uint64_t( slot.offset ) + 2u * slot.num_gates <= header->num_literals ? &slot : nullptr;
+      }
+    }
+  }
+
+  uint16_t const* fanins( mc_database_slot const& slot ) const
+  {
+    return literals + slot.offset;
+  }
+
+private:
+  mc_database() = default;
+
+private:
+  mapped_file file;
+  detail::mc_database_header const* header{nullptr};
+  mc_database_slot const* slots{nullptr};
+  uint16_t const* literals{nullptr};
+};
+
+/*! \brief Writes a compiled database with the structures of `entries` (keyed by representative) */
+inline bool write_mc_database( std::string const& filename, std::map<uint64_t, npn_structure> const& entries )
+{
+  detail::mc_database_header header;
+  std::memcpy( header.magic, detail::mc_database_magic, sizeof( header.magic ) );
+  header.version = detail::mc_database_version;
+  header.num_entries = static_cast<uint32_t>( entries.size() );
+  header.num_literals = 0u;
+
+  /* load factor of at most 1/2 */
+  header.num_slots = 2u;
+  while ( header.num_slots < 2u * header.num_entries )
+  {
+    header.num_slots <<= 1u;
+  }
+
+  std::vector<mc_database_slot> slots( header.num_slots, {0u, 0u, detail::mc_database_empty_slot, 0u} );
+  for ( auto const& [function, s] : entries )
+  {
+    auto i = detail::mc_database_hash( function, header.num_slots );
+    while ( slots[i].num_gates != detail::mc_database_empty_slot )
+    {
+      i = ( i + 1u ) & ( header.num_slots - 1u );
+    }
+    slots[i] = {function, header.num_literals, static_cast<uint16_t>( s.num_gates() ), s.output};
+    header.num_literals += static_cast<uint32_t>( s.fanins.size() );
+  }
+
+  return replace_file( filename, [&]( std::ostream& os ) {
+    os.write( reinterpret_cast<char const*>( &header ), sizeof( header ) );
+    os.write( reinterpret_cast<char const*>( slots.data() ), slots.size() * sizeof( mc_database_slot ) );
+    for ( auto const& p : entries )
+    {
+      os.write( reinterpret_cast<char const*>( p.second.fanins.data() ), p.second.fanins.size() * sizeof( uint16_t ) );
+    }
+  } );
+}
+
+/*! \brief Process-wide registry of compiled databases
+
+  Databases that are kept in the registry stay mapped for the lifetime of
+  the process and are shared by all environments (e.g., independent Python
+  sessions or batch runs in the same server process).
+*/
+class mc_database_registry
+{
+public:
+  static std::shared_ptr<mc_database const> find( std::string const& filename )
+  {
+    std::lock_guard<std::mutex> lock( mutex() );
+    const auto it = databases().find( filename );
+    return it == databases().end() ? nullptr : it->second;
+  }
+
+  static void keep( std::string const& filename, std::shared_ptr<mc_database const> const& db )
+  {
+    std::lock_guard<std::mutex> lock( mutex() );
+    databases()[filename] = db;
+  }
+
+  static void release( std::string const& filename )
+  {
+    std::lock_guard<std::mutex> lock( mutex() );
+    databases().erase( filename );
+  }
+
+private:
+  static std::mutex& mutex()
+  {
+    static std::mutex m;
+    return m;
+  }
+
+  static std::unordered_map<std::string, std::shared_ptr<mc_database const>>& databases()
+  {
+    static std::unordered_map<std::string, std::shared_ptr<mc_database const>> dbs;
+    return dbs;
+  }
+};
+
+/*! \brief MC resynthesis of cut functions with a compiled database
+
+  The cut function is classified by spectral canonization, the structure of
+  the representative is looked up in the database, and the spectral
+  operations are undone on the leaves (permutations, input negations, and
+  translations) and on the output (output negation and disjoint
+  translations).  Classifications are cached in the resynthesis object,
+  which is therefore not thread-safe; the database itself can be shared.
+  The reconstruction is checked by simulation when a function is
+  classified, functions that fail the check are not resynthesized.
+*/
+template<class Ntk = mockturtle::xag_network>
+class xag_minmc_db_resynthesis
+{
+public:
+  using signal = typename Ntk::signal;
+
+  explicit xag_minmc_db_resynthesis( std::shared_ptr<mc_database const> db )
+      : db( db )
+  {
+  }
+
+  template<typename LeavesIterator, typename Fn>
+  void operator()( Ntk& ntk, kitty::dynamic_truth_table const& function, LeavesIterator begin, LeavesIterator end, Fn&& fn )
+  {
+    if ( function.num_vars() > 6u )
+    {
+      return;
+    }
+
+    const auto word = expand_to_6_vars( function );
+    auto it = cache.find( word );
+    if ( it == cache.end() )
+    {
+      if ( cache.size() >= max_cache_size )
+      {
+        cache.clear();
+      }
+      auto t = spectral_canonize( word );
+      const auto* slot = db->find( t.representative );
+      if ( slot && !verify( word, *slot, t ) )
+      {
+        slot = nullptr;
+      }
+      it = cache.emplace( word, std::make_pair( slot, std::move( t ) ) ).first;
+    }
+
+    const auto* slot = it->second.first;
+    if ( !slot )
+    {
+      return;
+    }
+
+    std::vector<signal> leaves( 6u, ntk.get_constant( false ) );
+    std::copy( begin, end, leaves.begin() );
+
+    auto output_xor = ntk.get_constant( false );
+    const auto output_negation = undo( it->second.second, leaves, output_xor, [&]( auto const& a, auto const& b ) { return ntk.create_xor( a, b ); }, [&]( auto const& a ) { return ntk.create_not( a ); } );
+
+    std::vector<signal> signals( 7u + slot->num_gates, ntk.get_constant( false ) );
+    std::copy( leaves.begin(), leaves.end(), signals.begin() + 1u );
+
+    const auto literal = [&]( uint16_t lit ) {
+      return ( lit & 1 ) ? ntk.create_not( signals[lit >> 1] ) : signals[lit >> 1];
+    };
+
+    const auto* fanins = db->fanins( *slot );
+    for ( auto j = 0u; j < slot->num_gates; ++j )
+    {
+      const auto a = fanins[2u * j], b = fanins[2u * j + 1u];
+      signals[7u + j] = a > b ? ntk.create_xor( literal( a ), literal( b ) ) : ntk.create_and( literal( a ), literal( b ) );
+    }
+
+    const auto f = ntk.create_xor( literal( slot->output ), output_xor );
+    fn( output_negation ? ntk.create_not( f ) : f );
+  }
+
+private:
+  /* undoes the spectral operations on the leaves and collects the disjoint
+     translations in output_xor, returns whether the output is negated */
+  template<class T, class XorFn, class NotFn>
+  static bool undo( spectral_transformation const& t, std::vector<T>& leaves, T& output_xor, XorFn&& create_xor, NotFn&& create_not )
+  {
+    /* variables are encoded as bitmasks */
+    const auto var = []( auto mask ) { return static_cast<uint32_t>( std::log2( mask ) ); };
+
+    bool output_negation = false;
+    for ( auto const& op : t.ops )
+    {
+      switch ( op._kind )
+      {
+      default:
+        break;
+      case kitty::detail::spectral_operation::kind::permutation:
+        std::swap( leaves[var( op._var1 )], leaves[var( op._var2 )] );
+        break;
+      case kitty::detail::spectral_operation::kind::input_negation:
+        leaves[var( op._var1 )] = create_not( leaves[var( op._var1 )] );
+        break;
+      case kitty::detail::spectral_operation::kind::output_negation:
+        output_negation = !output_negation;
+        break;
+      case kitty::detail::spectral_operation::kind::spectral_translation:
+        leaves[var( op._var1 )] = create_xor( leaves[var( op._var1 )], leaves[var( op._var2 )] );
+        break;
+      case kitty::detail::spectral_operation::kind::disjoint_translation:
+        output_xor = create_xor( output_xor, leaves[var( op._var1 )] );
+        break;
+      }
+    }
+    return output_negation;
+  }
+
+  /* simulates the reconstruction once per function, which also rejects
+     corrupt database entries */
+  bool verify( uint64_t function, mc_database_slot const& slot, spectral_transformation const& t ) const
+  {
+    const auto* fanins = db->fanins( slot );
+    for ( auto j = 0u; j < slot.num_gates; ++j )
+    {
+      if ( ( fanins[2u * j] >> 1 ) >= 7u + j || ( fanins[2u * j + 1u] >> 1 ) >= 7u + j )
+      {
+        return false;
+      }
+    }
+    if ( ( slot.output >> 1 ) >= 7u + slot.num_gates )
+    {
+      return false;
+    }
+
+    std::vector<uint64_t> leaves{0xaaaaaaaaaaaaaaaa, 0xcccccccccccccccc, 0xf0f0f0f0f0f0f0f0, 0xff00ff00ff00ff00, 0xffff0000ffff0000, 0xffffffff00000000};
+    uint64_t output_xor{0u};
+    const auto output_negation = undo( t, leaves, output_xor, []( uint64_t a, uint64_t b ) { return a ^ b; }, []( uint64_t a ) { return ~a; } );
+    const auto value = simulate_npn_structure( fanins, slot.num_gates, slot.output, leaves.data() ) ^ output_xor;
+    return ( output_negation ? ~value : value ) == function;
+  }
+
+private:
+  static constexpr std::size_t max_cache_size = 1u << 20;
+
+  std::shared_ptr<mc_database const> db;
+  std::unordered_map<uint64_t, std::pair<mc_database_slot const*, spectral_transformation>> cache;
+};
+
+} // namespace cirkit
@@ -0,0 +1,304 @@
+/* CirKit: A circuit toolkit
+ * Copyright (C) 2017-2019  EPFL
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <exception>
+#include <fstream>
+#include <limits>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <fmt/format.h>
+#include <mockturtle/algorithms/cut_rewriting.hpp>
+#include <mockturtle/algorithms/node_resynthesis/bidecomposition.hpp>
+#include <mockturtle/algorithms/node_resynthesis/xag_minmc.hpp>
+#include <mockturtle/algorithms/refactoring.hpp>
+#include <mockturtle/networks/xag.hpp>
+#include <mockturtle/utils/stopwatch.hpp>
+
+#include "cancellation.hpp"
+#include "compaction.hpp"
+#include "dont_cares.hpp"
+#include "mc_database.hpp"
+#include "network_cost.hpp"
+#include "parallel_cut_rewriting.hpp"
+#include "partitioning.hpp"
+#include "refactoring.hpp"
+#include "thread_pool.hpp"
+
+namespace cirkit
+{
+
+/*! \brief Database for MC rewriting
+
+  Either a text database, which is parsed by mockturtle's
+  `xag_minmc_resynthesis`, or a compiled database (see `mc_database`).  Only
+  compiled databases can be used by several threads.
+*/
+struct mc_rewriting_database
+{
+  std::shared_ptr<mockturtle::xag_minmc_resynthesis> text;
+  std::shared_ptr<mc_database const> compiled;
+
+  /*! \brief Reason why the database could not be loaded */
+  std::string error;
+
+  explicit operator bool() const
+  {
+    return text || compiled;
+  }
+};
+
+/*! \brief Loads a database for MC rewriting
+
+  Compiled databases are taken from the process-wide registry if they have
+  been kept there, and are added to it if `keep` is true.  Returns an empty
+  database with the reason in `error` if the database cannot be read.
+*/
+inline mc_rewriting_database load_mc_rewriting_database( std::string const& filename, bool verify, bool keep )
+{
+  mc_rewriting_database db;
+
+  if ( !std::ifstream( filename ) )
+  {
+    db.error = fmt::format( "cannot open file {}", filename );
+    return db;
+  }
+
+  if ( mc_database::is_compiled( filename ) )
+  {
+    db.compiled = mc_database_registry::find( filename );
+    if ( !db.compiled )
+    {
+      db.compiled = mc_database::open( filename );
+    }
+    if ( !db.compiled )
+    {
+      db.error = fmt::format( "compiled database {} is truncated or has an unsupported version", filename );
+    }
+    else if ( keep )
+    {
+      mc_database_registry::keep( filename, db.compiled );
+    }
+    return db;
+  }
+
+  mockturtle::xag_minmc_resynthesis_params params;
+  params.verify_database = verify;
+  try
+  {
+    db.text = std::make_shared<mockturtle::xag_minmc_resynthesis>( filename, params );
+  }
+  catch ( std::exception const& e )
+  {
+    db.error = fmt::format( "text database {} is invalid ({})", filename, e.what() );
+  }
+  return db;
+}
+
+struct mc_rewriting_stats
+{
+  /*! \brief Whether the last call used the parallel engine */
+  bool parallel{false};
+
+  mockturtle::cut_rewriting_stats st;
+  parallel_cut_rewriting_stats pst;
+};
+
+/*! \brief Cut rewriting of an XAG for multiplicative complexity
+
+  With a compiled database, more than one thread, and cut sizes up to 6, cut
+  functions are classified and looked up concurrently by the parallel cut
+  rewriting engine, in which each thread has its own resynthesis object.
+  With don't cares, the engine is also used for a single thread (and always
+  for text databases, which cannot be shared by threads), and each
+  completion of the cut function is looked up (see `dont_care_resynthesis`).
+  The engine is also used if the memory for cut sets is limited to
+  `cut_memory` bytes (0 for no limit).  Otherwise, mockturtle's cut rewriting
+  is used.
+*/
+inline void mc_rewriting( mockturtle::xag_network& xag, mc_rewriting_database const& db, mockturtle::cut_rewriting_params const& ps, thread_pool& pool, mc_rewriting_stats& st, windowed_dont_cares<mockturtle::xag_network>* dont_cares = nullptr, uint64_t cut_memory = 0u )
+{
+  using resyn_t = xag_minmc_db_resynthesis<mockturtle::xag_network>;
+
+  st.parallel = ps.cut_enumeration_ps.cut_size <= small_cut::max_size && ( dont_cares || cut_memory != 0u || ( db.compiled && pool.num_threads() > 1u ) );
+
+  if ( st.parallel )
+  {
+    parallel_cut_rewriting_params pps;
+    pps.cut_size = ps.cut_enumeration_ps.cut_size;
+    pps.cut_limit = ps.cut_enumeration_ps.cut_limit;
+    pps.allow_zero_gain = ps.allow_zero_gain;
+    pps.cost = cost_function::mc;
+    pps.cut_memory = cut_memory;
+    pps.verbose = ps.verbose;
+
+    if ( db.compiled )
+    {
+      const auto make_resyn = [&]() { return dont_care_resynthesis<resyn_t>( resyn_t( db.compiled ) ); };
+      parallel_cut_rewriting( xag, make_resyn, pool, pps, &st.pst, mc_cost<mockturtle::xag_network>(), dont_cares );
+    }
+    else
+    {
+      db.text->ps.print_stats = ps.verbose;
+      thread_pool single_thread( 1u );
+      const auto make_resyn = [&]() { return dont_care_resynthesis<mockturtle::xag_minmc_resynthesis&>( *db.text ); };
+      parallel_cut_rewriting( xag, make_resyn, single_thread, pps, &st.pst, mc_cost<mockturtle::xag_network>(), dont_cares );
+    }
+  }
+  else if ( db.compiled )
+  {
+    resyn_t resyn( db.compiled );
+    mockturtle::cut_rewriting( xag, cancellable_resynthesis( resyn ), ps, &st.st, mc_cost<mockturtle::xag_network>() );
+  }
+  else
+  {
+    db.text->ps.print_stats = ps.verbose;
+    mockturtle::cut_rewriting( xag, cancellable_resynthesis( *db.text ), ps, &st.st, mc_cost<mockturtle::xag_network>() );
+  }
+
+  const auto old_to_new = compact_dangling( xag );
+  if ( dont_cares )
+  {
+    dont_cares->remap( xag, old_to_new );
+  }
+}
+
+/*! \brief Refactoring of an XAG for multiplicative complexity with bi-decomposition
+
+  With more than one thread, the XAG is partitioned into windows of at most
+  `window_size` gates (0 for the default size of `partitioning_params`),
+  which are refactored concurrently.  The windows do not depend on the number
+  of threads.  MFFCs do not extend beyond window boundaries.
+
+  If `ps.use_dont_cares` is set and `dont_cares` is given, don't cares are
+  taken from it; otherwise, mockturtle's refactoring computes them.  Each
+  window uses a copy of the entries of its gates, and the entries of all
+  windows are kept for the rebuilt network.
+*/
+inline void mc_refactoring( mockturtle::xag_network& xag, mockturtle::refactoring_params const& ps, thread_pool& pool, uint32_t window_size, mockturtle::refactoring_stats& st, windowed_dont_cares<mockturtle::xag_network>* dont_cares = nullptr )
+{
+  const auto refactor = []( mockturtle::xag_network& ntk, mockturtle::refactoring_params const& rps, mockturtle::refactoring_stats* pst, windowed_dont_cares<mockturtle::xag_network>* dcs ) {
+    mockturtle::bidecomposition_resynthesis<mockturtle::xag_network> resyn;
+    if ( rps.use_dont_cares && dcs )
+    {
+      refactoring_params cps;
+      cps.max_pis = rps.max_pis;
+      cps.allow_zero_gain = rps.allow_zero_gain;
+      cps.cost = cost_function::mc;
+      cps.verbose = rps.verbose;
+      refactoring_stats cst;
+      cirkit::refactoring( ntk, cancellable_resynthesis( resyn ), cps, &cst, mc_cost<mockturtle::xag_network>(), dcs );
+      pst->time_total = cst.time_total;
+    }
+    else
+    {
+      mockturtle::refactoring( ntk, cancellable_resynthesis( resyn ), rps, pst, mc_cost<mockturtle::xag_network>() );
+    }
+  };
+
+  if ( pool.num_threads() == 1u )
+  {
+    refactor( xag, ps, &st, dont_cares );
+    const auto old_to_new = compact_dangling( xag );
+    if ( dont_cares )
+    {
+      dont_cares->remap( xag, old_to_new );
+    }
+    return;
+  }
+
+  mockturtle::stopwatch t( st.time_total );
+
+  partitioning_params pps;
+  if ( window_size )
+  {
+    pps.size = window_size;
+  }
+
+  /* progress bars of concurrent windows would interleave */
+  auto part_ps = ps;
+  part_ps.progress = false;
+
+  if ( !dont_cares )
+  {
+    optimize_windows( xag, pool, pps, [&]( mockturtle::xag_network& part ) {
+      mockturtle::refactoring_stats part_st;
+      refactor( part, part_ps, &part_st, nullptr );
+    } );
+    return;
+  }
+
+  /* as in optimize_windows, but the don't cares of each window are carried
+     from the network into the window and back into the rebuilt network */
+  constexpr auto removed = std::numeric_limits<uint32_t>::max();
+  const auto windows = partition_network( xag, pps );
+
+  std::vector<mockturtle::xag_network> parts( windows.size() );
+  std::vector<std::unique_ptr<windowed_dont_cares<mockturtle::xag_network>>> part_dcs( windows.size() );
+  pool.parallel_for( 0u, static_cast<uint32_t>( windows.size() ), [&]( uint32_t i, uint32_t ) {
+    std::unordered_map<uint32_t, uint32_t> xag_to_part;
+    parts[i] = extract_window( xag, windows[i], &xag_to_part );
+    part_dcs[i] = std::make_unique<windowed_dont_cares<mockturtle::xag_network>>( dont_cares->params() );
+    part_dcs[i]->import( parts[i], *dont_cares, xag, windows[i].gates, [&]( uint32_t index ) {
+      const auto it = xag_to_part.find( index );
+      return it == xag_to_part.end() ? removed : it->second;
+    } );
+
+    if ( !is_cancelled() )
+    {
+      mockturtle::refactoring_stats part_st;
+      refactor( parts[i], part_ps, &part_st, part_dcs[i].get() );
+    }
+  } );
+
+  std::vector<std::vector<uint32_t>> part_to_res;
+  auto stitched = stitch_windows( xag, windows, parts, &part_to_res );
+
+  /* the rebuilt network is renumbered, its entries come from the windows */
+  dont_cares->clear();
+  for ( auto i = 0u; i < parts.size(); ++i )
+  {
+    std::vector<uint32_t> roots;
+    parts[i].foreach_gate( [&]( auto const& n ) {
+      roots.push_back( parts[i].node_to_index( n ) );
+    } );
+    auto const& indexes = part_to_res[i];
+    dont_cares->import( stitched, *part_dcs[i], parts[i], roots, [&]( uint32_t index ) {
+      return index < indexes.size() ? indexes[index] : removed;
+    } );
+  }
+
+  const auto old_to_new = compact_dangling( stitched );
+  dont_cares->remap( stitched, old_to_new );
+  xag = stitched;
+}
+
+} // namespace cirkit
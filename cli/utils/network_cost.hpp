@@ -0,0 +1,294 @@
+/* CirKit: A circuit toolkit
+ * Copyright (C) 2017-2019  EPFL
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include <mockturtle/traits.hpp>
+
+namespace cirkit
+{
+
+/*! \brief Cost functions of optimization commands
+
+  - `size`: number of gates
+  - `depth`: number of levels, then number of gates; replacements must not
+    increase the level of a node, and replacements that lower the level of a
+    node on a critical path are accepted even if they increase the size
+  - `size_depth`: number of gates, without increasing the level of any node
+  - `mc`: number of AND gates (multiplicative complexity)
+*/
+enum class cost_function
+{
+  size,
+  depth,
+  size_depth,
+  mc
+};
+
+inline std::optional<cost_function> cost_function_from_string( std::string const& name )
+{
+  if ( name == "size" )
+  {
+    return cost_function::size;
+  }
+  else if ( name == "depth" )
+  {
+    return cost_function::depth;
+  }
+  else if ( name == "size_depth" )
+  {
+    return cost_function::size_depth;
+  }
+  else if ( name == "mc" )
+  {
+    return cost_function::mc;
+  }
+  return std::nullopt;
+}
+
+/*! \brief Node cost function that counts gates */
+template<class Ntk>
+struct unit_cost
+{
+  uint32_t operator()( Ntk const& ntk, typename Ntk::node const& n ) const
+  {
+    (void)ntk;
+    (void)n;
+    return 1u;
+  }
+};
+
+/*! \brief Node cost function that counts AND gates */
+template<class Ntk>
+struct mc_cost
+{
+  static_assert( mockturtle::has_is_and_v<Ntk>, "Ntk does not implement the is_and method" );
+
+  uint32_t operator()( Ntk const& ntk, typename Ntk::node const& n ) const
+  {
+    return ntk.is_and( n ) ? 1u : 0u;
+  }
+};
+
+/*! \brief Acceptance and ranking of replacement candidates
+
+  A candidate replaces a root node and is described by its gain, i.e., the
+  cost of the logic that is removed minus the cost of the logic that is added,
+  and by its level, which is compared to the level of the root.  Whether the
+  root is on a critical path is only used by the `depth` cost function.
+*/
+struct cost_objective
+{
+  cost_function cost{cost_function::size};
+  int32_t min_gain{1};
+
+  bool level_constrained() const
+  {
+    return cost == cost_function::depth || cost == cost_function::size_depth;
+  }
+
+  bool accepts( int32_t gain, uint32_t level, uint32_t root_level, bool critical ) const
+  {
+    switch ( cost )
+    {
+    default:
+      return gain >= min_gain;
+    case cost_function::size_depth:
+      return gain >= min_gain && level <= root_level;
+    case cost_function::depth:
+      if ( level > root_level )
+      {
+        return false;
+      }
+      return ( critical && level < root_level ) || gain >= min_gain;
+    }
+  }
+
+  /*! \brief Whether candidate (gain, level) is preferred over (other_gain, other_level) */
+  bool better( int32_t gain, uint32_t level, int32_t other_gain, uint32_t other_level ) const
+  {
+    switch ( cost )
+    {
+    default:
+      return gain > other_gain;
+    case cost_function::size_depth:
+      return gain > other_gain || ( gain == other_gain && level < other_level );
+    case cost_function::depth:
+      return level < other_level || ( level == other_level && gain > other_gain );
+    }
+  }
+};
+
+/*! \brief Levels of a network that is modified by an optimization pass
+
+  `recompute` computes exact levels and required levels; node indexes need
+  not be in topological order.  Afterwards, `update` computes the levels of
+  nodes that were created in the meantime from the levels of their fanins,
+  without revisiting other nodes.  As long as every substitution replaces a
+  node by a signal whose level is not larger, stored levels remain upper
+  bounds of the actual ones, and the depth of the network does not increase.
+  Nodes are critical, if their level equals their required level at the last
+  recomputation; nodes created afterwards are not critical.
+*/
+template<class Ntk>
+class level_tracker
+{
+public:
+  using node = typename Ntk::node;
+
+  explicit level_tracker( Ntk const& ntk ) : ntk( ntk ) {}
+
+  void recompute()
+  {
+    levels.assign( ntk.size(), 0u );
+
+    /* 0: not visited, 1: fanins pending, 2: done */
+    std::vector<uint8_t> state( ntk.size(), 0u );
+    std::vector<uint32_t> stack;
+    std::vector<uint32_t> order;
+
+    ntk.foreach_gate( [&]( auto const& root ) {
+      if ( state[ntk.node_to_index( root )] == 2u )
+      {
+        return;
+      }
+
+      stack.push_back( ntk.node_to_index( root ) );
+      while ( !stack.empty() )
+      {
+        const auto index = stack.back();
+        const auto n = ntk.index_to_node( index );
+
+        if ( state[index] == 2u )
+        {
+          stack.pop_back();
+        }
+        else if ( state[index] == 0u )
+        {
+          state[index] = 1u;
+          ntk.foreach_fanin( n, [&]( auto const& f ) {
+            const auto c = ntk.get_node( f );
+            if ( !ntk.is_constant( c ) && !ntk.is_pi( c ) && state[ntk.node_to_index( c )] == 0u )
+            {
+              stack.push_back( ntk.node_to_index( c ) );
+            }
+          } );
+        }
+        else
+        {
+          levels[index] = compute( n );
+          state[index] = 2u;
+          order.push_back( index );
+          stack.pop_back();
+        }
+      }
+    } );
+
+    /* required levels in reverse topological order */
+    const auto max_level = depth();
+    required.assign( ntk.size(), std::numeric_limits<uint32_t>::max() );
+    ntk.foreach_po( [&]( auto const& f ) {
+      required[ntk.node_to_index( ntk.get_node( f ) )] = max_level;
+    } );
+    for ( auto it = order.rbegin(); it != order.rend(); ++it )
+    {
+      const auto r = required[*it];
+      if ( r == std::numeric_limits<uint32_t>::max() )
+      {
+        continue;
+      }
+      ntk.foreach_fanin( ntk.index_to_node( *it ), [&]( auto const& f ) {
+        auto& rc = required[ntk.node_to_index( ntk.get_node( f ) )];
+        rc = std::min( rc, r - 1u );
+      } );
+    }
+  }
+
+  void update()
+  {
+    for ( auto index = static_cast<uint32_t>( levels.size() ); index < ntk.size(); ++index )
+    {
+      levels.push_back( compute( ntk.index_to_node( index ) ) );
+    }
+  }
+
+  uint32_t operator[]( node const& n ) const
+  {
+    return levels[ntk.node_to_index( n )];
+  }
+
+  bool is_critical( node const& n ) const
+  {
+    const auto index = ntk.node_to_index( n );
+    return index < required.size() && levels[index] >= required[index];
+  }
+
+  uint32_t depth() const
+  {
+    uint32_t depth{0u};
+    ntk.foreach_po( [&]( auto const& f ) {
+      depth = std::max( depth, ( *this )[ntk.get_node( f )] );
+    } );
+    return depth;
+  }
+
+private:
+  uint32_t compute( node const& n ) const
+  {
+    if ( ntk.is_constant( n ) || ntk.is_pi( n ) )
+    {
+      return 0u;
+    }
+
+    uint32_t level{0u};
+    ntk.foreach_fanin( n, [&]( auto const& f ) {
+      level = std::max( level, levels[ntk.node_to_index( ntk.get_node( f ) )] );
+    } );
+    return level + 1u;
+  }
+
+private:
+  Ntk const& ntk;
+  std::vector<uint32_t> levels;
+  std::vector<uint32_t> required;
+};
+
+/*! \brief Depth of a network without creating a depth view */
+template<class Ntk>
+uint32_t network_depth( Ntk const& ntk )
+{
+  level_tracker<Ntk> levels( ntk );
+  levels.recompute();
+  return levels.depth();
+}
+
+} // namespace cirkit
@@ -0,0 +1,454 @@
+/* CirKit: A circuit toolkit
+ * Copyright (C) 2017-2019  EPFL
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <kitty/dynamic_truth_table.hpp>
+#include <kitty/npn.hpp>
+#include <kitty/static_truth_table.hpp>
+#include <mockturtle/traits.hpp>
+
+#include "mapped_file.hpp"
+
+namespace cirkit
+{
+
+/*! \brief Structure of a database entry
+
+  The structure is an XAG over 6 inputs.  Literal `2 * i + c` refers to node
+  `i`, complemented if `c` is 1.  Node 0 is the constant 0, nodes 1 to 6 are
+  the inputs, and gate `j` is node `7 + j`.  Each gate has two fanin literals;
+  as in mockturtle's XAG, a gate whose first literal is larger than its second
+  literal is an XOR, and an AND otherwise.
+*/
+struct npn_structure
+{
+  std::vector<uint16_t> fanins;
+  uint16_t output{0u};
+
+  uint32_t num_gates() const
+  {
+    return static_cast<uint32_t>( fanins.size() / 2u );
+  }
+};
+
+/*! \brief Simulates a structure for the given values of its 6 inputs */
+inline uint64_t simulate_npn_structure( uint16_t const* fanins, uint32_t num_gates, uint16_t output, uint64_t const* inputs )
+{
+  std::vector<uint64_t> values( 7u + num_gates, 0u );
+  std::copy( inputs, inputs + 6u, values.begin() + 1u );
+
+  const auto literal = [&]( uint16_t lit ) {
+    return ( lit & 1 ) ? ~values[lit >> 1] : values[lit >> 1];
+  };
+
+  for ( auto j = 0u; j < num_gates; ++j )
+  {
+    const auto a = fanins[2u * j], b = fanins[2u * j + 1u];
+    values[7u + j] = a > b ? literal( a ) ^ literal( b ) : literal( a ) & literal( b );
+  }
+
+  return literal( output );
+}
+
+/*! \brief Simulates a structure, returns its 6-input truth table */
+inline uint64_t simulate_npn_structure( uint16_t const* fanins, uint32_t num_gates, uint16_t output )
+{
+  static constexpr uint64_t projections[] = {0xaaaaaaaaaaaaaaaa, 0xcccccccccccccccc, 0xf0f0f0f0f0f0f0f0, 0xff00ff00ff00ff00, 0xffff0000ffff0000, 0xffffffff00000000};
+  return simulate_npn_structure( fanins, num_gates, output, projections );
+}
+
+/*! \brief Extracts the structure of `f` in terms of (at most 6) `pis`
+
+  Returns `std::nullopt`, if `f` depends on nodes that are not in the
+  transitive fanin of `pis` or if the network contains gates that are
+  neither AND nor XOR gates.
+*/
+template<class Ntk>
+std::optional<npn_structure> extract_npn_structure( Ntk const& ntk, typename Ntk::signal const& f, std::vector<typename Ntk::signal> const& pis )
+{
+  using node = typename Ntk::node;
+
+  static_assert( mockturtle::has_is_and_v<Ntk>, "Ntk does not implement the is_and method" );
+  static_assert( mockturtle::has_is_xor_v<Ntk>, "Ntk does not implement the is_xor method" );
+
+  std::unordered_map<node, uint16_t> literals;
+  literals[ntk.get_node( ntk.get_constant( false ) )] = 0u;
+  for ( auto i = 0u; i < pis.size() && i < 6u; ++i )
+  {
+    literals[ntk.get_node( pis[i] )] = static_cast<uint16_t>( 2u * ( i + 1u ) );
+  }
+
+  npn_structure s;
+  bool valid = true;
+
+  const auto rec = [&]( node const& n, auto&& self ) -> void {
+    if ( !valid || literals.count( n ) )
+    {
+      return;
+    }
+    if ( ntk.is_pi( n ) || ntk.fanin_size( n ) != 2u || ( !ntk.is_and( n ) && !ntk.is_xor( n ) ) )
+    {
+      valid = false;
+      return;
+    }
+
+    std::vector<uint16_t> children;
+    ntk.foreach_fanin( n, [&]( auto const& c ) {
+      self( ntk.get_node( c ), self );
+      if ( valid )
+      {
+        children.push_back( static_cast<uint16_t>( literals[ntk.get_node( c )] ^ ( ntk.is_complemented( c ) ? 1u : 0u ) ) );
+      }
+    } );
+    if ( !valid )
+    {
+      return;
+    }
+
+    /* encode the gate type in the fanin order */
+    if ( ntk.is_xor( n ) == ( children[0] < children[1] ) )
+    {
+      std::swap( children[0], children[1] );
+    }
+    literals[n] = static_cast<uint16_t>( 2u * ( 7u + s.num_gates() ) );
+    s.fanins.insert( s.fanins.end(), children.begin(), children.end() );
+  };
+  rec( ntk.get_node( f ), rec );
+
+  if ( !valid )
+  {
+    return std::nullopt;
+  }
+
+  s.output = static_cast<uint16_t>( literals[ntk.get_node( f )] ^ ( ntk.is_complemented( f ) ? 1u : 0u ) );
+  return s;
+}
+
+/*! \brief NPN transformation of a 6-input function into its representative
+
+  Input `i` of the representative is input `perm[i]` of the function,
+  complemented if bit `perm[i]` of `phase` is set; the output is complemented
+  if bit 6 of `phase` is set.
+
+  Database keys are computed with this function both when building and when
+  using a database.  The canonization is heuristic (sifting), but
+  deterministic, such that a function always maps to the same key.
+*/
+struct npn_transformation
+{
+  uint64_t representative{0u};
+  uint32_t phase{0u};
+  std::vector<uint8_t> perm;
+};
+
+inline npn_transformation npn_canonize( uint64_t function )
+{
+  kitty::static_truth_table<6u> tt;
+  *tt.begin() = function;
+
+  const auto [repr, phase, perm] = kitty::sifting_npn_canonization( tt );
+  return {*repr.cbegin(), phase, perm};
+}
+
+/*! \brief Expands a function with up to 6 variables to 6 variables */
+inline uint64_t expand_to_6_vars( kitty::dynamic_truth_table const& function )
+{
+  auto word = *function.cbegin();
+  for ( auto n = function.num_vars(); n < 6u; ++n )
+  {
+    const auto bits = 1u << n;
+    word = ( word & ( ( uint64_t( 1 ) << bits ) - 1u ) ) | ( word << bits );
+  }
+  return word;
+}
+
+/*! \brief Index entry of a database file */
+struct npn_database_entry
+{
+  uint64_t function;
+  uint32_t offset;
+  uint16_t num_gates;
+  uint16_t output;
+};
+
+namespace detail
+{
+
+struct npn_database_header
+{
+  char magic[8];
+  uint32_t version;
+  uint32_t flags;
+  uint32_t num_entries;
+  uint32_t num_literals;
+};
+
+static_assert( sizeof( npn_database_header ) == 24u, "unexpected header size" );
+static_assert( sizeof( npn_database_entry ) == 16u, "unexpected index entry size" );
+
+constexpr char npn_database_magic[8] = {'C', 'K', 'N', 'P', 'N', 'D', 'B', '\0'};
+constexpr uint32_t npn_database_version = 1u;
+constexpr uint32_t npn_database_has_xor = 1u;
+
+} // namespace detail
+
+/*! \brief Memory-mapped database of structures for 6-input NPN classes
+
+  The file consists of a header, an index of entries sorted by representative
+  function, and a pool of fanin literals.  All numbers are stored in the byte
+  order of the machine that wrote the database.  Opening a database maps the
+  file without reading it; lookups are binary searches in the index.  The
+  database is read-only and can be shared between threads.
+*/
+class npn_database
+{
+public:
+  /*! \brief Opens a database, returns `nullptr` if the file is not a valid database */
+  static std::shared_ptr<npn_database const> open( std::string const& filename )
+  {
+    std::shared_ptr<npn_database> db( new npn_database );
+    if ( !db->file.open( filename ) || db->file.size() < sizeof( detail::npn_database_header ) )
+    {
+      return nullptr;
+    }
+
+    const auto* header = reinterpret_cast<detail::npn_database_header const*>( db->file.data() );
+    if ( std::memcmp( header->magic, detail::npn_database_magic, sizeof( header->magic ) ) != 0 || header->version != detail::npn_database_version )
+    {
+      return nullptr;
+    }
+
+    const auto size = sizeof( detail::npn_database_header ) + uint64_t( header->num_entries ) * sizeof( npn_database_entry ) + uint64_t( header->num_literals ) * sizeof( uint16_t );
+    if ( db->file.size() < size )
+    {
+      return nullptr;
+    }
+
+    db->header = header;
+    db->index = reinterpret_cast<npn_database_entry const*>( db->file.data() + sizeof( detail::npn_database_header ) );
+    db->literals = reinterpret_cast<uint16_t const*>( db->index + header->num_entries );
+    db->filename = filename;
+    return db;
+  }
+
+  uint32_t size() const
+  {
+    return header->num_entries;
+  }
+
+  bool has_xor() const
+  {
+    return ( header->flags & detail::npn_database_has_xor ) != 0u;
+  }
+
+  std::string const& path() const
+  {
+    return filename;
+  }
+
+  /*! \brief Entry of representative `function` (or `nullptr`) */
+  npn_database_entry const* find( uint64_t function ) const
+  {
+    const auto end = index + header->num_entries;
+    const auto it = std::lower_bound( index, end, function, []( auto const& e, uint64_t f ) { return e.function < f; } );
+    if ( it == end || it->function != function || uint64_t( it->offset ) + 2u * it->num_gates > header->num_literals )
+    {
+      return nullptr;
+    }
+    return it;
+  }
+
+  uint16_t const* fanins( npn_database_entry const& entry ) const
+  {
+    return literals + entry.offset;
+  }
+
+  template<class Fn>
+  void foreach_entry( Fn&& fn ) const
+  {
+    for ( auto i = 0u; i < header->num_entries; ++i )
+    {
+      fn( index[i] );
+    }
+  }
+
+private:
+  npn_database() = default;
+
+private:
+  mapped_file file;
+  detail::npn_database_header const* header{nullptr};
+  npn_database_entry const* index{nullptr};
+  uint16_t const* literals{nullptr};
+  std::string filename;
+};
+
+/*! \brief Writes a database with the structures of `entries` (keyed by representative) */
+inline bool write_npn_database( std::string const& filename, std::map<uint64_t, npn_structure> const& entries )
+{
+  detail::npn_database_header header;
+  std::memcpy( header.magic, detail::npn_database_magic, sizeof( header.magic ) );
+  header.version = detail::npn_database_version;
+  header.flags = 0u;
+  header.num_entries = static_cast<uint32_t>( entries.size() );
+  header.num_literals = 0u;
+
+  std::vector<npn_database_entry> index;
+  index.reserve( entries.size() );
+  for ( auto const& [function, s] : entries )
+  {
+    index.push_back( {function, header.num_literals, static_cast<uint16_t>( s.num_gates() ), s.output} );
+    header.num_literals += static_cast<uint32_t>( s.fanins.size() );
+    for ( auto j = 0u; j < s.num_gates(); ++j )
+    {
+      if ( s.fanins[2u * j] > s.fanins[2u * j + 1u] )
+      {
+        header.flags |= detail::npn_database_has_xor;
+      }
+    }
+  }
+
+  return replace_file( filename, [&]( std::ostream& os ) {
+    os.write( reinterpret_cast<char const*>( &header ), sizeof( header ) );
+    os.write( reinterpret_cast<char const*>( index.data() ), index.size() * sizeof( npn_database_entry ) );
+    for ( auto const& p : entries )
+    {
+      os.write( reinterpret_cast<char const*>( p.second.fanins.data() ), p.second.fanins.size() * sizeof( uint16_t ) );
+    }
+  } );
+}
+
+/*! \brief Resynthesis function for cuts with up to 6 inputs using an NPN database
+
+  Functions with more than 4 inputs are canonized and looked up in the
+  database; if the class is not in the database, no candidate is returned.
+  Functions with up to 4 inputs are passed to `fallback` (e.g., the 4-input
+  NPN resynthesis of mockturtle).  XOR gates of the database are created
+  with `create_xor`, such that the database can be used with all network
+  types that provide AND and XOR gates.
+
+  Canonizations are cached in the resynthesis object, which is therefore not
+  thread-safe; the database itself can be shared.
+*/
+template<class Ntk, class FallbackFn>
+class npn_database_resynthesis
+{
+public:
+  using signal = typename Ntk::signal;
+
+  npn_database_resynthesis( std::shared_ptr<npn_database const> db, FallbackFn fallback )
+      : db( db ),
+        fallback( std::move( fallback ) )
+  {
+  }
+
+  template<typename LeavesIterator, typename Fn>
+  void operator()( Ntk& ntk, kitty::dynamic_truth_table const& function, LeavesIterator begin, LeavesIterator end, Fn&& fn )
+  {
+    if ( function.num_vars() <= 4u )
+    {
+      fallback( ntk, function, begin, end, fn );
+      return;
+    }
+    if ( function.num_vars() > 6u )
+    {
+      return;
+    }
+
+    const auto word = expand_to_6_vars( function );
+    auto it = cache.find( word );
+    if ( it == cache.end() )
+    {
+      if ( cache.size() >= max_cache_size )
+      {
+        cache.clear();
+      }
+      auto t = npn_canonize( word );
+      const auto* entry = db->find( t.representative );
+      it = cache.emplace( word, std::make_pair( entry, std::move( t ) ) ).first;
+    }
+
+    const auto* entry = it->second.first;
+    if ( !entry )
+    {
+      return;
+    }
+    auto const& t = it->second.second;
+
+    std::vector<signal> pis( 6u, ntk.get_constant( false ) );
+    std::copy( begin, end, pis.begin() );
+
+    std::vector<signal> signals( 7u + entry->num_gates, ntk.get_constant( false ) );
+    for ( auto i = 0u; i < 6u; ++i )
+    {
+      const auto s = pis[t.perm[i]];
+      signals[1u + i] = ( ( t.phase >> t.perm[i] ) & 1 ) ? ntk.create_not( s ) : s;
+    }
+
+    const auto literal = [&]( uint16_t lit ) {
+      return ( lit & 1 ) ? ntk.create_not( signals[lit >> 1] ) : signals[lit >> 1];
+    };
+
+    const auto* fanins = db->fanins( *entry );
+    for ( auto j = 0u; j < entry->num_gates; ++j )
+    {
+      const auto a = fanins[2u * j], b = fanins[2u * j + 1u];
+      if ( ( a >> 1 ) >= 7u + j || ( b >> 1 ) >= 7u + j )
+      {
+        return; /* corrupt entry */
+      }
+      signals[7u + j] = a > b ? ntk.create_xor( literal( a ), literal( b ) ) : ntk.create_and( literal( a ), literal( b ) );
+    }
+    if ( ( entry->output >> 1 ) >= 7u + entry->num_gates )
+    {
+      return;
+    }
+
+    const auto f = literal( entry->output );
+    fn( ( ( t.phase >> 6u ) & 1 ) ? ntk.create_not( f ) : f );
+  }
+
+private:
+  static constexpr std::size_t max_cache_size = 1u << 20;
+
+  std::shared_ptr<npn_database const> db;
+  FallbackFn fallback;
+  std::unordered_map<uint64_t, std::pair<npn_database_entry const*, npn_transformation>> cache;
+};
+
+} // namespace cirkit
@@ -0,0 +1,70 @@
+/* CirKit: A circuit toolkit
+ * Copyright (C) 2017-2019  EPFL
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <iostream>
+
+namespace cirkit
+{
+
+/*! \brief Output stream of the command that runs in this thread (or `nullptr`) */
+inline std::ostream*& current_output_stream()
+{
+  thread_local std::ostream* os = nullptr;
+  return os;
+}
+
+/*! \brief Stream for statistics and other output of algorithms
+
+  This is the output stream of the command that runs in this thread, which
+  differs from `std::cout` for commands of a server session, or `std::cout`
+  if the algorithm is called outside of a command.
+*/
+inline std::ostream& output_stream()
+{
+  auto* os = current_output_stream();
+  return os ? *os : std::cout;
+}
+
+/*! \brief Makes `os` the output stream of this thread until destruction */
+class output_stream_scope
+{
+public:
+  explicit output_stream_scope( std::ostream& os ) : prev( current_output_stream() )
+  {
+    current_output_stream() = &os;
+  }
+
+  ~output_stream_scope()
+  {
+    current_output_stream() = prev;
+  }
+
+private:
+  std::ostream* prev;
+};
+
+} // namespace cirkit
@@ -0,0 +1,834 @@
+/* CirKit: A circuit toolkit
+ * Copyright (C) 2017-2019  EPFL
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <fmt/format.h>
+#include <kitty/constructors.hpp>
+#include <kitty/dynamic_truth_table.hpp>
+#include <mockturtle/utils/stopwatch.hpp>
+
+#include "cancellation.hpp"
+#include "dont_cares.hpp"
+#include "network_cost.hpp"
+#include "output_stream.hpp"
+#include "parallel_cuts.hpp"
+#include "thread_pool.hpp"
+
+namespace cirkit
+{
+
+struct parallel_cut_rewriting_params
+{
+  /*! \brief Maximum cut size (at most 6) */
+  uint32_t cut_size{4u};
+
+  /*! \brief Maximum number of cuts per node (including the trivial cut) */
+  uint32_t cut_limit{8u};
+
+  /*! \brief Accept replacements that do not reduce the cost */
+  bool allow_zero_gain{false};
+
+  /*! \brief Cost function (the node cost function is passed separately) */
+  cost_function cost{cost_function::size};
+
+  /*! \brief Depth of the transitive fanout of changed nodes that is revisited
+             in incremental passes (0 for cut size) */
+  uint32_t frontier_depth{0u};
+
+  /*! \brief Memory limit for cut sets in bytes (0 for no limit) */
+  uint64_t cut_memory{0u};
+
+  /*! \brief Show statistics */
+  bool verbose{false};
+};
+
+struct parallel_cut_rewriting_stats
+{
+  mockturtle::stopwatch<>::duration time_total{0};
+  mockturtle::stopwatch<>::duration time_cuts{0};
+  mockturtle::stopwatch<>::duration time_evaluation{0};
+  mockturtle::stopwatch<>::duration time_commit{0};
+
+  uint32_t num_passes{0u};
+  uint32_t num_evaluated{0u};
+  uint32_t num_cuts{0u};
+  uint32_t num_candidates{0u};
+  uint32_t num_rewrites{0u};
+
+  /*! \brief Memory reserved for cut sets in bytes */
+  uint64_t cut_memory{0u};
+
+  /*! \brief Gates without cuts due to the memory limit (summed over passes) */
+  uint64_t num_capped{0u};
+
+  /*! \brief Adds the statistics of another call, e.g., of another iteration */
+  void add( parallel_cut_rewriting_stats const& other )
+  {
+    time_total += other.time_total;
+    time_cuts += other.time_cuts;
+    time_evaluation += other.time_evaluation;
+    time_commit += other.time_commit;
+    num_passes += other.num_passes;
+    num_evaluated += other.num_evaluated;
+    num_cuts += other.num_cuts;
+    num_candidates += other.num_candidates;
+    num_rewrites += other.num_rewrites;
+    cut_memory = std::max( cut_memory, other.cut_memory );
+    num_capped += other.num_capped;
+  }
+
+  void report( std::ostream& os = output_stream() ) const
+  {
+    os << fmt::format( "[i] passes     = {:>8d}\n", num_passes );
+    os << fmt::format( "[i] evaluated  = {:>8d} gates\n", num_evaluated );
+    os << fmt::format( "[i] cuts       = {:>8d} ({:>5.2f} secs)\n", num_cuts, mockturtle::to_seconds( time_cuts ) );
+    os << fmt::format( "[i] candidates = {:>8d} ({:>5.2f} secs)\n", num_candidates, mockturtle::to_seconds( time_evaluation ) );
+    os << fmt::format( "[i] rewrites   = {:>8d} ({:>5.2f} secs)\n", num_rewrites, mockturtle::to_seconds( time_commit ) );
+    os << fmt::format( "[i] cut memory = {:>8.2f} MB ({} gates capped)\n", cut_memory / 1048576.0, num_capped );
+    os << fmt::format( "[i] total time = {:>5.2f} secs\n", mockturtle::to_seconds( time_total ) );
+  }
+};
+
+namespace detail
+{
+
+/* MFFC cost of a node bounded by cut leaves, without changing reference counters */
+template<class Ntk, class NodeCostFn>
+class mffc_counter
+{
+public:
+  using node = typename Ntk::node;
+
+  explicit mffc_counter( NodeCostFn const& cost_fn ) : cost_fn( cost_fn ) {}
+
+  uint32_t operator()( Ntk const& ntk, node const& n, small_cut const& cut )
+  {
+    refs.clear();
+    return count( ntk, n, cut );
+  }
+
+private:
+  uint32_t count( Ntk const& ntk, node const& n, small_cut const& cut )
+  {
+    uint32_t size = cost_fn( ntk, n );
+    ntk.foreach_fanin( n, [&]( auto const& f ) {
+      const auto c = ntk.get_node( f );
+      const auto index = ntk.node_to_index( c );
+      if ( ntk.is_constant( c ) || ntk.is_pi( c ) || std::binary_search( cut.begin(), cut.end(), index ) )
+      {
+        return;
+      }
+
+      auto it = refs.find( index );
+      if ( it == refs.end() )
+      {
+        it = refs.emplace( index, ntk.fanout_size( c ) ).first;
+      }
+      if ( --it->second == 0u )
+      {
+        size += count( ntk, c, cut );
+      }
+    } );
+    return size;
+  }
+
+private:
+  NodeCostFn const& cost_fn;
+  std::unordered_map<uint32_t, uint32_t> refs;
+};
+
+/* thread-local state: scratch network with one PI per cut leaf, in which the
+   resynthesis function builds candidates, and its own resynthesis object;
+   candidates are only used while their gate is evaluated or committed, such
+   that the scratch network is rebuilt when it grows beyond a bound */
+template<class Ntk, class ResynFn, class NodeCostFn>
+struct rewriting_worker
+{
+  using signal = typename Ntk::signal;
+
+  static constexpr uint32_t max_scratch_size = 1u << 16u;
+
+  template<class MakeResynFn>
+  rewriting_worker( MakeResynFn& make_resyn, NodeCostFn const& cost_fn, uint32_t cut_size )
+      : resyn( make_resyn() ),
+        cost_fn( cost_fn ),
+        mffc( cost_fn ),
+        cut_size( cut_size )
+  {
+    reset_scratch();
+  }
+
+  /* called before the candidates of a gate are built */
+  void limit_scratch()
+  {
+    if ( scratch.size() > max_scratch_size )
+    {
+      reset_scratch();
+    }
+  }
+
+  void reset_scratch()
+  {
+    scratch = Ntk();
+    pis.clear();
+    for ( auto i = 0u; i < cut_size; ++i )
+    {
+      pis.push_back( scratch.create_pi() );
+    }
+    levels.clear();
+    levels.shrink_to_fit();
+  }
+
+  /* cost of the cone of f in the scratch network; computes its level if
+     leaf_levels contains the levels of the cut leaves */
+  uint32_t cone_cost( signal const& f, std::vector<uint32_t> const& leaf_levels, uint32_t& level )
+  {
+    scratch.incr_trav_id();
+    levels.resize( scratch.size() );
+    const auto cost = cone_cost_rec( scratch.get_node( f ), leaf_levels );
+    level = levels[scratch.node_to_index( scratch.get_node( f ) )];
+    return cost;
+  }
+
+  uint32_t cone_cost_rec( typename Ntk::node const& n, std::vector<uint32_t> const& leaf_levels )
+  {
+    const auto index = scratch.node_to_index( n );
+    if ( scratch.is_constant( n ) || scratch.is_pi( n ) )
+    {
+      levels[index] = scratch.is_pi( n ) && scratch.pi_index( n ) < leaf_levels.size() ? leaf_levels[scratch.pi_index( n )] : 0u;
+      return 0u;
+    }
+    if ( scratch.visited( n ) == scratch.trav_id() )
+    {
+      return 0u;
+    }
+    scratch.set_visited( n, scratch.trav_id() );
+
+    uint32_t cost = cost_fn( scratch, n );
+    uint32_t level{0u};
+    scratch.foreach_fanin( n, [&]( auto const& f ) {
+      cost += cone_cost_rec( scratch.get_node( f ), leaf_levels );
+      level = std::max( level, levels[scratch.node_to_index( scratch.get_node( f ) )] );
+    } );
+    levels[index] = level + 1u;
+    return cost;
+  }
+
+  Ntk scratch;
+  std::vector<signal> pis;
+  ResynFn resyn;
+  NodeCostFn const& cost_fn;
+  mffc_counter<Ntk, NodeCostFn> mffc;
+  uint32_t cut_size;
+  std::vector<uint32_t> levels, leaf_levels;
+};
+
+template<class Ntk>
+typename Ntk::signal copy_candidate( Ntk& ntk, Ntk const& scratch, typename Ntk::signal const& f, small_cut const& cut,
+                                     std::unordered_map<uint32_t, typename Ntk::signal>& copied )
+{
+  const auto n = scratch.get_node( f );
+  const auto index = scratch.node_to_index( n );
+
+  typename Ntk::signal s;
+  if ( auto it = copied.find( index ); it != copied.end() )
+  {
+    s = it->second;
+  }
+  else
+  {
+    if ( scratch.is_constant( n ) )
+    {
+      s = ntk.get_constant( scratch.constant_value( n ) );
+    }
+    else if ( scratch.is_pi( n ) )
+    {
+      s = ntk.make_signal( ntk.index_to_node( cut.leaves[scratch.pi_index( n )] ) );
+    }
+    else
+    {
+      std::vector<typename Ntk::signal> children;
+      scratch.foreach_fanin( n, [&]( auto const& g ) {
+        children.push_back( copy_candidate( ntk, scratch, g, cut, copied ) );
+      } );
+      s = ntk.clone_node( scratch, n, children );
+    }
+    copied.emplace( index, s );
+  }
+
+  return scratch.is_complemented( f ) ? ntk.create_not( s ) : s;
+}
+
+} // namespace detail
+
+/*! \brief Cut rewriting with parallel cut enumeration and evaluation
+
+  A pass works in three phases:
+
+  1. Cuts are enumerated in parallel level by level (see
+     `parallel_cut_enumeration`).
+  2. Each gate is evaluated independently: the resynthesis function builds
+     candidates for the function of each cut into a thread-local scratch
+     network, and the best candidate is kept.  The network is only read in
+     this phase.
+  3. Candidates are committed sequentially in topological order.  Before a
+     candidate is committed, the gain is recomputed, since earlier rewrites may
+     have removed the gate, its leaves, or parts of its MFFC.  The candidate
+     is rebuilt by a separate resynthesis object, such that the order in which
+     its nodes are created does not depend on the thread that found it.
+
+  Passes do not clean up the network, such that node indexes stay valid.  The
+  engine records the nodes that were created or got new fanins in a pass.
+  The next pass (`run_incremental_pass`) only recomputes cuts and evaluates
+  gates in the transitive fanout of these nodes up to a bounded depth.
+  Cut sets of recomputed and dead nodes are recycled between passes; if
+  `ps.cut_memory` is not 0, gates beyond this limit are not rewritten.
+
+  With don't cares (see `use_dont_cares`), the don't cares of the cut leaves
+  are passed to the resynthesis function.  They are computed when a gate is
+  evaluated and kept with the candidate, such that the commit replays the
+  same call.
+
+  Candidates are ranked by the cost objective (see `cost_objective`): the
+  gain is the cost of the MFFC minus the cost of the candidate, measured
+  with the node cost function.  Depth-aware cost functions compare the level
+  of a candidate to the level of the replaced gate; levels are recomputed
+  once per pass and extended to new nodes when candidates are committed.
+
+  The resynthesis function is not shared between threads; `make_resyn` is
+  called once per thread to create a resynthesis object.  The result depends
+  neither on the number of threads nor on scheduling as long as the
+  resynthesis function itself is deterministic.
+*/
+template<class Ntk, class MakeResynFn, class NodeCostFn = unit_cost<Ntk>>
+class parallel_cut_rewriting_impl
+{
+public:
+  using node = typename Ntk::node;
+  using signal = typename Ntk::signal;
+  using resyn_t = decltype( std::declval<MakeResynFn&>()() );
+  using worker_t = detail::rewriting_worker<Ntk, resyn_t, NodeCostFn>;
+
+  parallel_cut_rewriting_impl( Ntk& ntk, MakeResynFn& make_resyn, thread_pool& pool, parallel_cut_rewriting_params const& ps, parallel_cut_rewriting_stats& st, NodeCostFn const& cost_fn = {} )
+      : ntk( ntk ),
+        pool( pool ),
+        ps( ps ),
+        st( st ),
+        cost_fn( cost_fn ),
+        cuts( ntk, ps.cut_size, ps.cut_limit, ps.cut_memory ),
+        levels( ntk )
+  {
+    objective.cost = ps.cost;
+    objective.min_gain = ps.allow_zero_gain ? 0 : 1;
+
+    /* the last worker is used to rebuild candidates when committing */
+    for ( auto i = 0u; i <= pool.num_threads(); ++i )
+    {
+      workers.emplace_back( std::make_unique<worker_t>( make_resyn, this->cost_fn, std::min( ps.cut_size, small_cut::max_size ) ) );
+    }
+  }
+
+  /*! \brief Rewrites all gates, returns the number of rewrites */
+  uint32_t run_pass()
+  {
+    mockturtle::call_with_stopwatch( st.time_cuts, [&]() {
+      cuts.run( pool );
+    } );
+    return evaluate_and_commit();
+  }
+
+  /*! \brief Rewrites gates in the fanout of changes of the previous pass */
+  uint32_t run_incremental_pass()
+  {
+    const auto frontier = compute_frontier();
+    if ( frontier.empty() )
+    {
+      return 0u;
+    }
+
+    mockturtle::call_with_stopwatch( st.time_cuts, [&]() {
+      cuts.update( pool, frontier );
+    } );
+    return evaluate_and_commit();
+  }
+
+  /*! \brief Passes don't cares of cut leaves to the resynthesis function
+
+    Only used if the resynthesis function has a don't-care overload (see
+    `dont_care_resynthesis`).
+  */
+  void use_dont_cares( windowed_dont_cares<Ntk>& dcs )
+  {
+    if constexpr ( has_dont_care_resynthesis_v<resyn_t, Ntk> )
+    {
+      dont_cares = &dcs;
+    }
+  }
+
+  /*! \brief Depth of the network (0 if the cost function is not depth-aware) */
+  uint32_t depth()
+  {
+    if ( !objective.level_constrained() )
+    {
+      return 0u;
+    }
+    refresh_levels();
+    return levels.depth();
+  }
+
+  /*! \brief Total cost of the gates in the transitive fanin of the POs
+
+    Dangling gates, such as those of rejected candidates, are not counted.
+  */
+  uint32_t total_cost() const
+  {
+    uint32_t cost{0u};
+    std::vector<uint8_t> visited( ntk.size(), 0u );
+    std::vector<uint32_t> stack;
+    ntk.foreach_po( [&]( auto const& f ) {
+      stack.push_back( ntk.node_to_index( ntk.get_node( f ) ) );
+    } );
+    while ( !stack.empty() )
+    {
+      const auto index = stack.back();
+      stack.pop_back();
+      const auto n = ntk.index_to_node( index );
+      if ( visited[index] || ntk.is_constant( n ) || ntk.is_pi( n ) )
+      {
+        continue;
+      }
+      visited[index] = 1u;
+      cost += cost_fn( ntk, n );
+      ntk.foreach_fanin( n, [&]( auto const& f ) {
+        stack.push_back( ntk.node_to_index( ntk.get_node( f ) ) );
+      } );
+    }
+    return cost;
+  }
+
+private:
+  struct candidate
+  {
+    bool valid{false};
+    uint32_t cut{0u};
+    uint32_t index{0u}; /* position in the sequence of candidates for the cut */
+    int32_t gain{0};
+    uint32_t cost{0u};
+    uint32_t level{0u};
+    uint64_t dont_cares{0u};
+  };
+
+  kitty::dynamic_truth_table cut_function( small_cut const& cut ) const
+  {
+    kitty::dynamic_truth_table function( cut.size );
+    kitty::create_from_words( function, &cut.function, &cut.function + 1 );
+    function.mask_bits();
+    return function;
+  }
+
+  /* calls the resynthesis function of the worker for the cut function */
+  template<class Fn>
+  void resynthesize( worker_t& w, small_cut const& cut, uint64_t dc_word, Fn&& fn )
+  {
+    if constexpr ( has_dont_care_resynthesis_v<resyn_t, Ntk> )
+    {
+      if ( dc_word )
+      {
+        kitty::dynamic_truth_table dc( cut.size );
+        kitty::create_from_words( dc, &dc_word, &dc_word + 1 );
+        dc.mask_bits();
+        w.resyn( w.scratch, cut_function( cut ), dc, w.pis.begin(), w.pis.begin() + cut.size, fn );
+        return;
+      }
+    }
+    w.resyn( w.scratch, cut_function( cut ), w.pis.begin(), w.pis.begin() + cut.size, fn );
+  }
+
+  /* exact levels, if needed by the cost objective */
+  void refresh_levels()
+  {
+    if ( objective.level_constrained() && !levels_valid )
+    {
+      levels.recompute();
+      levels_valid = true;
+    }
+  }
+
+  /* evaluates the gates of the last cut update and commits the best candidates */
+  uint32_t evaluate_and_commit()
+  {
+    ++st.num_passes;
+    refresh_levels();
+    const auto use_levels = objective.level_constrained();
+
+    /* gates in topological order */
+    std::vector<uint32_t> gates;
+    for ( auto const& level : cuts.levels() )
+    {
+      gates.insert( gates.end(), level.begin(), level.end() );
+    }
+    st.num_evaluated += static_cast<uint32_t>( gates.size() );
+
+    std::vector<candidate> best( gates.size() );
+    std::vector<uint32_t> num_candidates( pool.num_threads(), 0u );
+
+    if ( dont_cares )
+    {
+      dont_cares->prepare( ntk );
+    }
+
+    mockturtle::call_with_stopwatch( st.time_evaluation, [&]() {
+      pool.parallel_for( 0u, static_cast<uint32_t>( gates.size() ), [&]( uint32_t i, uint32_t tid ) {
+        if ( is_cancelled() )
+        {
+          return;
+        }
+
+        auto& w = *workers[tid];
+        const auto n = ntk.index_to_node( gates[i] );
+        if ( ntk.is_dead( n ) )
+        {
+          return;
+        }
+        w.limit_scratch();
+        const auto& node_cuts = cuts.cuts( gates[i] );
+
+        for ( auto c = 0u; c < node_cuts.size(); ++c )
+        {
+          const auto& cut = node_cuts[c];
+          if ( cut.size < 2u || std::any_of( cut.begin(), cut.end(), [&]( auto leaf ) { return ntk.is_dead( ntk.index_to_node( leaf ) ); } ) )
+          {
+            continue;
+          }
+
+          const auto mffc = static_cast<int32_t>( w.mffc( ntk, n, cut ) );
+          const auto root_level = use_levels ? levels[n] : 0u;
+          const auto critical = use_levels && levels.is_critical( n );
+          w.leaf_levels.clear();
+          if ( use_levels )
+          {
+            for ( auto leaf : cut )
+            {
+              w.leaf_levels.push_back( levels[ntk.index_to_node( leaf )] );
+            }
+          }
+
+          const auto dc = dont_cares ? *dont_cares->compute( ntk, n, cut.begin(), cut.end() ).cbegin() : uint64_t( 0u );
+
+          uint32_t index{0u};
+          resynthesize( w, cut, dc, [&]( auto const& f ) {
+            ++num_candidates[tid];
+            uint32_t level{0u};
+            const auto cost = w.cone_cost( f, w.leaf_levels, level );
+            const auto gain = mffc - static_cast<int32_t>( cost );
+            auto& b = best[i];
+            if ( objective.accepts( gain, level, root_level, critical ) && ( !b.valid || objective.better( gain, level, b.gain, b.level ) ) )
+            {
+              b = {true, c, index, gain, cost, level, dc};
+            }
+            ++index;
+            return true;
+          } );
+        }
+      } );
+    } );
+
+    for ( auto n : num_candidates )
+    {
+      st.num_candidates += n;
+    }
+    st.num_cuts = cuts.total_cuts();
+    st.cut_memory = cuts.arena().reserved_bytes();
+    st.num_capped = cuts.arena().num_failed();
+
+    /* sequential commit in topological order */
+    uint32_t rewrites{0u};
+    modified.clear();
+    mockturtle::call_with_stopwatch( st.time_commit, [&]() {
+      detail::mffc_counter<Ntk, NodeCostFn> mffc( cost_fn );
+      std::unordered_map<uint32_t, signal> copied;
+      auto& w = *workers.back();
+
+      for ( auto i = 0u; i < gates.size(); ++i )
+      {
+        if ( is_cancelled() )
+        {
+          break;
+        }
+
+        const auto& cand = best[i];
+        if ( !cand.valid )
+        {
+          continue;
+        }
+
+        const auto n = ntk.index_to_node( gates[i] );
+        if ( ntk.is_dead( n ) || ntk.fanout_size( n ) == 0u )
+        {
+          continue;
+        }
+
+        const auto& cut = cuts.cuts( gates[i] )[cand.cut];
+        if ( std::any_of( cut.begin(), cut.end(), [&]( auto leaf ) { return ntk.is_dead( ntk.index_to_node( leaf ) ); } ) )
+        {
+          continue;
+        }
+
+        /* leaf and root levels did not change in this pass, only the gain
+           must be recomputed */
+        const auto gain = static_cast<int32_t>( mffc( ntk, n, cut ) ) - static_cast<int32_t>( cand.cost );
+        if ( !objective.accepts( gain, cand.level, use_levels ? levels[n] : 0u, use_levels && levels.is_critical( n ) ) )
+        {
+          continue;
+        }
+
+        std::optional<signal> g;
+        uint32_t index{0u};
+        w.limit_scratch();
+        resynthesize( w, cut, cand.dont_cares, [&]( auto const& f ) {
+          if ( index++ == cand.index )
+          {
+            g = f;
+            return false;
+          }
+          return true;
+        } );
+        if ( !g )
+        {
+          continue;
+        }
+
+        const auto size_before = ntk.size();
+        copied.clear();
+        const auto f = detail::copy_candidate( ntk, w.scratch, *g, cut, copied );
+        if ( ntk.get_node( f ) == n )
+        {
+          continue;
+        }
+
+        /* record new nodes and the root of the replacement, whose fanout
+           contains the gates that get new fanins by the substitution */
+        for ( auto index = size_before; index < ntk.size(); ++index )
+        {
+          modified.push_back( index );
+        }
+        modified.push_back( ntk.node_to_index( ntk.get_node( f ) ) );
+        if ( use_levels )
+        {
+          levels.update();
+        }
+
+        ntk.substitute_node( n, f );
+        ++rewrites;
+      }
+    } );
+
+    /* stored levels are upper bounds now */
+    if ( rewrites > 0u )
+    {
+      levels_valid = false;
+    }
+
+    st.num_rewrites += rewrites;
+    return rewrites;
+  }
+
+  /* gates in the transitive fanout of modified nodes up to the frontier depth */
+  std::vector<uint32_t> compute_frontier()
+  {
+    const auto depth = ps.frontier_depth == 0u ? ps.cut_size : ps.frontier_depth;
+
+    /* fanout lists of live gates */
+    std::vector<uint32_t> offsets( ntk.size() + 1u, 0u ), fanouts;
+    ntk.foreach_gate( [&]( auto const& n ) {
+      if ( ntk.is_dead( n ) )
+      {
+        return;
+      }
+      ntk.foreach_fanin( n, [&]( auto const& f ) {
+        ++offsets[ntk.node_to_index( ntk.get_node( f ) ) + 1u];
+      } );
+    } );
+    for ( auto i = 1u; i < offsets.size(); ++i )
+    {
+      offsets[i] += offsets[i - 1u];
+    }
+    fanouts.resize( offsets.back() );
+    {
+      auto pos = offsets;
+      ntk.foreach_gate( [&]( auto const& n ) {
+        if ( ntk.is_dead( n ) )
+        {
+          return;
+        }
+        ntk.foreach_fanin( n, [&]( auto const& f ) {
+          fanouts[pos[ntk.node_to_index( ntk.get_node( f ) )]++] = ntk.node_to_index( n );
+        } );
+      } );
+    }
+
+    /* breadth-first search from the modified nodes */
+    std::vector<uint32_t> distance( ntk.size(), UINT32_MAX );
+    std::vector<uint32_t> frontier, queue;
+    const auto visit = [&]( uint32_t index, uint32_t d ) {
+      if ( distance[index] != UINT32_MAX )
+      {
+        return;
+      }
+      distance[index] = d;
+      queue.push_back( index );
+    };
+    for ( auto index : modified )
+    {
+      visit( index, 0u );
+    }
+
+    for ( auto q = 0u; q < queue.size(); ++q )
+    {
+      const auto index = queue[q];
+      const auto n = ntk.index_to_node( index );
+      if ( !ntk.is_dead( n ) && !ntk.is_constant( n ) && !ntk.is_pi( n ) )
+      {
+        frontier.push_back( index );
+      }
+      if ( distance[index] == depth )
+      {
+        continue;
+      }
+      for ( auto i = offsets[index]; i < offsets[index + 1u]; ++i )
+      {
+        visit( fanouts[i], distance[index] + 1u );
+      }
+    }
+
+    return frontier;
+  }
+
+private:
+  Ntk& ntk;
+  thread_pool& pool;
+  parallel_cut_rewriting_params const& ps;
+  parallel_cut_rewriting_stats& st;
+  NodeCostFn cost_fn;
+  cost_objective objective;
+
+  parallel_cut_enumeration<Ntk> cuts;
+  level_tracker<Ntk> levels;
+  bool levels_valid{false};
+  std::vector<std::unique_ptr<worker_t>> workers;
+  windowed_dont_cares<Ntk>* dont_cares{nullptr};
+
+  std::vector<uint32_t> modified;
+};
+
+/*! \brief Runs one pass of parallel cut rewriting (see `parallel_cut_rewriting_impl`)
+
+  The network is not cleaned up.  Don't cares are used if `dont_cares` is
+  given (see `parallel_cut_rewriting_impl::use_dont_cares`).
+*/
+template<class Ntk, class MakeResynFn, class NodeCostFn = unit_cost<Ntk>>
+void parallel_cut_rewriting( Ntk& ntk, MakeResynFn&& make_resyn, thread_pool& pool, parallel_cut_rewriting_params const& ps = {}, parallel_cut_rewriting_stats* pst = nullptr, NodeCostFn const& cost_fn = {}, windowed_dont_cares<Ntk>* dont_cares = nullptr )
+{
+  parallel_cut_rewriting_stats st;
+  {
+    mockturtle::stopwatch t( st.time_total );
+    parallel_cut_rewriting_impl<Ntk, std::decay_t<MakeResynFn>, NodeCostFn> impl( ntk, make_resyn, pool, ps, st, cost_fn );
+    if ( dont_cares )
+    {
+      impl.use_dont_cares( *dont_cares );
+    }
+    impl.run_pass();
+  }
+
+  if ( ps.verbose )
+  {
+    st.report();
+  }
+
+  if ( pst )
+  {
+    *pst = st;
+  }
+}
+
+/*! \brief Repeats parallel cut rewriting until the cost does not decrease
+
+  After a full first pass, each pass only revisits the transitive fanout of
+  the nodes changed in the previous pass.  The cost is the total node cost
+  of the logic that drives the POs, preceded by the depth for the `depth`
+  cost function.  The network is not cleaned up.
+*/
+template<class Ntk, class MakeResynFn, class NodeCostFn = unit_cost<Ntk>>
+void parallel_cut_rewriting_fixpoint( Ntk& ntk, MakeResynFn&& make_resyn, thread_pool& pool, parallel_cut_rewriting_params const& ps = {}, parallel_cut_rewriting_stats* pst = nullptr, NodeCostFn const& cost_fn = {}, windowed_dont_cares<Ntk>* dont_cares = nullptr )
+{
+  parallel_cut_rewriting_stats st;
+  {
+    mockturtle::stopwatch t( st.time_total );
+    parallel_cut_rewriting_impl<Ntk, std::decay_t<MakeResynFn>, NodeCostFn> impl( ntk, make_resyn, pool, ps, st, cost_fn );
+    if ( dont_cares )
+    {
+      impl.use_dont_cares( *dont_cares );
+    }
+
+    const auto cost = [&]() {
+      return std::make_pair( ps.cost == cost_function::depth ? impl.depth() : 0u, impl.total_cost() );
+    };
+
+    auto curr_cost = cost();
+    auto rewrites = impl.run_pass();
+    while ( rewrites > 0u && !is_cancelled() )
+    {
+      const auto new_cost = cost();
+      if ( !( new_cost < curr_cost ) )
+      {
+        break;
+      }
+      curr_cost = new_cost;
+      rewrites = impl.run_incremental_pass();
+    }
+  }
+
+  if ( ps.verbose )
+  {
+    st.report();
+  }
+
+  if ( pst )
+  {
+    *pst = st;
+  }
+}
+
+} // namespace cirkit
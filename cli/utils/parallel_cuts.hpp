@@ -0,0 +1,429 @@
+/* CirKit: A circuit toolkit
+ * Copyright (C) 2017-2019  EPFL
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include <kitty/operations.hpp>
+#include <kitty/static_truth_table.hpp>
+
+#include "cut_arena.hpp"
+#include "thread_pool.hpp"
+
+namespace cirkit
+{
+
+/*! \brief Cut with at most 6 leaves and its function as a single word
+
+  The leaves are sorted node indexes, and the function is replicated such
+  that it does not depend on the variables above `size`.
+*/
+struct small_cut
+{
+  static constexpr uint32_t max_size = 6u;
+
+  std::array<uint32_t, max_size> leaves{};
+  uint8_t size{0u};
+  uint64_t function{0u};
+
+  uint32_t const* begin() const { return leaves.data(); }
+  uint32_t const* end() const { return leaves.data() + size; }
+
+  /*! \brief Whether the leaves of this cut are a subset of the leaves of `other` */
+  bool dominates( small_cut const& other ) const
+  {
+    return size <= other.size && std::includes( other.begin(), other.end(), begin(), end() );
+  }
+
+  bool operator<( small_cut const& other ) const
+  {
+    return size < other.size || ( size == other.size && std::lexicographical_compare( begin(), end(), other.begin(), other.end() ) );
+  }
+
+  bool operator==( small_cut const& other ) const
+  {
+    return size == other.size && std::equal( begin(), end(), other.begin() );
+  }
+};
+
+namespace detail
+{
+
+/* computes the union of two sorted leaf sets, fails if larger than cut_size */
+inline bool merge_leaves( small_cut const& a, small_cut const& b, small_cut& res, uint32_t cut_size )
+{
+  uint32_t i{0u}, j{0u}, k{0u};
+  while ( i < a.size || j < b.size )
+  {
+    if ( k == cut_size )
+    {
+      return false;
+    }
+    if ( j == b.size || ( i < a.size && a.leaves[i] < b.leaves[j] ) )
+    {
+      res.leaves[k++] = a.leaves[i++];
+    }
+    else if ( i == a.size || b.leaves[j] < a.leaves[i] )
+    {
+      res.leaves[k++] = b.leaves[j++];
+    }
+    else
+    {
+      res.leaves[k++] = a.leaves[i++];
+      ++j;
+    }
+  }
+  res.size = static_cast<uint8_t>( k );
+  return true;
+}
+
+/* expresses the function of `cut` over the leaves of `merged` (a superset) */
+inline kitty::static_truth_table<small_cut::max_size> expand_function( small_cut const& cut, small_cut const& merged )
+{
+  kitty::static_truth_table<small_cut::max_size> tt;
+  tt._bits = cut.function;
+
+  int j = static_cast<int>( merged.size ) - 1;
+  for ( int i = static_cast<int>( cut.size ) - 1; i >= 0; --i, --j )
+  {
+    while ( merged.leaves[j] != cut.leaves[i] )
+    {
+      --j;
+    }
+    if ( i != j )
+    {
+      kitty::swap_inplace( tt, i, j );
+    }
+  }
+  return tt;
+}
+
+} // namespace detail
+
+/*! \brief Cut enumeration that processes all nodes of a level in parallel
+
+  Cuts are computed bottom-up from the cuts of the fanins.  All nodes in one
+  level only depend on nodes in smaller levels, and are therefore processed
+  concurrently.  Each node keeps at most `cut_limit` cuts, which are chosen
+  deterministically (smallest cuts first, dominated cuts removed), and the
+  trivial cut as the last cut.  The results do not depend on the number of
+  threads.
+
+  Cuts can be updated for a subset of nodes, e.g., after the network has been
+  changed in some region.  Levels are computed relative to the updated nodes,
+  such that the node indexes need not be in topological order.  Cut functions
+  remain correct for nodes that are not updated as long as all changes to the
+  network preserve node functions, but their cuts may no longer be the best
+  ones.
+
+  Cut sets are stored in a `cut_arena`.  Before the nodes of a level are
+  processed, the cut sets of the nodes in the level are allocated in index
+  order, and the cut sets of dead nodes are recycled at each update.  If
+  `max_bytes` is not 0 and the arena reaches this limit, the remaining gates
+  only have their trivial cut, i.e., they are not considered as roots and
+  appear as leaves in the cuts of their fanouts.  The cut sets of constants
+  and PIs are stored in a region that is reserved up front and counts
+  towards the limit; the limit must be at least
+  `parallel_cut_enumeration_min_memory`.
+
+  Cut sizes are limited to 6, such that functions fit into a single word.
+*/
+template<class Ntk>
+class parallel_cut_enumeration
+{
+public:
+  using node = typename Ntk::node;
+
+  parallel_cut_enumeration( Ntk const& ntk, uint32_t cut_size, uint32_t cut_limit, uint64_t max_bytes = 0u )
+      : ntk( ntk ),
+        cut_size( std::min( cut_size, small_cut::max_size ) ),
+        cut_limit( std::min( std::max( cut_limit, 2u ), cut_arena<small_cut>::chunk_size ) ),
+        _cuts( max_bytes )
+  {
+  }
+
+  /*! \brief Computes the cuts of all nodes */
+  void run( thread_pool& pool )
+  {
+    std::vector<uint32_t> gates;
+    ntk.foreach_gate( [&]( auto const& n ) {
+      if ( !ntk.is_dead( n ) )
+      {
+        gates.push_back( ntk.node_to_index( n ) );
+      }
+    } );
+    update( pool, gates );
+  }
+
+  /*! \brief Recomputes the cuts of the given gates */
+  void update( thread_pool& pool, std::vector<uint32_t> const& gates )
+  {
+    _cuts.resize( ntk.size() );
+    _cuts.reserve_fallback( ntk.num_pis() + 2u );
+    for ( auto index = 0u; index < ntk.size(); ++index )
+    {
+      const auto n = ntk.index_to_node( index );
+      if ( ntk.is_dead( n ) )
+      {
+        _cuts.release( index );
+        continue;
+      }
+      if ( _cuts.has_cuts( index ) )
+      {
+        continue;
+      }
+      /* constants and PIs use the fallback region, which is within the memory limit */
+      if ( ntk.is_constant( n ) )
+      {
+        small_cut cut;
+        cut.function = ntk.constant_value( n ) ? ~UINT64_C( 0 ) : UINT64_C( 0 );
+        _cuts.allocate_fallback( index );
+        _cuts.push_back( index, cut );
+      }
+      else if ( ntk.is_pi( n ) )
+      {
+        _cuts.allocate_fallback( index );
+        _cuts.push_back( index, trivial_cut( n ) );
+      }
+    }
+
+    compute_levels( gates );
+
+    for ( auto const& level : _levels )
+    {
+      for ( auto index : level )
+      {
+        _cuts.allocate( index, cut_limit );
+      }
+      pool.parallel_for( 0u, static_cast<uint32_t>( level.size() ), [&]( uint32_t i, uint32_t ) {
+        compute_cuts( ntk.index_to_node( level[i] ) );
+      } );
+    }
+  }
+
+  /*! \brief Cuts of a node, empty for gates that were not updated so far or
+             exceeded the memory limit */
+  cut_span<small_cut> cuts( uint32_t index ) const
+  {
+    return _cuts.cuts( index );
+  }
+
+  /*! \brief Indexes of the gates of the last update grouped by level
+
+    The order of the gates is topological.
+  */
+  std::vector<std::vector<uint32_t>> const& levels() const
+  {
+    return _levels;
+  }
+
+  uint32_t total_cuts() const
+  {
+    return static_cast<uint32_t>( _cuts.total_cuts() );
+  }
+
+  cut_arena<small_cut> const& arena() const
+  {
+    return _cuts;
+  }
+
+private:
+  small_cut trivial_cut( node const& n ) const
+  {
+    small_cut cut;
+    cut.leaves[0] = ntk.node_to_index( n );
+    cut.size = 1u;
+    cut.function = UINT64_C( 0xaaaaaaaaaaaaaaaa );
+    return cut;
+  }
+
+  /* levels relative to the set of gates, i.e., only paths through gates in
+     the set are considered; gates of the same level are sorted by index */
+  void compute_levels( std::vector<uint32_t> const& gates )
+  {
+    constexpr auto outside = UINT32_MAX;
+    constexpr auto unknown = UINT32_MAX - 1u;
+
+    std::vector<uint32_t> level( ntk.size(), outside );
+    for ( auto g : gates )
+    {
+      level[g] = unknown;
+    }
+
+    std::vector<uint32_t> stack;
+    for ( auto g : gates )
+    {
+      stack.push_back( g );
+      while ( !stack.empty() )
+      {
+        const auto index = stack.back();
+        if ( level[index] != unknown )
+        {
+          stack.pop_back();
+          continue;
+        }
+
+        uint32_t l{0u};
+        bool ready{true};
+        ntk.foreach_fanin( ntk.index_to_node( index ), [&]( auto const& f ) {
+          const auto c = ntk.node_to_index( ntk.get_node( f ) );
+          if ( level[c] == unknown )
+          {
+            stack.push_back( c );
+            ready = false;
+          }
+          else if ( level[c] != outside )
+          {
+            l = std::max( l, level[c] + 1u );
+          }
+        } );
+
+        if ( ready )
+        {
+          level[index] = l;
+          stack.pop_back();
+        }
+      }
+    }
+
+    _levels.clear();
+    for ( auto g : gates )
+    {
+      if ( _levels.size() <= level[g] )
+      {
+        _levels.resize( level[g] + 1u );
+      }
+      _levels[level[g]].push_back( g );
+    }
+    for ( auto& l : _levels )
+    {
+      std::sort( l.begin(), l.end() );
+    }
+  }
+
+  void compute_cuts( node const& n )
+  {
+    const auto index = ntk.node_to_index( n );
+    if ( !_cuts.has_cuts( index ) )
+    {
+      return;
+    }
+
+    /* fanins without cuts (not part of any update so far, or beyond the
+       memory limit) only have the trivial cut */
+    std::vector<small_cut> fallback;
+    std::vector<cut_span<small_cut>> fanin_cuts;
+    fallback.reserve( ntk.fanin_size( n ) );
+    ntk.foreach_fanin( n, [&]( auto const& f ) {
+      const auto c = _cuts.cuts( ntk.node_to_index( ntk.get_node( f ) ) );
+      if ( c.empty() )
+      {
+        fallback.push_back( trivial_cut( ntk.get_node( f ) ) );
+        fanin_cuts.emplace_back( &fallback.back(), 1u );
+      }
+      else
+      {
+        fanin_cuts.push_back( c );
+      }
+    } );
+
+    std::vector<small_cut> candidates;
+    std::vector<small_cut const*> chosen( fanin_cuts.size() );
+    std::vector<kitty::static_truth_table<small_cut::max_size>> tts( fanin_cuts.size() );
+
+    if ( fanin_cuts.size() <= cut_size )
+    {
+      enumerate( n, 0u, small_cut(), fanin_cuts, chosen, tts, candidates );
+    }
+
+    std::sort( candidates.begin(), candidates.end() );
+    candidates.erase( std::unique( candidates.begin(), candidates.end() ), candidates.end() );
+
+    for ( auto const& cand : candidates )
+    {
+      const auto cuts = _cuts.cuts( index );
+      if ( cuts.size() + 1u == cut_limit )
+      {
+        break;
+      }
+      /* candidates are sorted by size, only earlier cuts can dominate */
+      if ( std::none_of( cuts.begin(), cuts.end(), [&]( auto const& c ) { return c.dominates( cand ); } ) )
+      {
+        _cuts.push_back( index, cand );
+      }
+    }
+    _cuts.push_back( index, trivial_cut( n ) );
+  }
+
+  void enumerate( node const& n, uint32_t i, small_cut const& partial, std::vector<cut_span<small_cut>> const& fanin_cuts,
+                  std::vector<small_cut const*>& chosen, std::vector<kitty::static_truth_table<small_cut::max_size>>& tts, std::vector<small_cut>& candidates ) const
+  {
+    if ( i == fanin_cuts.size() )
+    {
+      auto cut = partial;
+      for ( auto j = 0u; j < chosen.size(); ++j )
+      {
+        tts[j] = detail::expand_function( *chosen[j], cut );
+      }
+      cut.function = ntk.compute( n, tts.begin(), tts.end() )._bits;
+      candidates.push_back( cut );
+      return;
+    }
+
+    for ( auto const& c : fanin_cuts[i] )
+    {
+      small_cut merged;
+      if ( detail::merge_leaves( partial, c, merged, cut_size ) )
+      {
+        chosen[i] = &c;
+        enumerate( n, i + 1u, merged, fanin_cuts, chosen, tts, candidates );
+      }
+    }
+  }
+
+private:
+  Ntk const& ntk;
+  uint32_t cut_size;
+  uint32_t cut_limit;
+  cut_arena<small_cut> _cuts;
+  std::vector<std::vector<uint32_t>> _levels;
+};
+
+/*! \brief Smallest cut memory limit of `parallel_cut_enumeration` in bytes
+
+  This is the size of the region that keeps the cut sets of constants and
+  PIs, which are not subject to the limit otherwise.
+*/
+template<class Ntk>
+uint64_t parallel_cut_enumeration_min_memory( Ntk const& ntk )
+{
+  return cut_arena<small_cut>::fallback_bytes( ntk.num_pis() + 2u, 1u );
+}
+
+} // namespace cirkit
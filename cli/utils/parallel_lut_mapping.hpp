@@ -0,0 +1,785 @@
+/* CirKit: A circuit toolkit
+ * Copyright (C) 2017-2019  EPFL
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <limits>
+#include <tuple>
+#include <vector>
+
+#include <fmt/format.h>
+#include <kitty/constructors.hpp>
+#include <kitty/dynamic_truth_table.hpp>
+#include <kitty/operators.hpp>
+#include <kitty/static_truth_table.hpp>
+#include <mockturtle/utils/stopwatch.hpp>
+
+#include "cancellation.hpp"
+#include "cut_arena.hpp"
+#include "output_stream.hpp"
+#include "parallel_cuts.hpp"
+#include "thread_pool.hpp"
+
+namespace cirkit
+{
+
+struct parallel_lut_mapping_params
+{
+  /*! \brief Maximum number of LUT inputs (at most 6) */
+  uint32_t cut_size{6u};
+
+  /*! \brief Maximum number of cuts per node, including the trivial cut */
+  uint32_t cut_limit{8u};
+
+  /*! \brief Number of area-flow rounds */
+  uint32_t rounds{2u};
+
+  /*! \brief Number of exact-area rounds */
+  uint32_t rounds_ela{1u};
+
+  /*! \brief Delay of a LUT */
+  uint32_t lut_delay{1u};
+
+  /*! \brief Recover area only under the required times of a delay target */
+  bool delay_oriented{false};
+
+  /*! \brief Target depth in LUT levels (0 for the depth of the delay-optimal mapping) */
+  uint32_t target_depth{0u};
+
+  /*! \brief Relaxation of the delay-optimal depth in percent (if no target depth is given) */
+  uint32_t relax{0u};
+
+  /*! \brief Memory limit for cut sets in bytes (0 for no limit) */
+  uint64_t cut_memory{0u};
+
+  /*! \brief Show statistics */
+  bool verbose{false};
+};
+
+struct parallel_lut_mapping_stats
+{
+  mockturtle::stopwatch<>::duration time_total{0};
+  mockturtle::stopwatch<>::duration time_cuts{0};
+  mockturtle::stopwatch<>::duration time_area_flow{0};
+  mockturtle::stopwatch<>::duration time_exact_area{0};
+  mockturtle::stopwatch<>::duration time_functions{0};
+
+  uint64_t num_cuts{0u};
+  uint32_t num_luts{0u};
+  uint32_t depth{0u};
+  uint32_t delay{0u};
+
+  /*! \brief Required time of the outputs in delay-oriented mapping */
+  uint32_t required{0u};
+
+  /*! \brief Memory reserved for cut sets in bytes */
+  uint64_t cut_memory{0u};
+
+  /*! \brief Gates that only keep their best cut due to the memory limit */
+  uint32_t num_capped{0u};
+
+  void report( std::ostream& os = output_stream() ) const
+  {
+    os << fmt::format( "[i] cuts       = {:>8d} ({:>5.2f} secs)\n", num_cuts, mockturtle::to_seconds( time_cuts ) );
+    os << fmt::format( "[i] cut memory = {:>8.2f} MB ({} gates capped)\n", cut_memory / 1048576.0, num_capped );
+    os << fmt::format( "[i] LUTs       = {:>8d}\n", num_luts );
+    os << fmt::format( "[i] LUT depth  = {:>8d}\n", depth );
+    os << fmt::format( "[i] delay      = {:>8d}\n", delay );
+    if ( required != 0u )
+    {
+      os << fmt::format( "[i] required   = {:>8d}\n", required );
+    }
+    os << fmt::format( "[i] area flow  = {:>5.2f} secs\n", mockturtle::to_seconds( time_area_flow ) );
+    os << fmt::format( "[i] exact area = {:>5.2f} secs\n", mockturtle::to_seconds( time_exact_area ) );
+    os << fmt::format( "[i] functions  = {:>5.2f} secs\n", mockturtle::to_seconds( time_functions ) );
+    os << fmt::format( "[i] total time = {:>5.2f} secs\n", mockturtle::to_seconds( time_total ) );
+  }
+};
+
+namespace detail
+{
+
+template<class Ntk, bool StoreFunction>
+class parallel_lut_mapping_impl
+{
+public:
+  using node = typename Ntk::node;
+
+  parallel_lut_mapping_impl( Ntk& ntk, thread_pool& pool, parallel_lut_mapping_params const& ps, parallel_lut_mapping_stats& st )
+      : ntk( ntk ),
+        pool( pool ),
+        ps( ps ),
+        st( st ),
+        cut_size( std::min( ps.cut_size, small_cut::max_size ) ),
+        cut_limit( std::min( std::max( ps.cut_limit, 2u ), cut_arena<small_cut>::chunk_size ) ),
+        lut_delay( std::max( ps.lut_delay, 1u ) ),
+        cuts( ps.cut_memory, 2u ),
+        buffers( pool.num_threads() )
+  {
+  }
+
+  /* returns false if the network has gates with more fanins than the cut
+     size, which cannot be mapped */
+  bool run()
+  {
+    bool fits{true};
+    ntk.foreach_gate( [&]( auto const& n ) {
+      fits = fits && ntk.fanin_size( n ) <= cut_size;
+    } );
+    if ( !fits )
+    {
+      return false;
+    }
+
+    init_nodes();
+
+    mockturtle::call_with_stopwatch( st.time_cuts, [&]() {
+      for ( auto const& level : levels )
+      {
+        /* beyond the memory limit, gates keep their best cut and the trivial cut */
+        for ( auto index : level )
+        {
+          if ( !cuts.allocate( index, cut_limit ) )
+          {
+            cuts.allocate_fallback( index );
+            ++st.num_capped;
+          }
+        }
+        pool.parallel_for( 0u, static_cast<uint32_t>( level.size() ), [&]( uint32_t i, uint32_t tid ) {
+          compute_cuts( level[i], buffers[tid] );
+        } );
+      }
+    } );
+    set_mapping_refs();
+
+    /* the delay-optimal mapping defines the required time, which is only
+       relaxed if a larger target depth is given */
+    if ( ps.delay_oriented )
+    {
+      required_time = ps.target_depth != 0u ? std::max( ps.target_depth * lut_delay, st.delay ) : st.delay + st.delay * ps.relax / 100u;
+      st.required = required_time;
+      compute_required_times();
+    }
+
+    mockturtle::call_with_stopwatch( st.time_area_flow, [&]() {
+      for ( auto r = 0u; r < ps.rounds && !is_cancelled(); ++r )
+      {
+        for ( auto const& level : levels )
+        {
+          pool.parallel_for( 0u, static_cast<uint32_t>( level.size() ), [&]( uint32_t i, uint32_t ) {
+            select_area_flow( level[i] );
+          } );
+        }
+        set_mapping_refs();
+      }
+    } );
+
+    mockturtle::call_with_stopwatch( st.time_exact_area, [&]() {
+      for ( auto r = 0u; r < ps.rounds_ela && !is_cancelled(); ++r )
+      {
+        for ( auto const& level : levels )
+        {
+          for ( auto index : level )
+          {
+            select_exact_area( index );
+          }
+        }
+        set_mapping_refs();
+      }
+    } );
+
+    if ( is_cancelled() )
+    {
+      return true;
+    }
+
+    derive_mapping();
+    return true;
+  }
+
+private:
+  struct candidate
+  {
+    small_cut cut;
+    uint32_t delay;
+    float flow;
+  };
+
+  small_cut const& best_cut( uint32_t index ) const
+  {
+    return cuts.cuts( index )[best[index]];
+  }
+
+  void init_nodes()
+  {
+    const auto size = ntk.size();
+    cuts.resize( size );
+    cuts.reserve_fallback( size );
+    best.resize( size, 0u );
+    delays.resize( size, 0u );
+    required.resize( size, std::numeric_limits<uint32_t>::max() );
+    flows.resize( size, 0.0f );
+    est_refs.resize( size, 1.0f );
+    map_refs.resize( size, 0u );
+
+    std::vector<uint32_t> gates;
+    ntk.foreach_node( [&]( auto const& n ) {
+      const auto index = ntk.node_to_index( n );
+      est_refs[index] = static_cast<float>( std::max( 1u, static_cast<uint32_t>( ntk.fanout_size( n ) ) ) );
+
+      if ( ntk.is_constant( n ) )
+      {
+        cuts.allocate_fallback( index );
+        cuts.push_back( index, small_cut() );
+      }
+      else if ( ntk.is_pi( n ) )
+      {
+        cuts.allocate_fallback( index );
+        cuts.push_back( index, trivial_cut( index ) );
+      }
+      else
+      {
+        gates.push_back( index );
+      }
+    } );
+    compute_levels( gates );
+  }
+
+  /* gates grouped by level, such that all fanins of a gate are in smaller
+     levels; gates of the same level are sorted by index */
+  void compute_levels( std::vector<uint32_t> const& gates )
+  {
+    constexpr auto unknown = std::numeric_limits<uint32_t>::max();
+
+    std::vector<uint32_t> level( ntk.size(), 0u );
+    for ( auto g : gates )
+    {
+      level[g] = unknown;
+    }
+
+    std::vector<uint32_t> stack;
+    for ( auto g : gates )
+    {
+      stack.push_back( g );
+      while ( !stack.empty() )
+      {
+        const auto index = stack.back();
+        if ( level[index] != unknown )
+        {
+          stack.pop_back();
+          continue;
+        }
+
+        uint32_t l{0u};
+        bool ready{true};
+        ntk.foreach_fanin( ntk.index_to_node( index ), [&]( auto const& f ) {
+          const auto c = ntk.node_to_index( ntk.get_node( f ) );
+          if ( level[c] == unknown )
+          {
+            stack.push_back( c );
+            ready = false;
+          }
+          else
+          {
+            l = std::max( l, level[c] + 1u );
+          }
+        } );
+
+        if ( ready )
+        {
+          level[index] = l;
+          stack.pop_back();
+        }
+      }
+    }
+
+    for ( auto g : gates )
+    {
+      if ( levels.size() < level[g] )
+      {
+        levels.resize( level[g] );
+      }
+      levels[level[g] - 1u].push_back( g );
+    }
+    for ( auto& l : levels )
+    {
+      std::sort( l.begin(), l.end() );
+    }
+  }
+
+  small_cut trivial_cut( uint32_t index ) const
+  {
+    small_cut cut;
+    cut.leaves[0] = index;
+    cut.size = 1u;
+    return cut;
+  }
+
+  /* priority cuts: the cuts of the fanins are merged, and the candidates with
+     the smallest delay, then the smallest area flow are kept */
+  void compute_cuts( uint32_t index, std::vector<candidate>& candidates )
+  {
+    const auto n = ntk.index_to_node( index );
+
+    std::array<uint32_t, small_cut::max_size> fanins{};
+    uint32_t num_fanins{0u};
+    ntk.foreach_fanin( n, [&]( auto const& f ) {
+      fanins[num_fanins++] = ntk.node_to_index( ntk.get_node( f ) );
+    } );
+
+    candidates.clear();
+    enumerate( fanins, num_fanins, 0u, small_cut(), candidates );
+
+    std::sort( candidates.begin(), candidates.end(), [&]( auto const& a, auto const& b ) {
+      return std::tie( a.delay, a.flow, a.cut.size ) < std::tie( b.delay, b.flow, b.cut.size ) ||
+             ( std::tie( a.delay, a.flow, a.cut.size ) == std::tie( b.delay, b.flow, b.cut.size ) && std::lexicographical_compare( a.cut.begin(), a.cut.end(), b.cut.begin(), b.cut.end() ) );
+    } );
+
+    const auto capacity = cuts.capacity( index );
+    for ( auto const& cand : candidates )
+    {
+      const auto node_cuts = cuts.cuts( index );
+      if ( node_cuts.size() + 1u == capacity )
+      {
+        break;
+      }
+      if ( std::none_of( node_cuts.begin(), node_cuts.end(), [&]( auto const& c ) { return c.dominates( cand.cut ); } ) )
+      {
+        cuts.push_back( index, cand.cut );
+      }
+    }
+    cuts.push_back( index, trivial_cut( index ) );
+
+    best[index] = 0u;
+    delays[index] = candidates.front().delay;
+    flows[index] = candidates.front().flow / est_refs[index];
+  }
+
+  void enumerate( std::array<uint32_t, small_cut::max_size> const& fanins, uint32_t num_fanins, uint32_t i, small_cut const& partial, std::vector<candidate>& candidates ) const
+  {
+    if ( i == num_fanins )
+    {
+      candidates.push_back( {partial, cut_delay( partial ), cut_flow( partial )} );
+      return;
+    }
+
+    for ( auto const& c : cuts.cuts( fanins[i] ) )
+    {
+      small_cut merged;
+      if ( detail::merge_leaves( partial, c, merged, cut_size ) )
+      {
+        enumerate( fanins, num_fanins, i + 1u, merged, candidates );
+      }
+    }
+  }
+
+  uint32_t cut_delay( small_cut const& cut ) const
+  {
+    uint32_t delay{0u};
+    for ( auto l : cut )
+    {
+      delay = std::max( delay, delays[l] );
+    }
+    return delay + lut_delay;
+  }
+
+  /* cuts that violate the required time are ranked after all others, by
+     their delay; the current best cut of a mapped node always meets its
+     required time, since its leaves are selected under their required times
+     before */
+  uint32_t violation( uint32_t index, uint32_t delay ) const
+  {
+    return delay > required[index] ? delay : 0u;
+  }
+
+  float cut_flow( small_cut const& cut ) const
+  {
+    float flow{1.0f};
+    for ( auto l : cut )
+    {
+      flow += flows[l];
+    }
+    return flow;
+  }
+
+  void select_area_flow( uint32_t index )
+  {
+    std::tuple<uint32_t, float, uint32_t> best_cost{std::numeric_limits<uint32_t>::max(), 0.0f, 0u};
+    const auto node_cuts = cuts.cuts( index );
+    for ( auto j = 0u; j + 1u < node_cuts.size(); ++j )
+    {
+      auto const& cut = node_cuts[j];
+      const auto delay = cut_delay( cut );
+      const std::tuple<uint32_t, float, uint32_t> cost{violation( index, delay ), cut_flow( cut ) / est_refs[index], delay};
+      if ( cost < best_cost )
+      {
+        best_cost = cost;
+        best[index] = static_cast<uint16_t>( j );
+      }
+    }
+    flows[index] = std::get<1>( best_cost );
+    delays[index] = std::get<2>( best_cost );
+  }
+
+  void select_exact_area( uint32_t index )
+  {
+    if ( map_refs[index] > 0u )
+    {
+      cut_deref( best_cut( index ) );
+    }
+
+    std::tuple<uint32_t, uint32_t, uint32_t> best_cost{std::numeric_limits<uint32_t>::max(), 0u, 0u};
+    const auto node_cuts = cuts.cuts( index );
+    for ( auto j = 0u; j + 1u < node_cuts.size(); ++j )
+    {
+      auto const& cut = node_cuts[j];
+      const auto delay = cut_delay( cut );
+      const std::tuple<uint32_t, uint32_t, uint32_t> cost{violation( index, delay ), cut_ref( cut ), delay};
+      cut_deref( cut );
+      if ( cost < best_cost )
+      {
+        best_cost = cost;
+        best[index] = static_cast<uint16_t>( j );
+      }
+    }
+    delays[index] = std::get<2>( best_cost );
+
+    if ( map_refs[index] > 0u )
+    {
+      cut_ref( best_cut( index ) );
+    }
+  }
+
+  bool is_gate( uint32_t index ) const
+  {
+    const auto n = ntk.index_to_node( index );
+    return !ntk.is_constant( n ) && !ntk.is_pi( n );
+  }
+
+  /* number of LUTs that are added to the mapping when the cut is used */
+  uint32_t cut_ref( small_cut const& cut )
+  {
+    uint32_t area{1u};
+    for ( auto l : cut )
+    {
+      if ( map_refs[l]++ == 0u && is_gate( l ) )
+      {
+        area += cut_ref( best_cut( l ) );
+      }
+    }
+    return area;
+  }
+
+  uint32_t cut_deref( small_cut const& cut )
+  {
+    uint32_t area{1u};
+    for ( auto l : cut )
+    {
+      if ( --map_refs[l] == 0u && is_gate( l ) )
+      {
+        area += cut_deref( best_cut( l ) );
+      }
+    }
+    return area;
+  }
+
+  /* references of the current mapping, starting from the outputs; estimated
+     references for area flow are blended with the mapping references */
+  void set_mapping_refs()
+  {
+    std::fill( map_refs.begin(), map_refs.end(), 0u );
+    ntk.foreach_po( [&]( auto const& f ) {
+      map_refs[ntk.node_to_index( ntk.get_node( f ) )]++;
+    } );
+
+    st.num_luts = 0u;
+    st.depth = 0u;
+    for ( auto it = levels.rbegin(); it != levels.rend(); ++it )
+    {
+      for ( auto index : *it )
+      {
+        if ( map_refs[index] == 0u )
+        {
+          continue;
+        }
+        ++st.num_luts;
+        for ( auto l : best_cut( index ) )
+        {
+          map_refs[l]++;
+        }
+      }
+    }
+
+    st.delay = 0u;
+    ntk.foreach_po( [&]( auto const& f ) {
+      st.delay = std::max( st.delay, delays[ntk.node_to_index( ntk.get_node( f ) )] );
+    } );
+    st.depth = st.delay / lut_delay;
+
+    for ( auto i = 0u; i < est_refs.size(); ++i )
+    {
+      est_refs[i] = std::max( 1.0f, ( 2.0f * est_refs[i] + map_refs[i] ) / 3.0f );
+    }
+
+    if ( required_time != 0u )
+    {
+      compute_required_times();
+    }
+  }
+
+  /* required times of the nodes in the current mapping; nodes that are not
+     mapped are not constrained */
+  void compute_required_times()
+  {
+    std::fill( required.begin(), required.end(), std::numeric_limits<uint32_t>::max() );
+    ntk.foreach_po( [&]( auto const& f ) {
+      required[ntk.node_to_index( ntk.get_node( f ) )] = required_time;
+    } );
+
+    for ( auto it = levels.rbegin(); it != levels.rend(); ++it )
+    {
+      for ( auto index : *it )
+      {
+        if ( map_refs[index] == 0u )
+        {
+          continue;
+        }
+        const auto leaf_required = required[index] >= lut_delay ? required[index] - lut_delay : 0u;
+        for ( auto l : best_cut( index ) )
+        {
+          required[l] = std::min( required[l], leaf_required );
+        }
+      }
+    }
+  }
+
+  void derive_mapping()
+  {
+    std::vector<uint32_t> luts;
+    for ( auto const& level : levels )
+    {
+      for ( auto index : level )
+      {
+        if ( map_refs[index] > 0u )
+        {
+          luts.push_back( index );
+        }
+      }
+    }
+
+    std::vector<uint64_t> functions;
+    if constexpr ( StoreFunction )
+    {
+      mockturtle::call_with_stopwatch( st.time_functions, [&]() {
+        functions.resize( luts.size() );
+        pool.parallel_for( 0u, static_cast<uint32_t>( luts.size() ), [&]( uint32_t i, uint32_t ) {
+          functions[i] = cut_function( luts[i], best_cut( luts[i] ) );
+        } );
+      } );
+    }
+
+    ntk.clear_mapping();
+    for ( auto i = 0u; i < luts.size(); ++i )
+    {
+      auto const& cut = best_cut( luts[i] );
+      std::vector<node> leaves;
+      for ( auto l : cut )
+      {
+        leaves.push_back( ntk.index_to_node( l ) );
+      }
+      const auto n = ntk.index_to_node( luts[i] );
+      ntk.add_to_mapping( n, leaves.begin(), leaves.end() );
+
+      if constexpr ( StoreFunction )
+      {
+        kitty::dynamic_truth_table tt( cut.size );
+        kitty::create_from_words( tt, &functions[i], &functions[i] + 1 );
+        ntk.set_cell_function( n, tt );
+      }
+    }
+
+    st.num_cuts = cuts.total_cuts();
+    st.cut_memory = cuts.reserved_bytes();
+  }
+
+  /* simulates the cone of a node down to the leaves of a cut */
+  uint64_t cut_function( uint32_t index, small_cut const& cut ) const
+  {
+    std::vector<std::pair<uint32_t, kitty::static_truth_table<small_cut::max_size>>> values;
+    for ( auto i = 0u; i < cut.size; ++i )
+    {
+      kitty::static_truth_table<small_cut::max_size> tt;
+      kitty::create_nth_var( tt, i );
+      values.emplace_back( cut.leaves[i], tt );
+    }
+
+    const auto value_of = [&]( uint32_t i ) {
+      return std::find_if( values.begin(), values.end(), [&]( auto const& p ) { return p.first == i; } );
+    };
+
+    std::vector<uint32_t> stack{index};
+    while ( !stack.empty() )
+    {
+      const auto i = stack.back();
+      if ( value_of( i ) != values.end() )
+      {
+        stack.pop_back();
+        continue;
+      }
+
+      const auto n = ntk.index_to_node( i );
+      if ( ntk.is_constant( n ) )
+      {
+        kitty::static_truth_table<small_cut::max_size> tt;
+        if ( ntk.constant_value( n ) )
+        {
+          tt = ~tt;
+        }
+        values.emplace_back( i, tt );
+        stack.pop_back();
+        continue;
+      }
+
+      std::vector<kitty::static_truth_table<small_cut::max_size>> fanin_values;
+      bool ready{true};
+      ntk.foreach_fanin( n, [&]( auto const& f ) {
+        const auto c = ntk.node_to_index( ntk.get_node( f ) );
+        const auto it = value_of( c );
+        if ( it == values.end() )
+        {
+          stack.push_back( c );
+          ready = false;
+        }
+        else if ( ready )
+        {
+          fanin_values.push_back( it->second );
+        }
+      } );
+
+      if ( ready )
+      {
+        values.emplace_back( i, ntk.compute( n, fanin_values.begin(), fanin_values.end() ) );
+        stack.pop_back();
+      }
+    }
+
+    auto word = value_of( index )->second._bits;
+    if ( cut.size < small_cut::max_size )
+    {
+      word &= ( UINT64_C( 1 ) << ( 1u << cut.size ) ) - 1u;
+    }
+    return word;
+  }
+
+private:
+  Ntk& ntk;
+  thread_pool& pool;
+  parallel_lut_mapping_params const& ps;
+  parallel_lut_mapping_stats& st;
+  uint32_t cut_size;
+  uint32_t cut_limit;
+  uint32_t lut_delay;
+  uint32_t required_time{0u};
+
+  std::vector<std::vector<uint32_t>> levels;
+  cut_arena<small_cut> cuts;
+  std::vector<uint16_t> best;
+  std::vector<uint32_t> delays;
+  std::vector<uint32_t> required;
+  std::vector<float> flows;
+  std::vector<float> est_refs;
+  std::vector<uint32_t> map_refs;
+
+  /* candidate buffers of each thread, reused for all nodes */
+  std::vector<std::vector<candidate>> buffers;
+};
+
+} // namespace detail
+
+/*! \brief LUT mapping with priority cuts on a thread pool
+
+  Follows mockturtle's `lut_mapping`: cuts are enumerated once, keeping the
+  `cut_limit` cuts with the smallest delay and then the smallest area flow
+  for each node, and the best cut of each node is improved by area-flow and
+  exact-area rounds.  Cut enumeration and area-flow selection process all
+  gates of a level concurrently, since they only depend on gates in smaller
+  levels; exact-area selection is sequential.  The functions of the LUTs
+  (if `StoreFunction` is true) are computed concurrently by simulating their
+  cones.  The mapping does not depend on the number of threads.
+
+  If `ps.delay_oriented` is set, the delay of the first mapping, relaxed by
+  `ps.relax` percent or increased to `ps.target_depth` LUT levels, is the
+  required time of the outputs, and both area-recovery passes only select
+  cuts that meet the required times of the current mapping, such that the
+  final delay does not exceed it.  A target depth below the delay-optimal one
+  cannot be met and is ignored.
+
+  Cut sets are stored in a `cut_arena`.  If `ps.cut_memory` is not 0, gates
+  beyond this limit only keep their best cut (and the trivial cut), such
+  that the network can still be mapped.  These two cuts are stored in a
+  region that is reserved for all nodes up front and counts towards the
+  limit; the limit must be at least `parallel_lut_mapping_min_memory`.
+
+  Cut sizes are limited to 6.  Returns false, without changing the mapping,
+  if the network has gates with more fanins than the cut size.
+*/
+template<class Ntk, bool StoreFunction = false>
+bool parallel_lut_mapping( Ntk& ntk, thread_pool& pool, parallel_lut_mapping_params const& ps = {}, parallel_lut_mapping_stats* pst = nullptr )
+{
+  parallel_lut_mapping_stats st;
+  bool mapped{false};
+  {
+    mockturtle::stopwatch t( st.time_total );
+    detail::parallel_lut_mapping_impl<Ntk, StoreFunction> impl( ntk, pool, ps, st );
+    mapped = impl.run();
+  }
+
+  if ( ps.verbose && mapped )
+  {
+    st.report();
+  }
+
+  if ( pst )
+  {
+    *pst = st;
+  }
+  return mapped;
+}
+
+/*! \brief Smallest cut memory limit of `parallel_lut_mapping` in bytes
+
+  This is the size of the region that keeps the best and the trivial cut of
+  every node when the limit is reached.
+*/
+template<class Ntk>
+uint64_t parallel_lut_mapping_min_memory( Ntk const& ntk )
+{
+  return cut_arena<small_cut>::fallback_bytes( ntk.size(), 2u );
+}
+
+} // namespace cirkit
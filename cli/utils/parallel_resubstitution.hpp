@@ -0,0 +1,1407 @@
+/* CirKit: A circuit toolkit
+ * Copyright (C) 2017-2019  EPFL
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <type_traits>
+#include <vector>
+
+#include <fmt/format.h>
+#include <kitty/bit_operations.hpp>
+#include <kitty/constructors.hpp>
+#include <kitty/dynamic_truth_table.hpp>
+#include <kitty/operators.hpp>
+#include <mockturtle/networks/klut.hpp>
+#include <mockturtle/networks/xag.hpp>
+#include <mockturtle/networks/xmg.hpp>
+#include <mockturtle/utils/stopwatch.hpp>
+
+#include "cancellation.hpp"
+#include "network_cost.hpp"
+#include "output_stream.hpp"
+#include "thread_pool.hpp"
+
+namespace cirkit
+{
+
+struct parallel_resubstitution_params
+{
+  /*! \brief Maximum number of leaves of a reconvergence-driven window */
+  uint32_t max_pis{8u};
+
+  /*! \brief Maximum number of divisors */
+  uint32_t max_divisors{150u};
+
+  /*! \brief Maximum number of gates inserted by a substitution (at most 2) */
+  uint32_t max_inserts{2u};
+
+  /*! \brief Maximum fanout of a node to be considered as root */
+  uint32_t skip_fanout_limit_for_roots{1000u};
+
+  /*! \brief Maximum fanout of a node to be considered as side divisor */
+  uint32_t skip_fanout_limit_for_divisors{100u};
+
+  /*! \brief Maximum fanin size of a new LUT in LUT networks (at most 6) */
+  uint32_t lut_size{6u};
+
+  /*! \brief Cost function (`mc` counts AND gates in AIGs and XAGs) */
+  cost_function cost{cost_function::size};
+
+  /*! \brief Show statistics */
+  bool verbose{false};
+};
+
+struct parallel_resubstitution_stats
+{
+  mockturtle::stopwatch<>::duration time_total{0};
+  mockturtle::stopwatch<>::duration time_evaluation{0};
+  mockturtle::stopwatch<>::duration time_commit{0};
+
+  uint32_t num_roots{0u};
+  uint32_t num_candidates{0u};
+  uint32_t num_rejected{0u};
+  uint32_t num_substitutions{0u};
+
+  void report( std::ostream& os = output_stream() ) const
+  {
+    os << fmt::format( "[i] roots      = {:>8d}\n", num_roots );
+    os << fmt::format( "[i] candidates = {:>8d} ({:>5.2f} secs)\n", num_candidates, mockturtle::to_seconds( time_evaluation ) );
+    os << fmt::format( "[i] rejected   = {:>8d}\n", num_rejected );
+    os << fmt::format( "[i] substitute = {:>8d} ({:>5.2f} secs)\n", num_substitutions, mockturtle::to_seconds( time_commit ) );
+    os << fmt::format( "[i] total time = {:>5.2f} secs\n", mockturtle::to_seconds( time_total ) );
+  }
+};
+
+namespace detail
+{
+
+/* networks in which XOR is a single gate */
+template<class Ntk>
+inline constexpr bool has_xor_gates_v = std::is_same_v<Ntk, mockturtle::xag_network> || std::is_same_v<Ntk, mockturtle::xmg_network>;
+
+/* substitution of a root by a divisor or by up to two new gates over divisor
+   literals (2 * index + complement) */
+struct resubstitution
+{
+  enum class kind : uint8_t
+  {
+    none,
+    divisor,
+    and2,
+    or2,
+    xor2,
+    and3,   /* l0 & l1 & l2 */
+    or3,    /* l0 | l1 | l2 */
+    and_or, /* l0 & ( l1 | l2 ) */
+    or_and  /* l0 | ( l1 & l2 ) */
+  };
+
+  kind type{kind::none};
+  std::array<uint32_t, 3> literals{};
+
+  uint32_t num_literals() const
+  {
+    return type == kind::divisor ? 1u : ( type == kind::and2 || type == kind::or2 || type == kind::xor2 ? 2u : 3u );
+  }
+
+  uint32_t num_inserts() const
+  {
+    return num_literals() - 1u;
+  }
+
+  bool empty() const
+  {
+    return type == kind::none;
+  }
+};
+
+/* substitution of a root by a divisor or by a new LUT over divisors */
+struct lut_resubstitution
+{
+  std::array<uint32_t, 6> divisors{};
+  uint32_t num_divisors{0u};
+
+  /* function of the new LUT, variable i is divisor i */
+  uint64_t function{0u};
+  bool is_lut{false};
+
+  uint32_t num_inserts() const
+  {
+    return is_lut ? 1u : 0u;
+  }
+
+  bool empty() const
+  {
+    return num_divisors == 0u;
+  }
+};
+
+/* fanout lists of all live nodes */
+template<class Ntk>
+struct fanout_lists
+{
+  explicit fanout_lists( Ntk const& ntk )
+      : offsets( ntk.size() + 1u, 0u )
+  {
+    ntk.foreach_gate( [&]( auto const& n ) {
+      if ( ntk.is_dead( n ) )
+      {
+        return;
+      }
+      ntk.foreach_fanin( n, [&]( auto const& f ) {
+        ++offsets[ntk.node_to_index( ntk.get_node( f ) ) + 1u];
+      } );
+    } );
+    for ( auto i = 1u; i < offsets.size(); ++i )
+    {
+      offsets[i] += offsets[i - 1u];
+    }
+    fanouts.resize( offsets.back() );
+    auto pos = offsets;
+    ntk.foreach_gate( [&]( auto const& n ) {
+      if ( ntk.is_dead( n ) )
+      {
+        return;
+      }
+      ntk.foreach_fanin( n, [&]( auto const& f ) {
+        fanouts[pos[ntk.node_to_index( ntk.get_node( f ) )]++] = ntk.node_to_index( n );
+      } );
+    } );
+  }
+
+  template<class Fn>
+  void foreach_fanout( uint32_t index, Fn&& fn ) const
+  {
+    if ( index + 1u >= offsets.size() )
+    {
+      return;
+    }
+    for ( auto i = offsets[index]; i < offsets[index + 1u]; ++i )
+    {
+      fn( fanouts[i] );
+    }
+  }
+
+  std::vector<uint32_t> offsets, fanouts;
+};
+
+/* word-wise comparison of op( a, b ) with target, without temporaries */
+template<class Op>
+bool equals( kitty::dynamic_truth_table const& a, kitty::dynamic_truth_table const& b, kitty::dynamic_truth_table const& target, Op&& op )
+{
+  auto ia = a.cbegin(), ib = b.cbegin();
+  for ( auto it = target.cbegin(); it != target.cend(); ++it, ++ia, ++ib )
+  {
+    if ( op( *ia, *ib ) != *it )
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+template<class Op>
+bool equals( kitty::dynamic_truth_table const& a, kitty::dynamic_truth_table const& b, kitty::dynamic_truth_table const& c, kitty::dynamic_truth_table const& target, Op&& op )
+{
+  auto ia = a.cbegin(), ib = b.cbegin(), ic = c.cbegin();
+  for ( auto it = target.cbegin(); it != target.cend(); ++it, ++ia, ++ib, ++ic )
+  {
+    if ( op( *ia, *ib, *ic ) != *it )
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+/* whether op( a, b ) has no bit in common with ~target */
+template<class Op>
+bool within( kitty::dynamic_truth_table const& a, kitty::dynamic_truth_table const& b, kitty::dynamic_truth_table const& target, Op&& op )
+{
+  auto ia = a.cbegin(), ib = b.cbegin();
+  for ( auto it = target.cbegin(); it != target.cend(); ++it, ++ia, ++ib )
+  {
+    if ( op( *ia, *ib ) & ~*it )
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+/* reconvergence-driven window of a root, its MFFC and divisors, and their
+   simulation over the window leaves; the network is only read */
+template<class Ntk>
+class resubstitution_window
+{
+public:
+  using node = typename Ntk::node;
+  using signal = typename Ntk::signal;
+
+  resubstitution_window( Ntk const& ntk, parallel_resubstitution_params const& ps, level_tracker<Ntk> const& levels )
+      : ntk( ntk ),
+        ps( ps ),
+        levels( levels )
+  {
+  }
+
+protected:
+  /* computes and simulates window, MFFC, and divisors of n, returns the
+     cost of the MFFC */
+  uint32_t compute( node const& n, fanout_lists<Ntk> const& fanouts )
+  {
+    prepare();
+    compute_window( n );
+    const auto mffc_cost = compute_mffc( n );
+    collect_divisors( n, fanouts );
+    simulate();
+    return mffc_cost;
+  }
+
+  /* recomputes window and MFFC of n in the current network and simulates
+     them together with the cones of the given divisors, which must be
+     functions of the window leaves that do not depend on the MFFC; returns
+     the cost of the MFFC */
+  template<class Iterator>
+  std::optional<uint32_t> recompute( node const& n, Iterator begin, Iterator end )
+  {
+    prepare();
+    compute_window( n );
+    const auto mffc_cost = compute_mffc( n );
+
+    divisors.clear();
+    for ( auto it = begin; it != end; ++it )
+    {
+      const auto index = *it;
+      if ( index >= ntk.size() || ntk.is_dead( ntk.index_to_node( index ) ) || !add_cone( index ) )
+      {
+        return std::nullopt;
+      }
+    }
+    simulate();
+    return mffc_cost;
+  }
+
+  /* cost of a gate in the MFFC, 1 or whether it is an AND gate for `mc` */
+  uint32_t gate_cost( node const& n ) const
+  {
+    if constexpr ( mockturtle::has_is_and_v<Ntk> )
+    {
+      if ( ps.cost == cost_function::mc )
+      {
+        return ntk.is_and( n ) ? 1u : 0u;
+      }
+    }
+    return 1u;
+  }
+
+  /* whether substitutions must not increase the level of the root */
+  bool level_constrained() const
+  {
+    return cost_objective{ps.cost}.level_constrained();
+  }
+
+  /* whether a substitution of n with the given gain and level is accepted */
+  bool accepts( node const& n, int32_t gain, uint32_t level ) const
+  {
+    return cost_objective{ps.cost}.accepts( gain, level, levels[n], levels.is_critical( n ) );
+  }
+
+  /* node roles in the current window */
+  static constexpr uint8_t leaf = 1u;
+  static constexpr uint8_t inner = 2u;
+  static constexpr uint8_t mffc = 3u;
+  static constexpr uint8_t side = 4u;
+
+  void prepare()
+  {
+    if ( stamp.size() < ntk.size() )
+    {
+      stamp.resize( ntk.size(), 0u );
+      sorted.resize( ntk.size(), 0u );
+      role.resize( ntk.size(), 0u );
+      slot.resize( ntk.size(), 0u );
+    }
+    ++current;
+  }
+
+  bool in_window( uint32_t index ) const
+  {
+    return stamp[index] == current;
+  }
+
+  void mark( uint32_t index, uint8_t r )
+  {
+    stamp[index] = current;
+    role[index] = r;
+  }
+
+  /* reconvergence-driven window: the leaf that adds the fewest new leaves is
+     expanded, preferring leaves of higher level, as long as there are at
+     most max_pis leaves */
+  void compute_window( node const& n )
+  {
+    leaves.clear();
+    mark( ntk.node_to_index( n ), inner );
+    ntk.foreach_fanin( n, [&]( auto const& f ) {
+      const auto c = ntk.get_node( f );
+      const auto index = ntk.node_to_index( c );
+      if ( !ntk.is_constant( c ) && !in_window( index ) )
+      {
+        mark( index, leaf );
+        leaves.push_back( index );
+      }
+    } );
+
+    while ( true )
+    {
+      auto best = leaves.size();
+      uint32_t best_cost{0u}, best_level{0u};
+      for ( auto i = 0u; i < leaves.size(); ++i )
+      {
+        const auto l = ntk.index_to_node( leaves[i] );
+        if ( ntk.is_pi( l ) )
+        {
+          continue;
+        }
+        uint32_t cost{0u};
+        ntk.foreach_fanin( l, [&]( auto const& f ) {
+          const auto c = ntk.get_node( f );
+          if ( !ntk.is_constant( c ) && !in_window( ntk.node_to_index( c ) ) )
+          {
+            ++cost;
+          }
+        } );
+        const auto level = levels[l];
+        if ( leaves.size() - 1u + cost <= ps.max_pis && ( best == leaves.size() || cost < best_cost || ( cost == best_cost && level > best_level ) ) )
+        {
+          best = i;
+          best_cost = cost;
+          best_level = level;
+        }
+      }
+      if ( best == leaves.size() )
+      {
+        break;
+      }
+
+      const auto index = leaves[best];
+      leaves.erase( leaves.begin() + best );
+      role[index] = inner;
+      ntk.foreach_fanin( ntk.index_to_node( index ), [&]( auto const& f ) {
+        const auto c = ntk.get_node( f );
+        const auto ci = ntk.node_to_index( c );
+        if ( !ntk.is_constant( c ) && !in_window( ci ) )
+        {
+          mark( ci, leaf );
+          leaves.push_back( ci );
+        }
+      } );
+    }
+
+    /* inner nodes in topological order */
+    gates.clear();
+    std::vector<std::pair<uint32_t, bool>> stack{{ntk.node_to_index( n ), false}};
+    while ( !stack.empty() )
+    {
+      const auto [index, done] = stack.back();
+      stack.pop_back();
+      if ( done )
+      {
+        gates.push_back( index );
+        continue;
+      }
+      if ( sorted[index] == current )
+      {
+        continue;
+      }
+      sorted[index] = current;
+      stack.emplace_back( index, true );
+      ntk.foreach_fanin( ntk.index_to_node( index ), [&]( auto const& f ) {
+        const auto ci = ntk.node_to_index( ntk.get_node( f ) );
+        if ( in_window( ci ) && role[ci] == inner && sorted[ci] != current )
+        {
+          stack.emplace_back( ci, false );
+        }
+      } );
+    }
+  }
+
+  /* nodes of the MFFC of n within the window, returns their cost */
+  uint32_t compute_mffc( node const& n )
+  {
+    for ( auto index : gates )
+    {
+      slot[index] = ntk.fanout_size( ntk.index_to_node( index ) );
+    }
+
+    uint32_t cost = gate_cost( n );
+    role[ntk.node_to_index( n )] = mffc;
+    std::vector<uint32_t> stack{ntk.node_to_index( n )};
+    while ( !stack.empty() )
+    {
+      const auto index = stack.back();
+      stack.pop_back();
+      ntk.foreach_fanin( ntk.index_to_node( index ), [&]( auto const& f ) {
+        const auto ci = ntk.node_to_index( ntk.get_node( f ) );
+        if ( in_window( ci ) && role[ci] == inner && --slot[ci] == 0u )
+        {
+          role[ci] = mffc;
+          cost += gate_cost( ntk.index_to_node( ci ) );
+          stack.push_back( ci );
+        }
+      } );
+    }
+    return cost;
+  }
+
+  /* leaves, inner nodes outside the MFFC, and side divisors, which are
+     fanouts of divisors whose fanins are all divisors */
+  void collect_divisors( node const& n, fanout_lists<Ntk> const& fanouts )
+  {
+    divisors = leaves;
+    for ( auto index : gates )
+    {
+      if ( role[index] == inner )
+      {
+        divisors.push_back( index );
+      }
+    }
+
+    const auto is_divisor = [&]( uint32_t index ) {
+      return in_window( index ) && ( role[index] == leaf || role[index] == inner || role[index] == side );
+    };
+
+    for ( auto i = 0u; i < divisors.size() && divisors.size() < ps.max_divisors; ++i )
+    {
+      fanouts.foreach_fanout( divisors[i], [&]( auto index ) {
+        if ( divisors.size() >= ps.max_divisors || in_window( index ) )
+        {
+          return;
+        }
+        const auto d = ntk.index_to_node( index );
+        if ( ntk.is_dead( d ) || ntk.fanout_size( d ) > ps.skip_fanout_limit_for_divisors || ( level_constrained() && levels[d] > levels[n] ) )
+        {
+          return;
+        }
+        bool all_fanins{true};
+        ntk.foreach_fanin( d, [&]( auto const& f ) {
+          const auto c = ntk.get_node( f );
+          all_fanins = all_fanins && ( ntk.is_constant( c ) || is_divisor( ntk.node_to_index( c ) ) );
+        } );
+        if ( all_fanins )
+        {
+          mark( index, side );
+          divisors.push_back( index );
+        }
+      } );
+    }
+  }
+
+  /* adds the cone of a divisor of a substitution to the side divisors; the
+     cone must end in the window leaves and must not contain MFFC nodes */
+  bool add_cone( uint32_t root )
+  {
+    const auto limit = std::max( ps.max_divisors, 16u );
+    std::vector<std::pair<uint32_t, bool>> stack{{root, false}};
+    uint32_t count{0u};
+    while ( !stack.empty() )
+    {
+      const auto [index, done] = stack.back();
+      stack.pop_back();
+      if ( done )
+      {
+        mark( index, side );
+        divisors.push_back( index );
+        continue;
+      }
+      const auto d = ntk.index_to_node( index );
+      if ( ntk.is_constant( d ) )
+      {
+        continue;
+      }
+      if ( in_window( index ) )
+      {
+        if ( role[index] == mffc )
+        {
+          return false;
+        }
+        continue;
+      }
+      if ( ntk.is_pi( d ) || ++count > limit )
+      {
+        return false;
+      }
+      stack.emplace_back( index, true );
+      ntk.foreach_fanin( d, [&]( auto const& f ) {
+        stack.emplace_back( ntk.node_to_index( ntk.get_node( f ) ), false );
+      } );
+    }
+    return true;
+  }
+
+  /* truth tables over the leaves of the window nodes and divisors */
+  void simulate()
+  {
+    const auto num_vars = static_cast<uint32_t>( leaves.size() );
+    tts.clear();
+    ctts.clear();
+
+    const auto add = [&]( uint32_t index, kitty::dynamic_truth_table const& tt ) {
+      slot[index] = static_cast<uint32_t>( tts.size() );
+      tts.push_back( tt );
+      ctts.push_back( ~tt );
+    };
+    const auto compute = [&]( uint32_t index ) {
+      const auto m = ntk.index_to_node( index );
+      fanin_tts.clear();
+      ntk.foreach_fanin( m, [&]( auto const& f ) {
+        const auto c = ntk.get_node( f );
+        if ( ntk.is_constant( c ) )
+        {
+          fanin_tts.emplace_back( num_vars );
+          if ( ntk.constant_value( c ) )
+          {
+            fanin_tts.back() = ~fanin_tts.back();
+          }
+        }
+        else
+        {
+          fanin_tts.push_back( tts[slot[ntk.node_to_index( c )]] );
+        }
+      } );
+      add( index, ntk.compute( m, fanin_tts.begin(), fanin_tts.end() ) );
+    };
+
+    for ( auto i = 0u; i < num_vars; ++i )
+    {
+      kitty::dynamic_truth_table tt( num_vars );
+      kitty::create_nth_var( tt, i );
+      add( leaves[i], tt );
+    }
+    for ( auto index : gates )
+    {
+      compute( index );
+    }
+    for ( auto index : divisors )
+    {
+      if ( role[index] == side )
+      {
+        compute( index );
+      }
+    }
+  }
+
+  kitty::dynamic_truth_table const& literal_tt( uint32_t literal ) const
+  {
+    const auto s = slot[literal >> 1u];
+    return ( literal & 1u ) ? ctts[s] : tts[s];
+  }
+
+  uint32_t literal_level( uint32_t literal ) const
+  {
+    return levels[ntk.index_to_node( literal >> 1u )];
+  }
+
+protected:
+  Ntk const& ntk;
+  parallel_resubstitution_params const& ps;
+  level_tracker<Ntk> const& levels;
+
+  uint32_t current{0u};
+  std::vector<uint32_t> stamp, sorted, slot;
+  std::vector<uint8_t> role;
+
+  std::vector<uint32_t> leaves, gates, divisors;
+  std::vector<kitty::dynamic_truth_table> tts, ctts, fanin_tts;
+};
+
+/* substitutions by a divisor or by up to two AND, OR, or XOR gates over
+   divisor literals */
+template<class Ntk>
+class resubstitution_worker : public resubstitution_window<Ntk>
+{
+  using base = resubstitution_window<Ntk>;
+  using base::accepts;
+  using base::ctts;
+  using base::divisors;
+  using base::levels;
+  using base::literal_level;
+  using base::literal_tt;
+  using base::ntk;
+  using base::ps;
+  using base::slot;
+  using base::tts;
+
+public:
+  using node = typename Ntk::node;
+  using signal = typename Ntk::signal;
+  using candidate = resubstitution;
+
+  using base::base;
+
+  /*! \brief Best substitution of n (`num_candidates` counts all found ones) */
+  resubstitution evaluate( node const& n, fanout_lists<Ntk> const& fanouts, uint32_t& num_candidates )
+  {
+    const auto mffc_cost = this->compute( n, fanouts );
+    return search( n, mffc_cost, num_candidates );
+  }
+
+  /*! \brief Gain of a substitution found in an earlier state of the network, if it is accepted */
+  std::optional<int32_t> validate( node const& n, resubstitution const& sub )
+  {
+    std::array<uint32_t, 3> indexes;
+    for ( auto i = 0u; i < sub.num_literals(); ++i )
+    {
+      indexes[i] = sub.literals[i] >> 1u;
+    }
+
+    const auto mffc_cost = this->recompute( n, indexes.begin(), indexes.begin() + sub.num_literals() );
+    if ( !mffc_cost || !realizes( sub, tts[slot[ntk.node_to_index( n )]] ) || !accepts( n, gain( *mffc_cost, sub ), level( sub ) ) )
+    {
+      return std::nullopt;
+    }
+    return gain( *mffc_cost, sub );
+  }
+
+  /*! \brief Creates the gates of a substitution */
+  static signal build( Ntk& ntk, resubstitution const& sub )
+  {
+    std::array<signal, 3> s;
+    for ( auto i = 0u; i < sub.num_literals(); ++i )
+    {
+      s[i] = ntk.make_signal( ntk.index_to_node( sub.literals[i] >> 1u ) );
+      if ( sub.literals[i] & 1u )
+      {
+        s[i] = ntk.create_not( s[i] );
+      }
+    }
+
+    using kind = resubstitution::kind;
+    switch ( sub.type )
+    {
+    default:
+    case kind::divisor:
+      return s[0];
+    case kind::and2:
+      return ntk.create_and( s[0], s[1] );
+    case kind::or2:
+      return ntk.create_or( s[0], s[1] );
+    case kind::xor2:
+      if constexpr ( has_xor_gates_v<Ntk> )
+      {
+        return ntk.create_xor( s[0], s[1] );
+      }
+      return s[0];
+    case kind::and3:
+      return ntk.create_and( ntk.create_and( s[0], s[1] ), s[2] );
+    case kind::or3:
+      return ntk.create_or( ntk.create_or( s[0], s[1] ), s[2] );
+    case kind::and_or:
+      return ntk.create_and( s[0], ntk.create_or( s[1], s[2] ) );
+    case kind::or_and:
+      return ntk.create_or( s[0], ntk.create_and( s[1], s[2] ) );
+    }
+  }
+
+private:
+  /* cost of the MFFC minus the cost of the new gates, XOR gates are free for `mc` */
+  int32_t gain( uint32_t mffc_cost, resubstitution const& sub ) const
+  {
+    const auto inserted = ps.cost == cost_function::mc && sub.type == resubstitution::kind::xor2 ? 0u : sub.num_inserts();
+    return static_cast<int32_t>( mffc_cost ) - static_cast<int32_t>( inserted );
+  }
+
+  /* whether substitutions with `num_inserts` new gates can be accepted */
+  bool may_accept( node const& n, uint32_t mffc_cost, uint32_t num_inserts ) const
+  {
+    if ( ps.cost == cost_function::depth && levels.is_critical( n ) )
+    {
+      return true;
+    }
+    const auto min_cost = ps.cost == cost_function::mc && num_inserts == 1u && has_xor_gates_v<Ntk> ? 0u : num_inserts;
+    return mffc_cost > min_cost;
+  }
+
+  /* level of the root after the substitution */
+  uint32_t level( resubstitution const& sub ) const
+  {
+    const auto l0 = literal_level( sub.literals[0] );
+    switch ( sub.num_literals() )
+    {
+    case 1u:
+      return l0;
+    case 2u:
+      return std::max( l0, literal_level( sub.literals[1] ) ) + 1u;
+    default:
+    {
+      const auto inner_level = std::max( l0, literal_level( sub.literals[1] ) ) + 1u;
+      if ( sub.type == resubstitution::kind::and3 || sub.type == resubstitution::kind::or3 )
+      {
+        return std::max( inner_level, literal_level( sub.literals[2] ) ) + 1u;
+      }
+      return std::max( l0, std::max( literal_level( sub.literals[1] ), literal_level( sub.literals[2] ) ) + 1u ) + 1u;
+    }
+    }
+  }
+
+  bool realizes( resubstitution const& sub, kitty::dynamic_truth_table const& target ) const
+  {
+    const auto& a = literal_tt( sub.literals[0] );
+    const auto& b = sub.num_literals() > 1u ? literal_tt( sub.literals[1] ) : a;
+    const auto& c = sub.num_literals() > 2u ? literal_tt( sub.literals[2] ) : a;
+
+    using kind = resubstitution::kind;
+    switch ( sub.type )
+    {
+    case kind::divisor:
+      return a == target;
+    case kind::and2:
+      return equals( a, b, target, []( auto x, auto y ) { return x & y; } );
+    case kind::or2:
+      return equals( a, b, target, []( auto x, auto y ) { return x | y; } );
+    case kind::xor2:
+      return has_xor_gates_v<Ntk> && equals( a, b, target, []( auto x, auto y ) { return x ^ y; } );
+    case kind::and3:
+      return equals( a, b, c, target, []( auto x, auto y, auto z ) { return x & y & z; } );
+    case kind::or3:
+      return equals( a, b, c, target, []( auto x, auto y, auto z ) { return x | y | z; } );
+    case kind::and_or:
+      return equals( a, b, c, target, []( auto x, auto y, auto z ) { return x & ( y | z ); } );
+    case kind::or_and:
+      return equals( a, b, c, target, []( auto x, auto y, auto z ) { return x | ( y & z ); } );
+    default:
+      return false;
+    }
+  }
+
+  /* 0-resubstitution, then substitutions with one and with two new gates;
+     returns the first substitution with the fewest new gates */
+  resubstitution search( node const& n, uint32_t mffc_cost, uint32_t& num_candidates )
+  {
+    using kind = resubstitution::kind;
+
+    const auto n_index = ntk.node_to_index( n );
+    const auto& target = tts[slot[n_index]];
+
+    resubstitution sub;
+    const auto accept = [&]( kind type, std::array<uint32_t, 3> const& literals ) {
+      resubstitution cand{type, literals};
+      if ( !accepts( n, gain( mffc_cost, cand ), level( cand ) ) )
+      {
+        return false;
+      }
+      /* the gate of the root itself */
+      if ( cand.num_inserts() == 1u && is_root_gate( n, cand ) )
+      {
+        return false;
+      }
+      ++num_candidates;
+      sub = cand;
+      return true;
+    };
+
+    for ( auto d : divisors )
+    {
+      const auto l = 2u * d;
+      if ( tts[slot[d]] == target && accept( kind::divisor, {l, 0u, 0u} ) )
+      {
+        return sub;
+      }
+      if ( ctts[slot[d]] == target && accept( kind::divisor, {l | 1u, 0u, 0u} ) )
+      {
+        return sub;
+      }
+    }
+
+    if ( ps.max_inserts < 1u || !may_accept( n, mffc_cost, 1u ) )
+    {
+      return sub;
+    }
+
+    /* literals that contain the target, and that are contained in it */
+    std::vector<uint32_t> pos, neg;
+    const auto ones = []( auto x, auto ) { return x; };
+    for ( auto d : divisors )
+    {
+      for ( auto c = 0u; c < 2u; ++c )
+      {
+        const auto l = 2u * d + c;
+        if ( within( target, target, literal_tt( l ), ones ) )
+        {
+          pos.push_back( l );
+        }
+        if ( within( literal_tt( l ), literal_tt( l ), target, ones ) )
+        {
+          neg.push_back( l );
+        }
+      }
+    }
+
+    const auto and_op = []( auto x, auto y ) { return x & y; };
+    const auto or_op = []( auto x, auto y ) { return x | y; };
+    for ( auto i = 0u; i < pos.size(); ++i )
+    {
+      for ( auto j = i + 1u; j < pos.size(); ++j )
+      {
+        if ( equals( literal_tt( pos[i] ), literal_tt( pos[j] ), target, and_op ) && accept( kind::and2, {pos[i], pos[j], 0u} ) )
+        {
+          return sub;
+        }
+      }
+    }
+    for ( auto i = 0u; i < neg.size(); ++i )
+    {
+      for ( auto j = i + 1u; j < neg.size(); ++j )
+      {
+        if ( equals( literal_tt( neg[i] ), literal_tt( neg[j] ), target, or_op ) && accept( kind::or2, {neg[i], neg[j], 0u} ) )
+        {
+          return sub;
+        }
+      }
+    }
+    if constexpr ( has_xor_gates_v<Ntk> )
+    {
+      const auto xor_op = []( auto x, auto y ) { return x ^ y; };
+      for ( auto i = 0u; i < divisors.size(); ++i )
+      {
+        for ( auto j = i + 1u; j < divisors.size(); ++j )
+        {
+          const auto& a = tts[slot[divisors[i]]];
+          const auto& b = tts[slot[divisors[j]]];
+          if ( equals( a, b, target, xor_op ) && accept( kind::xor2, {2u * divisors[i], 2u * divisors[j], 0u} ) )
+          {
+            return sub;
+          }
+          if ( equals( a, b, ctts[slot[n_index]], xor_op ) && accept( kind::xor2, {2u * divisors[i] + 1u, 2u * divisors[j], 0u} ) )
+          {
+            return sub;
+          }
+        }
+      }
+    }
+
+    if ( ps.max_inserts < 2u || !may_accept( n, mffc_cost, 2u ) )
+    {
+      return sub;
+    }
+
+    /* unate literals are few in practice, the limits bound the worst case */
+    pos.resize( std::min<std::size_t>( pos.size(), max_unate ) );
+    neg.resize( std::min<std::size_t>( neg.size(), max_unate ) );
+
+    const auto and3_op = []( auto x, auto y, auto z ) { return x & y & z; };
+    const auto or3_op = []( auto x, auto y, auto z ) { return x | y | z; };
+    for ( auto i = 0u; i < pos.size(); ++i )
+    {
+      for ( auto j = i + 1u; j < pos.size(); ++j )
+      {
+        for ( auto k = j + 1u; k < pos.size(); ++k )
+        {
+          if ( equals( literal_tt( pos[i] ), literal_tt( pos[j] ), literal_tt( pos[k] ), target, and3_op ) && accept( kind::and3, {pos[i], pos[j], pos[k]} ) )
+          {
+            return sub;
+          }
+        }
+      }
+    }
+    for ( auto i = 0u; i < neg.size(); ++i )
+    {
+      for ( auto j = i + 1u; j < neg.size(); ++j )
+      {
+        for ( auto k = j + 1u; k < neg.size(); ++k )
+        {
+          if ( equals( literal_tt( neg[i] ), literal_tt( neg[j] ), literal_tt( neg[k] ), target, or3_op ) && accept( kind::or3, {neg[i], neg[j], neg[k]} ) )
+          {
+            return sub;
+          }
+        }
+      }
+    }
+
+    /* target = l0 & ( l1 | l2 ), in which l1 & l0 and l2 & l0 are contained
+       in the target, and dually target = l0 | ( l1 & l2 ) */
+    std::vector<uint32_t> cands;
+    for ( auto l0 : pos )
+    {
+      cands.clear();
+      for ( auto d : divisors )
+      {
+        for ( auto c = 0u; c < 2u && cands.size() < max_unate; ++c )
+        {
+          if ( within( literal_tt( l0 ), literal_tt( 2u * d + c ), target, and_op ) )
+          {
+            cands.push_back( 2u * d + c );
+          }
+        }
+      }
+      for ( auto i = 0u; i < cands.size(); ++i )
+      {
+        for ( auto j = i + 1u; j < cands.size(); ++j )
+        {
+          if ( equals( literal_tt( l0 ), literal_tt( cands[i] ), literal_tt( cands[j] ), target, []( auto x, auto y, auto z ) { return x & ( y | z ); } ) && accept( kind::and_or, {l0, cands[i], cands[j]} ) )
+          {
+            return sub;
+          }
+        }
+      }
+    }
+    const auto& ctarget = ctts[slot[n_index]];
+    for ( auto l0 : neg )
+    {
+      cands.clear();
+      for ( auto d : divisors )
+      {
+        for ( auto c = 0u; c < 2u && cands.size() < max_unate; ++c )
+        {
+          /* target is contained in l0 | l */
+          if ( within( literal_tt( l0 ^ 1u ), literal_tt( ( 2u * d + c ) ^ 1u ), ctarget, and_op ) )
+          {
+            cands.push_back( 2u * d + c );
+          }
+        }
+      }
+      for ( auto i = 0u; i < cands.size(); ++i )
+      {
+        for ( auto j = i + 1u; j < cands.size(); ++j )
+        {
+          if ( equals( literal_tt( l0 ), literal_tt( cands[i] ), literal_tt( cands[j] ), target, []( auto x, auto y, auto z ) { return x | ( y & z ); } ) && accept( kind::or_and, {l0, cands[i], cands[j]} ) )
+          {
+            return sub;
+          }
+        }
+      }
+    }
+
+    return sub;
+  }
+
+  /* whether a substitution with one gate would rebuild the gate of the root */
+  bool is_root_gate( node const& n, resubstitution const& sub ) const
+  {
+    uint32_t matches{0u}, fanins{0u};
+    ntk.foreach_fanin( n, [&]( auto const& f ) {
+      const auto c = ntk.get_node( f );
+      if ( ntk.is_constant( c ) )
+      {
+        return;
+      }
+      ++fanins;
+      const auto index = ntk.node_to_index( c );
+      if ( ( sub.literals[0] >> 1u ) == index || ( sub.literals[1] >> 1u ) == index )
+      {
+        ++matches;
+      }
+    } );
+    return fanins == 2u && matches == 2u;
+  }
+
+private:
+  static constexpr std::size_t max_unate = 50u;
+};
+
+/* substitutions by a divisor or by a new LUT with at most `lut_size` fanins;
+   a LUT over divisors S realizes the root, if no two window minterms agree on
+   all divisors in S but differ in the root, and S is selected greedily by the
+   number of such minterm pairs that remain */
+template<class Ntk>
+class lut_resubstitution_worker : public resubstitution_window<Ntk>
+{
+  using base = resubstitution_window<Ntk>;
+  using base::accepts;
+  using base::divisors;
+  using base::level_constrained;
+  using base::levels;
+  using base::ntk;
+  using base::ps;
+  using base::slot;
+  using base::tts;
+
+public:
+  using node = typename Ntk::node;
+  using signal = typename Ntk::signal;
+  using candidate = lut_resubstitution;
+
+  using base::base;
+
+  /*! \brief Best substitution of n (`num_candidates` counts all found ones) */
+  lut_resubstitution evaluate( node const& n, fanout_lists<Ntk> const& fanouts, uint32_t& num_candidates )
+  {
+    const auto mffc_cost = this->compute( n, fanouts );
+    const auto& target = tts[slot[ntk.node_to_index( n )]];
+
+    for ( auto d : divisors )
+    {
+      if ( tts[slot[d]] == target && ( !level_constrained() || levels[ntk.index_to_node( d )] <= levels[n] ) )
+      {
+        ++num_candidates;
+        lut_resubstitution sub;
+        sub.divisors[0] = d;
+        sub.num_divisors = 1u;
+        return sub;
+      }
+    }
+
+    /* a new LUT only reduces the size if it replaces at least two, or the
+       depth if the root is critical */
+    if ( mffc_cost < 2u && !( ps.cost == cost_function::depth && levels.is_critical( n ) ) )
+    {
+      return {};
+    }
+
+    auto sub = select_support( n, target );
+    if ( !sub.empty() )
+    {
+      ++num_candidates;
+    }
+    return sub;
+  }
+
+  /*! \brief Gain of a substitution found in an earlier state of the network, if it is accepted */
+  std::optional<int32_t> validate( node const& n, lut_resubstitution const& sub )
+  {
+    const auto mffc_cost = this->recompute( n, sub.divisors.begin(), sub.divisors.begin() + sub.num_divisors );
+    if ( !mffc_cost )
+    {
+      return std::nullopt;
+    }
+
+    const auto& target = tts[slot[ntk.node_to_index( n )]];
+    if ( !sub.is_lut )
+    {
+      if ( tts[slot[sub.divisors[0]]] != target )
+      {
+        return std::nullopt;
+      }
+    }
+    else
+    {
+      for ( auto m = 0u; m < target.num_bits(); ++m )
+      {
+        if ( ( ( sub.function >> minterm_class( sub, m ) ) & 1u ) != kitty::get_bit( target, m ) )
+        {
+          return std::nullopt;
+        }
+      }
+    }
+
+    uint32_t level{0u};
+    for ( auto i = 0u; i < sub.num_divisors; ++i )
+    {
+      level = std::max( level, levels[ntk.index_to_node( sub.divisors[i] )] + sub.num_inserts() );
+    }
+    const auto gain = static_cast<int32_t>( *mffc_cost ) - static_cast<int32_t>( sub.num_inserts() );
+    if ( !accepts( n, gain, level ) )
+    {
+      return std::nullopt;
+    }
+    return gain;
+  }
+
+  /*! \brief Creates the LUT of a substitution */
+  static signal build( Ntk& ntk, lut_resubstitution const& sub )
+  {
+    std::vector<signal> children;
+    for ( auto i = 0u; i < sub.num_divisors; ++i )
+    {
+      children.push_back( ntk.make_signal( ntk.index_to_node( sub.divisors[i] ) ) );
+    }
+    if ( !sub.is_lut )
+    {
+      return children.front();
+    }
+
+    kitty::dynamic_truth_table function( sub.num_divisors );
+    kitty::create_from_words( function, &sub.function, &sub.function + 1 );
+    return ntk.create_node( children, function );
+  }
+
+private:
+  /* values of the divisors of a substitution in minterm m */
+  uint32_t minterm_class( lut_resubstitution const& sub, uint32_t m ) const
+  {
+    uint32_t c{0u};
+    for ( auto i = 0u; i < sub.num_divisors; ++i )
+    {
+      c |= static_cast<uint32_t>( kitty::get_bit( tts[slot[sub.divisors[i]]], m ) ) << i;
+    }
+    return c;
+  }
+
+  lut_resubstitution select_support( node const& n, kitty::dynamic_truth_table const& target )
+  {
+    const auto num_minterms = static_cast<uint32_t>( target.num_bits() );
+    const auto lut_size = std::min( ps.lut_size, 6u );
+
+    lut_resubstitution sub;
+    sub.is_lut = true;
+    classes.assign( num_minterms, 0u );
+
+    const auto count_conflicts = [&]( uint32_t num_classes, auto&& class_of ) {
+      ones.assign( num_classes, 0u );
+      zeros.assign( num_classes, 0u );
+      for ( auto m = 0u; m < num_minterms; ++m )
+      {
+        ++( kitty::get_bit( target, m ) ? ones : zeros )[class_of( m )];
+      }
+      uint64_t conflicts{0u};
+      for ( auto c = 0u; c < num_classes; ++c )
+      {
+        conflicts += static_cast<uint64_t>( ones[c] ) * zeros[c];
+      }
+      return conflicts;
+    };
+
+    auto conflicts = count_conflicts( 1u, []( auto ) { return 0u; } );
+    while ( conflicts > 0u )
+    {
+      if ( sub.num_divisors == lut_size )
+      {
+        return {};
+      }
+
+      const auto shift = sub.num_divisors;
+      auto best = divisors.size();
+      auto best_conflicts = conflicts;
+      for ( auto i = 0u; i < divisors.size(); ++i )
+      {
+        const auto d = divisors[i];
+        if ( ( level_constrained() && levels[ntk.index_to_node( d )] >= levels[n] ) ||
+             std::find( sub.divisors.begin(), sub.divisors.begin() + sub.num_divisors, d ) != sub.divisors.begin() + sub.num_divisors )
+        {
+          continue;
+        }
+
+        const auto& tt = tts[slot[d]];
+        const auto c = count_conflicts( 2u << shift, [&]( auto m ) { return classes[m] | ( static_cast<uint32_t>( kitty::get_bit( tt, m ) ) << shift ); } );
+        if ( c < best_conflicts )
+        {
+          best = i;
+          best_conflicts = c;
+        }
+      }
+      if ( best == divisors.size() )
+      {
+        return {};
+      }
+
+      const auto& tt = tts[slot[divisors[best]]];
+      for ( auto m = 0u; m < num_minterms; ++m )
+      {
+        classes[m] |= static_cast<uint32_t>( kitty::get_bit( tt, m ) ) << shift;
+      }
+      sub.divisors[sub.num_divisors++] = divisors[best];
+      conflicts = best_conflicts;
+    }
+
+    /* a root without conflicts is constant */
+    if ( sub.num_divisors == 0u )
+    {
+      return {};
+    }
+
+    for ( auto m = 0u; m < num_minterms; ++m )
+    {
+      if ( kitty::get_bit( target, m ) )
+      {
+        sub.function |= uint64_t( 1 ) << classes[m];
+      }
+    }
+    return sub;
+  }
+
+private:
+  std::vector<uint32_t> classes, ones, zeros;
+};
+
+template<class Ntk>
+using resubstitution_worker_t = std::conditional_t<std::is_same_v<Ntk, mockturtle::klut_network>, lut_resubstitution_worker<Ntk>, resubstitution_worker<Ntk>>;
+
+} // namespace detail
+
+/*! \brief Resubstitution with parallel window and divisor evaluation
+
+  A pass works in two phases:
+
+  1. Each gate is evaluated independently on the unchanged network: a
+     reconvergence-driven window with at most `max_pis` leaves is computed,
+     the MFFC of the gate within the window is collected, and divisors (the
+     window nodes outside the MFFC and side divisors in their fanout) are
+     simulated over the leaves.  The search tries a divisor, then one gate,
+     then two gates over divisor literals (AND, OR, and XOR for XAGs and
+     XMGs), and keeps the first substitution with the fewest new gates.  In
+     LUT networks, the search tries a divisor, then a single new LUT with
+     at most `lut_size` divisors as fanins, which merges the LUTs of the
+     MFFC.
+  2. Substitutions are committed sequentially in the order of the gates.
+     Since earlier substitutions may have changed the window, each one is
+     validated first: the window and the MFFC are recomputed, the divisors
+     must still be functions of the leaves outside the MFFC, and the
+     substitution must realize the function of the root and be accepted by
+     the cost function.
+
+  The result depends neither on the number of threads nor on scheduling.
+  The network is not cleaned up.
+*/
+template<class Ntk>
+class parallel_resubstitution_impl
+{
+public:
+  using node = typename Ntk::node;
+  using signal = typename Ntk::signal;
+  using worker_t = detail::resubstitution_worker_t<Ntk>;
+  using candidate = typename worker_t::candidate;
+
+  parallel_resubstitution_impl( Ntk& ntk, thread_pool& pool, parallel_resubstitution_params const& ps, parallel_resubstitution_stats& st )
+      : ntk( ntk ),
+        pool( pool ),
+        ps( ps ),
+        st( st ),
+        levels( ntk )
+  {
+    /* the last worker validates substitutions when committing */
+    for ( auto i = 0u; i <= pool.num_threads(); ++i )
+    {
+      workers.emplace_back( std::make_unique<worker_t>( ntk, ps, levels ) );
+    }
+  }
+
+  /*! \brief Resubstitutes all gates, returns the number of substitutions */
+  uint32_t run()
+  {
+    levels.recompute();
+
+    std::vector<uint32_t> roots;
+    ntk.foreach_gate( [&]( auto const& n ) {
+      const auto fanout = ntk.fanout_size( n );
+      if ( !ntk.is_dead( n ) && fanout > 0u && fanout <= ps.skip_fanout_limit_for_roots )
+      {
+        roots.push_back( ntk.node_to_index( n ) );
+      }
+    } );
+    st.num_roots += static_cast<uint32_t>( roots.size() );
+
+    std::vector<candidate> best( roots.size() );
+    std::vector<uint32_t> num_candidates( pool.num_threads(), 0u );
+
+    mockturtle::call_with_stopwatch( st.time_evaluation, [&]() {
+      const detail::fanout_lists<Ntk> fanouts( ntk );
+      pool.parallel_for( 0u, static_cast<uint32_t>( roots.size() ), [&]( uint32_t i, uint32_t tid ) {
+        if ( !is_cancelled() )
+        {
+          best[i] = workers[tid]->evaluate( ntk.index_to_node( roots[i] ), fanouts, num_candidates[tid] );
+        }
+      } );
+    } );
+
+    for ( auto n : num_candidates )
+    {
+      st.num_candidates += n;
+    }
+
+    uint32_t substitutions{0u};
+    mockturtle::call_with_stopwatch( st.time_commit, [&]() {
+      auto& w = *workers.back();
+      for ( auto i = 0u; i < roots.size(); ++i )
+      {
+        if ( is_cancelled() )
+        {
+          break;
+        }
+
+        const auto& sub = best[i];
+        if ( sub.empty() )
+        {
+          continue;
+        }
+
+        const auto n = ntk.index_to_node( roots[i] );
+        if ( ntk.is_dead( n ) || ntk.fanout_size( n ) == 0u )
+        {
+          continue;
+        }
+
+        if ( !w.validate( n, sub ) )
+        {
+          ++st.num_rejected;
+          continue;
+        }
+
+        const auto f = worker_t::build( ntk, sub );
+        levels.update();
+        if ( ntk.get_node( f ) == n )
+        {
+          ++st.num_rejected;
+          continue;
+        }
+        ntk.substitute_node( n, f );
+        ++substitutions;
+      }
+    } );
+
+    st.num_substitutions += substitutions;
+    return substitutions;
+  }
+
+private:
+  Ntk& ntk;
+  thread_pool& pool;
+  parallel_resubstitution_params const& ps;
+  parallel_resubstitution_stats& st;
+  level_tracker<Ntk> levels;
+  std::vector<std::unique_ptr<worker_t>> workers;
+};
+
+/*! \brief Runs one pass of parallel resubstitution (see `parallel_resubstitution_impl`)
+
+  The network is not cleaned up.
+*/
+template<class Ntk>
+void parallel_resubstitution( Ntk& ntk, thread_pool& pool, parallel_resubstitution_params const& ps = {}, parallel_resubstitution_stats* pst = nullptr )
+{
+  parallel_resubstitution_stats st;
+  {
+    mockturtle::stopwatch t( st.time_total );
+    parallel_resubstitution_impl<Ntk> impl( ntk, pool, ps, st );
+    impl.run();
+  }
+
+  if ( ps.verbose )
+  {
+    st.report();
+  }
+
+  if ( pst )
+  {
+    *pst = st;
+  }
+}
+
+} // namespace cirkit
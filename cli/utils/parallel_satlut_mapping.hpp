@@ -0,0 +1,551 @@
+/* CirKit: A circuit toolkit
+ * Copyright (C) 2017-2019  EPFL
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <numeric>
+#include <unordered_map>
+#include <vector>
+
+#include <fmt/format.h>
+#include <kitty/dynamic_truth_table.hpp>
+#include <mockturtle/algorithms/satlut_mapping.hpp>
+#include <mockturtle/utils/stopwatch.hpp>
+#include <mockturtle/views/mapping_view.hpp>
+
+#include "cancellation.hpp"
+#include "cut_arena.hpp"
+#include "output_stream.hpp"
+#include "partitioning.hpp"
+#include "thread_pool.hpp"
+
+namespace cirkit
+{
+
+struct parallel_satlut_mapping_params
+{
+  /*! \brief Maximum number of cells per window */
+  uint32_t window_size{32u};
+
+  /*! \brief Parameters of SAT-based mapping in each window */
+  mockturtle::satlut_mapping_params satlut_ps;
+
+  /*! \brief Show statistics */
+  bool verbose{false};
+};
+
+struct satlut_window_stats
+{
+  uint32_t cells_before{0u};
+  uint32_t cells_after{0u};
+  mockturtle::stopwatch<>::duration time_sat{0};
+
+  /*! \brief Estimated memory of the cut sets of the window in bytes */
+  uint64_t cut_memory{0u};
+
+  /*! \brief Whether the window was solved (windows that share logic with other windows or whose
+             gates are merged by strashing are skipped) */
+  bool solved{false};
+
+  /*! \brief Whether the improved cover was merged into the mapping */
+  bool committed{false};
+};
+
+struct parallel_satlut_mapping_stats
+{
+  mockturtle::stopwatch<>::duration time_total{0};
+  mockturtle::stopwatch<>::duration time_windows{0};
+  mockturtle::stopwatch<>::duration time_commit{0};
+
+  uint32_t cells_before{0u};
+  uint32_t cells_after{0u};
+  uint32_t num_committed{0u};
+
+  /*! \brief Estimated memory of the cut sets of the windows that are solved at the same time in bytes,
+             i.e., of the largest windows, one per thread */
+  uint64_t cut_memory{0u};
+
+  /*! \brief Statistics of each window, in the order of the commits */
+  std::vector<satlut_window_stats> windows;
+
+  void report( std::ostream& os = output_stream() ) const
+  {
+    const auto solved = std::count_if( windows.begin(), windows.end(), []( auto const& w ) { return w.solved; } );
+    os << fmt::format( "[i] windows    = {:>8d} ({} solved)\n", windows.size(), solved );
+    os << fmt::format( "[i] improved   = {:>8d}\n", num_committed );
+    os << fmt::format( "[i] cells      = {:>8d} -> {}\n", cells_before, cells_after );
+    os << fmt::format( "[i] cut memory = {:>8.2f} MB\n", cut_memory / 1048576.0 );
+    os << fmt::format( "[i] solving    = {:>5.2f} secs\n", mockturtle::to_seconds( time_windows ) );
+    os << fmt::format( "[i] commit     = {:>5.2f} secs\n", mockturtle::to_seconds( time_commit ) );
+    os << fmt::format( "[i] total time = {:>5.2f} secs\n", mockturtle::to_seconds( time_total ) );
+  }
+};
+
+namespace detail
+{
+
+template<class Ntk, bool StoreFunction>
+class parallel_satlut_mapping_impl
+{
+public:
+  using node = typename Ntk::node;
+  using signal = typename Ntk::signal;
+  using base_ntk = typename Ntk::base_type;
+
+  static constexpr auto none = std::numeric_limits<uint32_t>::max();
+
+  parallel_satlut_mapping_impl( Ntk& ntk, thread_pool& pool, parallel_satlut_mapping_params const& ps, parallel_satlut_mapping_stats& st )
+      : ntk( ntk ),
+        pool( pool ),
+        ps( ps ),
+        st( st )
+  {
+  }
+
+  void run()
+  {
+    collect_cells();
+    partition_cells();
+    st.cells_before = static_cast<uint32_t>( roots.size() );
+
+    std::vector<window_result> results( windows.size() );
+    for ( auto i = 0u; i < windows.size(); ++i )
+    {
+      results[i].st.cells_before = static_cast<uint32_t>( window_cells[i].size() );
+    }
+
+    mockturtle::call_with_stopwatch( st.time_windows, [&]() {
+      pool.parallel_for( 0u, static_cast<uint32_t>( windows.size() ), [&]( uint32_t i, uint32_t ) {
+        if ( !is_cancelled() && window_cells[i].size() > 1u && !shares_logic[i] )
+        {
+          solve_window( i, results[i] );
+        }
+      } );
+    } );
+
+    mockturtle::call_with_stopwatch( st.time_commit, [&]() {
+      for ( auto i = 0u; i < windows.size(); ++i )
+      {
+        if ( results[i].st.solved && results[i].st.cells_after < results[i].st.cells_before && !is_cancelled() )
+        {
+          results[i].st.committed = commit( i, results[i] );
+          st.num_committed += results[i].st.committed ? 1u : 0u;
+        }
+        st.windows.push_back( results[i].st );
+      }
+    } );
+
+    st.cells_after = ntk.num_cells();
+
+    std::vector<uint64_t> window_memory;
+    for ( auto const& w : st.windows )
+    {
+      window_memory.push_back( w.cut_memory );
+    }
+    const auto concurrent = std::min<std::size_t>( pool.num_threads(), window_memory.size() );
+    std::partial_sort( window_memory.begin(), window_memory.begin() + concurrent, window_memory.end(), std::greater<uint64_t>() );
+    st.cut_memory = std::accumulate( window_memory.begin(), window_memory.begin() + concurrent, uint64_t( 0u ) );
+  }
+
+private:
+  struct window_result
+  {
+    satlut_window_stats st;
+
+    /* new cells as original node indexes, leaves in CSR form */
+    std::vector<uint32_t> roots;
+    std::vector<uint32_t> first_leaf;
+    std::vector<uint32_t> leaves;
+    std::vector<kitty::dynamic_truth_table> functions;
+  };
+
+  void collect_cells()
+  {
+    cell_of.resize( ntk.size(), none );
+    ntk.foreach_gate( [&]( auto const& n ) {
+      if ( !ntk.is_cell_root( n ) )
+      {
+        return;
+      }
+      cell_of[ntk.node_to_index( n )] = static_cast<uint32_t>( roots.size() );
+      roots.push_back( ntk.node_to_index( n ) );
+    } );
+
+    first_leaf.push_back( 0u );
+    for ( auto r : roots )
+    {
+      ntk.foreach_cell_fanin( ntk.index_to_node( r ), [&]( auto const& l ) {
+        leaves.push_back( ntk.node_to_index( l ) );
+      } );
+      first_leaf.push_back( static_cast<uint32_t>( leaves.size() ) );
+    }
+  }
+
+  /* windows are grown breadth-first along cell fanins and fanouts, starting
+     from the cell with the smallest root index that is not yet assigned */
+  void partition_cells()
+  {
+    std::vector<std::vector<uint32_t>> neighbors( roots.size() );
+    for ( auto c = 0u; c < roots.size(); ++c )
+    {
+      for ( auto i = first_leaf[c]; i < first_leaf[c + 1u]; ++i )
+      {
+        const auto d = cell_of[leaves[i]];
+        if ( d != none )
+        {
+          neighbors[c].push_back( d );
+          neighbors[d].push_back( c );
+        }
+      }
+    }
+
+    std::vector<uint32_t> window_of( roots.size(), none );
+    const auto window_size = std::max( ps.window_size, 1u );
+    for ( auto c = 0u; c < roots.size(); ++c )
+    {
+      if ( window_of[c] != none )
+      {
+        continue;
+      }
+
+      const auto id = static_cast<uint32_t>( window_cells.size() );
+      auto& cells = window_cells.emplace_back();
+      window_of[c] = id;
+      cells.push_back( c );
+      for ( auto q = 0u; q < cells.size() && cells.size() < window_size; ++q )
+      {
+        for ( auto d : neighbors[cells[q]] )
+        {
+          if ( window_of[d] == none && cells.size() < window_size )
+          {
+            window_of[d] = id;
+            cells.push_back( d );
+          }
+        }
+      }
+      std::sort( cells.begin(), cells.end() );
+    }
+
+    /* roots that are used by cells of other windows or by POs are outputs */
+    std::vector<bool> external( roots.size(), false );
+    for ( auto c = 0u; c < roots.size(); ++c )
+    {
+      for ( auto i = first_leaf[c]; i < first_leaf[c + 1u]; ++i )
+      {
+        const auto d = cell_of[leaves[i]];
+        if ( d != none && window_of[d] != window_of[c] )
+        {
+          external[d] = true;
+        }
+      }
+    }
+    ntk.foreach_po( [&]( auto const& f ) {
+      const auto c = cell_of[ntk.node_to_index( ntk.get_node( f ) )];
+      if ( c != none )
+      {
+        external[c] = true;
+      }
+    } );
+
+    for ( auto const& cells : window_cells )
+    {
+      build_window( cells, window_of, external );
+    }
+  }
+
+  void build_window( std::vector<uint32_t> const& cells, std::vector<uint32_t> const& window_of, std::vector<bool> const& external )
+  {
+    const auto id = window_of[cells.front()];
+    auto& w = windows.emplace_back();
+
+    for ( auto c : cells )
+    {
+      for ( auto i = first_leaf[c]; i < first_leaf[c + 1u]; ++i )
+      {
+        const auto l = leaves[i];
+        if ( !ntk.is_constant( ntk.index_to_node( l ) ) && ( cell_of[l] == none || window_of[cell_of[l]] != id ) )
+        {
+          w.inputs.push_back( l );
+        }
+      }
+      if ( external[c] )
+      {
+        w.outputs.push_back( roots[c] );
+      }
+    }
+    std::sort( w.inputs.begin(), w.inputs.end() );
+    w.inputs.erase( std::unique( w.inputs.begin(), w.inputs.end() ), w.inputs.end() );
+
+    /* the cones of the cells must not pass through window inputs, which
+       happens if logic is duplicated into cells of other windows */
+    bool shared{false};
+    std::vector<uint32_t> stack;
+    for ( auto c : cells )
+    {
+      const auto begin = leaves.begin() + first_leaf[c];
+      const auto end = leaves.begin() + first_leaf[c + 1u];
+      stack.push_back( roots[c] );
+      while ( !stack.empty() )
+      {
+        const auto index = stack.back();
+        stack.pop_back();
+        if ( std::find( begin, end, index ) != end || std::find( w.gates.begin(), w.gates.end(), index ) != w.gates.end() )
+        {
+          continue;
+        }
+        const auto n = ntk.index_to_node( index );
+        if ( ntk.is_constant( n ) )
+        {
+          continue;
+        }
+        if ( ntk.is_pi( n ) || std::binary_search( w.inputs.begin(), w.inputs.end(), index ) )
+        {
+          shared = true;
+          continue;
+        }
+        w.gates.push_back( index );
+        ntk.foreach_fanin( n, [&]( auto const& f ) {
+          stack.push_back( ntk.node_to_index( ntk.get_node( f ) ) );
+        } );
+      }
+    }
+    /* node indexes are in topological order */
+    std::sort( w.gates.begin(), w.gates.end() );
+    shares_logic.push_back( shared );
+  }
+
+  void solve_window( uint32_t id, window_result& res ) const
+  {
+    auto const& w = windows[id];
+
+    base_ntk part;
+    std::unordered_map<uint32_t, typename base_ntk::signal> old_to_new;
+    std::vector<uint32_t> part_to_old;
+
+    /* clone_node may strash or simplify a gate into an existing node, then
+       part nodes do not correspond to unique original nodes, and cells of
+       the new cover could be rooted at the wrong original node */
+    bool merged{false};
+    const auto record = [&]( uint32_t index, auto const& s ) {
+      const auto p = part.node_to_index( part.get_node( s ) );
+      part_to_old.resize( part.size(), none );
+      if ( part_to_old[p] != none || part.is_constant( part.get_node( s ) ) )
+      {
+        merged = true;
+        return;
+      }
+      part_to_old[p] = index;
+      old_to_new.emplace( index, s );
+    };
+
+    for ( auto i : w.inputs )
+    {
+      record( i, part.create_pi() );
+    }
+    for ( auto g : w.gates )
+    {
+      if ( merged )
+      {
+        return;
+      }
+
+      const auto n = ntk.index_to_node( g );
+      std::vector<typename base_ntk::signal> children;
+      ntk.foreach_fanin( n, [&]( auto const& f ) {
+        const auto c = ntk.get_node( f );
+        const auto s = ntk.is_constant( c ) ? part.get_constant( ntk.constant_value( c ) ) : old_to_new.at( ntk.node_to_index( c ) );
+        children.push_back( ntk.is_complemented( f ) ? part.create_not( s ) : s );
+      } );
+      record( g, part.clone_node( ntk, n, children ) );
+    }
+    if ( merged )
+    {
+      return;
+    }
+    for ( auto o : w.outputs )
+    {
+      part.create_po( old_to_new.at( o ) );
+    }
+    part_to_old.resize( part.size(), none );
+
+    /* the current cover is the initial mapping of the window */
+    mockturtle::mapping_view<base_ntk, StoreFunction> mapped{part};
+    for ( auto c : window_cells[id] )
+    {
+      std::vector<typename base_ntk::node> cell_leaves;
+      for ( auto i = first_leaf[c]; i < first_leaf[c + 1u]; ++i )
+      {
+        const auto l = ntk.index_to_node( leaves[i] );
+        cell_leaves.push_back( ntk.is_constant( l ) ? part.get_node( part.get_constant( false ) ) : part.get_node( old_to_new.at( leaves[i] ) ) );
+      }
+      mapped.add_to_mapping( part.get_node( old_to_new.at( roots[c] ) ), cell_leaves.begin(), cell_leaves.end() );
+    }
+
+    res.st.cut_memory = estimated_cut_memory( mapped );
+
+    mockturtle::satlut_mapping_stats sst;
+    mockturtle::satlut_mapping<decltype( mapped ), StoreFunction>( mapped, ps.satlut_ps, &sst );
+    res.st.time_sat = sst.time_sat;
+    res.st.solved = true;
+    res.st.cells_after = mapped.num_cells();
+    if ( res.st.cells_after >= res.st.cells_before )
+    {
+      return;
+    }
+
+    /* all cells must correspond to nodes of the original network */
+    bool valid{true};
+    mapped.foreach_gate( [&]( auto const& n ) {
+      if ( mapped.is_cell_root( n ) && part_to_old[part.node_to_index( n )] == none )
+      {
+        valid = false;
+      }
+    } );
+    if ( !valid )
+    {
+      res.st.cells_after = res.st.cells_before;
+      return;
+    }
+
+    res.first_leaf.push_back( 0u );
+    mapped.foreach_gate( [&]( auto const& n ) {
+      if ( !mapped.is_cell_root( n ) )
+      {
+        return;
+      }
+      res.roots.push_back( part_to_old[part.node_to_index( n )] );
+      mapped.foreach_cell_fanin( n, [&]( auto const& l ) {
+        res.leaves.push_back( part.is_constant( l ) ? 0u : part_to_old[part.node_to_index( l )] );
+      } );
+      res.first_leaf.push_back( static_cast<uint32_t>( res.leaves.size() ) );
+      if constexpr ( StoreFunction )
+      {
+        res.functions.push_back( mapped.cell_function( n ) );
+      }
+    } );
+  }
+
+  /* replaces the cells of a window by its new cover, fails if a new cell
+     root is the root of a cell in another window */
+  bool commit( uint32_t id, window_result const& res )
+  {
+    auto const& cells = window_cells[id];
+    const auto is_old_root = [&]( uint32_t index ) {
+      return cell_of[index] != none && std::binary_search( cells.begin(), cells.end(), cell_of[index] );
+    };
+
+    for ( auto r : res.roots )
+    {
+      if ( ntk.is_cell_root( ntk.index_to_node( r ) ) && !is_old_root( r ) )
+      {
+        return false;
+      }
+    }
+
+    for ( auto c : cells )
+    {
+      ntk.remove_from_mapping( ntk.index_to_node( roots[c] ) );
+    }
+
+    std::vector<node> cell_leaves;
+    for ( auto i = 0u; i < res.roots.size(); ++i )
+    {
+      cell_leaves.clear();
+      for ( auto j = res.first_leaf[i]; j < res.first_leaf[i + 1u]; ++j )
+      {
+        cell_leaves.push_back( ntk.index_to_node( res.leaves[j] ) );
+      }
+      const auto n = ntk.index_to_node( res.roots[i] );
+      ntk.add_to_mapping( n, cell_leaves.begin(), cell_leaves.end() );
+      if constexpr ( StoreFunction )
+      {
+        ntk.set_cell_function( n, res.functions[i] );
+      }
+    }
+    return true;
+  }
+
+private:
+  Ntk& ntk;
+  thread_pool& pool;
+  parallel_satlut_mapping_params const& ps;
+  parallel_satlut_mapping_stats& st;
+
+  /* cells of the initial mapping, leaves in CSR form */
+  std::vector<uint32_t> roots;
+  std::vector<uint32_t> first_leaf;
+  std::vector<uint32_t> leaves;
+  std::vector<uint32_t> cell_of;
+
+  std::vector<std::vector<uint32_t>> window_cells;
+  std::vector<network_window> windows;
+  std::vector<bool> shares_logic;
+};
+
+} // namespace detail
+
+/*! \brief SAT-based LUT mapping of disjoint windows on a thread pool
+
+  The cells of the current mapping are partitioned into windows of at most
+  `ps.window_size` cells, grown along cell fanins and fanouts.  Each window
+  is extracted into a network whose PIs are the leaves of the window and
+  whose POs are the cells used outside of the window, and the current cover
+  of the window is improved by mockturtle's `satlut_mapping` on one of the
+  threads of `pool`; each window has its own SAT solver.  Windows whose
+  cells duplicate logic behind the leaves of the window, or whose gates are
+  merged by structural hashing when extracted, are not solved.
+
+  Improved covers are merged into the mapping sequentially in window order.
+  The outputs of a window remain cell roots, such that the cells of other
+  windows stay valid.  A cover is rejected if one of its cells has the root
+  of a cell in another window.  The result does not depend on the number of
+  threads.  The network must be mapped.
+*/
+template<class Ntk, bool StoreFunction = false>
+void parallel_satlut_mapping( Ntk& ntk, thread_pool& pool, parallel_satlut_mapping_params const& ps = {}, parallel_satlut_mapping_stats* pst = nullptr )
+{
+  parallel_satlut_mapping_stats st;
+  {
+    mockturtle::stopwatch t( st.time_total );
+    detail::parallel_satlut_mapping_impl<Ntk, StoreFunction> impl( ntk, pool, ps, st );
+    impl.run();
+  }
+
+  if ( ps.verbose )
+  {
+    st.report();
+  }
+
+  if ( pst )
+  {
+    *pst = st;
+  }
+}
+
+} // namespace cirkit
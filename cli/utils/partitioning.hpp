@@ -0,0 +1,390 @@
+/* CirKit: A circuit toolkit
+ * Copyright (C) 2017-2019  EPFL
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <unordered_map>
+#include <vector>
+
+#include <mockturtle/utils/node_map.hpp>
+
+#include "cancellation.hpp"
+#include "compaction.hpp"
+#include "thread_pool.hpp"
+
+namespace cirkit
+{
+
+/*! \brief Window of a network
+
+  All entries are node indexes.  Gates are in topological order, and the
+  order of inputs and outputs defines the order of PIs and POs of the
+  extracted network.
+*/
+struct network_window
+{
+  std::vector<uint32_t> inputs;
+  std::vector<uint32_t> gates;
+  std::vector<uint32_t> outputs;
+};
+
+struct partitioning_params
+{
+  /*! \brief Maximum number of gates per window */
+  uint32_t size{10000u};
+
+  /*! \brief Maximum number of inputs per window (0 for no limit) */
+  uint32_t max_inputs{0u};
+
+  /*! \brief Maximum number of outputs per window (0 for no limit) */
+  uint32_t max_outputs{0u};
+};
+
+/*! \brief Partitions the gates of a network into windows
+
+  Gates are visited in depth-first order from the outputs, such that gates in
+  the same cone are likely in the same window, and consecutive gates are
+  collected into a window, until it has `size` gates or adding the next gate
+  would exceed the input or output limits.  While a window is filled, its
+  number of outputs is estimated by the gates with fanout outside the gates
+  visited so far, which is an upper bound of the final number.
+
+  Windows are in topological order, i.e., the inputs of a window are primary
+  inputs or outputs of earlier windows.  Gates that do not reach a primary
+  output are not contained in any window.
+*/
+template<class Ntk>
+std::vector<network_window> partition_network( Ntk const& ntk, partitioning_params const& ps = {} )
+{
+  /* depth-first topological order */
+  std::vector<uint32_t> order;
+  {
+    std::vector<uint8_t> state( ntk.size(), 0u );
+    std::vector<std::pair<uint32_t, bool>> stack;
+    ntk.foreach_po( [&]( auto const& f ) {
+      stack.emplace_back( ntk.node_to_index( ntk.get_node( f ) ), false );
+      while ( !stack.empty() )
+      {
+        const auto [index, expanded] = stack.back();
+        stack.pop_back();
+        const auto n = ntk.index_to_node( index );
+
+        if ( expanded )
+        {
+          state[index] = 2u;
+          order.push_back( index );
+          continue;
+        }
+        if ( state[index] != 0u || ntk.is_constant( n ) || ntk.is_pi( n ) )
+        {
+          continue;
+        }
+        state[index] = 1u;
+        stack.emplace_back( index, true );
+
+        std::vector<uint32_t> fanins;
+        ntk.foreach_fanin( n, [&]( auto const& g ) {
+          fanins.push_back( ntk.node_to_index( ntk.get_node( g ) ) );
+        } );
+        /* push in reverse order, such that the first fanin is visited first */
+        for ( auto it = fanins.rbegin(); it != fanins.rend(); ++it )
+        {
+          if ( state[*it] == 0u )
+          {
+            stack.emplace_back( *it, false );
+          }
+        }
+      }
+    } );
+  }
+
+  std::vector<network_window> windows;
+
+  /* window membership (window index + 1) and references from inside the window */
+  std::vector<uint32_t> window_of( ntk.size(), 0u );
+  std::vector<uint32_t> input_of( ntk.size(), 0u );
+  std::vector<uint32_t> internal_refs( ntk.size(), 0u );
+  uint32_t open_outputs{0u};
+
+  const auto close_window = [&]() {
+    auto& w = windows.back();
+    for ( auto g : w.gates )
+    {
+      if ( ntk.fanout_size( ntk.index_to_node( g ) ) > internal_refs[g] )
+      {
+        w.outputs.push_back( g );
+      }
+    }
+  };
+
+  for ( auto index : order )
+  {
+    const auto n = ntk.index_to_node( index );
+
+    std::vector<uint32_t> fanins;
+    ntk.foreach_fanin( n, [&]( auto const& f ) {
+      fanins.push_back( ntk.node_to_index( ntk.get_node( f ) ) );
+    } );
+
+    if ( !windows.empty() )
+    {
+      const auto id = static_cast<uint32_t>( windows.size() );
+      auto const& w = windows.back();
+
+      uint32_t new_inputs{0u}, closed_outputs{0u};
+      for ( auto i = 0u; i < fanins.size(); ++i )
+      {
+        const auto c = fanins[i];
+        if ( ntk.is_constant( ntk.index_to_node( c ) ) )
+        {
+          continue;
+        }
+        if ( window_of[c] == id )
+        {
+          /* count how many references of c are added by this gate */
+          uint32_t refs{0u};
+          for ( auto j = 0u; j < fanins.size(); ++j )
+          {
+            refs += fanins[j] == c ? 1u : 0u;
+          }
+          if ( std::find( fanins.begin(), fanins.begin() + i, c ) == fanins.begin() + i && internal_refs[c] + refs == ntk.fanout_size( ntk.index_to_node( c ) ) )
+          {
+            ++closed_outputs;
+          }
+        }
+        else if ( input_of[c] != id && std::find( fanins.begin(), fanins.begin() + i, c ) == fanins.begin() + i )
+        {
+          ++new_inputs;
+        }
+      }
+
+      if ( w.gates.size() >= ps.size ||
+           ( ps.max_inputs > 0u && w.inputs.size() + new_inputs > ps.max_inputs ) ||
+           ( ps.max_outputs > 0u && open_outputs + 1u - closed_outputs > ps.max_outputs ) )
+      {
+        close_window();
+        windows.emplace_back();
+        open_outputs = 0u;
+      }
+    }
+    else
+    {
+      windows.emplace_back();
+    }
+
+    const auto id = static_cast<uint32_t>( windows.size() );
+    auto& w = windows.back();
+
+    for ( auto c : fanins )
+    {
+      if ( ntk.is_constant( ntk.index_to_node( c ) ) )
+      {
+        continue;
+      }
+      if ( window_of[c] == id )
+      {
+        if ( ++internal_refs[c] == ntk.fanout_size( ntk.index_to_node( c ) ) )
+        {
+          --open_outputs;
+        }
+      }
+      else if ( input_of[c] != id )
+      {
+        input_of[c] = id;
+        w.inputs.push_back( c );
+      }
+    }
+
+    window_of[index] = id;
+    w.gates.push_back( index );
+    ++open_outputs;
+  }
+
+  if ( !windows.empty() )
+  {
+    close_window();
+  }
+
+  return windows;
+}
+
+/*! \brief Extracts a window into a new network
+
+  The PIs of the new network correspond to the window inputs and the POs to
+  the window outputs.  If `ntk_to_part` is given, it receives the node index
+  in the new network of each window input and gate that is not complemented.
+*/
+template<class Ntk>
+Ntk extract_window( Ntk const& ntk, network_window const& window, std::unordered_map<uint32_t, uint32_t>* ntk_to_part = nullptr )
+{
+  Ntk part;
+  std::unordered_map<uint32_t, typename Ntk::signal> old_to_new;
+
+  for ( auto i : window.inputs )
+  {
+    old_to_new.emplace( i, part.create_pi() );
+  }
+
+  for ( auto g : window.gates )
+  {
+    const auto n = ntk.index_to_node( g );
+    std::vector<typename Ntk::signal> children;
+    ntk.foreach_fanin( n, [&]( auto const& f ) {
+      const auto c = ntk.get_node( f );
+      const auto s = ntk.is_constant( c ) ? part.get_constant( ntk.constant_value( c ) ) : old_to_new.at( ntk.node_to_index( c ) );
+      children.push_back( ntk.is_complemented( f ) ? part.create_not( s ) : s );
+    } );
+    old_to_new.emplace( g, part.clone_node( ntk, n, children ) );
+  }
+
+  for ( auto o : window.outputs )
+  {
+    part.create_po( old_to_new.at( o ) );
+  }
+
+  if ( ntk_to_part )
+  {
+    ntk_to_part->clear();
+    ntk_to_part->emplace( 0u, 0u );
+    for ( auto const& [i, s] : old_to_new )
+    {
+      if ( !part.is_complemented( s ) )
+      {
+        ntk_to_part->emplace( i, part.node_to_index( part.get_node( s ) ) );
+      }
+    }
+  }
+
+  return part;
+}
+
+/*! \brief Rebuilds a network from (optimized) windows
+
+  `parts[i]` must have as many PIs and POs as `windows[i]` has inputs and
+  outputs.  Gates are recreated with structural hashing, such that logic
+  that has become equal in different windows is shared.  If `part_to_res`
+  is given, `( *part_to_res )[i]` receives the node index in the new network
+  of each node of `parts[i]` that is not complemented, or
+  `std::numeric_limits<uint32_t>::max()`.
+*/
+template<class Ntk>
+Ntk stitch_windows( Ntk const& ntk, std::vector<network_window> const& windows, std::vector<Ntk> const& parts, std::vector<std::vector<uint32_t>>* part_to_res = nullptr )
+{
+  using signal = typename Ntk::signal;
+
+  Ntk res;
+  std::unordered_map<uint32_t, signal> old_to_new;
+
+  ntk.foreach_pi( [&]( auto const& n ) {
+    old_to_new.emplace( ntk.node_to_index( n ), res.create_pi() );
+  } );
+
+  for ( auto i = 0u; i < windows.size(); ++i )
+  {
+    auto const& part = parts[i];
+    mockturtle::node_map<signal, Ntk> part_to_new( part );
+
+    part.foreach_pi( [&]( auto const& n, auto j ) {
+      part_to_new[n] = old_to_new.at( windows[i].inputs[j] );
+    } );
+
+    const auto get = [&]( auto const& f ) {
+      const auto c = part.get_node( f );
+      const auto s = part.is_constant( c ) ? res.get_constant( part.constant_value( c ) ) : part_to_new[c];
+      return part.is_complemented( f ) ? res.create_not( s ) : s;
+    };
+
+    part.foreach_gate( [&]( auto const& n ) {
+      std::vector<signal> children;
+      part.foreach_fanin( n, [&]( auto const& f ) {
+        children.push_back( get( f ) );
+      } );
+      part_to_new[n] = res.clone_node( part, n, children );
+    } );
+
+    part.foreach_po( [&]( auto const& f, auto j ) {
+      old_to_new[windows[i].outputs[j]] = get( f );
+    } );
+
+    if ( part_to_res )
+    {
+      part_to_res->resize( parts.size() );
+      auto& indexes = ( *part_to_res )[i];
+      indexes.assign( part.size(), std::numeric_limits<uint32_t>::max() );
+      indexes[0u] = 0u;
+      const auto add = [&]( auto const& n ) {
+        if ( !res.is_complemented( part_to_new[n] ) )
+        {
+          indexes[part.node_to_index( n )] = res.node_to_index( res.get_node( part_to_new[n] ) );
+        }
+      };
+      part.foreach_pi( add );
+      part.foreach_gate( add );
+    }
+  }
+
+  ntk.foreach_po( [&]( auto const& f ) {
+    const auto c = ntk.get_node( f );
+    const auto s = ntk.is_constant( c ) ? res.get_constant( ntk.constant_value( c ) ) : old_to_new.at( ntk.node_to_index( c ) );
+    res.create_po( ntk.is_complemented( f ) ? res.create_not( s ) : s );
+  } );
+
+  return res;
+}
+
+/*! \brief Optimizes the windows of a network concurrently
+
+  Each window is extracted into a network, which is optimized in place by
+  `optimize_fn( part )` on one of the threads of `pool`, and the network is
+  rebuilt from the optimized windows.  `optimize_fn` must preserve the PIs and
+  POs of the part and must be safe to call concurrently on different parts.
+*/
+template<class Ntk, class Fn>
+void optimize_windows( Ntk& ntk, thread_pool& pool, partitioning_params const& ps, Fn&& optimize_fn )
+{
+  const auto windows = partition_network( ntk, ps );
+
+  std::vector<Ntk> parts;
+  for ( auto const& w : windows )
+  {
+    parts.push_back( extract_window( ntk, w ) );
+  }
+
+  pool.parallel_for( 0u, static_cast<uint32_t>( windows.size() ), [&]( uint32_t i, uint32_t ) {
+    if ( !is_cancelled() )
+    {
+      optimize_fn( parts[i] );
+    }
+  } );
+
+  auto stitched = stitch_windows( ntk, windows, parts );
+  compact_dangling( stitched );
+  ntk = stitched;
+}
+
+} // namespace cirkit
@@ -0,0 +1,472 @@
+/* CirKit: A circuit toolkit
+ * Copyright (C) 2017-2019  EPFL
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+#include <fmt/format.h>
+#include <kitty/dynamic_truth_table.hpp>
+#include <kitty/hash.hpp>
+#include <mockturtle/algorithms/simulation.hpp>
+#include <mockturtle/utils/stopwatch.hpp>
+#include <mockturtle/views/mffc_view.hpp>
+
+#include "cancellation.hpp"
+#include "dont_cares.hpp"
+#include "network_cost.hpp"
+#include "output_stream.hpp"
+
+namespace cirkit
+{
+
+struct refactoring_params
+{
+  /*! \brief Maximum number of PIs of an MFFC */
+  uint32_t max_pis{6u};
+
+  /*! \brief Accept replacements that do not reduce the cost */
+  bool allow_zero_gain{false};
+
+  /*! \brief Cost function (the node cost function is passed separately) */
+  cost_function cost{cost_function::size};
+
+  /*! \brief Reuse resynthesis results for MFFCs with the same function */
+  bool cache_resynthesis{true};
+
+  /*! \brief Show statistics */
+  bool verbose{false};
+};
+
+struct refactoring_stats
+{
+  mockturtle::stopwatch<>::duration time_total{0};
+  mockturtle::stopwatch<>::duration time_simulation{0};
+  mockturtle::stopwatch<>::duration time_dont_cares{0};
+  mockturtle::stopwatch<>::duration time_resynthesis{0};
+
+  uint32_t num_candidates{0u};
+  uint32_t num_rewrites{0u};
+  uint32_t num_cache_hits{0u};
+
+  void report( std::ostream& os = output_stream() ) const
+  {
+    os << fmt::format( "[i] candidates = {:>8d} ({:>5.2f} secs)\n", num_candidates, mockturtle::to_seconds( time_resynthesis ) );
+    os << fmt::format( "[i] rewrites   = {:>8d}\n", num_rewrites );
+    os << fmt::format( "[i] cache hits = {:>8d}\n", num_cache_hits );
+    os << fmt::format( "[i] simulation = {:>5.2f} secs\n", mockturtle::to_seconds( time_simulation ) );
+    os << fmt::format( "[i] DC         = {:>5.2f} secs\n", mockturtle::to_seconds( time_dont_cares ) );
+    os << fmt::format( "[i] total time = {:>5.2f} secs\n", mockturtle::to_seconds( time_total ) );
+  }
+};
+
+namespace detail
+{
+
+template<class Ntk, class RefactoringFn, class NodeCostFn>
+class refactoring_impl
+{
+public:
+  using node = typename Ntk::node;
+  using signal = typename Ntk::signal;
+
+  refactoring_impl( Ntk& ntk, RefactoringFn& refactoring_fn, refactoring_params const& ps, refactoring_stats& st, NodeCostFn const& cost_fn, windowed_dont_cares<Ntk>* dont_cares )
+      : ntk( ntk ),
+        refactoring_fn( refactoring_fn ),
+        ps( ps ),
+        st( st ),
+        cost_fn( cost_fn ),
+        levels( ntk ),
+        dont_cares( has_dont_care_resynthesis_v<RefactoringFn, Ntk> ? dont_cares : nullptr )
+  {
+    objective.cost = ps.cost;
+    objective.min_gain = ps.allow_zero_gain ? 0 : 1;
+  }
+
+  void run()
+  {
+    mockturtle::stopwatch t( st.time_total );
+
+    if ( objective.level_constrained() )
+    {
+      levels.recompute();
+    }
+
+    if ( dont_cares )
+    {
+      mockturtle::call_with_stopwatch( st.time_dont_cares, [&]() {
+        dont_cares->prepare( ntk );
+      } );
+    }
+
+    /* resynthesis results are only reused without don't cares, which depend
+       on the context of the MFFC */
+    if ( ps.cache_resynthesis && !dont_cares )
+    {
+      for ( auto i = 0u; i < ps.max_pis; ++i )
+      {
+        scratch_pis.push_back( scratch.create_pi() );
+      }
+      cache.resize( ps.max_pis + 1u );
+    }
+
+    ntk.clear_values();
+    ntk.foreach_node( [&]( auto const& n ) {
+      ntk.set_value( n, ntk.fanout_size( n ) );
+    } );
+
+    const auto size = ntk.size();
+    ntk.foreach_gate( [&]( auto const& n ) {
+      if ( ntk.node_to_index( n ) >= size || is_cancelled() )
+      {
+        return false;
+      }
+      if ( ntk.fanout_size( n ) != 0u )
+      {
+        refactor( n );
+      }
+      return true;
+    } );
+  }
+
+private:
+  void refactor( node const& n )
+  {
+    mockturtle::mffc_view mffc{ntk, n};
+    if ( mffc.num_pos() == 0 || mffc.num_pis() > ps.max_pis || mffc.size() < 4 )
+    {
+      return;
+    }
+
+    std::vector<signal> leaves( mffc.num_pis() );
+    mffc.foreach_pi( [&]( auto const& m, auto j ) {
+      leaves[j] = ntk.make_signal( m );
+    } );
+
+    mockturtle::default_simulator<kitty::dynamic_truth_table> sim( mffc.num_pis() );
+    const auto tt = mockturtle::call_with_stopwatch( st.time_simulation, [&]() {
+      return mockturtle::simulate<kitty::dynamic_truth_table>( mffc, sim )[0];
+    } );
+
+    const auto use_levels = objective.level_constrained();
+    const auto root_level = use_levels ? levels[n] : 0u;
+    const auto critical = use_levels && levels.is_critical( n );
+    const auto mffc_cost = static_cast<int32_t>( deref( n ) );
+
+    bool found{false};
+    signal best;
+    int32_t best_gain{0};
+    uint32_t best_level{0u};
+
+    const auto on_candidate = [&]( auto const& f ) {
+      ++st.num_candidates;
+
+      const auto g = ntk.get_node( f );
+      if ( g == n )
+      {
+        return true;
+      }
+
+      /* the candidate must not depend on the root */
+      bool contains{false};
+      const auto gain = mffc_cost - static_cast<int32_t>( ref_root( g, n, contains ) );
+      deref_root( g );
+      if ( contains )
+      {
+        return true;
+      }
+
+      if ( use_levels )
+      {
+        levels.update();
+      }
+      const auto level = use_levels ? levels[g] : 0u;
+      if ( objective.accepts( gain, level, root_level, critical ) && ( !found || objective.better( gain, level, best_gain, best_level ) ) )
+      {
+        found = true;
+        best = f;
+        best_gain = gain;
+        best_level = level;
+      }
+      return true;
+    };
+
+    if ( dont_cares )
+    {
+      std::vector<uint32_t> leaf_indexes;
+      for ( auto const& l : leaves )
+      {
+        leaf_indexes.push_back( ntk.node_to_index( ntk.get_node( l ) ) );
+      }
+      const auto dc = mockturtle::call_with_stopwatch( st.time_dont_cares, [&]() {
+        return dont_cares->compute( ntk, n, leaf_indexes.begin(), leaf_indexes.end() );
+      } );
+      mockturtle::call_with_stopwatch( st.time_resynthesis, [&]() {
+        resynthesize( tt, dc, leaves, on_candidate );
+      } );
+    }
+    else if ( !cache.empty() )
+    {
+      mockturtle::call_with_stopwatch( st.time_resynthesis, [&]() {
+        resynthesize_cached( tt, leaves, on_candidate );
+      } );
+    }
+    else
+    {
+      mockturtle::call_with_stopwatch( st.time_resynthesis, [&]() {
+        refactoring_fn( ntk, tt, leaves.begin(), leaves.end(), on_candidate );
+      } );
+    }
+
+    if ( !found )
+    {
+      ref( n );
+      return;
+    }
+
+    bool contains{false};
+    ref_root( ntk.get_node( best ), n, contains );
+    ntk.substitute_node( n, best );
+    ntk.set_value( n, 0 );
+    ntk.set_value( ntk.get_node( best ), ntk.fanout_size( ntk.get_node( best ) ) );
+    ++st.num_rewrites;
+  }
+
+  /* the engine only keeps don't cares for resynthesis functions with a
+     don't-care overload */
+  template<class Fn>
+  void resynthesize( kitty::dynamic_truth_table const& tt, kitty::dynamic_truth_table const& dc, std::vector<signal> const& leaves, Fn&& on_candidate )
+  {
+    if constexpr ( has_dont_care_resynthesis_v<RefactoringFn, Ntk> )
+    {
+      refactoring_fn( ntk, tt, dc, leaves.begin(), leaves.end(), on_candidate );
+    }
+  }
+
+  /* candidates for a function are synthesized once into the scratch network,
+     whose PIs stand for the MFFC leaves, and copied onto the leaves of every
+     MFFC with the same function */
+  template<class Fn>
+  void resynthesize_cached( kitty::dynamic_truth_table const& tt, std::vector<signal> const& leaves, Fn&& on_candidate )
+  {
+    auto& entries = cache[tt.num_vars()];
+    auto it = entries.find( tt );
+    if ( it == entries.end() )
+    {
+      std::vector<signal> candidates;
+      refactoring_fn( scratch, tt, scratch_pis.begin(), scratch_pis.begin() + tt.num_vars(), [&]( auto const& f ) {
+        candidates.push_back( f );
+        return true;
+      } );
+      if ( is_cancelled() )
+      {
+        return;
+      }
+      it = entries.emplace( tt, std::move( candidates ) ).first;
+    }
+    else
+    {
+      ++st.num_cache_hits;
+    }
+
+    ++copy_stamp;
+    for ( auto const& f : it->second )
+    {
+      if ( !on_candidate( copy_candidate( f, leaves ) ) )
+      {
+        break;
+      }
+    }
+  }
+
+  signal copy_candidate( signal const& f, std::vector<signal> const& leaves )
+  {
+    const auto s = scratch.get_node( f );
+    const auto index = scratch.node_to_index( s );
+    if ( index >= copies.size() )
+    {
+      copies.resize( scratch.size() );
+      copy_stamps.resize( scratch.size(), 0u );
+    }
+
+    if ( copy_stamps[index] != copy_stamp )
+    {
+      if ( scratch.is_constant( s ) )
+      {
+        copies[index] = ntk.get_constant( false );
+      }
+      else if ( scratch.is_pi( s ) )
+      {
+        /* PIs are the first nodes after the constant */
+        copies[index] = leaves[index - 1u];
+      }
+      else
+      {
+        std::vector<signal> children;
+        scratch.foreach_fanin( s, [&]( auto const& c ) {
+          children.push_back( copy_candidate( c, leaves ) );
+        } );
+        copies[index] = ntk.clone_node( scratch, s, children );
+      }
+      copy_stamps[index] = copy_stamp;
+    }
+
+    return scratch.is_complemented( f ) ? ntk.create_not( copies[index] ) : copies[index];
+  }
+
+  /* reference counting as in mockturtle's MFFC utilities, weighted by the
+     node cost function */
+  uint32_t deref( node const& n )
+  {
+    if ( ntk.is_constant( n ) || ntk.is_pi( n ) )
+    {
+      return 0u;
+    }
+
+    uint32_t cost = cost_fn( ntk, n );
+    ntk.foreach_fanin( n, [&]( auto const& f ) {
+      if ( ntk.decr_value( ntk.get_node( f ) ) == 0 )
+      {
+        cost += deref( ntk.get_node( f ) );
+      }
+    } );
+    return cost;
+  }
+
+  uint32_t ref( node const& n )
+  {
+    if ( ntk.is_constant( n ) || ntk.is_pi( n ) )
+    {
+      return 0u;
+    }
+
+    uint32_t cost = cost_fn( ntk, n );
+    ntk.foreach_fanin( n, [&]( auto const& f ) {
+      if ( ntk.incr_value( ntk.get_node( f ) ) == 0 )
+      {
+        cost += ref( ntk.get_node( f ) );
+      }
+    } );
+    return cost;
+  }
+
+  /* references a candidate root as if it was used by the fanout of root, and
+     returns the cost of the nodes that are added to the network */
+  uint32_t ref_root( node const& g, node const& root, bool& contains )
+  {
+    contains = contains_rec( g, root );
+    return ntk.incr_value( g ) == 0 ? ref( g ) : 0u;
+  }
+
+  void deref_root( node const& g )
+  {
+    if ( ntk.decr_value( g ) == 0 )
+    {
+      deref( g );
+    }
+  }
+
+  /* whether root is in the transitive fanin of g, visiting only nodes that
+     are not referenced, i.e., the new logic of the candidate (as mockturtle's
+     `recursive_ref_contains`) */
+  bool contains_rec( node const& g, node const& root )
+  {
+    if ( g == root )
+    {
+      return true;
+    }
+    if ( ntk.is_constant( g ) || ntk.is_pi( g ) || ntk.value( g ) != 0 )
+    {
+      return false;
+    }
+
+    bool contains{false};
+    ntk.foreach_fanin( g, [&]( auto const& f ) {
+      if ( !contains )
+      {
+        contains = contains_rec( ntk.get_node( f ), root );
+      }
+    } );
+    return contains;
+  }
+
+private:
+  Ntk& ntk;
+  RefactoringFn& refactoring_fn;
+  refactoring_params const& ps;
+  refactoring_stats& st;
+  NodeCostFn const& cost_fn;
+  cost_objective objective;
+  level_tracker<Ntk> levels;
+  windowed_dont_cares<Ntk>* dont_cares;
+
+  Ntk scratch;
+  std::vector<signal> scratch_pis;
+  std::vector<std::unordered_map<kitty::dynamic_truth_table, std::vector<signal>, kitty::hash<kitty::dynamic_truth_table>>> cache;
+  std::vector<signal> copies;
+  std::vector<uint32_t> copy_stamps;
+  uint32_t copy_stamp{0u};
+};
+
+} // namespace detail
+
+/*! \brief Refactoring with a cost objective
+
+  Like mockturtle's refactoring, the MFFC of each gate is collapsed into a
+  truth table and resynthesized.  In addition, replacements are ranked by a
+  cost objective (see `cost_objective`), such that a depth-aware cost function
+  rejects candidates that would increase the level of the replaced gate.
+  Levels are computed once and then extended to new nodes as candidates are
+  created.  The network is not cleaned up.
+
+  If `dont_cares` is given and the resynthesis function has a don't-care
+  overload (see `dont_care_resynthesis`), the don't cares of the MFFC leaves
+  are passed to the resynthesis function.  Otherwise, and if
+  `ps.cache_resynthesis` is set, the resynthesis function is called once per
+  MFFC function in a run, and its candidates are copied for later MFFCs with
+  the same function.
+*/
+template<class Ntk, class RefactoringFn, class NodeCostFn = unit_cost<Ntk>>
+void refactoring( Ntk& ntk, RefactoringFn&& refactoring_fn, refactoring_params const& ps = {}, refactoring_stats* pst = nullptr, NodeCostFn const& cost_fn = {}, windowed_dont_cares<Ntk>* dont_cares = nullptr )
+{
+  refactoring_stats st;
+  detail::refactoring_impl<Ntk, std::decay_t<RefactoringFn>, NodeCostFn> impl( ntk, refactoring_fn, ps, st, cost_fn, dont_cares );
+  impl.run();
+
+  if ( ps.verbose )
+  {
+    st.report();
+  }
+
+  if ( pst )
+  {
+    *pst = st;
+  }
+}
+
+} // namespace cirkit
@@ -0,0 +1,208 @@
+/* CirKit: A circuit toolkit
+ * Copyright (C) 2017-2019  EPFL
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "cancellation.hpp"
+
+namespace cirkit
+{
+
+/*! \brief Persistent pool of worker threads
+
+  The pool is meant to be kept by a command across runs, such that threads are
+  not created for every pass.  Work is distributed with `parallel_for`, in
+  which the calling thread participates as thread 0.  Workers adopt the
+  cancellation token of the caller, such that `is_cancelled()` behaves in
+  workers as in the command itself.
+*/
+class thread_pool
+{
+public:
+  explicit thread_pool( uint32_t num_threads = 1u )
+      : _num_threads( std::max( 1u, num_threads ) )
+  {
+    for ( auto tid = 1u; tid < _num_threads; ++tid )
+    {
+      workers.emplace_back( [this, tid]() { worker( tid ); } );
+    }
+  }
+
+  ~thread_pool()
+  {
+    {
+      std::lock_guard<std::mutex> lock( mutex );
+      stop = true;
+    }
+    cv_start.notify_all();
+    for ( auto& w : workers )
+    {
+      w.join();
+    }
+  }
+
+  thread_pool( thread_pool const& ) = delete;
+  thread_pool& operator=( thread_pool const& ) = delete;
+
+  uint32_t num_threads() const
+  {
+    return _num_threads;
+  }
+
+  /*! \brief Calls `fn( i, tid )` for all `i` in `[begin, end)`
+
+    Indexes are handed out in small chunks.  The call returns when all indexes
+    have been processed; the first exception thrown by `fn` is rethrown.
+  */
+  template<class Fn>
+  void parallel_for( uint32_t begin, uint32_t end, Fn&& fn )
+  {
+    if ( begin >= end )
+    {
+      return;
+    }
+
+    if ( _num_threads == 1u || end - begin == 1u )
+    {
+      for ( auto i = begin; i < end; ++i )
+      {
+        fn( i, 0u );
+      }
+      return;
+    }
+
+    const auto chunk = std::max( 1u, ( end - begin ) / ( 8u * _num_threads ) );
+    std::atomic<uint32_t> next{begin};
+    std::exception_ptr error;
+    std::mutex error_mutex;
+
+    const auto run = [&]( uint32_t tid ) {
+      try
+      {
+        while ( true )
+        {
+          const auto first = next.fetch_add( chunk );
+          if ( first >= end )
+          {
+            break;
+          }
+          const auto last = std::min( end, first + chunk );
+          for ( auto i = first; i < last; ++i )
+          {
+            fn( i, tid );
+          }
+        }
+      }
+      catch ( ... )
+      {
+        std::lock_guard<std::mutex> lock( error_mutex );
+        if ( !error )
+        {
+          error = std::current_exception();
+        }
+        next = end;
+      }
+    };
+
+    {
+      std::lock_guard<std::mutex> lock( mutex );
+      job = run;
+      token = cancellation_token::current();
+      pending = _num_threads - 1u;
+      ++generation;
+    }
+    cv_start.notify_all();
+
+    run( 0u );
+
+    {
+      std::unique_lock<std::mutex> lock( mutex );
+      cv_done.wait( lock, [this]() { return pending == 0u; } );
+      job = nullptr;
+    }
+
+    if ( error )
+    {
+      std::rethrow_exception( error );
+    }
+  }
+
+private:
+  void worker( uint32_t tid )
+  {
+    uint64_t seen{0u};
+    while ( true )
+    {
+      std::function<void( uint32_t )> current_job;
+      cancellation_token* current_token;
+      {
+        std::unique_lock<std::mutex> lock( mutex );
+        cv_start.wait( lock, [&]() { return stop || generation != seen; } );
+        if ( stop )
+        {
+          return;
+        }
+        seen = generation;
+        current_job = job;
+        current_token = token;
+      }
+
+      {
+        cancellation_token::adopt adopt( current_token );
+        current_job( tid );
+      }
+
+      {
+        std::lock_guard<std::mutex> lock( mutex );
+        --pending;
+      }
+      cv_done.notify_one();
+    }
+  }
+
+private:
+  uint32_t _num_threads;
+  std::vector<std::thread> workers;
+
+  std::mutex mutex;
+  std::condition_variable cv_start, cv_done;
+  std::function<void( uint32_t )> job;
+  cancellation_token* token{nullptr};
+  uint32_t pending{0u};
+  uint64_t generation{0u};
+  bool stop{false};
+};
+
+} // namespace cirkit
@@ -32,7 +32,12 @@
 
 #pragma once
 
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <memory>
 #include <string>
+#include <tuple>
 #include <vector>
 
 #include <fmt/format.h>
@@ -119,6 +124,9 @@ struct alice_globals
   std::vector<std::pair<std::string, std::string>> command_names;
   std::vector<std::string> read_tags, write_tags;
   std::vector<std::string> read_names, write_names;
+#if defined ALICE_PYTHON
+  std::vector<std::tuple<std::string, std::string, detail::python_function>> python_functions;
+#endif
 };
 /*! \endcond */
 
@@ -165,31 +173,34 @@ struct insert_write_commands<CLI, Tuple, 0>
 };
 
 #if defined ALICE_PYTHON
-template<typename CLI, typename Tuple, std::size_t Index>
-struct make_special_write_commands
-{
-  make_special_write_commands( CLI& cli, py::module& m )
-  {
-    make_special_write_commands<CLI, Tuple, Index - 1> irc( cli, m );
-
-    auto const& tag = alice_globals::get().write_tags[Index - 1];
-    const auto name = fmt::format( "write_{}", tag );
-    auto const& cmd = cli.env->commands().at( name );
-    m.def( fmt::format( "to_{}", tag ).c_str(), [cmd, name]( py::kwargs kwargs ) -> py::str {
-      auto pargs = detail::make_args( name, kwargs );
-      pargs.push_back( "--log" );
-      cmd->run( pargs );
-      const auto log = cmd->log();
-      return py::str( log["contents"].template get<std::string>() );
-    } );
-  }
-};
+/*! \brief Adds a function to the Python module
 
-template<typename CLI, typename Tuple>
-struct make_special_write_commands<CLI, Tuple, 0>
-{
-  make_special_write_commands( CLI& cli, py::module& m ) {}
-};
+  Unlike commands, which return their log as a dictionary, such functions can
+  return arbitrary Python objects, e.g., NumPy arrays that are filled directly
+  from store elements.  The function is passed the environment and the keyword
+  arguments.  It is called with the GIL held and the session locked; the C++
+  part of its work should be wrapped in ``alice::detail::without_gil``, such
+  that other Python threads can run meanwhile.  Only available when compiling
+  with ``ALICE_PYTHON``.
+
+  The macro must be followed by a code block.
+
+  \param name Function name in the Python module
+  \param env Name of the environment variable in the code block
+  \param kwargs Name of the keyword arguments variable in the code block
+  \param doc Docstring of the function
+*/
+#define ALICE_ADD_PYTHON_FUNCTION(name, env, kwargs, doc) \
+py::object _alice_python_##name( const environment::ptr& env, py::kwargs kwargs ); \
+struct name##_python_function_init \
+{ \
+  name##_python_function_init() \
+  { \
+    alice_globals::get().python_functions.emplace_back( #name, doc, _alice_python_##name ); \
+  } \
+}; \
+name##_python_function_init _##name##_python_function_init; \
+py::object _alice_python_##name( const environment::ptr& env, py::kwargs kwargs )
 #endif
 
 /*! \brief Returns a one-line string to show when printing store contents
@@ -502,6 +513,17 @@ _ALICE_COMMAND_INIT(name, category) \
 _ALICE_ADD_TO_LIST(alice_commands, name##_command)
 
 /*! \cond PRIVATE */
+/* keeps the CLI factory, such that CLIs created by the factory can again create CLIs */
+template<typename CLI>
+struct make_cli_helper
+{
+  static std::function<std::shared_ptr<CLI>()>& get()
+  {
+    static std::function<std::shared_ptr<CLI>()> factory;
+    return factory;
+  }
+};
+
 #define ALICE_INIT \
 _ALICE_START_LIST( alice_stores ) \
 _ALICE_START_LIST( alice_commands ) \
@@ -516,11 +538,17 @@ _ALICE_START_LIST( alice_write_tags )
   _ALICE_END_LIST( alice_write_tags ) \
   \
   using cli_t = tuple_to_cli<alice_stores>::type; \
-  cli_t cli( #prefix ); \
-  \
-  insert_read_commands<cli_t, alice_read_tags, std::tuple_size<alice_read_tags>::value> irc( cli ); \
-  insert_write_commands<cli_t, alice_write_tags, std::tuple_size<alice_write_tags>::value> iwc( cli ); \
-  insert_commands<cli_t, alice_commands, std::tuple_size<alice_commands>::value> ic( cli );
+  const auto make_cli = []() { \
+    auto cli = std::make_shared<cli_t>( #prefix ); \
+    insert_read_commands<cli_t, alice_read_tags, std::tuple_size<alice_read_tags>::value> irc( *cli ); \
+    insert_write_commands<cli_t, alice_write_tags, std::tuple_size<alice_write_tags>::value> iwc( *cli ); \
+    insert_commands<cli_t, alice_commands, std::tuple_size<alice_commands>::value> ic( *cli ); \
+    cli->set_factory( make_cli_helper<cli_t>::get() ); \
+    return cli; \
+  }; \
+  make_cli_helper<cli_t>::get() = make_cli; \
+  auto cli_p = make_cli(); \
+  auto& cli = *cli_p;
 /*! \endcond */
 
 #if defined ALICE_PYTHON
@@ -528,8 +556,7 @@ _ALICE_START_LIST( alice_write_tags )
 PYBIND11_MODULE(prefix, m) \
 { \
   _ALICE_MAIN_BODY(prefix) \
-  alice::detail::create_python_module( cli, m ); \
-  make_special_write_commands<cli_t, alice_write_tags, std::tuple_size<alice_write_tags>::value> swc( cli, m ); \
+  alice::detail::create_python_module<cli_t>( cli_p, m, make_cli, alice_globals::get().write_tags, alice_globals::get().python_functions ); \
 }
 #elif defined ALICE_CINTERFACE
 #ifdef _MSC_VER
@@ -562,23 +589,37 @@ extern "C" { \
   \
   DLLEXPORT int prefix##_command( void* p, const char *cmd, char* log, size_t size ) { \
     auto cli = reinterpret_cast<cli_t*>( p ); \
-    auto vline = detail::split_with_quotes<' '>( cmd ); \
-    const auto it = cli->env->commands().find( vline.front() ); \
-    if ( it != cli->env->commands().end() ) \
+    if ( !cli->execute_command_line( cmd ) ) \
+    { \
+      return -1; \
+    } \
+    const auto& json = cli->last_command_log(); \
+    if ( log && size && !json.is_null() ) { \
+      const auto dump = json.dump(); \
+      strncpy( log, dump.c_str(), size ); \
+      log[size - 1] = '\0'; \
+      return dump.size() + 1; \
+    } \
+    return 0; \
+  } \
+  \
+  /* size-query-then-copy access to the log of the last command: returns the \
+     required buffer size (incl. terminating zero, 0 if there is no log) and \
+     copies the log only if the buffer is large enough */ \
+  DLLEXPORT size_t prefix##_log( void* p, char* log, size_t size ) { \
+    auto cli = reinterpret_cast<cli_t*>( p ); \
+    const auto& json = cli->last_command_log(); \
+    if ( json.is_null() ) \
+    { \
+      return 0; \
+    } \
+    const auto dump = json.dump(); \
+    if ( log && size > dump.size() ) \
     { \
-      const auto result = it->second->run( vline ); \
-      if ( result ) \
-      { \
-        const auto json = it->second->log(); \
-        if ( log && !json.is_null() ) { \
-          const auto dump = json.dump(); \
-          strncpy( log, dump.c_str(), size ); \
-          return dump.size() + 1; \
-        } \
-        return 0; \
-      } \
+      std::copy( dump.begin(), dump.end(), log ); \
+      log[dump.size()] = '\0'; \
     } \
-    return -1; \
+    return dump.size() + 1; \
   } \
 }
 #else
@@ -32,11 +32,18 @@
 
 #pragma once
 
+#include <algorithm>
+#include <atomic>
 #include <chrono>
 #include <fstream>
+#include <functional>
 #include <memory>
+#include <mutex>
 #include <regex>
+#include <sstream>
 #include <string>
+#include <thread>
+#include <unordered_map>
 #include <vector>
 
 #include <CLI11.hpp>
@@ -44,6 +51,7 @@
 
 #include "command.hpp"
 #include "detail/logging.hpp"
+#include "detail/server.hpp"
 #include "readline.hpp"
 
 #include "commands/alias.hpp"
@@ -91,6 +99,8 @@ public:
     /* for each type in S ... */
     []( ... ) {}( ( env->add_store<S>(), 0 )... );
 
+    env->_execute = [this]( const std::string& line ) { return execute_command_line( line ); };
+
     set_category( "General" );
     insert_command( "alias", std::make_shared<alias_command>( env ) );
     insert_command( "help", std::make_shared<help_command>( env ) );
@@ -113,6 +123,34 @@ public:
     opts->add_flag( "-n,--counter", "show a counter in the prefix" );
     opts->add_flag( "-i,--interactive", "continue in interactive mode after processing commands (in command or file mode)" );
     opts->add_option( "-l,--log", logname, "logs the execution and stores many statistical information" );
+    opts->add_option( "--trace", tracename, "writes a timeline of all commands in Chrome trace-event format" );
+    opts->add_option( "--serve", socketname, "serves command lines over a Unix domain socket (after processing commands)" );
+  }
+
+  /*! \brief Sets a factory for new CLI instances
+
+    The factory creates a CLI with the same stores and commands as this one.
+    It is used to create independent sessions, e.g., in server mode.  The
+    macro :c:macro:`ALICE_MAIN` sets the factory automatically.
+
+    \param _factory Function that returns a new CLI instance
+  */
+  void set_factory( const std::function<std::shared_ptr<cli>()>& _factory )
+  {
+    factory = _factory;
+
+    if ( factory )
+    {
+      env->_spawn = [_factory]() {
+        /* the environment pointer shares ownership with the new CLI */
+        const auto shell = _factory();
+        return environment::ptr( shell, shell->env.get() );
+      };
+    }
+    else
+    {
+      env->_spawn = nullptr;
+    }
   }
 
   /*! \brief Sets the current category
@@ -181,6 +219,29 @@ public:
     insert_command( name, std::make_shared<write_io_command<Tag, S...>>( env, label ) );
   }
 
+  /*! \brief Executes a single command line
+
+    Aliases are expanded.  The log of the last executed command is kept and can
+    be accessed with ``last_command_log()``.  This function is used when alice
+    is embedded, e.g., from the C interface.
+
+    \param line Command line
+    \return True, if the command could be executed
+  */
+  bool execute_command_line( const std::string& line )
+  {
+    capture_log = true;
+    last_log = nullptr;
+    last_status.clear();
+    return execute_line( preprocess_alias( detail::trim_copy( line ) ) );
+  }
+
+  /*! \brief Returns the log of the last command executed with ``execute_command_line`` */
+  const nlohmann::json& last_command_log() const
+  {
+    return last_log;
+  }
+
   /*! \brief Runs the shell
 
     This function is only used if the CLI is used in stand-alone mode, not when
@@ -218,6 +279,12 @@ public:
       env->logger.start( logname );
     }
 
+    if ( opts->count( "--trace" ) )
+    {
+      env->trace = true;
+      env->tracer.start( tracename );
+    }
+
     if ( opts->count( "-c" ) )
     {
       auto split = detail::split_with_quotes<';'>( command );
@@ -253,6 +320,23 @@ public:
       }
     }
 
+    if ( opts->count( "--serve" ) )
+    {
+      const auto ret = serve( socketname );
+
+      if ( env->log )
+      {
+        env->logger.stop();
+      }
+
+      if ( env->trace )
+      {
+        env->tracer.stop();
+      }
+
+      return ret;
+    }
+
     if ( ( !opts->count( "-c" ) && !opts->count( "-f" ) ) || ( !env->quit && opts->count( "-i" ) ) )
     {
       auto& rl = readline_wrapper::instance();
@@ -271,6 +355,11 @@ public:
       env->logger.stop();
     }
 
+    if ( env->trace )
+    {
+      env->tracer.stop();
+    }
+
     return 0;
   }
 
@@ -339,11 +428,40 @@ private:
     if ( it != env->commands().end() )
     {
       const auto now = std::chrono::system_clock::now();
+      const auto trace_start = detail::tracer::clock::now();
       const auto result = it->second->run( vline );
 
+      if ( capture_log )
+      {
+        last_log = result ? it->second->log() : nullptr;
+        last_status = result ? it->second->status() : std::string();
+      }
+
       if ( result && env->log )
       {
-        env->logger.log( it->second->log(), line, now );
+        auto log = it->second->log();
+        if ( const auto status = it->second->status(); !status.empty() )
+        {
+          if ( !log.is_object() )
+          {
+            log = nlohmann::json::object();
+          }
+          log["status"] = status;
+        }
+        env->logger.log( log, line, now );
+      }
+
+      if ( env->trace )
+      {
+        const auto duration = detail::tracer::clock::now() - trace_start;
+        const auto phases = result ? it->second->phases() : std::vector<std::pair<std::string, double>>();
+        nlohmann::json args = {{"command", line}, {"success", result}};
+        for ( const auto& p : phases )
+        {
+          args["phases"][p.first] = p.second;
+        }
+        env->tracer.span( vline.front(), "command", trace_start, duration, args );
+        env->tracer.phases( phases, vline.front(), trace_start, duration );
       }
 
       return result;
@@ -394,6 +512,187 @@ private:
     return false;
   }
 
+  /* server mode: every client connection starts in a fresh session, the
+     line `:session <name>` attaches the connection to a named session, which
+     stays resident after the client disconnects, and `:shutdown` stops the
+     server.  Each other line is executed as a command line and answered with
+     a single line that contains a JSON object. */
+  struct server_session
+  {
+    std::shared_ptr<cli> shell;
+    std::mutex mutex;
+
+    nlohmann::json execute( const std::string& line )
+    {
+      std::lock_guard<std::mutex> lock( mutex );
+
+      std::ostringstream out, err;
+      shell->env->reroute( out, err );
+      shell->last_log = nullptr;
+      shell->last_status.clear();
+      const auto success = shell->execute_line( shell->preprocess_alias( line ) );
+      shell->env->reroute( std::cout, std::cerr );
+
+      nlohmann::json response = {{"success", success}, {"output", out.str()}, {"error", err.str()}, {"log", shell->last_log}};
+      if ( !shell->last_status.empty() )
+      {
+        response["status"] = shell->last_status;
+      }
+      return response;
+    }
+  };
+
+  std::shared_ptr<server_session> make_session()
+  {
+    auto session = std::make_shared<server_session>();
+    session->shell = factory();
+    session->shell->capture_log = true;
+
+    /* sessions inherit aliases and variables from the server */
+    std::lock_guard<std::mutex> lock( sessions_mutex );
+    session->shell->env->_aliases = env->_aliases;
+    session->shell->env->_variables = env->_variables;
+    return session;
+  }
+
+  int serve( const std::string& path )
+  {
+#ifdef _WIN32
+    env->err() << "[e] server mode is not supported on Windows" << std::endl;
+    return 1;
+#else
+    if ( !factory )
+    {
+      env->err() << "[e] server mode requires a CLI factory" << std::endl;
+      return 1;
+    }
+
+    detail::unix_socket_server server( path );
+    std::atomic<bool> stop{false};
+
+    if ( !server.good() )
+    {
+      env->err() << "[e] cannot listen on " << path << std::endl;
+      return 1;
+    }
+    env->out() << "[i] serving on " << path << std::endl;
+
+    /* client threads are joined before returning, since they use the sessions
+       of this CLI; open connections are shut down to unblock their reads */
+    struct client_thread
+    {
+      std::thread thread;
+      std::shared_ptr<std::atomic<bool>> done;
+    };
+    std::vector<client_thread> clients;
+    std::mutex clients_mutex;
+    std::vector<int> open_fds;
+
+    while ( !stop )
+    {
+      const auto fd = server.accept();
+      if ( fd < 0 )
+      {
+        break;
+      }
+
+      for ( auto it = clients.begin(); it != clients.end(); )
+      {
+        if ( *it->done )
+        {
+          it->thread.join();
+          it = clients.erase( it );
+        }
+        else
+        {
+          ++it;
+        }
+      }
+
+      {
+        std::lock_guard<std::mutex> lock( clients_mutex );
+        open_fds.push_back( fd );
+      }
+
+      auto done = std::make_shared<std::atomic<bool>>( false );
+      std::thread thread( [this, fd, done, &server, &stop, &clients_mutex, &open_fds]() {
+        auto session = make_session();
+        detail::socket_line_reader reader( fd );
+        std::string line;
+
+        while ( reader.read_line( line ) )
+        {
+          detail::trim( line );
+
+          nlohmann::json response;
+          if ( line.rfind( ":session ", 0 ) == 0 )
+          {
+            auto name = line.substr( 9u );
+            detail::trim( name );
+
+            std::unique_lock<std::mutex> lock( sessions_mutex );
+            auto it = sessions.find( name );
+            if ( it == sessions.end() )
+            {
+              lock.unlock();
+              auto named = make_session();
+              lock.lock();
+              it = sessions.emplace( name, named ).first;
+            }
+            session = it->second;
+            response = {{"success", true}, {"session", name}};
+          }
+          else if ( line == ":shutdown" )
+          {
+            stop = true;
+            server.shutdown();
+            detail::socket_write_line( fd, nlohmann::json( {{"success", true}} ).dump() );
+            break;
+          }
+          else
+          {
+            response = session->execute( line );
+          }
+
+          if ( !detail::socket_write_line( fd, response.dump() ) )
+          {
+            break;
+          }
+
+          /* quit closes the connection, named sessions stay alive */
+          if ( session->shell->env->quit )
+          {
+            session->shell->env->quit = false;
+            break;
+          }
+        }
+
+        {
+          std::lock_guard<std::mutex> lock( clients_mutex );
+          open_fds.erase( std::find( open_fds.begin(), open_fds.end(), fd ) );
+          ::close( fd );
+        }
+        *done = true;
+      } );
+      clients.push_back( {std::move( thread ), done} );
+    }
+
+    {
+      std::lock_guard<std::mutex> lock( clients_mutex );
+      for ( auto fd : open_fds )
+      {
+        ::shutdown( fd, SHUT_RDWR );
+      }
+    }
+    for ( auto& client : clients )
+    {
+      client.thread.join();
+    }
+
+    return 0;
+#endif
+  }
+
   std::string get_prefix()
   {
     std::string r = prefix;
@@ -456,7 +755,15 @@ private:
   std::shared_ptr<CLI::App> opts;
   std::string category;
 
-  std::string command, file, logname;
+  std::string command, file, logname, tracename, socketname;
+
+  std::function<std::shared_ptr<cli>()> factory;
+  bool capture_log{false};
+  nlohmann::json last_log;
+  std::string last_status;
+
+  std::mutex sessions_mutex;
+  std::unordered_map<std::string, std::shared_ptr<server_session>> sessions;
 
   unsigned counter{1u};
   /*! \endcond */
@@ -215,6 +215,33 @@ public:
     return ALICE_SETTINGS_WITH_DEFAULT_OPTION && _default_option == option;
   }
 
+  /*! \brief Creates an independent environment
+
+    The new environment has the same commands and store types as this one, but
+    empty stores.  It stays valid as long as the returned pointer is kept, and
+    can be used from another thread than this environment.  Commands can use
+    this to run other commands on parts of their data concurrently.
+
+    Returns ``nullptr``, if the shell was created without a factory (see
+    ``cli::set_factory``).
+  */
+  ptr spawn() const
+  {
+    return _spawn ? _spawn() : nullptr;
+  }
+
+  /*! \brief Executes a command line in this environment
+
+    Aliases are expanded.  Returns ``false``, if the command could not be
+    executed.
+
+    \param line Command line
+  */
+  bool execute( const std::string& line )
+  {
+    return _execute && _execute( line );
+  }
+
 private:
   /*! \brief Adds store to environment */
   template<typename T>
@@ -251,8 +278,13 @@ private:
   std::unordered_map<std::string, std::string> _variables;
   std::string _default_option;
 
+  std::function<ptr()> _spawn;
+  std::function<bool( const std::string& )> _execute;
+
   bool log{false};
   alice::detail::logger logger;
+  bool trace{false};
+  alice::detail::tracer tracer;
   bool quit{false};
 
   std::ostream* _out = &std::cout;
@@ -363,6 +395,29 @@ public:
   */
   virtual nlohmann::json log() const { return nullptr; }
 
+  /*! \brief Returns timings of algorithm phases
+
+    The phases are reported as pairs of names and run-times in seconds, in the
+    order in which they should be shown.  When tracing is enabled (option
+    ``--trace``), they are added to the arguments of the command span and
+    written as a counter track over the command span, since run-times are
+    usually accumulated over the whole execution and have no start time.
+    Commands should only return phases if the last execution ran the
+    algorithm.
+
+    By default, an empty vector is returned.
+  */
+  virtual std::vector<std::pair<std::string, double>> phases() const { return {}; }
+
+  /*! \brief Returns a status for the last execution
+
+    A command that did not complete its work (e.g., because it was interrupted)
+    can return a short status message, which is added as ``status`` to the
+    command's log entry.  An empty string means that the command completed
+    normally.
+  */
+  virtual std::string status() const { return {}; }
+
 public:
   /*! \brief Returns command short description */
   inline const auto& caption() const { return scaption; }
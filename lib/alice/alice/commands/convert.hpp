@@ -76,7 +76,7 @@ int convert_helper_inner( const environment::ptr& env, const command& cmd )
 
       if ( source_store.current_index() == -1 )
       {
-        std::cout << fmt::format( "[w] there is no {} to convert from", source_name ) << std::endl;
+        env->out() << fmt::format( "[w] there is no {} to convert from", source_name ) << std::endl;
         return 0;
       }
 
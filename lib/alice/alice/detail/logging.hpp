@@ -32,6 +32,7 @@
 
 #pragma once
 
+#include <algorithm>
 #include <chrono>
 #include <fstream>
 #include <iomanip>
@@ -84,5 +85,82 @@ private:
   nlohmann::json array = nlohmann::json::array();
 };
 
+/* writes spans in the Chrome trace-event format (chrome://tracing, Perfetto) */
+class tracer
+{
+public:
+  using clock = std::chrono::steady_clock;
+
+  void start( const std::string& filename )
+  {
+    _filename = filename;
+    _origin = clock::now();
+  }
+
+  void span( const std::string& name, const std::string& category, const clock::time_point& start, const clock::duration& duration, const nlohmann::json& args = nullptr )
+  {
+    nlohmann::json event = {
+        {"name", name},
+        {"cat", category},
+        {"ph", "X"},
+        {"ts", std::chrono::duration_cast<std::chrono::microseconds>( start - _origin ).count()},
+        {"dur", std::chrono::duration_cast<std::chrono::microseconds>( duration ).count()},
+        {"pid", 1},
+        {"tid", 1}};
+
+    if ( !args.is_null() )
+    {
+      event["args"] = args;
+    }
+
+    events.push_back( event );
+  }
+
+  /* phase timings are accumulated by the algorithms and have no position
+     inside the command span, therefore they are written as a counter track
+     that holds the run-times (in seconds) while the command runs */
+  void phases( const std::vector<std::pair<std::string, double>>& timings, const std::string& name, const clock::time_point& start, const clock::duration& total )
+  {
+    if ( timings.empty() )
+    {
+      return;
+    }
+
+    auto values = nlohmann::json::object();
+    auto zeros = nlohmann::json::object();
+    for ( const auto& p : timings )
+    {
+      values[p.first] = p.second;
+      zeros[p.first] = 0.0;
+    }
+
+    counter( name, start, values );
+    counter( name, start + total, zeros );
+  }
+
+  void stop()
+  {
+    std::ofstream os( _filename.c_str(), std::ofstream::out );
+    os << nlohmann::json( {{"traceEvents", events}, {"displayTimeUnit", "ms"}} );
+  }
+
+private:
+  void counter( const std::string& name, const clock::time_point& time, const nlohmann::json& values )
+  {
+    nlohmann::json event = {
+        {"name", name + " phases"},
+        {"ph", "C"},
+        {"ts", std::chrono::duration_cast<std::chrono::microseconds>( time - _origin ).count()},
+        {"pid", 1},
+        {"args", values}};
+
+    events.push_back( event );
+  }
+
+  std::string _filename;
+  clock::time_point _origin;
+  nlohmann::json events = nlohmann::json::array();
+};
+
 }
 }
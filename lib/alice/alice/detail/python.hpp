@@ -34,7 +34,12 @@
 
 #if defined ALICE_PYTHON
 
+#include <functional>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <tuple>
+#include <vector>
 
 #include <fmt/format.h>
 #include <pybind11/pybind11.h>
@@ -205,9 +210,96 @@ inline std::vector<std::string> make_args( const std::string& name, py::kwargs k
   return pargs;
 }
 
+/* functions added with ALICE_ADD_PYTHON_FUNCTION */
+using python_function = std::function<py::object( const environment::ptr&, py::kwargs )>;
+
+/* runs fn without holding the GIL; fn must not create or access Python
+   objects, such functions convert their arguments before and their result
+   after calling it */
+template<typename Fn>
+decltype( auto ) without_gil( Fn&& fn )
+{
+  py::gil_scoped_release release;
+  return fn();
+}
+
+/* A shell instance that is accessed from Python
+
+   Commands are executed without holding the GIL, such that several sessions
+   can run in parallel from Python threads.  The session mutex serializes
+   accesses to the same session; it is never waited for while holding the GIL,
+   since the thread that owns the session may need the GIL to return. */
 template<typename CLI>
-void create_python_module( CLI& cli, py::module& m )
+class python_session
 {
+public:
+  explicit python_session( const std::shared_ptr<CLI>& shell ) : shell( shell ) {}
+
+  py::object execute( const std::string& name, py::kwargs kwargs )
+  {
+    const auto pargs = make_args( name, kwargs );
+    const auto& cmd = shell->env->commands().at( name );
+
+    nlohmann::json log;
+    {
+      py::gil_scoped_release release;
+      std::lock_guard<std::mutex> guard( mutex );
+      cmd->run( pargs );
+      log = cmd->log();
+    }
+
+    if ( log.is_object() )
+    {
+      return py::cast( return_value_dict( log ) );
+    }
+    else
+    {
+      return py::none();
+    }
+  }
+
+  py::object write_to_string( const std::string& name, py::kwargs kwargs )
+  {
+    auto pargs = make_args( name, kwargs );
+    pargs.push_back( "--log" );
+    const auto& cmd = shell->env->commands().at( name );
+
+    std::string contents;
+    {
+      py::gil_scoped_release release;
+      std::lock_guard<std::mutex> guard( mutex );
+      cmd->run( pargs );
+      contents = cmd->log()["contents"].template get<std::string>();
+    }
+    return py::str( contents );
+  }
+
+  /* fn is called with the GIL held, it releases it around its C++ work
+     with without_gil; the session stays locked until fn returns */
+  py::object call( const python_function& fn, py::kwargs kwargs )
+  {
+    std::unique_lock<std::mutex> lock( mutex, std::defer_lock );
+    {
+      py::gil_scoped_release release;
+      lock.lock();
+    }
+    return fn( shell->env, kwargs );
+  }
+
+private:
+  std::shared_ptr<CLI> shell;
+  std::mutex mutex;
+};
+
+/* Adds commands, to_<tag> functions for all write tags, and additional
+   functions to the module (operating on the module's shell) and as methods to
+   the Session class (operating on a fresh shell created by the factory) */
+template<typename CLI>
+void create_python_module( const std::shared_ptr<CLI>& cli, py::module& m, const std::function<std::shared_ptr<CLI>()>& factory,
+                           const std::vector<std::string>& write_tags, const std::vector<std::tuple<std::string, std::string, python_function>>& functions )
+{
+  using session_t = python_session<CLI>;
+
   m.doc() = "Python bindings";
 
   py::class_<return_value_dict> representer( m, "ReturnValueDict" );
@@ -217,23 +309,41 @@ void create_python_module( CLI& cli, py::module& m )
       .def( "_repr_html_", &return_value_dict::_repr_html_ )
       .def( "dict", &return_value_dict::dict );
 
-  for ( const auto& p : cli.env->commands() )
-  {
-    m.def( p.first.c_str(), [p]( py::kwargs kwargs ) -> py::object {
-      p.second->run( make_args( p.first, kwargs ) );
+  py::class_<session_t, std::shared_ptr<session_t>> session_class( m, "Session", "Independent session with its own stores" );
+  session_class.def( py::init( [factory]() { return std::make_shared<session_t>( factory() ); } ) );
 
-      const auto log = p.second->log();
+  const auto default_session = std::make_shared<session_t>( cli );
 
-      if ( log.is_object() )
-      {
-        return py::cast( return_value_dict( log ) );
-      }
-      else
-      {
-        return py::none();
-      }
+  const auto add_function = [&]( const std::string& name, const std::string& doc, auto fn ) {
+    m.def( name.c_str(), [default_session, fn]( py::kwargs kwargs ) -> py::object {
+      return fn( *default_session, kwargs );
     },
-           p.second->caption().c_str() );
+           doc.c_str() );
+    session_class.def( name.c_str(), [fn]( session_t& session, py::kwargs kwargs ) -> py::object {
+      return fn( session, kwargs );
+    },
+                       doc.c_str() );
+  };
+
+  for ( const auto& p : cli->env->commands() )
+  {
+    add_function( p.first, p.second->caption(), [name = p.first]( session_t& session, py::kwargs kwargs ) {
+      return session.execute( name, kwargs );
+    } );
+  }
+
+  for ( const auto& tag : write_tags )
+  {
+    add_function( fmt::format( "to_{}", tag ), fmt::format( "Returns the output of write_{} as string", tag ), [name = fmt::format( "write_{}", tag )]( session_t& session, py::kwargs kwargs ) {
+      return session.write_to_string( name, kwargs );
+    } );
+  }
+
+  for ( const auto& [name, doc, fn] : functions )
+  {
+    add_function( name, doc, [fn = fn]( session_t& session, py::kwargs kwargs ) {
+      return session.call( fn, kwargs );
+    } );
   }
 }
 }
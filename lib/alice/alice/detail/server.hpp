@@ -0,0 +1,221 @@
+/* alice: C++ command shell library
+ * Copyright (C) 2017-2018  EPFL
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+  \file server.hpp
+  \brief Unix domain socket helpers for server mode
+
+  \author Mathias Soeken
+*/
+
+#pragma once
+
+#ifndef _WIN32
+
+#include <cerrno>
+#include <cstring>
+#include <string>
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace alice
+{
+
+namespace detail
+{
+
+class unix_socket_server
+{
+public:
+  explicit unix_socket_server( const std::string& path ) : path( path )
+  {
+    sockaddr_un addr{};
+    if ( path.size() >= sizeof( addr.sun_path ) )
+    {
+      return;
+    }
+
+    fd = ::socket( AF_UNIX, SOCK_STREAM, 0 );
+    if ( fd < 0 )
+    {
+      return;
+    }
+
+    /* writing to the pipe wakes up a pending accept */
+    if ( ::pipe( wakeup ) < 0 )
+    {
+      ::close( fd );
+      fd = -1;
+      return;
+    }
+
+    addr.sun_family = AF_UNIX;
+    std::strncpy( addr.sun_path, path.c_str(), sizeof( addr.sun_path ) - 1 );
+    ::unlink( path.c_str() );
+
+    if ( ::bind( fd, reinterpret_cast<sockaddr*>( &addr ), sizeof( addr ) ) < 0 || ::listen( fd, SOMAXCONN ) < 0 )
+    {
+      ::close( fd );
+      fd = -1;
+    }
+  }
+
+  ~unix_socket_server()
+  {
+    if ( fd >= 0 )
+    {
+      ::close( fd );
+      ::close( wakeup[0] );
+      ::close( wakeup[1] );
+      ::unlink( path.c_str() );
+    }
+  }
+
+  bool good() const
+  {
+    return fd >= 0;
+  }
+
+  /* returns client file descriptor, or -1 on error or after shutdown */
+  int accept()
+  {
+    while ( true )
+    {
+      pollfd fds[2] = {{fd, POLLIN, 0}, {wakeup[0], POLLIN, 0}};
+      if ( ::poll( fds, 2, -1 ) < 0 )
+      {
+        if ( errno == EINTR )
+        {
+          continue;
+        }
+        return -1;
+      }
+
+      if ( fds[1].revents != 0 )
+      {
+        return -1;
+      }
+
+      const auto client = ::accept( fd, nullptr, nullptr );
+      if ( client < 0 && ( errno == EINTR || errno == ECONNABORTED ) )
+      {
+        continue;
+      }
+      return client;
+    }
+  }
+
+  /* unblocks a pending accept, all later calls to accept return -1; this is
+     called from client threads */
+  void shutdown()
+  {
+    const char c = 0;
+    while ( ::write( wakeup[1], &c, 1 ) < 0 && errno == EINTR )
+    {
+    }
+  }
+
+private:
+  std::string path;
+  int fd{-1};
+  int wakeup[2] = {-1, -1};
+};
+
+/* reads newline-terminated lines from a socket */
+class socket_line_reader
+{
+public:
+  explicit socket_line_reader( int fd ) : fd( fd ) {}
+
+  bool read_line( std::string& line )
+  {
+    while ( true )
+    {
+      if ( const auto pos = buffer.find( '\n' ); pos != std::string::npos )
+      {
+        line = buffer.substr( 0, pos );
+        buffer.erase( 0, pos + 1 );
+        return true;
+      }
+
+      char chunk[4096];
+      const auto n = ::recv( fd, chunk, sizeof( chunk ), 0 );
+      if ( n < 0 && errno == EINTR )
+      {
+        continue;
+      }
+      if ( n <= 0 )
+      {
+        /* last line without newline */
+        if ( !buffer.empty() )
+        {
+          line.swap( buffer );
+          buffer.clear();
+          return true;
+        }
+        return false;
+      }
+      buffer.append( chunk, n );
+    }
+  }
+
+private:
+  int fd;
+  std::string buffer;
+};
+
+inline bool socket_write_line( int fd, const std::string& line )
+{
+#ifdef MSG_NOSIGNAL
+  constexpr int flags = MSG_NOSIGNAL;
+#else
+  constexpr int flags = 0;
+#endif
+
+  const auto data = line + "\n";
+  std::size_t sent = 0u;
+  while ( sent < data.size() )
+  {
+    const auto n = ::send( fd, data.data() + sent, data.size() - sent, flags );
+    if ( n < 0 && errno == EINTR )
+    {
+      continue;
+    }
+    if ( n <= 0 )
+    {
+      return false;
+    }
+    sent += n;
+  }
+  return true;
+}
+
+} // namespace detail
+} // namespace alice
+
+#endif